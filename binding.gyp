@@ -12,6 +12,12 @@
 			'sources': [
 				'./src/main.cc',
 				'./src/mbus-master.cc',
+				'./src/mbus-data.cc',
+				'./src/bus-thread.cc',
+				'./src/reactor.cc',
+				'./src/readout-job.cc',
+				'./src/job-control.cc',
+				'./src/frame-decoder.cc',
 				'./src/util.cc'
 			],
             'conditions': [
@@ -41,6 +47,7 @@
 				'./libmbus/mbus/mbus-protocol.c',
 				'./libmbus/mbus/mbus-serial.c',
 				'./libmbus/mbus/mbus-tcp.c',
+				'./libmbus/mbus/mbus-transaction.c',
 				'./libmbus/mbus/mbus.c'
 			],
             'conditions': [
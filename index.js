@@ -6,6 +6,7 @@
 
 var mbusBinding = require('bindings')('mbus');
 var xmlParser = require('xml2js');
+var EventEmitter = require('events');
 
 const MAXFRAMES = 16;
 
@@ -14,13 +15,26 @@ function MbusMaster(options) {
     this.mbusMaster = new mbusBinding.MbusMaster();
 }
 
-MbusMaster.prototype.connect = function connect(callback) {
-    if (this.mbusMaster.connected && this.mbusMaster.communicationInProgress) {
-        if (callback) {
-            callback(new Error('Communication already in progress'));
-        }
-        return false;
+const PURGE_POLICIES = {full: 0, fast: 1, skip: 2};
+
+// bus options of an opened connection
+function setBusOptions(self) {
+    // learn the response time of every address, adaptiveTimeout: true or {min, max} in ms
+    var adaptive = self.options.adaptiveTimeout;
+    if (adaptive) {
+        var min = (typeof adaptive.min === 'number') ? adaptive.min : 50;
+        var max = (typeof adaptive.max === 'number') ? adaptive.max : (self.options.timeout || 4000);
+        self.mbusMaster.setAdaptiveTimeout(min, max);
     }
+    if (self.options.purge && PURGE_POLICIES[self.options.purge] !== undefined) {
+        var purgeWindow = (typeof self.options.purgeWindow === 'number') ? self.options.purgeWindow : -1;
+        self.mbusMaster.setPurgePolicy(PURGE_POLICIES[self.options.purge], purgeWindow);
+    }
+}
+
+MbusMaster.prototype.connect = function connect(callback) {
+    // requests while communication is in progress are queued by the bus
+    // thread (or the reactor) and executed one after the other
     if (this.mbusMaster.connected) {
         if (callback) {
             callback(null);
@@ -29,7 +43,8 @@ MbusMaster.prototype.connect = function connect(callback) {
     }
     if (this.options.host && this.options.port) {
         if (!this.options.timeout) this.options.timeout = 0;
-        if (this.mbusMaster.openTCP(this.options.host, this.options.port, this.options.timeout/1000)) {
+        if (this.mbusMaster.openTCP(this.options.host, this.options.port, this.options.timeout/1000, !!this.options.reactor, (this.options.connectTimeout || 0)/1000)) {
+            setBusOptions(this);
             if (callback) {
                 callback(null);
             }
@@ -44,7 +59,11 @@ MbusMaster.prototype.connect = function connect(callback) {
     }
     else if (this.options.serialPort) {
         var baudRate = this.options.serialBaudRate || 0;
-        if (this.mbusMaster.openSerial(this.options.serialPort, baudRate)) {
+        var timing = function(value) {
+            return (typeof value === 'number' && value >= 0) ? value : -1;
+        };
+        if (this.mbusMaster.openSerial(this.options.serialPort, baudRate, timing(this.options.serialFirstByteTimeout), timing(this.options.serialInterByteTimeout), timing(this.options.serialTurnaroundTime))) {
+            setBusOptions(this);
             if (callback) {
                 callback(null);
             }
@@ -103,11 +122,91 @@ MbusMaster.prototype.close = function close(callback, wait) {
     }
 };
 
-MbusMaster.prototype.getData = function getData(address, callback, max_frames = MAXFRAMES) {
+function dataFormat(options) {
+    var format = options.dataFormat;
+    if (format !== 'xml' && format !== 'object') format = 'json';
+    return format;
+}
+
+// convert the data of one slave as delivered by the native library
+function convertData(format, data, callback) {
+    if (format === 'object') {
+        callback(null, data);
+        return;
+    }
+    if (format === 'json') {
+        var err = null;
+        try {
+            data = JSON.parse(data);
+        }
+        catch (e) {
+            err = new Error(e + ': ' + data);
+            data = null;
+        }
+        callback(err, data);
+        return;
+    }
+    var parserOpt =  {
+        explicitArray: false,
+        mergeAttrs: true,
+        valueProcessors: [xmlParser.processors.parseNumbers],
+        attrValueProcessors: [xmlParser.processors.parseNumbers]
+    };
+    xmlParser.parseString(data, parserOpt, function (err, result) {
+        if (!err && result && result.MBusData) {
+            result = result.MBusData;
+            if (result.DataRecord && !Array.isArray(result.DataRecord)) {
+                result.DataRecord = [result.DataRecord];
+            }
+        }
+        callback(err, result);
+    });
+}
+
+function abortError() {
+    var err = new Error('The operation was aborted');
+    err.name = 'AbortError';
+    return err;
+}
+
+// start a native job that can be cancelled by an AbortSignal, start gets the
+// release function that removes the abort listener again and returns the job
+// id; the native methods may call back (and release) before the id is known
+function abortable(mbusMaster, signal, start) {
+    var id;
+    var released = false;
+    var onAbort = function() {
+        if (id) mbusMaster.abort(id);
+    };
+    var release = function() {
+        released = true;
+        if (signal) signal.removeEventListener('abort', onAbort);
+    };
+    if (signal) signal.addEventListener('abort', onAbort);
+    id = start(release);
+    if (released) id = undefined;
+}
+
+MbusMaster.prototype.getData = function getData(address, callback, options) {
+    if (typeof options !== 'object' || options === null) {
+        options = {maxFrames: options};
+    }
+    var max_frames = options.maxFrames || MAXFRAMES;
+    var signal = options.signal;
+    var records = options.records;
+    var storage = (typeof options.storage === 'number' && options.storage >= 0) ? options.storage : undefined;
+    var globalReadout = !!options.globalReadout;
     if (!this.mbusMaster.connected && !this.options.autoConnect) {
         if (callback) callback(new Error('Not connected and autoConnect is false'));
         return;
     }
+    if (signal && signal.aborted) {
+        if (callback) callback(abortError());
+        return;
+    }
+    if (typeof records === 'string') {
+        records = Buffer.from(records.replace(/\s/g, ''), 'hex');
+    }
 
     var self = this;
     this.connect(function(err) {
@@ -115,22 +214,15 @@ MbusMaster.prototype.getData = function getData(address, callback, max_frames =
             if (callback) callback(err);
             return;
         }
-        self.mbusMaster.get(address, max_frames, function(err, data) {
+        var format = dataFormat(self.options);
+        abortable(self.mbusMaster, signal, (release) => self.mbusMaster.get(address, max_frames, format, function(err, data) {
+            release();
+            if (err && signal && signal.aborted) {
+                if (callback) callback(abortError());
+                return;
+            }
             if (!err && data) {
-                //data = JSON.parse(data).MBusData;
-                var parserOpt =  {
-                    explicitArray: false,
-                    mergeAttrs: true,
-                    valueProcessors: [xmlParser.processors.parseNumbers],
-                    attrValueProcessors: [xmlParser.processors.parseNumbers]
-                };
-                xmlParser.parseString(data, parserOpt, function (err, result) {
-                    if (!err && result && result.MBusData) {
-                        result = result.MBusData;
-                        if (result.DataRecord && !Array.isArray(result.DataRecord)) {
-                            result.DataRecord = [result.DataRecord];
-                        }
-                    }
+                convertData(format, data, function(err, result) {
                     if (callback) callback(err, result);
                 });
                 return;
@@ -139,15 +231,25 @@ MbusMaster.prototype.getData = function getData(address, callback, max_frames =
                 err = new Error(err);
             }
             if (callback) callback(err, data);
-        });
+        }, records, storage, globalReadout));
     });
 };
 
-MbusMaster.prototype.scanSecondary = function scanSecondary(callback) {
+MbusMaster.prototype.getRaw = function getRaw(address, options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = {};
+    }
+    options = options || {};
+    var signal = options.signal;
     if (!this.mbusMaster.connected && !this.options.autoConnect) {
         if (callback) callback(new Error('Not connected and autoConnect is false'));
         return;
     }
+    if (signal && signal.aborted) {
+        if (callback) callback(abortError());
+        return;
+    }
 
     var self = this;
     this.connect(function(err) {
@@ -155,7 +257,166 @@ MbusMaster.prototype.scanSecondary = function scanSecondary(callback) {
             if (callback) callback(err);
             return;
         }
-        self.mbusMaster.scan(function(err, data) {
+        var max_frames = options.maxFrames || MAXFRAMES;
+        abortable(self.mbusMaster, signal, (release) => self.mbusMaster.getRaw(String(address), max_frames, function(err, frames) {
+            release();
+            if (err && signal && signal.aborted) {
+                err = abortError();
+            }
+            else if (err) {
+                err = new Error(err);
+            }
+            if (callback) callback(err, frames);
+        }));
+    });
+};
+
+MbusMaster.prototype.getDataMany = function getDataMany(addresses, options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = {};
+    }
+    options = options || {};
+    var signal = options.signal;
+    if (!this.mbusMaster.connected && !this.options.autoConnect) {
+        if (callback) callback(new Error('Not connected and autoConnect is false'));
+        return;
+    }
+    if (signal && signal.aborted) {
+        if (callback) callback(abortError());
+        return;
+    }
+
+    var self = this;
+    this.connect(function(err) {
+        if (err) {
+            if (callback) callback(err);
+            return;
+        }
+        var format = dataFormat(self.options);
+        var max_frames = options.maxFrames || MAXFRAMES;
+        var onResult;
+        if (options.onResult) {
+            onResult = function(err, address, data) {
+                if (err) {
+                    options.onResult(err, address);
+                    return;
+                }
+                convertData(format, data, function(err, result) {
+                    options.onResult(err, address, result);
+                });
+            };
+        }
+        abortable(self.mbusMaster, signal, (release) => self.mbusMaster.getMany(addresses.map(String), max_frames, format, onResult, function(err, list) {
+            release();
+            if (err && signal && signal.aborted) {
+                if (callback) callback(abortError());
+                return;
+            }
+            if (err) {
+                if (callback) callback(new Error(err));
+                return;
+            }
+            if (!list) {
+                if (callback) callback(null);
+                return;
+            }
+            var results = [];
+            var open = list.length + 1;
+            var done = function() {
+                if (--open === 0 && callback) callback(null, results);
+            };
+            list.forEach(function(entry, i) {
+                if (entry.error !== undefined) {
+                    results[i] = {address: entry.address, err: new Error(entry.error)};
+                    done();
+                    return;
+                }
+                convertData(format, entry.data, function(err, result) {
+                    results[i] = {address: entry.address, err: err, data: result};
+                    done();
+                });
+            });
+            done();
+        }));
+    });
+};
+
+MbusMaster.prototype.getDataStream = function getDataStream(address, options) {
+    options = options || {};
+    var signal = options.signal;
+    var emitter = new EventEmitter();
+    var self = this;
+
+    var finish = function(err) {
+        if (err) emitter.emit('error', err);
+        emitter.emit('end');
+    };
+
+    if (!this.mbusMaster.connected && !this.options.autoConnect) {
+        process.nextTick(finish, new Error('Not connected and autoConnect is false'));
+        return emitter;
+    }
+    if (signal && signal.aborted) {
+        process.nextTick(finish, abortError());
+        return emitter;
+    }
+
+    this.connect(function(err) {
+        if (err) {
+            process.nextTick(finish, err);
+            return;
+        }
+        var format = dataFormat(self.options);
+        var max_frames = options.maxFrames || MAXFRAMES;
+        abortable(self.mbusMaster, signal, (release) => self.mbusMaster.getStream(String(address), max_frames, format, function(data, index) {
+            convertData(format, data, function(err, result) {
+                if (err) {
+                    emitter.emit('error', err);
+                    return;
+                }
+                emitter.emit('frame', result, index);
+            });
+        }, function(err) {
+            release();
+            if (err && signal && signal.aborted) {
+                finish(abortError());
+                return;
+            }
+            finish(err ? new Error(err) : null);
+        }));
+    });
+    return emitter;
+};
+
+MbusMaster.prototype.scanSecondary = function scanSecondary(options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = {};
+    }
+    options = options || {};
+    var signal = options.signal;
+    if (!this.mbusMaster.connected && !this.options.autoConnect) {
+        if (callback) callback(new Error('Not connected and autoConnect is false'));
+        return;
+    }
+    if (signal && signal.aborted) {
+        if (callback) callback(abortError());
+        return;
+    }
+
+    var self = this;
+    this.connect(function(err) {
+        if (err) {
+            if (callback) callback(err);
+            return;
+        }
+        abortable(self.mbusMaster, signal, (release) => self.mbusMaster.scan(options.onProgress, options.onFound, function(err, data) {
+            release();
+            if (err && signal && signal.aborted) {
+                if (callback) callback(abortError());
+                return;
+            }
             if (!err && data !== null && data !== undefined && typeof data === 'string' ) {
                 if (data === '') {
                     data = [];
@@ -174,7 +435,7 @@ MbusMaster.prototype.scanSecondary = function scanSecondary(callback) {
                 err = new Error(err);
             }
             if (callback) callback(err, data);
-        });
+        }));
     });
 };
 
@@ -202,4 +463,64 @@ MbusMaster.prototype.setPrimaryId = function setPrimaryId(oldAddress, newAddress
     });
 };
 
+// convert the {data}/{error} entries of the native decoder
+function decodeResults(format, list, callback) {
+    var results = [];
+    var open = list.length + 1;
+    var done = function() {
+        if (--open === 0) callback(results);
+    };
+    list.forEach(function(entry, i) {
+        if (entry.error !== undefined) {
+            results[i] = {err: new Error(entry.error)};
+            done();
+            return;
+        }
+        convertData(format, entry.data, function(err, result) {
+            results[i] = {err: err, data: result};
+            done();
+        });
+    });
+    done();
+}
+
+MbusMaster.decodeFramesSync = function decodeFramesSync(buffers, options) {
+    options = options || {};
+    var format = dataFormat(options);
+    var results;
+    decodeResults(format, mbusBinding.decodeFramesSync(buffers, format), function(list) {
+        results = list;
+    });
+    return results;
+};
+
+MbusMaster.decodeFrames = function decodeFrames(buffers, options, callback) {
+    if (typeof options === 'function') {
+        callback = options;
+        options = {};
+    }
+    options = options || {};
+    var format = dataFormat(options);
+    var batchSize = options.batchSize || 1000;
+    var results = new Array(buffers.length);
+    var open = Math.ceil(buffers.length / batchSize) + 1;
+    var done = function() {
+        if (--open === 0 && callback) callback(null, results);
+    };
+
+    for (var start = 0; start < buffers.length; start += batchSize) {
+        (function(start) {
+            mbusBinding.decodeFrames(buffers.slice(start, start + batchSize), format, function(err, list) {
+                decodeResults(format, list, function(list) {
+                    for (var i = 0; i < list.length; i++) {
+                        results[start + i] = list[i];
+                    }
+                    done();
+                });
+            });
+        })(start);
+    }
+    done();
+};
+
 module.exports = MbusMaster;
@@ -12,6 +12,7 @@
 //------------------------------------------------------------------------------
 #ifdef _WIN32
 #define __PRETTY_FUNCTION__ __FUNCSIG__
+#include <windows.h>
 #endif
 
 #include "mbus-protocol-aux.h"
@@ -42,8 +43,9 @@ typedef struct _mbus_variable_vif {
     const char * quantity;
 } mbus_variable_vif;
 
+/* Every code has its entry at the index ((code >> 8) << 7) | (code & 0x7F) */
 mbus_variable_vif vif_table[] = {
-/*  Primary VIFs (main table), range 0x00 - 0xFF */
+/*  Primary VIFs (main table), range 0x00 - 0x7F */
 
     /*  E000 0nnn    Energy Wh (0.001Wh to 10000Wh) */
     { 0x00, 1.0e-3, "Wh", "Energy" },
@@ -218,18 +220,17 @@ mbus_variable_vif vif_table[] = {
     /* E111 1010 Bus Address */
     { 0x7A, 1.0, "", "Bus Address" },
 
+    /* FBh, 7Ch/FCh and FDh are no units (extension tables, plain text VIF) */
+    { 0x7B, 0.0, NULL, NULL },
+    { 0x7C, 0.0, NULL, NULL },
+    { 0x7D, 0.0, NULL, NULL },
+
     /* Any VIF: 7Eh */
     { 0x7E, 1.0, "", "Any VIF" },
 
     /* Manufacturer specific: 7Fh */
     { 0x7F, 1.0, "", "Manufacturer specific" },
 
-    /* Any VIF: 7Eh */
-    { 0xFE, 1.0, "", "Any VIF" },
-
-    /* Manufacturer specific: FFh */
-    { 0xFF, 1.0, "", "Manufacturer specific" },
-
 
 /* Main VIFE-Code Extension table (following VIF=FDh for primary VIF)
    See 8.4.4 a, only some of them are here. Using range 0x100 - 0x1FF */
@@ -786,6 +787,26 @@ mbus_register_found_event(mbus_handle * handle, void (*event)(mbus_handle * hand
     handle->found_event = event;
 }
 
+//------------------------------------------------------------------------------
+/// Register a function that is called for every frame of a (multi-telegram)
+/// reply as soon as it was received and parsed.
+//------------------------------------------------------------------------------
+void
+mbus_register_frame_event(mbus_handle * handle, void (*event)(mbus_handle * handle, mbus_frame *frame))
+{
+    handle->frame_event = event;
+}
+
+//------------------------------------------------------------------------------
+/// Register a function that is asked before every request frame and scan
+/// probe whether the running operation should be aborted (non zero result).
+//------------------------------------------------------------------------------
+void
+mbus_register_abort_check(mbus_handle * handle, int (*check)(mbus_handle * handle))
+{
+    handle->abort_check = check;
+}
+
 int mbus_fixed_normalize(int medium_unit, long medium_value, char **unit_out, double *value_out, char **quantity_out)
 {
     medium_unit = medium_unit & 0x3F;
@@ -1036,7 +1057,7 @@ int mbus_variable_value_decode(mbus_data_record *record, double *value_out_real,
 int
 mbus_vif_unit_normalize(int vif, double value, char **unit_out, double *value_out, char **quantity_out)
 {
-    int i;
+    const mbus_variable_vif *entry;
     unsigned newVif = vif & 0xF7F; /* clear extension bit */
 
     MBUS_DEBUG("vif_unit_normalize = 0x%03X \n", vif);
@@ -1047,13 +1068,16 @@ mbus_vif_unit_normalize(int vif, double value, char **unit_out, double *value_ou
         return -1;
     }
 
-    for(i=0; vif_table[i].vif < 0xfff; ++i)
+    // primary VIF, FDh and FBh table follow each other with 128 codes each
+    if (newVif < 0x300)
     {
-        if (vif_table[i].vif == newVif)
+        entry = &vif_table[((newVif >> 8) << 7) | (newVif & 0x7F)];
+
+        if (entry->vif == newVif && entry->unit != NULL)
         {
-            *unit_out = strdup(vif_table[i].unit);
-            *value_out = value * vif_table[i].exponent;
-            *quantity_out = strdup(vif_table[i].quantity);
+            *unit_out = strdup(entry->unit);
+            *value_out = value * entry->exponent;
+            *quantity_out = strdup(entry->quantity);
             return 0;
         }
     }
@@ -1224,6 +1248,7 @@ mbus_parse_fixed_record(char status_byte, char medium_unit, unsigned char *data)
 {
     long value = 0;
     mbus_record * record = NULL;
+    char function[32];
 
     if (!(record = mbus_record_new()))
     {
@@ -1231,8 +1256,7 @@ mbus_parse_fixed_record(char status_byte, char medium_unit, unsigned char *data)
         return NULL;
     }
 
-    /* shared/static memory - get own copy */
-    record->function_medium = strdup(mbus_data_fixed_function((int)status_byte));  /* stored / actual */
+    record->function_medium = strdup(mbus_data_fixed_function_r((int)status_byte, function, sizeof(function)));  /* stored / actual */
 
     if (record->function_medium == NULL)
     {
@@ -1271,6 +1295,7 @@ mbus_parse_variable_record(mbus_data_record *data)
     char * value_out_str     = NULL;
     int    value_out_str_size = 0;
     double real_val         = 0.0;  /**< normalized value */
+    char   function[32];
 
     if (data == NULL)
     {
@@ -1331,7 +1356,7 @@ mbus_parse_variable_record(mbus_data_record *data)
     }
     else
     {
-        record->function_medium = strdup(mbus_data_record_function(data));
+        record->function_medium = strdup(mbus_data_record_function_r(data, function, sizeof(function)));
 
         if (record->function_medium == NULL)
         {
@@ -1386,6 +1411,7 @@ mbus_data_variable_xml_normalized(mbus_data_variable *data)
     mbus_record *norm_record;
     char *buff = NULL, *new_buff = NULL;
     char str_encoded[768] = "";
+    char header[8192];
     size_t len = 0, buff_size = 8192;
     size_t i;
 
@@ -1400,7 +1426,7 @@ mbus_data_variable_xml_normalized(mbus_data_variable *data)
 
         len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
 
-        len += snprintf(&buff[len], buff_size - len, "%s", mbus_data_variable_header_xml(&(data->header)));
+        len += snprintf(&buff[len], buff_size - len, "%s", mbus_data_variable_header_xml_r(&(data->header), header, sizeof(header)));
 
         for (record = data->record, i = 0; record; record = record->next, i++)
         {
@@ -1509,7 +1535,7 @@ mbus_context_serial(const char *device)
     if ((serial_data = (mbus_serial_data *)malloc(sizeof(mbus_serial_data))) == NULL)
     {
         snprintf(error_str, sizeof(error_str), "%s: failed to allocate memory for handle\n", __PRETTY_FUNCTION__);
-        mbus_error_str_set(error_str);
+        mbus_error_set(MBUS_ERROR_CODE_NOMEM, error_str);
         free(handle);
         return NULL;
     }
@@ -1528,11 +1554,29 @@ mbus_context_serial(const char *device)
     handle->send_event = NULL;
     handle->scan_progress = NULL;
     handle->found_event = NULL;
+    handle->frame_event = NULL;
+    handle->abort_check = NULL;
+    handle->user_data = NULL;
+    handle->response_timeout = -1;
+    handle->purge_policy = MBUS_PURGE_POLICY_FULL;
+    handle->purge_window = -1;
+    handle->error_code = MBUS_ERROR_CODE_NONE;
+    handle->error_str[0] = '\0';
+    mbus_slave_session_reset(handle, -1);
+    mbus_rx_buffer_reset(&(handle->rx));
+    memset(&(handle->latency), 0, sizeof(handle->latency));
+    handle->latency.pending_address = -1;
+
+    serial_data->baudrate = 2400;
+    serial_data->first_byte_timeout = -1;
+    serial_data->inter_byte_timeout = -1;
+    serial_data->turnaround_time = -1;
+    serial_data->idle_since = 0;
 
     if ((serial_data->device = strdup(device)) == NULL)
     {
         snprintf(error_str, sizeof(error_str), "%s: failed to allocate memory for device\n", __PRETTY_FUNCTION__);
-        mbus_error_str_set(error_str);
+        mbus_error_set(MBUS_ERROR_CODE_NOMEM, error_str);
         free(serial_data);
         free(handle);
         return NULL;
@@ -1557,7 +1601,7 @@ mbus_context_tcp(const char *host, uint16_t port)
     if ((tcp_data = (mbus_tcp_data *)malloc(sizeof(mbus_tcp_data))) == NULL)
     {
         snprintf(error_str, sizeof(error_str), "%s: failed to allocate memory for handle\n", __PRETTY_FUNCTION__);
-        mbus_error_str_set(error_str);
+        mbus_error_set(MBUS_ERROR_CODE_NOMEM, error_str);
         free(handle);
         return NULL;
     }
@@ -1576,12 +1620,26 @@ mbus_context_tcp(const char *host, uint16_t port)
     handle->send_event = NULL;
     handle->scan_progress = NULL;
     handle->found_event = NULL;
+    handle->frame_event = NULL;
+    handle->abort_check = NULL;
+    handle->user_data = NULL;
+    handle->response_timeout = -1;
+    handle->purge_policy = MBUS_PURGE_POLICY_FULL;
+    handle->purge_window = -1;
+    handle->error_code = MBUS_ERROR_CODE_NONE;
+    handle->error_str[0] = '\0';
+    mbus_slave_session_reset(handle, -1);
+    mbus_rx_buffer_reset(&(handle->rx));
+    memset(&(handle->latency), 0, sizeof(handle->latency));
+    handle->latency.pending_address = -1;
 
     tcp_data->port = port;
+    tcp_data->timeout_usec = -1;
+    tcp_data->connect_timeout_usec = -1;
     if ((tcp_data->host = strdup(host)) == NULL)
     {
         snprintf(error_str, sizeof(error_str), "%s: failed to allocate memory for host\n", __PRETTY_FUNCTION__);
-        mbus_error_str_set(error_str);
+        mbus_error_set(MBUS_ERROR_CODE_NOMEM, error_str);
         free(tcp_data);
         free(handle);
         return NULL;
@@ -1658,11 +1716,237 @@ mbus_context_set_option(mbus_handle * handle, mbus_context_option option, long v
                 return 0;
             }
             break;
+        case MBUS_OPTION_TIMEOUT_FLOOR:
+            if ((value >= 0) && (value <= 60000))
+            {
+                handle->latency.timeout_floor = value;
+                return 0;
+            }
+            break;
+        case MBUS_OPTION_TIMEOUT_CEILING:
+            if ((value >= 0) && (value <= 60000))
+            {
+                handle->latency.timeout_ceiling = value;
+                return 0;
+            }
+            break;
+        case MBUS_OPTION_PURGE_POLICY:
+            if ((value == MBUS_PURGE_POLICY_FULL) ||
+                (value == MBUS_PURGE_POLICY_FAST) ||
+                (value == MBUS_PURGE_POLICY_SKIP_VALID))
+            {
+                handle->purge_policy = value;
+                return 0;
+            }
+            break;
+        case MBUS_OPTION_PURGE_WINDOW:
+            if ((value >= -1) && (value <= 60000))
+            {
+                handle->purge_window = value;
+                return 0;
+            }
+            break;
     }
 
     return -1; // unable to set option
 }
 
+//------------------------------------------------------------------------------
+// Monotonic time in ms to measure the response times
+//------------------------------------------------------------------------------
+static unsigned long long
+mbus_time_ms(void)
+{
+#ifdef _WIN32
+    return GetTickCount64();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+#define MBUS_LATENCY_MAX_BACKOFF 6
+
+int
+mbus_latency_timeout(mbus_handle * handle, int address, int default_ms)
+{
+    mbus_latency *latency;
+    double timeout;
+
+    if (handle == NULL || handle->latency.timeout_ceiling <= 0 ||
+        address < 0 || address >= MBUS_LATENCY_ADDRESSES)
+    {
+        return default_ms;
+    }
+
+    latency = &(handle->latency.address[address]);
+    if (latency->samples == 0)
+    {
+        return default_ms;
+    }
+
+    timeout = latency->srtt + 4 * latency->rttvar;
+
+    if (timeout < handle->latency.timeout_floor)
+    {
+        timeout = handle->latency.timeout_floor;
+    }
+    timeout *= 1 << latency->backoff;
+    if (timeout > handle->latency.timeout_ceiling)
+    {
+        timeout = handle->latency.timeout_ceiling;
+    }
+    return (int)ceil(timeout);
+}
+
+int
+mbus_latency_address(const mbus_frame *frame)
+{
+    if (frame == NULL || frame->type == MBUS_FRAME_TYPE_ACK)
+        return -1;
+
+    // a select is answered by a single device of the mask at most, a missing
+    // answer is no reason to wait longer for the next one
+    if (frame->type == MBUS_FRAME_TYPE_LONG &&
+        (frame->control_information == MBUS_CONTROL_INFO_SELECT_SLAVE ||
+         frame->control_information == MBUS_CONTROL_INFO_SELECT_SLAVE_MSB))
+        return -1;
+
+    return frame->address;
+}
+
+void
+mbus_latency_sent(mbus_handle * handle, int address, unsigned long long now)
+{
+    if (handle == NULL)
+        return;
+
+    // broadcasts have no (single) answer
+    handle->latency.pending_address = (address >= 0 && address < MBUS_LATENCY_ADDRESSES) ? address : -1;
+    handle->latency.sent_at = now;
+}
+
+void
+mbus_latency_received(mbus_handle * handle, int result, unsigned long long now)
+{
+    mbus_latency *latency;
+    double sample, err;
+
+    if (handle == NULL || handle->latency.pending_address < 0)
+        return;
+
+    latency = &(handle->latency.address[handle->latency.pending_address]);
+    handle->latency.pending_address = -1;
+
+    if (result == MBUS_RECV_RESULT_TIMEOUT)
+    {
+        // the device may just be slower than learned, wait longer next time
+        if (latency->backoff < MBUS_LATENCY_MAX_BACKOFF)
+            latency->backoff++;
+        return;
+    }
+
+    if (result != MBUS_RECV_RESULT_OK)
+    {
+        return;
+    }
+
+    sample = (double)(now - handle->latency.sent_at);
+    latency->backoff = 0;
+
+    if (latency->samples++ == 0)
+    {
+        latency->srtt = sample;
+        latency->rttvar = sample / 2;
+        return;
+    }
+
+    err = sample - latency->srtt;
+    latency->srtt += err / 8;
+    latency->rttvar += (fabs(err) - latency->rttvar) / 4;
+}
+
+int
+mbus_slave_session(mbus_handle * handle, int address)
+{
+    if (handle == NULL || address < 0 || address > MBUS_ADDRESS_NETWORK_LAYER)
+    {
+        return -1;
+    }
+    return handle->slave_data[address].state_fcb;
+}
+
+void
+mbus_slave_session_start(mbus_handle * handle, int address)
+{
+    size_t i;
+
+    if (handle == NULL)
+        return;
+
+    if (address == MBUS_ADDRESS_BROADCAST_REPLY || address == MBUS_ADDRESS_BROADCAST_NOREPLY)
+    {
+        for (i = 0; i < NITEMS(handle->slave_data); i++)
+        {
+            handle->slave_data[i].state_fcb = 1;
+        }
+        return;
+    }
+
+    if (address >= 0 && address <= MBUS_ADDRESS_NETWORK_LAYER)
+    {
+        handle->slave_data[address].state_fcb = 1;
+    }
+}
+
+void
+mbus_slave_session_reset(mbus_handle * handle, int address)
+{
+    size_t i;
+
+    if (handle == NULL)
+        return;
+
+    for (i = 0; i < NITEMS(handle->slave_data); i++)
+    {
+        if (address == -1 || (int)i == address)
+        {
+            handle->slave_data[i].state_fcb = -1;
+            handle->slave_data[i].state_acd = 0;
+        }
+    }
+
+    if (address == -1 || address == MBUS_ADDRESS_NETWORK_LAYER)
+    {
+        handle->selected_address[0] = '\0';
+    }
+}
+
+void
+mbus_handle_error_set(mbus_handle * handle, int code, const char *message)
+{
+    if (handle != NULL)
+    {
+        handle->error_code = code;
+        snprintf(handle->error_str, sizeof(handle->error_str), "%s", message ? message : "");
+    }
+    mbus_error_set(code, message);
+}
+
+int
+mbus_handle_error_code(mbus_handle * handle)
+{
+    return handle != NULL ? handle->error_code : MBUS_ERROR_CODE_INVALID;
+}
+
+const char *
+mbus_handle_error_str(mbus_handle * handle)
+{
+    return handle != NULL ? handle->error_str : "Invalid M-Bus handle.";
+}
+
 int
 mbus_recv_frame(mbus_handle * handle, mbus_frame *frame)
 {
@@ -1680,11 +1964,20 @@ mbus_recv_frame(mbus_handle * handle, mbus_frame *frame)
         return MBUS_RECV_RESULT_ERROR;
     }
 
+    // answers to a request of a known address are awaited as long as the
+    // address needs, other frames (purge) with the default of the transport
+    if (handle->latency.pending_address >= 0)
+    {
+        handle->response_timeout = mbus_latency_timeout(handle, handle->latency.pending_address, handle->response_timeout);
+    }
+
     result = handle->recv(handle, frame);
 
     switch (mbus_frame_direction(frame))
     {
         case MBUS_CONTROL_MASK_DIR_M2S:
+            // the echo of the sent frame is already stripped by the transport,
+            // only a garbled or delayed echo is left
             if (handle->purge_first_frame == MBUS_FRAME_PURGE_M2S)
                 result = handle->recv(handle, frame);  // purge echo and retry
             break;
@@ -1694,6 +1987,9 @@ mbus_recv_frame(mbus_handle * handle, mbus_frame *frame)
             break;
     }
 
+    handle->response_timeout = -1;
+    mbus_latency_received(handle, result, mbus_time_ms());
+
     if (frame != NULL)
     {
         /* set timestamp to receive time */
@@ -1703,6 +1999,19 @@ mbus_recv_frame(mbus_handle * handle, mbus_frame *frame)
     return result;
 }
 
+int
+mbus_purge_window(mbus_handle *handle)
+{
+    if (handle->purge_window >= 0)
+    {
+        return handle->purge_window;
+    }
+
+    // the frames of late or colliding answers follow the last byte without
+    // a gap, the answer time of a new request is not needed
+    return mbus_serial_silence_window(handle);
+}
+
 int mbus_purge_frames(mbus_handle *handle)
 {
     int err, received;
@@ -1713,6 +2022,11 @@ int mbus_purge_frames(mbus_handle *handle)
     received = 0;
     while (1)
     {
+        if (handle->purge_policy != MBUS_PURGE_POLICY_FULL)
+        {
+            handle->response_timeout = mbus_purge_window(handle);
+        }
+
         err = mbus_recv_frame(handle, &reply);
         if (err != MBUS_RECV_RESULT_OK &&
             err != MBUS_RECV_RESULT_INVALID)
@@ -1733,6 +2047,8 @@ mbus_send_frame(mbus_handle * handle, mbus_frame *frame)
         return 0;
     }
 
+    mbus_latency_sent(handle, mbus_latency_address(frame), mbus_time_ms());
+
     return handle->send(handle, frame);
 }
 
@@ -1755,6 +2071,9 @@ mbus_send_select_frame(mbus_handle * handle, const char *secondary_addr_str)
         return -1;
     }
 
+    // the selection changes
+    handle->selected_address[0] = '\0';
+
     if (mbus_send_frame(handle, frame) == -1)
     {
         MBUS_ERROR("%s: Failed to send mbus frame.\n", __PRETTY_FUNCTION__);
@@ -1762,6 +2081,9 @@ mbus_send_select_frame(mbus_handle * handle, const char *secondary_addr_str)
         return -1;
     }
 
+    // a newly selected slave is requested with FCB 1
+    mbus_slave_session_start(handle, MBUS_ADDRESS_NETWORK_LAYER);
+
     mbus_frame_free(frame);
     return 0;
 }
@@ -2014,6 +2336,140 @@ mbus_send_user_data_frame(mbus_handle * handle, int address, const unsigned char
     return retval;
 }
 
+//------------------------------------------------------------------------------
+/// Pack the selection record (DIF/DIFEs, VIF any) for the readout of one
+/// storage number. Returns the record length or -1 when the storage number
+/// is negative or the buffer is too small.
+//------------------------------------------------------------------------------
+int
+mbus_readout_selection_storage(unsigned char *buff, size_t size, long storage)
+{
+    size_t len = 0;
+
+    if (buff == NULL || size < 1 || storage < 0)
+    {
+        return -1;
+    }
+
+    buff[len++] = MBUS_DIB_DIF_SELECTION | ((storage & 0x01) ? MBUS_DIB_DIF_STORAGE_BIT : 0);
+    storage >>= 1;
+
+    // the remaining storage number bits go into DIFEs, 4 bits each
+    while (storage > 0)
+    {
+        if (len >= size || len > 10)
+        {
+            return -1;
+        }
+        buff[len - 1] |= MBUS_DIB_DIF_EXTENSION_BIT;
+        buff[len++] = storage & MBUS_DIB_DIFE_STORAGE_MASK;
+        storage >>= 4;
+    }
+
+    if (len >= size)
+    {
+        return -1;
+    }
+    buff[len++] = MBUS_DIB_VIF_ANY;
+    return (int)len;
+}
+
+//------------------------------------------------------------------------------
+// send the readout selection records (SND_UD) and wait for the ACK, the
+// following REQ_UD2 is answered with the selected records only
+//------------------------------------------------------------------------------
+int
+mbus_send_readout_selection(mbus_handle *handle, int address, const unsigned char *records, size_t records_size)
+{
+    int retval = -1, result;
+    mbus_frame *frame;
+    mbus_frame reply;
+
+    if (handle == NULL)
+    {
+        MBUS_ERROR("%s: Invalid M-Bus handle for selection.\n", __PRETTY_FUNCTION__);
+        return -1;
+    }
+
+    if (mbus_is_primary_address(address) == 0)
+    {
+        MBUS_ERROR("%s: invalid address %d\n", __PRETTY_FUNCTION__, address);
+        return -1;
+    }
+
+    if (records == NULL || records_size == 0 || records_size > MBUS_FRAME_DATA_LENGTH)
+    {
+        MBUS_ERROR("%s: illegal records_size %zu\n", __PRETTY_FUNCTION__, records_size);
+        return -1;
+    }
+
+    frame = mbus_frame_new(MBUS_FRAME_TYPE_LONG);
+
+    if (frame == NULL)
+    {
+        MBUS_ERROR("%s: failed to allocate mbus frame.\n", __PRETTY_FUNCTION__);
+        return -1;
+    }
+
+    // SND_UD takes part in the FCB cycle like REQ_UD2
+    frame->control = MBUS_CONTROL_MASK_SND_UD |
+                     MBUS_CONTROL_MASK_DIR_M2S |
+                     MBUS_CONTROL_MASK_FCV     |
+                     MBUS_CONTROL_MASK_FCB;
+
+    if (mbus_slave_session(handle, address) == 0)
+    {
+        frame->control &= ~MBUS_CONTROL_MASK_FCB;
+    }
+
+    frame->address = address;
+    frame->control_information = MBUS_CONTROL_INFO_DATA_SEND;
+    frame->data_size = records_size;
+    memcpy(frame->data, records, records_size);
+
+    if (mbus_send_frame(handle, frame) == -1)
+    {
+        MBUS_ERROR("%s: failed to send mbus frame.\n", __PRETTY_FUNCTION__);
+        mbus_frame_free(frame);
+        mbus_slave_session_reset(handle, address);
+        return -1;
+    }
+
+    memset((void *)&reply, 0, sizeof(mbus_frame));
+    result = mbus_recv_frame(handle, &reply);
+
+    if (result == MBUS_RECV_RESULT_OK && mbus_frame_type(&reply) == MBUS_FRAME_TYPE_ACK)
+    {
+        retval = 0;
+
+        // the acknowledged frame completes the FCB cycle
+        if (address <= MBUS_ADDRESS_NETWORK_LAYER)
+        {
+            handle->slave_data[address].state_fcb = (frame->control & MBUS_CONTROL_MASK_FCB) ? 0 : 1;
+        }
+
+        if (handle->purge_policy != MBUS_PURGE_POLICY_SKIP_VALID)
+        {
+            mbus_purge_frames(handle);
+        }
+    }
+    else
+    {
+        MBUS_ERROR("%s: No M-Bus ACK of the readout selection received.\n", __PRETTY_FUNCTION__);
+
+        if (result == MBUS_RECV_RESULT_OK || result == MBUS_RECV_RESULT_INVALID)
+        {
+            mbus_purge_frames(handle);
+        }
+
+        // the slave state is unknown, start a new session the next time
+        mbus_slave_session_reset(handle, address);
+    }
+
+    mbus_frame_free(frame);
+    return retval;
+}
+
 //------------------------------------------------------------------------------
 // send a request from master to slave in order to change the primary address
 //------------------------------------------------------------------------------
@@ -2078,6 +2534,12 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
                      MBUS_CONTROL_MASK_FCV     |
                      MBUS_CONTROL_MASK_FCB;
 
+    // continue the link layer session of the slave
+    if (mbus_slave_session(handle, address) == 0)
+    {
+        frame->control &= ~MBUS_CONTROL_MASK_FCB;
+    }
+
     frame->address = address;
 
     //
@@ -2097,6 +2559,13 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
             break;
         }
 
+        if (handle->abort_check && handle->abort_check(handle))
+        {
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_ABORTED, "M-Bus request aborted.");
+            retval = 1;
+            break;
+        }
+
         if (debug)
             printf("%s: debug: sending request frame\n", __PRETTY_FUNCTION__);
 
@@ -2115,7 +2584,12 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
         if (result == MBUS_RECV_RESULT_OK)
         {
             retry = 0;
-            mbus_purge_frames(handle);
+
+            // a valid complete answer is the only one on the bus
+            if (handle->purge_policy != MBUS_PURGE_POLICY_SKIP_VALID)
+            {
+                mbus_purge_frames(handle);
+            }
         }
         else if (result == MBUS_RECV_RESULT_TIMEOUT)
         {
@@ -2139,6 +2613,13 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
 
         frame_count++;
 
+        // the answered request completes the FCB cycle
+        if (address <= MBUS_ADDRESS_NETWORK_LAYER)
+        {
+            handle->slave_data[address].state_fcb = (frame->control & MBUS_CONTROL_MASK_FCB) ? 0 : 1;
+            handle->slave_data[address].state_acd = (next_frame->control & MBUS_CONTROL_MASK_ACD) ? 1 : 0;
+        }
+
         //
         // We need to parse the data in the received frame to be able to tell
         // if more records are available or not.
@@ -2150,6 +2631,12 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
             break;
         }
 
+        //
+        // call the frame event function, if the callback function is registered
+        //
+        if (handle->frame_event)
+            handle->frame_event(handle, next_frame);
+
         //
         // Continue a cycle of sending requests and reading replies until the
         // reply do not have DIF=0x1F in the last record (which signals that
@@ -2202,6 +2689,12 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
         }
     }
 
+    if (retval != 0)
+    {
+        // the slave state is unknown, start a new session the next time
+        mbus_slave_session_reset(handle, address);
+    }
+
     mbus_frame_free(frame);
     return retval;
 }
@@ -2213,7 +2706,7 @@ mbus_sendrecv_request(mbus_handle *handle, int address, mbus_frame *reply, int m
 int
 mbus_send_ping_frame(mbus_handle *handle, int address, char purge_response)
 {
-    int retval = 0;
+    int retval = 0, answered = 0;
     mbus_frame *frame;
 
     if (mbus_is_primary_address(address) == 0)
@@ -2242,7 +2735,46 @@ mbus_send_ping_frame(mbus_handle *handle, int address, char purge_response)
 
     if (purge_response)
     {
-        mbus_purge_frames(handle);
+        if (handle->purge_policy == MBUS_PURGE_POLICY_SKIP_VALID &&
+            address < MBUS_ADDRESS_NETWORK_LAYER)
+        {
+            // a single slave answers, stop after its valid ACK
+            mbus_frame reply;
+
+            memset((void *)&reply, 0, sizeof(mbus_frame));
+            handle->response_timeout = mbus_purge_window(handle);
+            switch (mbus_recv_frame(handle, &reply))
+            {
+                case MBUS_RECV_RESULT_OK:
+                    answered = 1;
+                    break;
+                case MBUS_RECV_RESULT_INVALID:
+                    answered = 1;
+                    mbus_purge_frames(handle);
+                    break;
+            }
+        }
+        else
+        {
+            answered = mbus_purge_frames(handle);
+        }
+    }
+
+    // the reset deselects the selected slave
+    if (address >= MBUS_ADDRESS_NETWORK_LAYER)
+    {
+        handle->selected_address[0] = '\0';
+    }
+
+    // a slave that acknowledged the reset expects FCB 1 next, the network
+    // layer and broadcast addresses have no (single) answer
+    if (answered || address >= MBUS_ADDRESS_NETWORK_LAYER)
+    {
+        mbus_slave_session_start(handle, address);
+    }
+    else
+    {
+        mbus_slave_session_reset(handle, address);
     }
 
     mbus_frame_free(frame);
@@ -2264,12 +2796,18 @@ mbus_select_secondary_address(mbus_handle * handle, const char *mask)
         return MBUS_PROBE_ERROR;
     }
 
+    /* the slave is still selected */
+    if (strcmp(handle->selected_address, mask) == 0)
+    {
+        return MBUS_PROBE_SINGLE;
+    }
+
     /* send select command */
     if (mbus_send_select_frame(handle, mask) == -1)
     {
         MBUS_ERROR("%s: Failed to send selection frame: %s.\n",
                    __PRETTY_FUNCTION__,
-                   mbus_error_str());
+                   mbus_handle_error_str(handle));
         return MBUS_PROBE_ERROR;
     }
 
@@ -2296,6 +2834,8 @@ mbus_select_secondary_address(mbus_handle * handle, const char *mask)
             return MBUS_PROBE_COLLISION;
         }
 
+        /* keep the selection for the next requests */
+        snprintf(handle->selected_address, sizeof(handle->selected_address), "%s", mask);
         return MBUS_PROBE_SINGLE;
     }
 
@@ -2332,7 +2872,7 @@ mbus_probe_secondary_address(mbus_handle *handle, const char *mask, char *matchi
                 MBUS_ERROR("%s: Failed to send request to selected secondary device [mask %s]: %s.\n",
                            __PRETTY_FUNCTION__,
                            mask,
-                           mbus_error_str());
+                           mbus_handle_error_str(handle));
                 return MBUS_PROBE_ERROR;
             }
 
@@ -2359,7 +2899,8 @@ mbus_probe_secondary_address(mbus_handle *handle, const char *mask, char *matchi
 
             if (mbus_frame_type(&reply) == MBUS_FRAME_TYPE_LONG)
             {
-                char *addr = mbus_frame_get_secondary_address(&reply);
+                char addr_buff[32];
+                char *addr = mbus_frame_get_secondary_address_r(&reply, addr_buff, sizeof(addr_buff));
 
                 if (addr == NULL)
                 {
@@ -2526,6 +3067,13 @@ mbus_scan_2nd_address_range(mbus_handle * handle, int pos, char *addr_mask)
     {
         for (i = i_start; i <= i_end; i++)
         {
+            if (handle->abort_check && handle->abort_check(handle))
+            {
+                mbus_handle_error_set(handle, MBUS_ERROR_CODE_ABORTED, "M-Bus scan aborted.");
+                free(mask);
+                return -1;
+            }
+
             mask[pos] = '0'+i;
 
             if (handle->scan_progress)
@@ -80,6 +80,37 @@ extern "C" {
 #define MBUS_FRAME_PURGE_M2S  1
 #define MBUS_FRAME_PURGE_NONE 0
 
+//
+// Purge policies: how long to listen for further frames after an answer
+//
+#define MBUS_PURGE_POLICY_FULL       0 /**< until the receive timeout of the transport (default) */
+#define MBUS_PURGE_POLICY_FAST       1 /**< until a silence window derived from the baud rate */
+#define MBUS_PURGE_POLICY_SKIP_VALID 2 /**< no purge after a valid complete answer of a single slave, else as fast */
+
+/**
+ * Response latency of one address, smoothed like the TCP retransmission timer
+ * (RFC 6298).
+ */
+typedef struct _mbus_latency {
+    double srtt;      /**< smoothed response time in ms */
+    double rttvar;    /**< smoothed mean deviation of the response time in ms */
+    int samples;      /**< number of measured answers */
+    int backoff;      /**< timeouts since the last answer, doubles the timeout */
+} mbus_latency;
+
+#define MBUS_LATENCY_ADDRESSES 254 /**< primary addresses and the network layer address (253) */
+
+/**
+ * Adaptive response timeouts of a handle. Disabled while timeout_ceiling is 0.
+ */
+typedef struct _mbus_latency_table {
+    int timeout_floor;         /**< lower bound of a derived timeout in ms */
+    int timeout_ceiling;       /**< upper bound of a derived timeout in ms */
+    int pending_address;       /**< address of the last request, -1 if none is outstanding */
+    unsigned long long sent_at; /**< monotonic ms of the last request */
+    mbus_latency address[MBUS_LATENCY_ADDRESSES];
+} mbus_latency_table;
+
 /**
  * Unified MBus handle type encapsulating either Serial or TCP gateway.
  */
@@ -98,7 +129,19 @@ typedef struct _mbus_handle {
     void (*send_event) (unsigned char src_type, const char *buff, size_t len);
     void (*scan_progress) (struct _mbus_handle *handle, const char *mask);
     void (*found_event) (struct _mbus_handle *handle, mbus_frame *frame);
+    void (*frame_event) (struct _mbus_handle *handle, mbus_frame *frame); /**< every parsed reply frame of mbus_sendrecv_request */
+    int (*abort_check) (struct _mbus_handle *handle); /**< non zero stops requests and scans at the next frame/probe */
     void *auxdata;
+    void *user_data; /**< free for the application, e.g. for the event functions */
+    mbus_rx_buffer rx; /**< received bytes that were not taken as frame yet */
+    mbus_latency_table latency; /**< response times of the addresses */
+    int response_timeout; /**< ms the transport waits for the next answer, -1 for its default */
+    int purge_policy; /**< MBUS_PURGE_POLICY_* */
+    int purge_window; /**< silence window in ms of the fast purge, -1 to derive it from the baud rate */
+    mbus_slave_data slave_data[MBUS_ADDRESS_NETWORK_LAYER + 1]; /**< link layer state per address, state_fcb -1 without session */
+    char selected_address[17]; /**< secondary address of the selected slave, empty if unknown */
+    int error_code; /**< MBUS_ERROR_CODE_* of the last error of the handle */
+    char error_str[256]; /**< message of the last error of the handle */
 } mbus_handle;
 
 /**
@@ -154,7 +197,11 @@ typedef struct _mbus_record {
 typedef enum _mbus_context_option {
     MBUS_OPTION_MAX_DATA_RETRY,  /**< option defines the maximum attempts of data request retransmission */
     MBUS_OPTION_MAX_SEARCH_RETRY,  /**< option defines the maximum attempts of search request retransmission */
-    MBUS_OPTION_PURGE_FIRST_FRAME  /**< option controls the echo cancelation for mbus_recv_frame */
+    MBUS_OPTION_PURGE_FIRST_FRAME,  /**< option controls the echo cancelation for mbus_recv_frame */
+    MBUS_OPTION_TIMEOUT_FLOOR,     /**< lower bound in ms of the response timeouts learned per address */
+    MBUS_OPTION_TIMEOUT_CEILING,   /**< upper bound in ms of the response timeouts learned per address, 0 disables them */
+    MBUS_OPTION_PURGE_POLICY,      /**< option selects the MBUS_PURGE_POLICY_* of mbus_purge_frames */
+    MBUS_OPTION_PURGE_WINDOW       /**< silence window in ms of the fast purge policies, -1 derives it from the baud rate */
 } mbus_context_option;
 
 /**
@@ -167,6 +214,8 @@ void mbus_register_recv_event(mbus_handle *handle, void (*event)(unsigned char s
 void mbus_register_send_event(mbus_handle *handle, void (*event)(unsigned char src_type, const char *buff, size_t len));
 void mbus_register_scan_progress(mbus_handle *handle, void (*event)(mbus_handle *handle, const char *mask));
 void mbus_register_found_event(mbus_handle *handle, void (*event)(mbus_handle *handle, mbus_frame *frame));
+void mbus_register_frame_event(mbus_handle *handle, void (*event)(mbus_handle *handle, mbus_frame *frame));
+void mbus_register_abort_check(mbus_handle *handle, int (*check)(mbus_handle *handle));
 
 /**
  * Allocate and initialize M-Bus serial context.
@@ -224,6 +273,95 @@ int mbus_disconnect(mbus_handle * handle);
  */
 int mbus_context_set_option(mbus_handle * handle, mbus_context_option option, long value);
 
+/**
+ * Response timeout of the address derived from its measured response times.
+ *
+ * @param handle     Initialized handle
+ * @param address    Address (0-253)
+ * @param default_ms Returned when adaptive timeouts are disabled or the address has no answer yet
+ *
+ * @return Timeout in ms.
+ */
+int mbus_latency_timeout(mbus_handle * handle, int address, int default_ms);
+
+/**
+ * Address whose latency is measured with the answer to the frame. Selects of
+ * secondary addresses (also wildcard masks of a scan) are not measured, no
+ * answer is the expected result for most of them.
+ *
+ * @param frame Frame to send
+ *
+ * @return Address (0-253), -1 if the answer is not measured.
+ */
+int mbus_latency_address(const mbus_frame *frame);
+
+/**
+ * Mark the start of a request to the address, the next answer is measured.
+ *
+ * @param handle  Initialized handle
+ * @param address Address (0-255), -1 if the answer is not measured
+ * @param now     Monotonic time in ms
+ */
+void mbus_latency_sent(mbus_handle * handle, int address, unsigned long long now);
+
+/**
+ * Record the result of the answer to the last request.
+ *
+ * @param handle Initialized handle
+ * @param result MBUS_RECV_RESULT_*
+ * @param now    Monotonic time in ms
+ */
+void mbus_latency_received(mbus_handle * handle, int result, unsigned long long now);
+
+/**
+ * Link layer session of an address: after a SND_NKE the slave expects FCB 1,
+ * then the FCB toggles with every answered request.
+ *
+ * @param handle  Initialized handle
+ * @param address Address (0-253)
+ *
+ * @return FCB (0 or 1) of the next request, -1 when the address has no session.
+ */
+int mbus_slave_session(mbus_handle * handle, int address);
+
+/**
+ * Start the session of an address after a SND_NKE (broadcasts start all).
+ *
+ * @param handle  Initialized handle
+ * @param address Address (0-255)
+ */
+void mbus_slave_session_start(mbus_handle * handle, int address);
+
+/**
+ * Forget the session of an address after an error, -1 forgets all. Forgetting
+ * the network layer address also forgets the selected secondary address.
+ *
+ * @param handle  Initialized handle
+ * @param address Address (0-253) or -1
+ */
+void mbus_slave_session_reset(mbus_handle * handle, int address);
+
+/**
+ * Set the last error of the handle, it is also the last error of the calling
+ * thread (mbus_error_str, mbus_error_code).
+ *
+ * @param handle  Initialized handle
+ * @param code    MBUS_ERROR_CODE_*
+ * @param message Error message
+ */
+void mbus_handle_error_set(mbus_handle * handle, int code, const char *message);
+
+/**
+ * Last error of the handle, errors of other handles (buses) do not overwrite it.
+ *
+ * @param handle Initialized handle
+ *
+ * @return MBUS_ERROR_CODE_* resp. the message, MBUS_ERROR_CODE_NONE and an
+ *         empty message when no error occurred.
+ */
+int mbus_handle_error_code(mbus_handle * handle);
+const char *mbus_handle_error_str(mbus_handle * handle);
+
 /**
  * Receives a frame using "unified" handle
  *
@@ -236,6 +374,7 @@ int mbus_recv_frame(mbus_handle * handle, mbus_frame *frame);
 
 /**
  * Used for handling collisions. Blocks as long as receiving frames or corrupted data.
+ * With the fast purge policies every frame is awaited only for the silence window.
  *
  * @param handle Initialized handle
  *
@@ -243,6 +382,16 @@ int mbus_recv_frame(mbus_handle * handle, mbus_frame *frame);
  */
 int mbus_purge_frames(mbus_handle * handle);
 
+/**
+ * Silence window of the fast purge policies: the inter-byte timeout of the
+ * serial receive (a 2400 baud bus is assumed behind TCP gateways).
+ *
+ * @param handle Initialized handle
+ *
+ * @return Window in ms.
+ */
+int mbus_purge_window(mbus_handle * handle);
+
 /**
  * Sends frame using "unified" handle
  *
@@ -308,6 +457,33 @@ int mbus_send_request_frame_fcb(mbus_handle * handle, int address);
  */
 int mbus_send_user_data_frame(mbus_handle * handle, int address, const unsigned char *data, size_t data_size);
 
+/**
+ * Packs the selection record for the readout of one storage number
+ * (DIF/DIFEs with the storage number, VIF any). The global readout request
+ * is the single DIF MBUS_DIB_DIF_GLOBAL_READOUT.
+ *
+ * @param buff    Buffer for the record
+ * @param size    Size of the buffer
+ * @param storage Storage number (>= 0)
+ *
+ * @return Length of the record, -1 when the storage number is negative or the buffer is too small.
+ */
+int mbus_readout_selection_storage(unsigned char *buff, size_t size, long storage);
+
+/**
+ * Sends the readout selection records (EN 13757-3 SND_UD) to given slave and
+ * waits for the ACK. Devices that support it answer the next REQ_UD2 with
+ * the selected records only.
+ *
+ * @param handle       Initialized handle
+ * @param address      Address (0-253)
+ * @param records      DIF/VIF records of the selection
+ * @param records_size Byte count of the records
+ *
+ * @return Zero when the slave acknowledged the selection.
+ */
+int mbus_send_readout_selection(mbus_handle *handle, int address, const unsigned char *records, size_t records_size);
+
 /**
  * Sends frame to change primary address of given slave using "unified" handle
  *
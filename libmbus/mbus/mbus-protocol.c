@@ -15,16 +15,40 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "mbus-protocol.h"
 
+#if defined(_MSC_VER)
+#define MBUS_THREAD_LOCAL __declspec(thread)
+#else
+#define MBUS_THREAD_LOCAL __thread
+#endif
+
 static int parse_debug = 0, debug = 0;
-static char error_str[512];
+
+// every thread (bus) has its own last error
+static MBUS_THREAD_LOCAL char error_str[512];
+static MBUS_THREAD_LOCAL int error_code;
 
 #define NITEMS(x) (sizeof(x)/sizeof(x[0]))
 
+// records allocated at once when parsing a frame, the block grows as needed
+#define MBUS_DATA_RECORD_BLOCK 16
+
+// gmtime with a buffer of the caller
+static struct tm *
+mbus_gmtime_r(const time_t *timep, struct tm *result)
+{
+#ifdef _WIN32
+    return gmtime_s(result, timep) == 0 ? result : NULL;
+#else
+    return gmtime_r(timep, result);
+#endif
+}
+
 //------------------------------------------------------------------------------
 // Returns the manufacturer ID according to the manufacturer's 3 byte ASCII code
 // or zero when there was an error.
@@ -81,7 +105,8 @@ mbus_dump_send_event(unsigned char src_type, const char *buff, size_t len)
 }
 
 //------------------------------------------------------------------------------
-/// Return a string that contains an the latest error message.
+/// Return a string that contains an the latest error message of the calling
+/// thread.
 //------------------------------------------------------------------------------
 char *
 mbus_error_str()
@@ -89,19 +114,35 @@ mbus_error_str()
     return error_str;
 }
 
+//------------------------------------------------------------------------------
+/// Return the MBUS_ERROR_CODE_* of the latest error of the calling thread.
+//------------------------------------------------------------------------------
+int
+mbus_error_code()
+{
+    return error_code;
+}
+
+void
+mbus_error_set(int code, const char *message)
+{
+    error_code = code;
+    snprintf(error_str, sizeof(error_str), "%s", message ? message : "");
+}
+
 void
 mbus_error_str_set(char *message)
 {
     if (message)
     {
-        snprintf(error_str, sizeof(error_str), "%s", message);
+        mbus_error_set(MBUS_ERROR_CODE_OTHER, message);
     }
 }
 
 void
 mbus_error_reset()
 {
-    snprintf(error_str, sizeof(error_str), "no errors");
+    mbus_error_set(MBUS_ERROR_CODE_NONE, "no errors");
 }
 
 //------------------------------------------------------------------------------
@@ -335,6 +376,41 @@ mbus_frame_direction(mbus_frame *frame)
     return -1;
 }
 
+//------------------------------------------------------------------------------
+/// Check the control field of a short (SHORT) or long (CONTROL/LONG) frame.
+//------------------------------------------------------------------------------
+static int
+mbus_frame_control_verify(int type, unsigned char control)
+{
+    if (type == MBUS_FRAME_TYPE_SHORT)
+    {
+        if ((control ==  MBUS_CONTROL_MASK_SND_NKE)                          ||
+            (control ==  MBUS_CONTROL_MASK_REQ_UD1)                          ||
+            (control == (MBUS_CONTROL_MASK_REQ_UD1 | MBUS_CONTROL_MASK_FCB)) ||
+            (control ==  MBUS_CONTROL_MASK_REQ_UD2)                          ||
+            (control == (MBUS_CONTROL_MASK_REQ_UD2 | MBUS_CONTROL_MASK_FCB)))
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        if ((control ==  MBUS_CONTROL_MASK_SND_UD)                          ||
+            (control == (MBUS_CONTROL_MASK_SND_UD | MBUS_CONTROL_MASK_FCB)) ||
+            (control ==  MBUS_CONTROL_MASK_RSP_UD)                          ||
+            (control == (MBUS_CONTROL_MASK_RSP_UD | MBUS_CONTROL_MASK_DFC)) ||
+            (control == (MBUS_CONTROL_MASK_RSP_UD | MBUS_CONTROL_MASK_ACD)) ||
+            (control == (MBUS_CONTROL_MASK_RSP_UD | MBUS_CONTROL_MASK_DFC | MBUS_CONTROL_MASK_ACD)))
+        {
+            return 0;
+        }
+    }
+
+    snprintf(error_str, sizeof(error_str), "Unknown Control Code 0x%.2x", control);
+
+    return -1;
+}
+
 //------------------------------------------------------------------------------
 /// Verify that parsed frame is a valid M-bus frame.
 //
@@ -367,14 +443,8 @@ mbus_frame_verify(mbus_frame *frame)
                     return -1;
                 }
 
-                if ((frame->control !=  MBUS_CONTROL_MASK_SND_NKE)                          &&
-                    (frame->control !=  MBUS_CONTROL_MASK_REQ_UD1)                          &&
-                    (frame->control != (MBUS_CONTROL_MASK_REQ_UD1 | MBUS_CONTROL_MASK_FCB)) &&
-                    (frame->control !=  MBUS_CONTROL_MASK_REQ_UD2)                          &&
-                    (frame->control != (MBUS_CONTROL_MASK_REQ_UD2 | MBUS_CONTROL_MASK_FCB)))
+                if (mbus_frame_control_verify(frame->type, frame->control) != 0)
                 {
-                    snprintf(error_str, sizeof(error_str), "Unknown Control Code 0x%.2x", frame->control);
-
                     return -1;
                 }
 
@@ -390,15 +460,8 @@ mbus_frame_verify(mbus_frame *frame)
                     return -1;
                 }
 
-                if ((frame->control !=  MBUS_CONTROL_MASK_SND_UD)                          &&
-                    (frame->control != (MBUS_CONTROL_MASK_SND_UD | MBUS_CONTROL_MASK_FCB)) &&
-                    (frame->control !=  MBUS_CONTROL_MASK_RSP_UD)                          &&
-                    (frame->control != (MBUS_CONTROL_MASK_RSP_UD | MBUS_CONTROL_MASK_DFC)) &&
-                    (frame->control != (MBUS_CONTROL_MASK_RSP_UD | MBUS_CONTROL_MASK_ACD)) &&
-                    (frame->control != (MBUS_CONTROL_MASK_RSP_UD | MBUS_CONTROL_MASK_DFC | MBUS_CONTROL_MASK_ACD)))
+                if (mbus_frame_control_verify(frame->type, frame->control) != 0)
                 {
-                    snprintf(error_str, sizeof(error_str), "Unknown Control Code 0x%.2x", frame->control);
-
                     return -1;
                 }
 
@@ -892,33 +955,41 @@ mbus_data_manufacturer_encode(unsigned char *m_data, unsigned char *m_code)
 ///
 //------------------------------------------------------------------------------
 const char *
-mbus_decode_manufacturer(unsigned char byte1, unsigned char byte2)
+mbus_decode_manufacturer_r(unsigned char byte1, unsigned char byte2, char *buff, size_t size)
 {
-    static char m_str[4];
-
+    unsigned char m_bytes[2];
     int m_id;
 
-    m_str[0] = byte1;
-    m_str[1] = byte2;
+    if (size < 4)
+        return NULL;
+
+    m_bytes[0] = byte1;
+    m_bytes[1] = byte2;
+
+    mbus_data_int_decode(m_bytes, 2, &m_id);
 
-    mbus_data_int_decode(m_str, 2, &m_id);
+    buff[0] = (char)(((m_id>>10) & 0x001F) + 64);
+    buff[1] = (char)(((m_id>>5)  & 0x001F) + 64);
+    buff[2] = (char)(((m_id)     & 0x001F) + 64);
+    buff[3] = 0;
 
-    m_str[0] = (char)(((m_id>>10) & 0x001F) + 64);
-    m_str[1] = (char)(((m_id>>5)  & 0x001F) + 64);
-    m_str[2] = (char)(((m_id)     & 0x001F) + 64);
-    m_str[3] = 0;
+    return buff;
+}
+
+const char *
+mbus_decode_manufacturer(unsigned char byte1, unsigned char byte2)
+{
+    static char m_str[4];
 
-    return m_str;
+    return mbus_decode_manufacturer_r(byte1, byte2, m_str, sizeof(m_str));
 }
 
 const char *
 mbus_data_product_name(mbus_data_variable_header *header)
 {
-    static char buff[128];
+    const char *name = "";
     unsigned int manufacturer;
 
-    memset(buff, 0, sizeof(buff));
-
     if (header)
     {
         manufacturer = (header->manufacturer[1] << 8) + header->manufacturer[0];
@@ -930,7 +1001,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x02:
-                    strcpy(buff,"ABB Delta-Meter");
+                    name = "ABB Delta-Meter";
                     break;
             }
         }
@@ -939,22 +1010,22 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x09:
-                    strcpy(buff,"Itron CF Echo 2");
+                    name = "Itron CF Echo 2";
                     break;
                 case 0x0A:
-                    strcpy(buff,"Itron CF 51");
+                    name = "Itron CF 51";
                     break;
                 case 0x0B:
-                    strcpy(buff,"Itron CF 55");
+                    name = "Itron CF 55";
                     break;
                 case 0x0E:
-                    strcpy(buff,"Itron BM +m");
+                    name = "Itron BM +m";
                     break;
                 case 0x0F:
-                    strcpy(buff,"Itron CF 800");
+                    name = "Itron CF 800";
                     break;
                 case 0x14:
-                    strcpy(buff,"Itron CYBLE M-Bus 1.4");
+                    name = "Itron CYBLE M-Bus 1.4";
                     break;
             }
         }
@@ -962,19 +1033,19 @@ mbus_data_product_name(mbus_data_variable_header *header)
         {
             if (header->version >= 0xC0)
             {
-                strcpy(buff,"Aquametro CALEC ST");
+                name = "Aquametro CALEC ST";
             }
             else if (header->version >= 0x80)
             {
-                strcpy(buff,"Aquametro CALEC MB");
+                name = "Aquametro CALEC MB";
             }
             else if (header->version >= 0x40)
             {
-                strcpy(buff,"Aquametro SAPHIR");
+                name = "Aquametro SAPHIR";
             }
             else
             {
-                strcpy(buff,"Aquametro AMTRON");
+                name = "Aquametro AMTRON";
             }
         }
         else if (manufacturer == mbus_manufacturer_id("BEC"))
@@ -984,10 +1055,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
                 switch (header->version)
                 {
                     case 0x00:
-                        strcpy(buff,"Berg DCMi");
+                        name = "Berg DCMi";
                         break;
                     case 0x07:
-                        strcpy(buff,"Berg BLMi");
+                        name = "Berg BLMi";
                         break;
                 }
             }
@@ -996,7 +1067,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
                 switch (header->version)
                 {
                     case 0x71:
-                        strcpy(buff, "Berg BMB-10S0");
+                        name = "Berg BMB-10S0";
                         break;
                 }
             }
@@ -1006,10 +1077,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x00:
-                    strcpy(buff, ((header->medium == 0x06) ? "Engelmann WaterStar" : "Engelmann / Elster SensoStar 2"));
+                    name = ((header->medium == 0x06) ? "Engelmann WaterStar" : "Engelmann / Elster SensoStar 2");
                     break;
                 case 0x01:
-                    strcpy(buff,"Engelmann SensoStar 2C");
+                    name = "Engelmann SensoStar 2C";
                     break;
             }
         }
@@ -1018,13 +1089,13 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x02:
-                    strcpy(buff,"Elster TMP-A");
+                    name = "Elster TMP-A";
                     break;
                 case 0x0A:
-                    strcpy(buff,"Elster Falcon");
+                    name = "Elster Falcon";
                     break;
                 case 0x2F:
-                    strcpy(buff,"Elster F96 Plus");
+                    name = "Elster F96 Plus";
                     break;
             }
         }
@@ -1042,7 +1113,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
                 case 0x1B:
                 case 0x1C:
                 case 0x1D:
-                    strcpy(buff, "Elvaco CMa10");
+                    name = "Elvaco CMa10";
                     break;
                 case 0x32:
                 case 0x33:
@@ -1054,7 +1125,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
                 case 0x39:
                 case 0x3A:
                 case 0x3B:
-                    strcpy(buff,"Elvaco CMa11");
+                    name = "Elvaco CMa11";
                     break;
             }
         }
@@ -1063,7 +1134,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x00:
-                    strcpy(buff,"EMH DIZ");
+                    name = "EMH DIZ";
                     break;
             }
         }
@@ -1074,7 +1145,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
                 switch (header->version)
                 {
                     case 0x10:
-                        strcpy(buff,"EMU Professional 3/75 M-Bus");
+                        name = "EMU Professional 3/75 M-Bus";
                         break;
                 }
             }
@@ -1089,14 +1160,14 @@ mbus_data_product_name(mbus_data_variable_header *header)
                     case 0x2E:
                     case 0x2F:
                     case 0x30:
-                        strcpy(buff,"Carlo Gavazzi EM24");
+                        name = "Carlo Gavazzi EM24";
                         break;
                     case 0x39:
                     case 0x3A:
-                        strcpy(buff,"Carlo Gavazzi EM21");
+                        name = "Carlo Gavazzi EM21";
                         break;
                     case 0x40:
-                        strcpy(buff,"Carlo Gavazzi EM33");
+                        name = "Carlo Gavazzi EM33";
                         break;
                 }
             }
@@ -1106,7 +1177,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0xE6:
-                    strcpy(buff,"GMC-I A230 EMMOD 206");
+                    name = "GMC-I A230 EMMOD 206";
                     break;
             }
         }
@@ -1115,10 +1186,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x01:
-                    strcpy(buff,"Kamstrup 382 (6850-005)");
+                    name = "Kamstrup 382 (6850-005)";
                     break;
                 case 0x08:
-                    strcpy(buff,"Kamstrup Multical 601");
+                    name = "Kamstrup Multical 601";
                     break;
             }
         }
@@ -1127,10 +1198,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x02:
-                    strcpy(buff,"Allmess Megacontrol CF-50");
+                    name = "Allmess Megacontrol CF-50";
                     break;
                 case 0x06:
-                    strcpy(buff,"CF Compact / Integral MK MaXX");
+                    name = "CF Compact / Integral MK MaXX";
                     break;
             }
         }
@@ -1139,10 +1210,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x28:
-                    strcpy(buff,"ABB F95 Typ US770");
+                    name = "ABB F95 Typ US770";
                     break;
                 case 0x2F:
-                    strcpy(buff,"Hydrometer Sharky 775");
+                    name = "Hydrometer Sharky 775";
                     break;
             }
         }
@@ -1153,7 +1224,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
                 switch (header->version)
                 {
                     case 0x09:
-                        strcpy(buff,"Janitza UMG 96S");
+                        name = "Janitza UMG 96S";
                         break;
                 }
             }
@@ -1163,16 +1234,16 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x02:
-                    strcpy(buff,"Landis & Gyr Ultraheat 2WR5");
+                    name = "Landis & Gyr Ultraheat 2WR5";
                     break;
                 case 0x03:
-                    strcpy(buff,"Landis & Gyr Ultraheat 2WR6");
+                    name = "Landis & Gyr Ultraheat 2WR6";
                     break;
                 case 0x04:
-                    strcpy(buff,"Landis & Gyr Ultraheat UH50");
+                    name = "Landis & Gyr Ultraheat UH50";
                     break;
                 case 0x07:
-                    strcpy(buff,"Landis & Gyr Ultraheat T230");
+                    name = "Landis & Gyr Ultraheat T230";
                     break;
             }
         }
@@ -1181,7 +1252,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x99:
-                    strcpy(buff,"Siemens WFH21");
+                    name = "Siemens WFH21";
                     break;
             }
         }
@@ -1190,10 +1261,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x01:
-                    strcpy(buff,"NZR DHZ 5/63");
+                    name = "NZR DHZ 5/63";
                     break;
                 case 0x50:
-                    strcpy(buff,"NZR IC-M2");
+                    name = "NZR IC-M2";
                     break;
             }
         }
@@ -1202,7 +1273,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x03:
-                    strcpy(buff, "Rossweiner ETK/ETW Modularis");
+                    name = "Rossweiner ETK/ETW Modularis";
                     break;
             }
         }
@@ -1211,19 +1282,19 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x08:
-                    strcpy(buff, "Relay PadPuls M1");
+                    name = "Relay PadPuls M1";
                     break;
                 case 0x12:
-                    strcpy(buff, "Relay PadPuls M4");
+                    name = "Relay PadPuls M4";
                     break;
                 case 0x20:
-                    strcpy(buff, "Relay Padin 4");
+                    name = "Relay Padin 4";
                     break;
                 case 0x30:
-                    strcpy(buff, "Relay AnDi 4");
+                    name = "Relay AnDi 4";
                     break;
                 case 0x40:
-                    strcpy(buff, "Relay PadPuls M2");
+                    name = "Relay PadPuls M2";
                     break;
             }
         }
@@ -1232,7 +1303,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x69:
-                    strcpy(buff,"Ista sensonic II mbus");
+                    name = "Ista sensonic II mbus";
                     break;
             }
         }
@@ -1242,10 +1313,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             {
                 case 0x10:
                 case 0x19:
-                    strcpy(buff,"Saia-Burgess ALE3");
+                    name = "Saia-Burgess ALE3";
                     break;
                 case 0x11:
-                    strcpy(buff,"Saia-Burgess AWD3");
+                    name = "Saia-Burgess AWD3";
                     break;
             }
         }
@@ -1254,23 +1325,23 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->id_bcd[3])
             {
                 case 0x30:
-                    strcpy(buff,"Sensoco PT100");
+                    name = "Sensoco PT100";
                     break;
                 case 0x41:
-                    strcpy(buff,"Sensoco 2-NTC");
+                    name = "Sensoco 2-NTC";
                     break;
                 case 0x45:
-                    strcpy(buff,"Sensoco Laser Light");
+                    name = "Sensoco Laser Light";
                     break;
                 case 0x48:
-                    strcpy(buff,"Sensoco ADIO");
+                    name = "Sensoco ADIO";
                     break;
                 case 0x51:
                 case 0x61:
-                    strcpy(buff,"Sensoco THU");
+                    name = "Sensoco THU";
                     break;
                 case 0x80:
-                    strcpy(buff,"Sensoco PulseCounter for E-Meter");
+                    name = "Sensoco PulseCounter for E-Meter";
                     break;
             }
         }
@@ -1280,13 +1351,13 @@ mbus_data_product_name(mbus_data_variable_header *header)
             {
                 case 0x08:
                 case 0x19:
-                    strcpy(buff,"Sensus PolluCom E");
+                    name = "Sensus PolluCom E";
                     break;
                 case 0x0B:
-                    strcpy(buff,"Sensus PolluTherm");
+                    name = "Sensus PolluTherm";
                     break;
                 case 0x0E:
-                    strcpy(buff,"Sensus PolluStat E");
+                    name = "Sensus PolluStat E";
                     break;
             }
         }
@@ -1295,7 +1366,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x0D:
-                    strcpy(buff,"Sontex Supercal 531");
+                    name = "Sontex Supercal 531";
                     break;
             }
         }
@@ -1305,7 +1376,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             {
                 case 0x31:
                 case 0x34:
-                    strcpy(buff,"Sensus PolluTherm");
+                    name = "Sensus PolluTherm";
                     break;
             }
         }
@@ -1314,10 +1385,10 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x08:
-                    strcpy(buff,"Elster F2 / Deltamess F2");
+                    name = "Elster F2 / Deltamess F2";
                     break;
                 case 0x09:
-                    strcpy(buff,"Elster F4 / Kamstrup SVM F22");
+                    name = "Elster F4 / Kamstrup SVM F22";
                     break;
             }
         }
@@ -1326,7 +1397,7 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x26:
-                    strcpy(buff,"Techem m-bus S");
+                    name = "Techem m-bus S";
                     break;
             }
         }
@@ -1335,17 +1406,17 @@ mbus_data_product_name(mbus_data_variable_header *header)
             switch (header->version)
             {
                 case 0x81:
-                    strcpy(buff,"Minol Minocal C2");
+                    name = "Minol Minocal C2";
                     break;
                 case 0x82:
-                    strcpy(buff,"Minol Minocal WR3");
+                    name = "Minol Minocal WR3";
                     break;
             }
         }
 
     }
 
-    return buff;
+    return name;
 }
 
 //------------------------------------------------------------------------------
@@ -1380,64 +1451,63 @@ mbus_data_product_name(mbus_data_variable_header *header)
 /// For fixed-length frames, get a string describing the medium.
 ///
 const char *
-mbus_data_fixed_medium(mbus_data_fixed *data)
+mbus_data_fixed_medium_r(mbus_data_fixed *data, char *buff, size_t size)
 {
-    static char buff[256];
 
     if (data)
     {
         switch ( (data->cnt1_type&0xC0)>>6 | (data->cnt2_type&0xC0)>>4 )
         {
             case 0x00:
-                snprintf(buff, sizeof(buff), "Other");
+                snprintf(buff, size, "Other");
                 break;
             case 0x01:
-                snprintf(buff, sizeof(buff), "Oil");
+                snprintf(buff, size, "Oil");
                 break;
             case 0x02:
-                snprintf(buff, sizeof(buff), "Electricity");
+                snprintf(buff, size, "Electricity");
                 break;
             case 0x03:
-                snprintf(buff, sizeof(buff), "Gas");
+                snprintf(buff, size, "Gas");
                 break;
             case 0x04:
-                snprintf(buff, sizeof(buff), "Heat");
+                snprintf(buff, size, "Heat");
                 break;
             case 0x05:
-                snprintf(buff, sizeof(buff), "Steam");
+                snprintf(buff, size, "Steam");
                 break;
             case 0x06:
-                snprintf(buff, sizeof(buff), "Hot Water");
+                snprintf(buff, size, "Hot Water");
                 break;
             case 0x07:
-                snprintf(buff, sizeof(buff), "Water");
+                snprintf(buff, size, "Water");
                 break;
             case 0x08:
-                snprintf(buff, sizeof(buff), "H.C.A.");
+                snprintf(buff, size, "H.C.A.");
                 break;
             case 0x09:
-                snprintf(buff, sizeof(buff), "Reserved");
+                snprintf(buff, size, "Reserved");
                 break;
             case 0x0A:
-                snprintf(buff, sizeof(buff), "Gas Mode 2");
+                snprintf(buff, size, "Gas Mode 2");
                 break;
             case 0x0B:
-                snprintf(buff, sizeof(buff), "Heat Mode 2");
+                snprintf(buff, size, "Heat Mode 2");
                 break;
             case 0x0C:
-                snprintf(buff, sizeof(buff), "Hot Water Mode 2");
+                snprintf(buff, size, "Hot Water Mode 2");
                 break;
             case 0x0D:
-                snprintf(buff, sizeof(buff), "Water Mode 2");
+                snprintf(buff, size, "Water Mode 2");
                 break;
             case 0x0E:
-                snprintf(buff, sizeof(buff), "H.C.A. Mode 2");
+                snprintf(buff, size, "H.C.A. Mode 2");
                 break;
             case 0x0F:
-                snprintf(buff, sizeof(buff), "Reserved");
+                snprintf(buff, size, "Reserved");
                 break;
             default:
-                snprintf(buff, sizeof(buff), "unknown");
+                snprintf(buff, size, "unknown");
                 break;
         }
 
@@ -1447,6 +1517,14 @@ mbus_data_fixed_medium(mbus_data_fixed *data)
     return NULL;
 }
 
+const char *
+mbus_data_fixed_medium(mbus_data_fixed *data)
+{
+    static char buff[256];
+
+    return mbus_data_fixed_medium_r(data, buff, sizeof(buff));
+}
+
 
 //------------------------------------------------------------------------------
 //                        Hex code                            Hex code
@@ -1491,213 +1569,220 @@ mbus_data_fixed_medium(mbus_data_fixed *data)
 /// For fixed-length frames, get a string describing the unit of the data.
 ///
 const char *
-mbus_data_fixed_unit(int medium_unit_byte)
+mbus_data_fixed_unit_r(int medium_unit_byte, char *buff, size_t size)
 {
-    static char buff[256];
 
     switch (medium_unit_byte & 0x3F)
     {
         case 0x00:
-            snprintf(buff, sizeof(buff), "h,m,s");
+            snprintf(buff, size, "h,m,s");
             break;
         case 0x01:
-            snprintf(buff, sizeof(buff), "D,M,Y");
+            snprintf(buff, size, "D,M,Y");
             break;
 
         case 0x02:
-            snprintf(buff, sizeof(buff), "Wh");
+            snprintf(buff, size, "Wh");
             break;
         case 0x03:
-            snprintf(buff, sizeof(buff), "10 Wh");
+            snprintf(buff, size, "10 Wh");
             break;
         case 0x04:
-            snprintf(buff, sizeof(buff), "100 Wh");
+            snprintf(buff, size, "100 Wh");
             break;
         case 0x05:
-            snprintf(buff, sizeof(buff), "kWh");
+            snprintf(buff, size, "kWh");
             break;
         case 0x06:
-            snprintf(buff, sizeof(buff), "10 kWh");
+            snprintf(buff, size, "10 kWh");
             break;
         case 0x07:
-            snprintf(buff, sizeof(buff), "100 kWh");
+            snprintf(buff, size, "100 kWh");
             break;
         case 0x08:
-            snprintf(buff, sizeof(buff), "MWh");
+            snprintf(buff, size, "MWh");
             break;
         case 0x09:
-            snprintf(buff, sizeof(buff), "10 MWh");
+            snprintf(buff, size, "10 MWh");
             break;
         case 0x0A:
-            snprintf(buff, sizeof(buff), "100 MWh");
+            snprintf(buff, size, "100 MWh");
             break;
 
         case 0x0B:
-            snprintf(buff, sizeof(buff), "kJ");
+            snprintf(buff, size, "kJ");
             break;
         case 0x0C:
-            snprintf(buff, sizeof(buff), "10 kJ");
+            snprintf(buff, size, "10 kJ");
             break;
         case 0x0E:
-            snprintf(buff, sizeof(buff), "100 kJ");
+            snprintf(buff, size, "100 kJ");
             break;
         case 0x0D:
-            snprintf(buff, sizeof(buff), "MJ");
+            snprintf(buff, size, "MJ");
             break;
         case 0x0F:
-            snprintf(buff, sizeof(buff), "10 MJ");
+            snprintf(buff, size, "10 MJ");
             break;
         case 0x10:
-            snprintf(buff, sizeof(buff), "100 MJ");
+            snprintf(buff, size, "100 MJ");
             break;
         case 0x11:
-            snprintf(buff, sizeof(buff), "GJ");
+            snprintf(buff, size, "GJ");
             break;
         case 0x12:
-            snprintf(buff, sizeof(buff), "10 GJ");
+            snprintf(buff, size, "10 GJ");
             break;
         case 0x13:
-            snprintf(buff, sizeof(buff), "100 GJ");
+            snprintf(buff, size, "100 GJ");
             break;
 
         case 0x14:
-            snprintf(buff, sizeof(buff), "W");
+            snprintf(buff, size, "W");
             break;
         case 0x15:
-            snprintf(buff, sizeof(buff), "10 W");
+            snprintf(buff, size, "10 W");
             break;
         case 0x16:
-            snprintf(buff, sizeof(buff), "100 W");
+            snprintf(buff, size, "100 W");
             break;
         case 0x17:
-            snprintf(buff, sizeof(buff), "kW");
+            snprintf(buff, size, "kW");
             break;
         case 0x18:
-            snprintf(buff, sizeof(buff), "10 kW");
+            snprintf(buff, size, "10 kW");
             break;
         case 0x19:
-            snprintf(buff, sizeof(buff), "100 kW");
+            snprintf(buff, size, "100 kW");
             break;
         case 0x1A:
-            snprintf(buff, sizeof(buff), "MW");
+            snprintf(buff, size, "MW");
             break;
         case 0x1B:
-            snprintf(buff, sizeof(buff), "10 MW");
+            snprintf(buff, size, "10 MW");
             break;
         case 0x1C:
-            snprintf(buff, sizeof(buff), "100 MW");
+            snprintf(buff, size, "100 MW");
             break;
 
         case 0x1D:
-            snprintf(buff, sizeof(buff), "kJ/h");
+            snprintf(buff, size, "kJ/h");
             break;
         case 0x1E:
-            snprintf(buff, sizeof(buff), "10 kJ/h");
+            snprintf(buff, size, "10 kJ/h");
             break;
         case 0x1F:
-            snprintf(buff, sizeof(buff), "100 kJ/h");
+            snprintf(buff, size, "100 kJ/h");
             break;
         case 0x20:
-            snprintf(buff, sizeof(buff), "MJ/h");
+            snprintf(buff, size, "MJ/h");
             break;
         case 0x21:
-            snprintf(buff, sizeof(buff), "10 MJ/h");
+            snprintf(buff, size, "10 MJ/h");
             break;
         case 0x22:
-            snprintf(buff, sizeof(buff), "100 MJ/h");
+            snprintf(buff, size, "100 MJ/h");
             break;
         case 0x23:
-            snprintf(buff, sizeof(buff), "GJ/h");
+            snprintf(buff, size, "GJ/h");
             break;
         case 0x24:
-            snprintf(buff, sizeof(buff), "10 GJ/h");
+            snprintf(buff, size, "10 GJ/h");
             break;
         case 0x25:
-            snprintf(buff, sizeof(buff), "100 GJ/h");
+            snprintf(buff, size, "100 GJ/h");
             break;
 
         case 0x26:
-            snprintf(buff, sizeof(buff), "ml");
+            snprintf(buff, size, "ml");
             break;
         case 0x27:
-            snprintf(buff, sizeof(buff), "10 ml");
+            snprintf(buff, size, "10 ml");
             break;
         case 0x28:
-            snprintf(buff, sizeof(buff), "100 ml");
+            snprintf(buff, size, "100 ml");
             break;
         case 0x29:
-            snprintf(buff, sizeof(buff), "l");
+            snprintf(buff, size, "l");
             break;
         case 0x2A:
-            snprintf(buff, sizeof(buff), "10 l");
+            snprintf(buff, size, "10 l");
             break;
         case 0x2B:
-            snprintf(buff, sizeof(buff), "100 l");
+            snprintf(buff, size, "100 l");
             break;
         case 0x2C:
-            snprintf(buff, sizeof(buff), "m^3");
+            snprintf(buff, size, "m^3");
             break;
         case 0x2D:
-            snprintf(buff, sizeof(buff), "10 m^3");
+            snprintf(buff, size, "10 m^3");
             break;
         case 0x2E:
-            snprintf(buff, sizeof(buff), "100 m^3");
+            snprintf(buff, size, "100 m^3");
             break;
 
         case 0x2F:
-            snprintf(buff, sizeof(buff), "ml/h");
+            snprintf(buff, size, "ml/h");
             break;
         case 0x30:
-            snprintf(buff, sizeof(buff), "10 ml/h");
+            snprintf(buff, size, "10 ml/h");
             break;
         case 0x31:
-            snprintf(buff, sizeof(buff), "100 ml/h");
+            snprintf(buff, size, "100 ml/h");
             break;
         case 0x32:
-            snprintf(buff, sizeof(buff), "l/h");
+            snprintf(buff, size, "l/h");
             break;
         case 0x33:
-            snprintf(buff, sizeof(buff), "10 l/h");
+            snprintf(buff, size, "10 l/h");
             break;
         case 0x34:
-            snprintf(buff, sizeof(buff), "100 l/h");
+            snprintf(buff, size, "100 l/h");
             break;
         case 0x35:
-            snprintf(buff, sizeof(buff), "m^3/h");
+            snprintf(buff, size, "m^3/h");
             break;
         case 0x36:
-            snprintf(buff, sizeof(buff), "10 m^3/h");
+            snprintf(buff, size, "10 m^3/h");
             break;
         case 0x37:
-            snprintf(buff, sizeof(buff), "100 m^3/h");
+            snprintf(buff, size, "100 m^3/h");
             break;
 
         case 0x38:
-            snprintf(buff, sizeof(buff), "1e-3 °C");
+            snprintf(buff, size, "1e-3 °C");
             break;
         case 0x39:
-            snprintf(buff, sizeof(buff), "units for HCA");
+            snprintf(buff, size, "units for HCA");
             break;
         case 0x3A:
         case 0x3B:
         case 0x3C:
         case 0x3D:
-            snprintf(buff, sizeof(buff), "reserved");
+            snprintf(buff, size, "reserved");
             break;
         case 0x3E:
-            snprintf(buff, sizeof(buff), "reserved but historic");
+            snprintf(buff, size, "reserved but historic");
             break;
         case 0x3F:
-            snprintf(buff, sizeof(buff), "without units");
+            snprintf(buff, size, "without units");
             break;
         default:
-            snprintf(buff, sizeof(buff), "unknown");
+            snprintf(buff, size, "unknown");
             break;
     }
 
     return buff;
 }
 
+const char *
+mbus_data_fixed_unit(int medium_unit_byte)
+{
+    static char buff[256];
+
+    return mbus_data_fixed_unit_r(medium_unit_byte, buff, sizeof(buff));
+}
+
 //------------------------------------------------------------------------------
 //
 // VARIABLE-LENGTH DATA RECORD FUNCTIONS
@@ -1763,158 +1848,157 @@ mbus_data_fixed_unit(int medium_unit_byte)
 /// For variable-length frames, returns a string describing the medium.
 ///
 const char *
-mbus_data_variable_medium_lookup(unsigned char medium)
+mbus_data_variable_medium_lookup_r(unsigned char medium, char *buff, size_t size)
 {
-    static char buff[256];
 
     switch (medium)
     {
         case MBUS_VARIABLE_DATA_MEDIUM_OTHER:
-            snprintf(buff, sizeof(buff), "Other");
+            snprintf(buff, size, "Other");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_OIL:
-            snprintf(buff, sizeof(buff), "Oil");
+            snprintf(buff, size, "Oil");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_ELECTRICITY:
-            snprintf(buff, sizeof(buff), "Electricity");
+            snprintf(buff, size, "Electricity");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_GAS:
-            snprintf(buff, sizeof(buff), "Gas");
+            snprintf(buff, size, "Gas");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_HEAT_OUT:
-            snprintf(buff, sizeof(buff), "Heat: Outlet");
+            snprintf(buff, size, "Heat: Outlet");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_STEAM:
-            snprintf(buff, sizeof(buff), "Steam");
+            snprintf(buff, size, "Steam");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_HOT_WATER:
-            snprintf(buff, sizeof(buff), "Warm water (30-90°C)");
+            snprintf(buff, size, "Warm water (30-90°C)");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_WATER:
-            snprintf(buff, sizeof(buff), "Water");
+            snprintf(buff, size, "Water");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_HEAT_COST:
-            snprintf(buff, sizeof(buff), "Heat Cost Allocator");
+            snprintf(buff, size, "Heat Cost Allocator");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_COMPR_AIR:
-            snprintf(buff, sizeof(buff), "Compressed Air");
+            snprintf(buff, size, "Compressed Air");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_COOL_OUT:
-            snprintf(buff, sizeof(buff), "Cooling load meter: Outlet");
+            snprintf(buff, size, "Cooling load meter: Outlet");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_COOL_IN:
-            snprintf(buff, sizeof(buff), "Cooling load meter: Inlet");
+            snprintf(buff, size, "Cooling load meter: Inlet");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_HEAT_IN:
-            snprintf(buff, sizeof(buff), "Heat: Inlet");
+            snprintf(buff, size, "Heat: Inlet");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_HEAT_COOL:
-            snprintf(buff, sizeof(buff), "Heat / Cooling load meter");
+            snprintf(buff, size, "Heat / Cooling load meter");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_BUS:
-            snprintf(buff, sizeof(buff), "Bus/System");
+            snprintf(buff, size, "Bus/System");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_UNKNOWN:
-            snprintf(buff, sizeof(buff), "Unknown Medium");
+            snprintf(buff, size, "Unknown Medium");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_IRRIGATION:
-            snprintf(buff, sizeof(buff), "Irrigation Water");
+            snprintf(buff, size, "Irrigation Water");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_WATER_LOGGER:
-            snprintf(buff, sizeof(buff), "Water Logger");
+            snprintf(buff, size, "Water Logger");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_GAS_LOGGER:
-            snprintf(buff, sizeof(buff), "Gas Logger");
+            snprintf(buff, size, "Gas Logger");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_GAS_CONV:
-            snprintf(buff, sizeof(buff), "Gas Converter");
+            snprintf(buff, size, "Gas Converter");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_COLORIFIC:
-            snprintf(buff, sizeof(buff), "Calorific value");
+            snprintf(buff, size, "Calorific value");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_BOIL_WATER:
-            snprintf(buff, sizeof(buff), "Hot water (>90°C)");
+            snprintf(buff, size, "Hot water (>90°C)");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_COLD_WATER:
-            snprintf(buff, sizeof(buff), "Cold water");
+            snprintf(buff, size, "Cold water");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_DUAL_WATER:
-            snprintf(buff, sizeof(buff), "Dual water");
+            snprintf(buff, size, "Dual water");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_PRESSURE:
-            snprintf(buff, sizeof(buff), "Pressure");
+            snprintf(buff, size, "Pressure");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_ADC:
-            snprintf(buff, sizeof(buff), "A/D Converter");
+            snprintf(buff, size, "A/D Converter");
             break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_SMOKE:
-          snprintf(buff, sizeof(buff), "Smoke Detector");
+          snprintf(buff, size, "Smoke Detector");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_ROOM_SENSOR:
-          snprintf(buff, sizeof(buff), "Ambient Sensor");
+          snprintf(buff, size, "Ambient Sensor");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_GAS_DETECTOR:
-          snprintf(buff, sizeof(buff), "Gas Detector");
+          snprintf(buff, size, "Gas Detector");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_BREAKER_E:
-          snprintf(buff, sizeof(buff), "Breaker: Electricity");
+          snprintf(buff, size, "Breaker: Electricity");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_VALVE:
-          snprintf(buff, sizeof(buff), "Valve: Gas or Water");
+          snprintf(buff, size, "Valve: Gas or Water");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_CUSTOMER_UNIT:
-          snprintf(buff, sizeof(buff), "Customer Unit: Display Device");
+          snprintf(buff, size, "Customer Unit: Display Device");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_WASTE_WATER:
-          snprintf(buff, sizeof(buff), "Waste Water");
+          snprintf(buff, size, "Waste Water");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_GARBAGE:
-          snprintf(buff, sizeof(buff), "Garbage");
+          snprintf(buff, size, "Garbage");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_SERVICE_UNIT:
-          snprintf(buff, sizeof(buff), "Service Unit");
+          snprintf(buff, size, "Service Unit");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_RC_SYSTEM:
-          snprintf(buff, sizeof(buff), "Radio Converter: System");
+          snprintf(buff, size, "Radio Converter: System");
           break;
 
         case MBUS_VARIABLE_DATA_MEDIUM_RC_METER:
-          snprintf(buff, sizeof(buff), "Radio Converter: Meter");
+          snprintf(buff, size, "Radio Converter: Meter");
           break;
 
         case 0x22:
@@ -1940,28 +2024,35 @@ mbus_data_variable_medium_lookup(unsigned char medium)
         case 0x3D:
         case 0x3E:
         case 0x3F:
-            snprintf(buff, sizeof(buff), "Reserved");
+            snprintf(buff, size, "Reserved");
             break;
 
 
         // add more ...
         default:
-            snprintf(buff, sizeof(buff), "Unknown medium (0x%.2x)", medium);
+            snprintf(buff, size, "Unknown medium (0x%.2x)", medium);
             break;
     }
 
     return buff;
 }
 
+const char *
+mbus_data_variable_medium_lookup(unsigned char medium)
+{
+    static char buff[256];
+
+    return mbus_data_variable_medium_lookup_r(medium, buff, sizeof(buff));
+}
+
 //------------------------------------------------------------------------------
 ///
 /// Lookup the unit description from a VIF field in a data record
 ///
 //------------------------------------------------------------------------------
 const char *
-mbus_unit_prefix(int exp)
+mbus_unit_prefix_r(int exp, char *buff, size_t size)
 {
-    static char buff[256];
 
     switch (exp)
     {
@@ -1970,48 +2061,56 @@ mbus_unit_prefix(int exp)
             break;
 
         case -3:
-            snprintf(buff, sizeof(buff), "m");
+            snprintf(buff, size, "m");
             break;
 
         case -6:
-            snprintf(buff, sizeof(buff), "my");
+            snprintf(buff, size, "my");
             break;
 
         case 1:
-            snprintf(buff, sizeof(buff), "10 ");
+            snprintf(buff, size, "10 ");
             break;
 
         case 2:
-            snprintf(buff, sizeof(buff), "100 ");
+            snprintf(buff, size, "100 ");
             break;
 
         case 3:
-            snprintf(buff, sizeof(buff), "k");
+            snprintf(buff, size, "k");
             break;
 
         case 4:
-            snprintf(buff, sizeof(buff), "10 k");
+            snprintf(buff, size, "10 k");
             break;
 
         case 5:
-            snprintf(buff, sizeof(buff), "100 k");
+            snprintf(buff, size, "100 k");
             break;
 
         case 6:
-            snprintf(buff, sizeof(buff), "M");
+            snprintf(buff, size, "M");
             break;
 
         case 9:
-            snprintf(buff, sizeof(buff), "G");
+            snprintf(buff, size, "G");
             break;
 
         default:
-            snprintf(buff, sizeof(buff), "1e%d ", exp);
+            snprintf(buff, size, "1e%d ", exp);
     }
 
     return buff;
 }
 
+const char *
+mbus_unit_prefix(int exp)
+{
+    static char buff[256];
+
+    return mbus_unit_prefix_r(exp, buff, sizeof(buff));
+}
+
 //------------------------------------------------------------------------------
 /// Look up the data length from a DIF field in the data record.
 ///
@@ -2064,330 +2163,629 @@ mbus_dif_datalength_lookup(unsigned char dif)
 }
 
 //------------------------------------------------------------------------------
-/// Look up the unit from a VIF field in the data record.
-///
-/// See section 8.4.3  Codes for Value Information Field (VIF) in the M-BUS spec
+/// Unit tables of the VIF and the first VIFE after 0xFB/0xFD, indexed by the
+/// code without extension bit: quantity, unit, decimal exponent and the text of
+/// mbus_vib_unit_lookup (a format for the code byte in case of unknown or
+/// reserved codes).
 //------------------------------------------------------------------------------
-const char *
-mbus_vif_unit_lookup(unsigned char vif)
-{
-    static char buff[256];
-    int n;
-
-    switch (vif & MBUS_DIB_VIF_WITHOUT_EXTENSION) // ignore the extension bit in this selection
-    {
-        // E000 0nnn Energy 10(nnn-3) W
-        case 0x00:
-        case 0x00+1:
-        case 0x00+2:
-        case 0x00+3:
-        case 0x00+4:
-        case 0x00+5:
-        case 0x00+6:
-        case 0x00+7:
-            n = (vif & 0x07) - 3;
-            snprintf(buff, sizeof(buff), "Energy (%sWh)", mbus_unit_prefix(n));
-            break;
-
-        // 0000 1nnn          Energy       10(nnn)J     (0.001kJ to 10000kJ)
-        case 0x08:
-        case 0x08+1:
-        case 0x08+2:
-        case 0x08+3:
-        case 0x08+4:
-        case 0x08+5:
-        case 0x08+6:
-        case 0x08+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Energy (%sJ)", mbus_unit_prefix(n));
-
-            break;
-
-        // E001 1nnn Mass 10(nnn-3) kg 0.001kg to 10000kg
-        case 0x18:
-        case 0x18+1:
-        case 0x18+2:
-        case 0x18+3:
-        case 0x18+4:
-        case 0x18+5:
-        case 0x18+6:
-        case 0x18+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Mass (%skg)", mbus_unit_prefix(n-3));
-
-            break;
-
-        // E010 1nnn Power 10(nnn-3) W 0.001W to 10000W
-        case 0x28:
-        case 0x28+1:
-        case 0x28+2:
-        case 0x28+3:
-        case 0x28+4:
-        case 0x28+5:
-        case 0x28+6:
-        case 0x28+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Power (%sW)", mbus_unit_prefix(n-3));
-            //snprintf(buff, sizeof(buff), "Power (10^%d W)", n-3);
-
-            break;
-
-        // E011 0nnn Power 10(nnn) J/h 0.001kJ/h to 10000kJ/h
-        case 0x30:
-        case 0x30+1:
-        case 0x30+2:
-        case 0x30+3:
-        case 0x30+4:
-        case 0x30+5:
-        case 0x30+6:
-        case 0x30+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Power (%sJ/h)", mbus_unit_prefix(n));
-
-            break;
-
-        // E001 0nnn Volume 10(nnn-6) m3 0.001l to 10000l
-        case 0x10:
-        case 0x10+1:
-        case 0x10+2:
-        case 0x10+3:
-        case 0x10+4:
-        case 0x10+5:
-        case 0x10+6:
-        case 0x10+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Volume (%s m^3)", mbus_unit_prefix(n-6));
+typedef struct _mbus_vif_unit {
+    unsigned char quantity;   // mbus_quantity
+    unsigned char unit;       // mbus_unit
+    signed char   exponent;
+    const char   *text;
+} mbus_vif_unit;
 
-            break;
-
-        // E011 1nnn Volume Flow 10(nnn-6) m3/h 0.001l/h to 10000l/
-        case 0x38:
-        case 0x38+1:
-        case 0x38+2:
-        case 0x38+3:
-        case 0x38+4:
-        case 0x38+5:
-        case 0x38+6:
-        case 0x38+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Volume flow (%s m^3/h)", mbus_unit_prefix(n-6));
-
-            break;
-
-        // E100 0nnn Volume Flow ext. 10(nnn-7) m3/min 0.0001l/min to 1000l/min
-        case 0x40:
-        case 0x40+1:
-        case 0x40+2:
-        case 0x40+3:
-        case 0x40+4:
-        case 0x40+5:
-        case 0x40+6:
-        case 0x40+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Volume flow (%s m^3/min)", mbus_unit_prefix(n-7));
-
-            break;
-
-        // E100 1nnn Volume Flow ext. 10(nnn-9) m3/s 0.001ml/s to 10000ml/
-        case 0x48:
-        case 0x48+1:
-        case 0x48+2:
-        case 0x48+3:
-        case 0x48+4:
-        case 0x48+5:
-        case 0x48+6:
-        case 0x48+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Volume flow (%s m^3/s)", mbus_unit_prefix(n-9));
-
-            break;
-
-        // E101 0nnn Mass flow 10(nnn-3) kg/h 0.001kg/h to 10000kg/
-        case 0x50:
-        case 0x50+1:
-        case 0x50+2:
-        case 0x50+3:
-        case 0x50+4:
-        case 0x50+5:
-        case 0x50+6:
-        case 0x50+7:
-
-            n = (vif & 0x07);
-            snprintf(buff, sizeof(buff), "Mass flow (%s kg/h)", mbus_unit_prefix(n-3));
-
-            break;
-
-        // E101 10nn Flow Temperature 10(nn-3) °C 0.001°C to 1°C
-        case 0x58:
-        case 0x58+1:
-        case 0x58+2:
-        case 0x58+3:
-
-            n = (vif & 0x03);
-            snprintf(buff, sizeof(buff), "Flow temperature (%sdeg C)", mbus_unit_prefix(n-3));
-
-            break;
-
-        // E101 11nn Return Temperature 10(nn-3) °C 0.001°C to 1°C
-        case 0x5C:
-        case 0x5C+1:
-        case 0x5C+2:
-        case 0x5C+3:
-
-            n = (vif & 0x03);
-            snprintf(buff, sizeof(buff), "Return temperature (%sdeg C)", mbus_unit_prefix(n-3));
-
-            break;
-
-        // E110 10nn Pressure 10(nn-3) bar 1mbar to 1000mbar
-        case 0x68:
-        case 0x68+1:
-        case 0x68+2:
-        case 0x68+3:
-
-            n = (vif & 0x03);
-            snprintf(buff, sizeof(buff), "Pressure (%s bar)", mbus_unit_prefix(n-3));
-
-            break;
-
-        // E010 00nn On Time
-        // nn = 00 seconds
-        // nn = 01 minutes
-        // nn = 10   hours
-        // nn = 11    days
-        // E010 01nn Operating Time coded like OnTime
-        // E111 00nn Averaging Duration coded like OnTime
-        // E111 01nn Actuality Duration coded like OnTime
-        case 0x20:
-        case 0x20+1:
-        case 0x20+2:
-        case 0x20+3:
-        case 0x24:
-        case 0x24+1:
-        case 0x24+2:
-        case 0x24+3:
-        case 0x70:
-        case 0x70+1:
-        case 0x70+2:
-        case 0x70+3:
-        case 0x74:
-        case 0x74+1:
-        case 0x74+2:
-        case 0x74+3:
-            {
-                int offset;
-
-                if      ((vif & 0x7C) == 0x20)
-                    offset = snprintf(buff, sizeof(buff), "On time ");
-                else if ((vif & 0x7C) == 0x24)
-                    offset = snprintf(buff, sizeof(buff), "Operating time ");
-                else if ((vif & 0x7C) == 0x70)
-                    offset = snprintf(buff, sizeof(buff), "Averaging Duration ");
-                else
-                    offset = snprintf(buff, sizeof(buff), "Actuality Duration ");
-
-                switch (vif & 0x03)
-                {
-                    case 0x00:
-                        snprintf(&buff[offset], sizeof(buff)-offset, "(seconds)");
-                        break;
-                    case 0x01:
-                        snprintf(&buff[offset], sizeof(buff)-offset, "(minutes)");
-                        break;
-                    case 0x02:
-                        snprintf(&buff[offset], sizeof(buff)-offset, "(hours)");
-                        break;
-                    case 0x03:
-                        snprintf(&buff[offset], sizeof(buff)-offset, "(days)");
-                        break;
-                }
-            }
-            break;
-
-        // E110 110n Time Point
-        // n = 0        date
-        // n = 1 time & date
-        // data type G
-        // data type F
-        case 0x6C:
-        case 0x6C+1:
+//
+// Primary VIF (VIF & 0x7F), see section 8.4.3 of the M-Bus spec
+//
+static const mbus_vif_unit mbus_vif_units[128] = {
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,               -3, "Energy (mWh)" }, // 0x00
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,               -2, "Energy (1e-2 Wh)" }, // 0x01
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,               -1, "Energy (1e-1 Wh)" }, // 0x02
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                0, "Energy (Wh)" }, // 0x03
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                1, "Energy (10 Wh)" }, // 0x04
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                2, "Energy (100 Wh)" }, // 0x05
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                3, "Energy (kWh)" }, // 0x06
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                4, "Energy (10 kWh)" }, // 0x07
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 0, "Energy (J)" }, // 0x08
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 1, "Energy (10 J)" }, // 0x09
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 2, "Energy (100 J)" }, // 0x0A
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 3, "Energy (kJ)" }, // 0x0B
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 4, "Energy (10 kJ)" }, // 0x0C
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 5, "Energy (100 kJ)" }, // 0x0D
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 6, "Energy (MJ)" }, // 0x0E
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 7, "Energy (1e7 J)" }, // 0x0F
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,               -6, "Volume (my m^3)" }, // 0x10
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,               -5, "Volume (1e-5  m^3)" }, // 0x11
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,               -4, "Volume (1e-4  m^3)" }, // 0x12
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,               -3, "Volume (m m^3)" }, // 0x13
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,               -2, "Volume (1e-2  m^3)" }, // 0x14
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,               -1, "Volume (1e-1  m^3)" }, // 0x15
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,                0, "Volume ( m^3)" }, // 0x16
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,                1, "Volume (10  m^3)" }, // 0x17
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,               -3, "Mass (mkg)" }, // 0x18
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,               -2, "Mass (1e-2 kg)" }, // 0x19
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,               -1, "Mass (1e-1 kg)" }, // 0x1A
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                0, "Mass (kg)" }, // 0x1B
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                1, "Mass (10 kg)" }, // 0x1C
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                2, "Mass (100 kg)" }, // 0x1D
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                3, "Mass (kkg)" }, // 0x1E
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                4, "Mass (10 kkg)" }, // 0x1F
+    { MBUS_QUANTITY_ON_TIME,                   MBUS_UNIT_SECOND,            0, "On time (seconds)" }, // 0x20
+    { MBUS_QUANTITY_ON_TIME,                   MBUS_UNIT_MINUTE,            0, "On time (minutes)" }, // 0x21
+    { MBUS_QUANTITY_ON_TIME,                   MBUS_UNIT_HOUR,              0, "On time (hours)" }, // 0x22
+    { MBUS_QUANTITY_ON_TIME,                   MBUS_UNIT_DAY,               0, "On time (days)" }, // 0x23
+    { MBUS_QUANTITY_OPERATING_TIME,            MBUS_UNIT_SECOND,            0, "Operating time (seconds)" }, // 0x24
+    { MBUS_QUANTITY_OPERATING_TIME,            MBUS_UNIT_MINUTE,            0, "Operating time (minutes)" }, // 0x25
+    { MBUS_QUANTITY_OPERATING_TIME,            MBUS_UNIT_HOUR,              0, "Operating time (hours)" }, // 0x26
+    { MBUS_QUANTITY_OPERATING_TIME,            MBUS_UNIT_DAY,               0, "Operating time (days)" }, // 0x27
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                -3, "Power (mW)" }, // 0x28
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                -2, "Power (1e-2 W)" }, // 0x29
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                -1, "Power (1e-1 W)" }, // 0x2A
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 0, "Power (W)" }, // 0x2B
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 1, "Power (10 W)" }, // 0x2C
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 2, "Power (100 W)" }, // 0x2D
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 3, "Power (kW)" }, // 0x2E
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 4, "Power (10 kW)" }, // 0x2F
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           0, "Power (J/h)" }, // 0x30
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           1, "Power (10 J/h)" }, // 0x31
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           2, "Power (100 J/h)" }, // 0x32
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           3, "Power (kJ/h)" }, // 0x33
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           4, "Power (10 kJ/h)" }, // 0x34
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           5, "Power (100 kJ/h)" }, // 0x35
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           6, "Power (MJ/h)" }, // 0x36
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           7, "Power (1e7 J/h)" }, // 0x37
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,         -6, "Volume flow (my m^3/h)" }, // 0x38
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,         -5, "Volume flow (1e-5  m^3/h)" }, // 0x39
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,         -4, "Volume flow (1e-4  m^3/h)" }, // 0x3A
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,         -3, "Volume flow (m m^3/h)" }, // 0x3B
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,         -2, "Volume flow (1e-2  m^3/h)" }, // 0x3C
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,         -1, "Volume flow (1e-1  m^3/h)" }, // 0x3D
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,          0, "Volume flow ( m^3/h)" }, // 0x3E
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_H,          1, "Volume flow (10  m^3/h)" }, // 0x3F
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -7, "Volume flow (1e-7  m^3/min)" }, // 0x40
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -6, "Volume flow (my m^3/min)" }, // 0x41
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -5, "Volume flow (1e-5  m^3/min)" }, // 0x42
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -4, "Volume flow (1e-4  m^3/min)" }, // 0x43
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -3, "Volume flow (m m^3/min)" }, // 0x44
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -2, "Volume flow (1e-2  m^3/min)" }, // 0x45
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,       -1, "Volume flow (1e-1  m^3/min)" }, // 0x46
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_MIN,        0, "Volume flow ( m^3/min)" }, // 0x47
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -9, "Volume flow (1e-9  m^3/s)" }, // 0x48
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -8, "Volume flow (1e-8  m^3/s)" }, // 0x49
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -7, "Volume flow (1e-7  m^3/s)" }, // 0x4A
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -6, "Volume flow (my m^3/s)" }, // 0x4B
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -5, "Volume flow (1e-5  m^3/s)" }, // 0x4C
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -4, "Volume flow (1e-4  m^3/s)" }, // 0x4D
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -3, "Volume flow (m m^3/s)" }, // 0x4E
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_M3_PER_S,         -2, "Volume flow (1e-2  m^3/s)" }, // 0x4F
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,         -3, "Mass flow (m kg/h)" }, // 0x50
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,         -2, "Mass flow (1e-2  kg/h)" }, // 0x51
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,         -1, "Mass flow (1e-1  kg/h)" }, // 0x52
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,          0, "Mass flow ( kg/h)" }, // 0x53
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,          1, "Mass flow (10  kg/h)" }, // 0x54
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,          2, "Mass flow (100  kg/h)" }, // 0x55
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,          3, "Mass flow (k kg/h)" }, // 0x56
+    { MBUS_QUANTITY_MASS_FLOW,                 MBUS_UNIT_KG_PER_H,          4, "Mass flow (10 k kg/h)" }, // 0x57
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_CELSIUS,          -3, "Flow temperature (mdeg C)" }, // 0x58
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_CELSIUS,          -2, "Flow temperature (1e-2 deg C)" }, // 0x59
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_CELSIUS,          -1, "Flow temperature (1e-1 deg C)" }, // 0x5A
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_CELSIUS,           0, "Flow temperature (deg C)" }, // 0x5B
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_CELSIUS,          -3, "Return temperature (mdeg C)" }, // 0x5C
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_CELSIUS,          -2, "Return temperature (1e-2 deg C)" }, // 0x5D
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_CELSIUS,          -1, "Return temperature (1e-1 deg C)" }, // 0x5E
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_CELSIUS,           0, "Return temperature (deg C)" }, // 0x5F
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_KELVIN,           -3, "Temperature Difference (m deg C)" }, // 0x60
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_KELVIN,           -2, "Temperature Difference (1e-2  deg C)" }, // 0x61
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_KELVIN,           -1, "Temperature Difference (1e-1  deg C)" }, // 0x62
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_KELVIN,            0, "Temperature Difference ( deg C)" }, // 0x63
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_CELSIUS,          -3, "External temperature (m deg C)" }, // 0x64
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_CELSIUS,          -2, "External temperature (1e-2  deg C)" }, // 0x65
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_CELSIUS,          -1, "External temperature (1e-1  deg C)" }, // 0x66
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_CELSIUS,           0, "External temperature ( deg C)" }, // 0x67
+    { MBUS_QUANTITY_PRESSURE,                  MBUS_UNIT_BAR,              -3, "Pressure (m bar)" }, // 0x68
+    { MBUS_QUANTITY_PRESSURE,                  MBUS_UNIT_BAR,              -2, "Pressure (1e-2  bar)" }, // 0x69
+    { MBUS_QUANTITY_PRESSURE,                  MBUS_UNIT_BAR,              -1, "Pressure (1e-1  bar)" }, // 0x6A
+    { MBUS_QUANTITY_PRESSURE,                  MBUS_UNIT_BAR,               0, "Pressure ( bar)" }, // 0x6B
+    { MBUS_QUANTITY_TIME_POINT,                MBUS_UNIT_DATE,              0, "Time Point (date)" }, // 0x6C
+    { MBUS_QUANTITY_TIME_POINT,                MBUS_UNIT_DATE_TIME,         0, "Time Point (time & date)" }, // 0x6D
+    { MBUS_QUANTITY_HCA_UNITS,                 MBUS_UNIT_NONE,              0, "Units for H.C.A." }, // 0x6E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x6F
+    { MBUS_QUANTITY_AVERAGING_DURATION,        MBUS_UNIT_SECOND,            0, "Averaging Duration (seconds)" }, // 0x70
+    { MBUS_QUANTITY_AVERAGING_DURATION,        MBUS_UNIT_MINUTE,            0, "Averaging Duration (minutes)" }, // 0x71
+    { MBUS_QUANTITY_AVERAGING_DURATION,        MBUS_UNIT_HOUR,              0, "Averaging Duration (hours)" }, // 0x72
+    { MBUS_QUANTITY_AVERAGING_DURATION,        MBUS_UNIT_DAY,               0, "Averaging Duration (days)" }, // 0x73
+    { MBUS_QUANTITY_ACTUALITY_DURATION,        MBUS_UNIT_SECOND,            0, "Actuality Duration (seconds)" }, // 0x74
+    { MBUS_QUANTITY_ACTUALITY_DURATION,        MBUS_UNIT_MINUTE,            0, "Actuality Duration (minutes)" }, // 0x75
+    { MBUS_QUANTITY_ACTUALITY_DURATION,        MBUS_UNIT_HOUR,              0, "Actuality Duration (hours)" }, // 0x76
+    { MBUS_QUANTITY_ACTUALITY_DURATION,        MBUS_UNIT_DAY,               0, "Actuality Duration (days)" }, // 0x77
+    { MBUS_QUANTITY_FABRICATION_NUMBER,        MBUS_UNIT_NONE,              0, "Fabrication number" }, // 0x78
+    { MBUS_QUANTITY_UNKNOWN,                   MBUS_UNIT_NONE,              0, "Unknown (VIF=0x%.2X)" }, // 0x79
+    { MBUS_QUANTITY_BUS_ADDRESS,               MBUS_UNIT_NONE,              0, "Bus Address" }, // 0x7A
+    { MBUS_QUANTITY_UNKNOWN,                   MBUS_UNIT_NONE,              0, "Unknown (VIF=0x%.2X)" }, // 0x7B
+    { MBUS_QUANTITY_CUSTOM,                    MBUS_UNIT_NONE,              0, "Custom VIF" }, // 0x7C
+    { MBUS_QUANTITY_UNKNOWN,                   MBUS_UNIT_NONE,              0, "Unknown (VIF=0x%.2X)" }, // 0x7D
+    { MBUS_QUANTITY_UNKNOWN,                   MBUS_UNIT_NONE,              0, "Unknown (VIF=0x%.2X)" }, // 0x7E
+    { MBUS_QUANTITY_MANUFACTURER_SPECIFIC,     MBUS_UNIT_NONE,              0, "Manufacturer specific" }, // 0x7F
+};
 
-            if (vif & 0x1)
-                snprintf(buff, sizeof(buff), "Time Point (time & date)");
-            else
-                snprintf(buff, sizeof(buff), "Time Point (date)");
+//
+// First VIFE after VIF 0xFB, see table 8.4.4 b
+//
+static const mbus_vif_unit mbus_vife_fb_units[128] = {
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                5, "Energy (0.1 MWh)" }, // 0x00
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_WH,                6, "Energy (MWh)" }, // 0x01
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x02
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x03
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x04
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x05
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x06
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x07
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 8, "Energy (0.1 GJ)" }, // 0x08
+    { MBUS_QUANTITY_ENERGY,                    MBUS_UNIT_J,                 9, "Energy (GJ)" }, // 0x09
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x0A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x0B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x0C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x0D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x0E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x0F
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,                2, "Volume (100 m3)" }, // 0x10
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_M3,                3, "Volume (km3)" }, // 0x11
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x12
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x13
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x14
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x15
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x16
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x17
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                5, "Mass (100 t)" }, // 0x18
+    { MBUS_QUANTITY_MASS,                      MBUS_UNIT_KG,                6, "Mass (kt)" }, // 0x19
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x1A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x1B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x1C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x1D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x1E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x1F
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x20
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_FEET3,            -1, "Volume (0.1 feet^3)" }, // 0x21
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_US_GALLON,        -1, "Volume (0.1 american gallon)" }, // 0x22
+    { MBUS_QUANTITY_VOLUME,                    MBUS_UNIT_US_GALLON,         0, "Volume (american gallon)" }, // 0x23
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_US_GALLON_PER_MIN,  -3, "Volume flow (0.001 american gallon/min)" }, // 0x24
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_US_GALLON_PER_MIN,   0, "Volume flow (american gallon/min)" }, // 0x25
+    { MBUS_QUANTITY_VOLUME_FLOW,               MBUS_UNIT_US_GALLON_PER_H,   0, "Volume flow (american gallon/h)" }, // 0x26
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x27
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 5, "Power (0.1 MW)" }, // 0x28
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_W,                 6, "Power (MW)" }, // 0x29
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x2A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x2B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x2C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x2D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x2E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x2F
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           8, "Power (0.1 GJ/h)" }, // 0x30
+    { MBUS_QUANTITY_POWER,                     MBUS_UNIT_J_PER_H,           9, "Power (GJ/h)" }, // 0x31
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x32
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x33
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x34
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x35
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x36
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x37
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x38
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x39
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x3A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x3B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x3C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x3D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x3E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x3F
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x40
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x41
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x42
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x43
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x44
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x45
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x46
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x47
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x48
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x49
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x4A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x4B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x4C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x4D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x4E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x4F
+    { MBUS_QUANTITY_UNKNOWN,                   MBUS_UNIT_NONE,              0, "Unrecognized VIF 0xFB extension: 0x%.2x" }, // 0x50
+    { MBUS_QUANTITY_UNKNOWN,                   MBUS_UNIT_NONE,              0, "Unrecognized VIF 0xFB extension: 0x%.2x" }, // 0x51
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x52
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x53
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x54
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x55
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x56
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x57
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_FAHRENHEIT,       -3, "Flow Temperature (m degree F)" }, // 0x58
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_FAHRENHEIT,       -2, "Flow Temperature (1e-2  degree F)" }, // 0x59
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_FAHRENHEIT,       -1, "Flow Temperature (1e-1  degree F)" }, // 0x5A
+    { MBUS_QUANTITY_FLOW_TEMPERATURE,          MBUS_UNIT_FAHRENHEIT,        0, "Flow Temperature ( degree F)" }, // 0x5B
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_FAHRENHEIT,       -3, "Return Temperature (m degree F)" }, // 0x5C
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_FAHRENHEIT,       -2, "Return Temperature (1e-2  degree F)" }, // 0x5D
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_FAHRENHEIT,       -1, "Return Temperature (1e-1  degree F)" }, // 0x5E
+    { MBUS_QUANTITY_RETURN_TEMPERATURE,        MBUS_UNIT_FAHRENHEIT,        0, "Return Temperature ( degree F)" }, // 0x5F
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_FAHRENHEIT,       -3, "Temperature Difference (m degree F)" }, // 0x60
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_FAHRENHEIT,       -2, "Temperature Difference (1e-2  degree F)" }, // 0x61
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_FAHRENHEIT,       -1, "Temperature Difference (1e-1  degree F)" }, // 0x62
+    { MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,    MBUS_UNIT_FAHRENHEIT,        0, "Temperature Difference ( degree F)" }, // 0x63
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_FAHRENHEIT,       -3, "External Temperature (m degree F)" }, // 0x64
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_FAHRENHEIT,       -2, "External Temperature (1e-2  degree F)" }, // 0x65
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_FAHRENHEIT,       -1, "External Temperature (1e-1  degree F)" }, // 0x66
+    { MBUS_QUANTITY_EXTERNAL_TEMPERATURE,      MBUS_UNIT_FAHRENHEIT,        0, "External Temperature ( degree F)" }, // 0x67
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x68
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x69
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x6A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x6B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x6C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x6D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x6E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved (0x%.2x)" }, // 0x6F
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_FAHRENHEIT,       -3, "Cold / Warm Temperature Limit (m degree F)" }, // 0x70
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_FAHRENHEIT,       -2, "Cold / Warm Temperature Limit (1e-2  degree F)" }, // 0x71
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_FAHRENHEIT,       -1, "Cold / Warm Temperature Limit (1e-1  degree F)" }, // 0x72
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_FAHRENHEIT,        0, "Cold / Warm Temperature Limit ( degree F)" }, // 0x73
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_CELSIUS,          -3, "Cold / Warm Temperature Limit (m degree C)" }, // 0x74
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_CELSIUS,          -2, "Cold / Warm Temperature Limit (1e-2  degree C)" }, // 0x75
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_CELSIUS,          -1, "Cold / Warm Temperature Limit (1e-1  degree C)" }, // 0x76
+    { MBUS_QUANTITY_TEMPERATURE_LIMIT,         MBUS_UNIT_CELSIUS,           0, "Cold / Warm Temperature Limit ( degree C)" }, // 0x77
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                -3, "cumul. count max power (m W)" }, // 0x78
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                -2, "cumul. count max power (1e-2  W)" }, // 0x79
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                -1, "cumul. count max power (1e-1  W)" }, // 0x7A
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                 0, "cumul. count max power ( W)" }, // 0x7B
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                 1, "cumul. count max power (10  W)" }, // 0x7C
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                 2, "cumul. count max power (100  W)" }, // 0x7D
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                 3, "cumul. count max power (k W)" }, // 0x7E
+    { MBUS_QUANTITY_MAX_POWER_COUNT,           MBUS_UNIT_W,                 4, "cumul. count max power (10 k W)" }, // 0x7F
+};
 
-            break;
+//
+// First VIFE after VIF 0xFD, see table 8.4.4 a
+//
+static const mbus_vif_unit mbus_vife_fd_units[128] = {
+    { MBUS_QUANTITY_CREDIT,                    MBUS_UNIT_CURRENCY,         -3, "Credit of m of the nominal local legal currency units" }, // 0x00
+    { MBUS_QUANTITY_CREDIT,                    MBUS_UNIT_CURRENCY,         -2, "Credit of 1e-2  of the nominal local legal currency units" }, // 0x01
+    { MBUS_QUANTITY_CREDIT,                    MBUS_UNIT_CURRENCY,         -1, "Credit of 1e-1  of the nominal local legal currency units" }, // 0x02
+    { MBUS_QUANTITY_CREDIT,                    MBUS_UNIT_CURRENCY,          0, "Credit of  of the nominal local legal currency units" }, // 0x03
+    { MBUS_QUANTITY_DEBIT,                     MBUS_UNIT_CURRENCY,         -3, "Debit of m of the nominal local legal currency units" }, // 0x04
+    { MBUS_QUANTITY_DEBIT,                     MBUS_UNIT_CURRENCY,         -2, "Debit of 1e-2  of the nominal local legal currency units" }, // 0x05
+    { MBUS_QUANTITY_DEBIT,                     MBUS_UNIT_CURRENCY,         -1, "Debit of 1e-1  of the nominal local legal currency units" }, // 0x06
+    { MBUS_QUANTITY_DEBIT,                     MBUS_UNIT_CURRENCY,          0, "Debit of  of the nominal local legal currency units" }, // 0x07
+    { MBUS_QUANTITY_ACCESS_NUMBER,             MBUS_UNIT_NONE,              0, "Access Number (transmission count)" }, // 0x08
+    { MBUS_QUANTITY_MEDIUM,                    MBUS_UNIT_NONE,              0, "Medium (as in fixed header)" }, // 0x09
+    { MBUS_QUANTITY_MANUFACTURER,              MBUS_UNIT_NONE,              0, "Manufacturer (as in fixed header)" }, // 0x0A
+    { MBUS_QUANTITY_PARAMETER_SET,             MBUS_UNIT_NONE,              0, "Parameter set identification" }, // 0x0B
+    { MBUS_QUANTITY_MODEL_VERSION,             MBUS_UNIT_NONE,              0, "Model / Version" }, // 0x0C
+    { MBUS_QUANTITY_HARDWARE_VERSION,          MBUS_UNIT_NONE,              0, "Hardware version" }, // 0x0D
+    { MBUS_QUANTITY_FIRMWARE_VERSION,          MBUS_UNIT_NONE,              0, "Firmware version" }, // 0x0E
+    { MBUS_QUANTITY_SOFTWARE_VERSION,          MBUS_UNIT_NONE,              0, "Software version" }, // 0x0F
+    { MBUS_QUANTITY_CUSTOMER_LOCATION,         MBUS_UNIT_NONE,              0, "Customer location" }, // 0x10
+    { MBUS_QUANTITY_CUSTOMER,                  MBUS_UNIT_NONE,              0, "Customer" }, // 0x11
+    { MBUS_QUANTITY_ACCESS_CODE_USER,          MBUS_UNIT_NONE,              0, "Access Code User" }, // 0x12
+    { MBUS_QUANTITY_ACCESS_CODE_OPERATOR,      MBUS_UNIT_NONE,              0, "Access Code Operator" }, // 0x13
+    { MBUS_QUANTITY_ACCESS_CODE_SYSTEM_OPERATOR, MBUS_UNIT_NONE,              0, "Access Code System Operator" }, // 0x14
+    { MBUS_QUANTITY_ACCESS_CODE_DEVELOPER,     MBUS_UNIT_NONE,              0, "Access Code Developer" }, // 0x15
+    { MBUS_QUANTITY_PASSWORD,                  MBUS_UNIT_NONE,              0, "Password" }, // 0x16
+    { MBUS_QUANTITY_ERROR_FLAGS,               MBUS_UNIT_NONE,              0, "Error flags" }, // 0x17
+    { MBUS_QUANTITY_ERROR_MASK,                MBUS_UNIT_NONE,              0, "Error mask" }, // 0x18
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x19
+    { MBUS_QUANTITY_DIGITAL_OUTPUT,            MBUS_UNIT_NONE,              0, "Digital output (binary)" }, // 0x1A
+    { MBUS_QUANTITY_DIGITAL_INPUT,             MBUS_UNIT_NONE,              0, "Digital input (binary)" }, // 0x1B
+    { MBUS_QUANTITY_BAUDRATE,                  MBUS_UNIT_BAUD,              0, "Baudrate" }, // 0x1C
+    { MBUS_QUANTITY_RESPONSE_DELAY,            MBUS_UNIT_BIT_TIMES,         0, "response delay time" }, // 0x1D
+    { MBUS_QUANTITY_RETRY,                     MBUS_UNIT_NONE,              0, "Retry" }, // 0x1E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x1F
+    { MBUS_QUANTITY_FIRST_STORAGE,             MBUS_UNIT_NONE,              0, "First storage # for cyclic storage" }, // 0x20
+    { MBUS_QUANTITY_LAST_STORAGE,              MBUS_UNIT_NONE,              0, "Last storage # for cyclic storage" }, // 0x21
+    { MBUS_QUANTITY_STORAGE_BLOCK_SIZE,        MBUS_UNIT_NONE,              0, "Size of storage block" }, // 0x22
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x23
+    { MBUS_QUANTITY_STORAGE_INTERVAL,          MBUS_UNIT_SECOND,            0, "Storage interval second(s)" }, // 0x24
+    { MBUS_QUANTITY_STORAGE_INTERVAL,          MBUS_UNIT_MINUTE,            0, "Storage interval minute(s)" }, // 0x25
+    { MBUS_QUANTITY_STORAGE_INTERVAL,          MBUS_UNIT_HOUR,              0, "Storage interval hour(s)" }, // 0x26
+    { MBUS_QUANTITY_STORAGE_INTERVAL,          MBUS_UNIT_DAY,               0, "Storage interval day(s)" }, // 0x27
+    { MBUS_QUANTITY_STORAGE_INTERVAL,          MBUS_UNIT_MONTH,             0, "Storage interval month(s)" }, // 0x28
+    { MBUS_QUANTITY_STORAGE_INTERVAL,          MBUS_UNIT_YEAR,              0, "Storage interval year(s)" }, // 0x29
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x2A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x2B
+    { MBUS_QUANTITY_DURATION_SINCE_READOUT,    MBUS_UNIT_SECOND,            0, "Duration since last readout second(s)" }, // 0x2C
+    { MBUS_QUANTITY_DURATION_SINCE_READOUT,    MBUS_UNIT_MINUTE,            0, "Duration since last readout minute(s)" }, // 0x2D
+    { MBUS_QUANTITY_DURATION_SINCE_READOUT,    MBUS_UNIT_HOUR,              0, "Duration since last readout hour(s)" }, // 0x2E
+    { MBUS_QUANTITY_DURATION_SINCE_READOUT,    MBUS_UNIT_DAY,               0, "Duration since last readout day(s)" }, // 0x2F
+    { MBUS_QUANTITY_TARIFF_START,              MBUS_UNIT_DATE_TIME,         0, "Start (date/time) of tariff" }, // 0x30
+    { MBUS_QUANTITY_TARIFF_DURATION,           MBUS_UNIT_MINUTE,            0, "Duration of tariff minute(s)" }, // 0x31
+    { MBUS_QUANTITY_TARIFF_DURATION,           MBUS_UNIT_HOUR,              0, "Duration of tariff hour(s)" }, // 0x32
+    { MBUS_QUANTITY_TARIFF_DURATION,           MBUS_UNIT_DAY,               0, "Duration of tariff day(s)" }, // 0x33
+    { MBUS_QUANTITY_TARIFF_PERIOD,             MBUS_UNIT_SECOND,            0, "Period of tariff second(s)" }, // 0x34
+    { MBUS_QUANTITY_TARIFF_PERIOD,             MBUS_UNIT_MINUTE,            0, "Period of tariff minute(s)" }, // 0x35
+    { MBUS_QUANTITY_TARIFF_PERIOD,             MBUS_UNIT_HOUR,              0, "Period of tariff hour(s)" }, // 0x36
+    { MBUS_QUANTITY_TARIFF_PERIOD,             MBUS_UNIT_DAY,               0, "Period of tariff day(s)" }, // 0x37
+    { MBUS_QUANTITY_TARIFF_PERIOD,             MBUS_UNIT_MONTH,             0, "Period of tariff months(s)" }, // 0x38
+    { MBUS_QUANTITY_TARIFF_PERIOD,             MBUS_UNIT_YEAR,              0, "Period of tariff year(s)" }, // 0x39
+    { MBUS_QUANTITY_DIMENSIONLESS,             MBUS_UNIT_NONE,              0, "dimensionless / no VIF" }, // 0x3A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x3B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x3C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x3D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x3E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved" }, // 0x3F
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -9, "1e-9  V" }, // 0x40
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -8, "1e-8  V" }, // 0x41
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -7, "1e-7  V" }, // 0x42
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -6, "my V" }, // 0x43
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -5, "1e-5  V" }, // 0x44
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -4, "1e-4  V" }, // 0x45
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -3, "m V" }, // 0x46
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -2, "1e-2  V" }, // 0x47
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                -1, "1e-1  V" }, // 0x48
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 0, " V" }, // 0x49
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 1, "10  V" }, // 0x4A
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 2, "100  V" }, // 0x4B
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 3, "k V" }, // 0x4C
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 4, "10 k V" }, // 0x4D
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 5, "100 k V" }, // 0x4E
+    { MBUS_QUANTITY_VOLTAGE,                   MBUS_UNIT_V,                 6, "M V" }, // 0x4F
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,               -12, "1e-12  A" }, // 0x50
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,               -11, "1e-11  A" }, // 0x51
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,               -10, "1e-10  A" }, // 0x52
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -9, "1e-9  A" }, // 0x53
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -8, "1e-8  A" }, // 0x54
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -7, "1e-7  A" }, // 0x55
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -6, "my A" }, // 0x56
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -5, "1e-5  A" }, // 0x57
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -4, "1e-4  A" }, // 0x58
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -3, "m A" }, // 0x59
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -2, "1e-2  A" }, // 0x5A
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                -1, "1e-1  A" }, // 0x5B
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                 0, " A" }, // 0x5C
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                 1, "10  A" }, // 0x5D
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                 2, "100  A" }, // 0x5E
+    { MBUS_QUANTITY_CURRENT,                   MBUS_UNIT_A,                 3, "k A" }, // 0x5F
+    { MBUS_QUANTITY_RESET_COUNTER,             MBUS_UNIT_NONE,              0, "Reset counter" }, // 0x60
+    { MBUS_QUANTITY_CUMULATION_COUNTER,        MBUS_UNIT_NONE,              0, "Cumulation counter" }, // 0x61
+    { MBUS_QUANTITY_CONTROL_SIGNAL,            MBUS_UNIT_NONE,              0, "Control signal" }, // 0x62
+    { MBUS_QUANTITY_DAY_OF_WEEK,               MBUS_UNIT_NONE,              0, "Day of week" }, // 0x63
+    { MBUS_QUANTITY_WEEK_NUMBER,               MBUS_UNIT_NONE,              0, "Week number" }, // 0x64
+    { MBUS_QUANTITY_DAY_CHANGE,                MBUS_UNIT_NONE,              0, "Time point of day change" }, // 0x65
+    { MBUS_QUANTITY_PARAMETER_ACTIVATION,      MBUS_UNIT_NONE,              0, "State of parameter activation" }, // 0x66
+    { MBUS_QUANTITY_SUPPLIER_INFORMATION,      MBUS_UNIT_NONE,              0, "Special supplier information" }, // 0x67
+    { MBUS_QUANTITY_DURATION_SINCE_CUMULATION, MBUS_UNIT_HOUR,              0, "Duration since last cumulation hour(s)" }, // 0x68
+    { MBUS_QUANTITY_DURATION_SINCE_CUMULATION, MBUS_UNIT_DAY,               0, "Duration since last cumulation day(s)" }, // 0x69
+    { MBUS_QUANTITY_DURATION_SINCE_CUMULATION, MBUS_UNIT_MONTH,             0, "Duration since last cumulation month(s)" }, // 0x6A
+    { MBUS_QUANTITY_DURATION_SINCE_CUMULATION, MBUS_UNIT_YEAR,              0, "Duration since last cumulation year(s)" }, // 0x6B
+    { MBUS_QUANTITY_BATTERY_OPERATING_TIME,    MBUS_UNIT_HOUR,              0, "Operating time battery hour(s)" }, // 0x6C
+    { MBUS_QUANTITY_BATTERY_OPERATING_TIME,    MBUS_UNIT_DAY,               0, "Operating time battery day(s)" }, // 0x6D
+    { MBUS_QUANTITY_BATTERY_OPERATING_TIME,    MBUS_UNIT_MONTH,             0, "Operating time battery month(s)" }, // 0x6E
+    { MBUS_QUANTITY_BATTERY_OPERATING_TIME,    MBUS_UNIT_YEAR,              0, "Operating time battery year(s)" }, // 0x6F
+    { MBUS_QUANTITY_BATTERY_CHANGE,            MBUS_UNIT_DATE_TIME,         0, "Date and time of battery change" }, // 0x70
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x71
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x72
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x73
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x74
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x75
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x76
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x77
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x78
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x79
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x7A
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x7B
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x7C
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x7D
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x7E
+    { MBUS_QUANTITY_RESERVED,                  MBUS_UNIT_NONE,              0, "Reserved VIF extension" }, // 0x7F
+};
+
+static const char *mbus_quantity_names[MBUS_QUANTITY_COUNT] = {
+    "Unknown",                             // MBUS_QUANTITY_UNKNOWN
+    "Reserved",                            // MBUS_QUANTITY_RESERVED
+    "Energy",                              // MBUS_QUANTITY_ENERGY
+    "Volume",                              // MBUS_QUANTITY_VOLUME
+    "Mass",                                // MBUS_QUANTITY_MASS
+    "On time",                             // MBUS_QUANTITY_ON_TIME
+    "Operating time",                      // MBUS_QUANTITY_OPERATING_TIME
+    "Power",                               // MBUS_QUANTITY_POWER
+    "Volume flow",                         // MBUS_QUANTITY_VOLUME_FLOW
+    "Mass flow",                           // MBUS_QUANTITY_MASS_FLOW
+    "Flow temperature",                    // MBUS_QUANTITY_FLOW_TEMPERATURE
+    "Return temperature",                  // MBUS_QUANTITY_RETURN_TEMPERATURE
+    "Temperature difference",              // MBUS_QUANTITY_TEMPERATURE_DIFFERENCE
+    "External temperature",                // MBUS_QUANTITY_EXTERNAL_TEMPERATURE
+    "Pressure",                            // MBUS_QUANTITY_PRESSURE
+    "Time point",                          // MBUS_QUANTITY_TIME_POINT
+    "Units for H.C.A.",                    // MBUS_QUANTITY_HCA_UNITS
+    "Averaging duration",                  // MBUS_QUANTITY_AVERAGING_DURATION
+    "Actuality duration",                  // MBUS_QUANTITY_ACTUALITY_DURATION
+    "Fabrication number",                  // MBUS_QUANTITY_FABRICATION_NUMBER
+    "Bus address",                         // MBUS_QUANTITY_BUS_ADDRESS
+    "Custom",                              // MBUS_QUANTITY_CUSTOM
+    "Manufacturer specific",               // MBUS_QUANTITY_MANUFACTURER_SPECIFIC
+    "Cold / Warm Temperature Limit",       // MBUS_QUANTITY_TEMPERATURE_LIMIT
+    "Cumul count max power",               // MBUS_QUANTITY_MAX_POWER_COUNT
+    "Credit",                              // MBUS_QUANTITY_CREDIT
+    "Debit",                               // MBUS_QUANTITY_DEBIT
+    "Access number",                       // MBUS_QUANTITY_ACCESS_NUMBER
+    "Medium",                              // MBUS_QUANTITY_MEDIUM
+    "Manufacturer",                        // MBUS_QUANTITY_MANUFACTURER
+    "Parameter set identification",        // MBUS_QUANTITY_PARAMETER_SET
+    "Model / Version",                     // MBUS_QUANTITY_MODEL_VERSION
+    "Hardware version",                    // MBUS_QUANTITY_HARDWARE_VERSION
+    "Firmware version",                    // MBUS_QUANTITY_FIRMWARE_VERSION
+    "Software version",                    // MBUS_QUANTITY_SOFTWARE_VERSION
+    "Customer location",                   // MBUS_QUANTITY_CUSTOMER_LOCATION
+    "Customer",                            // MBUS_QUANTITY_CUSTOMER
+    "Access code user",                    // MBUS_QUANTITY_ACCESS_CODE_USER
+    "Access code operator",                // MBUS_QUANTITY_ACCESS_CODE_OPERATOR
+    "Access code system operator",         // MBUS_QUANTITY_ACCESS_CODE_SYSTEM_OPERATOR
+    "Access code developer",               // MBUS_QUANTITY_ACCESS_CODE_DEVELOPER
+    "Password",                            // MBUS_QUANTITY_PASSWORD
+    "Error flags",                         // MBUS_QUANTITY_ERROR_FLAGS
+    "Error mask",                          // MBUS_QUANTITY_ERROR_MASK
+    "Digital output",                      // MBUS_QUANTITY_DIGITAL_OUTPUT
+    "Digital input",                       // MBUS_QUANTITY_DIGITAL_INPUT
+    "Baudrate",                            // MBUS_QUANTITY_BAUDRATE
+    "Response delay time",                 // MBUS_QUANTITY_RESPONSE_DELAY
+    "Retry",                               // MBUS_QUANTITY_RETRY
+    "First storage # for cyclic storage",  // MBUS_QUANTITY_FIRST_STORAGE
+    "Last storage # for cyclic storage",   // MBUS_QUANTITY_LAST_STORAGE
+    "Size of storage block",               // MBUS_QUANTITY_STORAGE_BLOCK_SIZE
+    "Storage interval",                    // MBUS_QUANTITY_STORAGE_INTERVAL
+    "Duration since last readout",         // MBUS_QUANTITY_DURATION_SINCE_READOUT
+    "Start of tariff",                     // MBUS_QUANTITY_TARIFF_START
+    "Duration of tariff",                  // MBUS_QUANTITY_TARIFF_DURATION
+    "Period of tariff",                    // MBUS_QUANTITY_TARIFF_PERIOD
+    "Dimensionless",                       // MBUS_QUANTITY_DIMENSIONLESS
+    "Voltage",                             // MBUS_QUANTITY_VOLTAGE
+    "Current",                             // MBUS_QUANTITY_CURRENT
+    "Reset counter",                       // MBUS_QUANTITY_RESET_COUNTER
+    "Cumulation counter",                  // MBUS_QUANTITY_CUMULATION_COUNTER
+    "Control signal",                      // MBUS_QUANTITY_CONTROL_SIGNAL
+    "Day of week",                         // MBUS_QUANTITY_DAY_OF_WEEK
+    "Week number",                         // MBUS_QUANTITY_WEEK_NUMBER
+    "Time point of day change",            // MBUS_QUANTITY_DAY_CHANGE
+    "State of parameter activation",       // MBUS_QUANTITY_PARAMETER_ACTIVATION
+    "Special supplier information",        // MBUS_QUANTITY_SUPPLIER_INFORMATION
+    "Duration since last cumulation",      // MBUS_QUANTITY_DURATION_SINCE_CUMULATION
+    "Operating time battery",              // MBUS_QUANTITY_BATTERY_OPERATING_TIME
+    "Date and time of battery change",     // MBUS_QUANTITY_BATTERY_CHANGE
+};
+
+static const char *mbus_unit_symbols[MBUS_UNIT_COUNT] = {
+    "",                        // MBUS_UNIT_NONE
+    "Wh",                      // MBUS_UNIT_WH
+    "J",                       // MBUS_UNIT_J
+    "m^3",                     // MBUS_UNIT_M3
+    "kg",                      // MBUS_UNIT_KG
+    "s",                       // MBUS_UNIT_SECOND
+    "min",                     // MBUS_UNIT_MINUTE
+    "h",                       // MBUS_UNIT_HOUR
+    "d",                       // MBUS_UNIT_DAY
+    "W",                       // MBUS_UNIT_W
+    "J/h",                     // MBUS_UNIT_J_PER_H
+    "m^3/h",                   // MBUS_UNIT_M3_PER_H
+    "m^3/min",                 // MBUS_UNIT_M3_PER_MIN
+    "m^3/s",                   // MBUS_UNIT_M3_PER_S
+    "kg/h",                    // MBUS_UNIT_KG_PER_H
+    "deg C",                   // MBUS_UNIT_CELSIUS
+    "K",                       // MBUS_UNIT_KELVIN
+    "bar",                     // MBUS_UNIT_BAR
+    "date",                    // MBUS_UNIT_DATE
+    "date/time",               // MBUS_UNIT_DATE_TIME
+    "feet^3",                  // MBUS_UNIT_FEET3
+    "american gallon",         // MBUS_UNIT_US_GALLON
+    "american gallon/min",     // MBUS_UNIT_US_GALLON_PER_MIN
+    "american gallon/h",       // MBUS_UNIT_US_GALLON_PER_H
+    "deg F",                   // MBUS_UNIT_FAHRENHEIT
+    "currency units",          // MBUS_UNIT_CURRENCY
+    "Baud",                    // MBUS_UNIT_BAUD
+    "bittimes",                // MBUS_UNIT_BIT_TIMES
+    "month",                   // MBUS_UNIT_MONTH
+    "year",                    // MBUS_UNIT_YEAR
+    "V",                       // MBUS_UNIT_V
+    "A",                       // MBUS_UNIT_A
+};
+
+//------------------------------------------------------------------------------
+/// Name of a quantity (MBUS_QUANTITY_*)
+//------------------------------------------------------------------------------
+const char *
+mbus_quantity_name(int quantity)
+{
+    if (quantity < 0 || quantity >= MBUS_QUANTITY_COUNT)
+        return mbus_quantity_names[MBUS_QUANTITY_UNKNOWN];
 
-        // E110 00nn    Temperature Difference   10(nn-3)K   (mK to  K)
-        case 0x60:
-        case 0x60+1:
-        case 0x60+2:
-        case 0x60+3:
+    return mbus_quantity_names[quantity];
+}
 
-            n = (vif & 0x03);
+//------------------------------------------------------------------------------
+/// Symbol of a unit (MBUS_UNIT_*), empty for dimensionless values
+//------------------------------------------------------------------------------
+const char *
+mbus_unit_symbol(int unit)
+{
+    if (unit < 0 || unit >= MBUS_UNIT_COUNT)
+        return mbus_unit_symbols[MBUS_UNIT_NONE];
 
-            snprintf(buff, sizeof(buff), "Temperature Difference (%s deg C)", mbus_unit_prefix(n-3));
+    return mbus_unit_symbols[unit];
+}
 
-            break;
+//------------------------------------------------------------------------------
+/// Decode quantity, unit and decimal exponent of the VIB with table lookups,
+/// no text is generated. A multiplicative correction factor in the first VIFE
+/// (E111 0nnn, E111 1101) is added to the exponent. Returns -1 for a missing
+/// VIF extension, otherwise 0 (unknown codes give MBUS_QUANTITY_UNKNOWN).
+//------------------------------------------------------------------------------
+int
+mbus_vib_unit_decode(const mbus_value_information_block *vib, mbus_value_unit *unit)
+{
+    const mbus_vif_unit *entry;
+    unsigned char vife;
 
-        // E110 01nn External Temperature 10(nn-3) °C 0.001°C to 1°C
-        case 0x64:
-        case 0x64+1:
-        case 0x64+2:
-        case 0x64+3:
+    if (vib == NULL || unit == NULL)
+        return -1;
 
-            n = (vif & 0x03);
-            snprintf(buff, sizeof(buff), "External temperature (%s deg C)", mbus_unit_prefix(n-3));
+    unit->quantity = MBUS_QUANTITY_UNKNOWN;
+    unit->unit = MBUS_UNIT_NONE;
+    unit->exponent = 0;
 
-            break;
+    if (vib->vif == 0xFB || vib->vif == 0xFD)
+    {
+        if (vib->nvife == 0)
+            return -1;
 
-        // E110 1110 Units for H.C.A. dimensionless
-        case 0x6E:
-            snprintf(buff, sizeof(buff), "Units for H.C.A.");
-            break;
+        vife = vib->vife[0] & MBUS_DIB_VIF_WITHOUT_EXTENSION;
+        entry = (vib->vif == 0xFB) ? &mbus_vife_fb_units[vife] : &mbus_vife_fd_units[vife];
+    }
+    else
+    {
+        entry = &mbus_vif_units[vib->vif & MBUS_DIB_VIF_WITHOUT_EXTENSION];
+    }
 
-        // E110 1111 Reserved
-        case 0x6F:
-            snprintf(buff, sizeof(buff), "Reserved");
-            break;
+    unit->quantity = (mbus_quantity)entry->quantity;
+    unit->unit = (mbus_unit)entry->unit;
+    unit->exponent = entry->exponent;
 
-        // Custom VIF in the following string: never reached...
-        case 0x7C:
-            snprintf(buff, sizeof(buff), "Custom VIF");
-            break;
+    if ((vib->vif & MBUS_DIB_VIF_EXTENSION_BIT) && vib->nvife > 0 &&
+        vib->vif != 0xFB && vib->vif != 0xFD)
+    {
+        vife = vib->vife[0] & MBUS_DIB_VIF_WITHOUT_EXTENSION;
 
-        // Fabrication No
-        case 0x78:
-            snprintf(buff, sizeof(buff), "Fabrication number");
-            break;
+        if ((vife & 0x78) == 0x70)
+        {
+            // multiplicative correction factor 10^(nnn-6), for a plain text
+            // VIF (0xFC) the factor of the unit
+            unit->exponent += (vife & 0x07) - 6;
+        }
+        else if (vife == 0x7D)
+        {
+            // multiplicative correction factor 10^3
+            unit->exponent += 3;
+        }
+    }
 
-        // Bus Address
-        case 0x7A:
-            snprintf(buff, sizeof(buff), "Bus Address");
-            break;
+    return 0;
+}
 
-        // Manufacturer specific: 7Fh / FF
-        case 0x7F:
-        case 0xFF:
-            snprintf(buff, sizeof(buff), "Manufacturer specific");
-            break;
+//------------------------------------------------------------------------------
+/// Look up the unit from a VIF field in the data record.
+///
+/// See section 8.4.3  Codes for Value Information Field (VIF) in the M-BUS spec
+//------------------------------------------------------------------------------
+const char *
+mbus_vif_unit_lookup_r(unsigned char vif, char *buff, size_t size)
+{
+    snprintf(buff, size, mbus_vif_units[vif & MBUS_DIB_VIF_WITHOUT_EXTENSION].text, vif);
 
-        default:
-            snprintf(buff, sizeof(buff), "Unknown (VIF=0x%.2X)", vif);
-            break;
-    }
+    return buff;
+}
 
+const char *
+mbus_vif_unit_lookup(unsigned char vif)
+{
+    static char buff[256];
 
-    return buff;
+    return mbus_vif_unit_lookup_r(vif, buff, sizeof(buff));
 }
 
 
@@ -2397,650 +2795,82 @@ mbus_vif_unit_lookup(unsigned char vif)
 // See section 6.6  Codes for general application errors in the M-BUS spec
 //------------------------------------------------------------------------------
 const char *
-mbus_data_error_lookup(int error)
+mbus_data_error_lookup_r(int error, char *buff, size_t size)
 {
-    static char buff[256];
 
     switch (error)
     {
         case MBUS_ERROR_DATA_UNSPECIFIED:
-            snprintf(buff, sizeof(buff), "Unspecified error");
+            snprintf(buff, size, "Unspecified error");
             break;
 
         case MBUS_ERROR_DATA_UNIMPLEMENTED_CI:
-            snprintf(buff, sizeof(buff), "Unimplemented CI-Field");
+            snprintf(buff, size, "Unimplemented CI-Field");
             break;
 
         case MBUS_ERROR_DATA_BUFFER_TOO_LONG:
-            snprintf(buff, sizeof(buff), "Buffer too long, truncated");
+            snprintf(buff, size, "Buffer too long, truncated");
             break;
 
         case MBUS_ERROR_DATA_TOO_MANY_RECORDS:
-            snprintf(buff, sizeof(buff), "Too many records");
+            snprintf(buff, size, "Too many records");
             break;
 
         case MBUS_ERROR_DATA_PREMATURE_END:
-            snprintf(buff, sizeof(buff), "Premature end of record");
+            snprintf(buff, size, "Premature end of record");
             break;
 
         case MBUS_ERROR_DATA_TOO_MANY_DIFES:
-            snprintf(buff, sizeof(buff), "More than 10 DIFE´s");
+            snprintf(buff, size, "More than 10 DIFE´s");
             break;
 
         case MBUS_ERROR_DATA_TOO_MANY_VIFES:
-            snprintf(buff, sizeof(buff), "More than 10 VIFE´s");
+            snprintf(buff, size, "More than 10 VIFE´s");
             break;
 
         case MBUS_ERROR_DATA_RESERVED:
-            snprintf(buff, sizeof(buff), "Reserved");
+            snprintf(buff, size, "Reserved");
             break;
 
         case MBUS_ERROR_DATA_APPLICATION_BUSY:
-            snprintf(buff, sizeof(buff), "Application busy");
+            snprintf(buff, size, "Application busy");
             break;
 
         case MBUS_ERROR_DATA_TOO_MANY_READOUTS:
-            snprintf(buff, sizeof(buff), "Too many readouts");
+            snprintf(buff, size, "Too many readouts");
             break;
 
         default:
-            snprintf(buff, sizeof(buff), "Unknown error (0x%.2X)", error);
+            snprintf(buff, size, "Unknown error (0x%.2X)", error);
             break;
     }
 
     return buff;
 }
 
-static const char *
-mbus_unit_duration_nn(int nn)
+const char *
+mbus_data_error_lookup(int error)
 {
-    switch (nn)
-    {
-        case 0:
-            return "second(s)";
-        case 1:
-            return "minute(s)";
-        case 2:
-            return "hour(s)";
-        case 3:
-            return "day(s)";
-    }
-    return "error: out-of-range";
+    static char buff[256];
+
+    return mbus_data_error_lookup_r(error, buff, sizeof(buff));
 }
 
 static const char *
-mbus_unit_duration_pp(int pp)
+mbus_vib_unit_lookup_fb(mbus_value_information_block *vib, char *buff, size_t size)
 {
-    switch (pp)
-    {
-        case 0:
-            return "hour(s)";
-
-        case 1:
-            return "day(s)";
+    snprintf(buff, size, mbus_vife_fb_units[vib->vife[0] & MBUS_DIB_VIF_WITHOUT_EXTENSION].text, vib->vife[0]);
 
-        case 2:
-            return "month(s)";
-
-        case 3:
-            return "year(s)";
-    }
-    return "error: out-of-range";
-}
-
-static const char *
-mbus_vib_unit_lookup_fb(mbus_value_information_block *vib)
-{
-    static char buff[256];
-    int n;
-    const char * prefix = "";
-    switch (vib->vife[0] & MBUS_DIB_VIF_WITHOUT_EXTENSION)
-    {
-        case 0x0:
-        case 0x0 + 1:
-            // E000 000n
-            n = 0x01 & vib->vife[0];
-            if (n == 0)
-                prefix = "0.1 ";
-        snprintf(buff, sizeof(buff), "Energy (%sMWh)", prefix);
-        break;
-    case 0x2:
-    case 0x2 + 1:
-        // E000 001n
-    case 0x4:
-    case 0x4 + 1:
-    case 0x4 + 2:
-    case 0x4 + 3:
-        // E000 01nn
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x8:
-    case 0x8 + 1:
-        // E000 100n
-        n = 0x01 & vib->vife[0];
-        if (n == 0)
-           prefix = "0.1 ";
-        snprintf(buff, sizeof(buff), "Energy (%sGJ)", prefix);
-        break;
-    case 0xA:
-    case 0xA + 1:
-    case 0xC:
-    case 0xC + 1:
-    case 0xC + 2:
-    case 0xC + 3:
-        // E000 101n
-        // E000 11nn
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x10:
-    case 0x10 + 1:
-        // E001 000n
-        n = 0x01 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Volume (%sm3)", mbus_unit_prefix(n+2));
-        break;
-    case 0x12:
-    case 0x12 + 1:
-    case 0x14:
-    case 0x14 + 1:
-    case 0x14 + 2:
-    case 0x14 + 3:
-        // E001 001n
-        // E001 01nn
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x18:
-    case 0x18 + 1:
-        // E001 100n
-        n = 0x01 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Mass (%st)", mbus_unit_prefix(n+2));
-        break;
-    case 0x1A:
-    case 0x1B:
-    case 0x1C:
-    case 0x1D:
-    case 0x1E:
-    case 0x1F:
-    case 0x20:
-        // E001 1010 to E010 0000, Reserved
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x21:
-        // E010 0001
-        snprintf(buff, sizeof(buff), "Volume (0.1 feet^3)");
-        break;
-    case 0x22:
-    case 0x23:
-        // E010 0010
-        // E010 0011
-        n = 0x01 & vib->vife[0];
-        if (n == 0)
-           prefix = "0.1 ";
-        snprintf(buff, sizeof(buff), "Volume (%samerican gallon)", prefix);
-        break;
-
-    case 0x24:
-        // E010 0100
-        snprintf(buff, sizeof(buff), "Volume flow (0.001 american gallon/min)");
-        break;
-    case 0x25:
-        // E010 0101
-        snprintf(buff, sizeof(buff), "Volume flow (american gallon/min)");
-        break;
-    case 0x26:
-        // E010 0110
-        snprintf(buff, sizeof(buff), "Volume flow (american gallon/h)");
-        break;
-    case 0x27:
-        // E010 0111, Reserved
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x28:
-    case 0x28 + 1:
-        // E010 100n
-        n = 0x01 & vib->vife[0];
-        if (n == 0)
-           prefix = "0.1 ";
-        snprintf(buff, sizeof(buff), "Power (%sMW)", prefix);
-        break;
-    case 0x2A:
-    case 0x2A + 1:
-    case 0x2C:
-    case 0x2C + 1:
-    case 0x2C + 2:
-    case 0x2C + 3:
-        // E010 101n, Reserved
-        // E010 11nn, Reserved
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x30:
-    case 0x30 + 1:
-        // E011 000n
-        n = 0x01 & vib->vife[0];
-        if (n == 0)
-           prefix = "0.1 ";
-        snprintf(buff, sizeof(buff), "Power (%sGJ/h)", prefix);
-        break;
-    case 0x32:
-    case 0x33:
-    case 0x34:
-    case 0x35:
-    case 0x36:
-    case 0x37:
-    case 0x38:
-    case 0x39:
-    case 0x3A:
-    case 0x3B:
-    case 0x3C:
-    case 0x3D:
-    case 0x3E:
-    case 0x3F:
-
-    case 0x40:
-    case 0x41:
-    case 0x42:
-    case 0x43:
-    case 0x44:
-    case 0x45:
-    case 0x46:
-    case 0x47:
-    case 0x48:
-    case 0x49:
-    case 0x4A:
-    case 0x4B:
-    case 0x4C:
-    case 0x4D:
-    case 0x4E:
-    case 0x4F:
-
-    case 0x52:
-    case 0x53:
-    case 0x54:
-    case 0x55:
-    case 0x56:
-    case 0x57:
-        // E011 0010 to E101 0111
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x58:
-    case 0x58 + 1:
-    case 0x58 + 2:
-    case 0x58 + 3:
-        // E101 10nn
-        n = 0x03 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Flow Temperature (%s degree F)", mbus_unit_prefix(n -3));
-        break;
-    case 0x5C:
-    case 0x5C + 1:
-    case 0x5C + 2:
-    case 0x5C + 3:
-        // E101 11nn
-        n = 0x03 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Return Temperature (%s degree F)", mbus_unit_prefix(n -3));
-        break;
-    case 0x60:
-    case 0x60 + 1:
-    case 0x60 + 2:
-    case 0x60 + 3:
-        // E110 00nn
-        n = 0x03 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Temperature Difference (%s degree F)", mbus_unit_prefix(n -3));
-        break;
-    case 0x64:
-    case 0x64 + 1:
-    case 0x64 + 2:
-    case 0x64 + 3:
-        // E110 01nn
-        n = 0x03 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "External Temperature (%s degree F)", mbus_unit_prefix(n -3));
-        break;
-    case 0x68:
-    case 0x69:
-    case 0x6A:
-    case 0x6B:
-    case 0x6C:
-    case 0x6D:
-    case 0x6E:
-    case 0x6F:
-        // E110 1nnn
-        snprintf(buff, sizeof(buff), "Reserved (0x%.2x)", vib->vife[0]);
-        break;
-    case 0x70:
-    case 0x70 + 1:
-    case 0x70 + 2:
-    case 0x70 + 3:
-        // E111 00nn
-        n = 0x03 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Cold / Warm Temperature Limit (%s degree F)", mbus_unit_prefix(n -3));
-        break;
-    case 0x74:
-    case 0x74 + 1:
-    case 0x74 + 2:
-    case 0x74 + 3:
-        // E111 00nn
-        n = 0x03 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "Cold / Warm Temperature Limit (%s degree C)", mbus_unit_prefix(n -3));
-        break;
-    case 0x78:
-    case 0x78 + 1:
-    case 0x78 + 2:
-    case 0x78 + 3:
-    case 0x78 + 4:
-    case 0x78 + 5:
-    case 0x78 + 6:
-    case 0x78 + 7:
-        // E111 1nnn
-        n = 0x07 & vib->vife[0];
-        snprintf(buff, sizeof(buff), "cumul. count max power (%s W)", mbus_unit_prefix(n - 3));
-        break;
-    default:
-        snprintf(buff, sizeof(buff), "Unrecognized VIF 0xFB extension: 0x%.2x", vib->vife[0]);
-        break;
-    }
-    return buff;
-}
+    return buff;
+}
 
 static const char *
-mbus_vib_unit_lookup_fd(mbus_value_information_block *vib)
+mbus_vib_unit_lookup_fd(mbus_value_information_block *vib, char *buff, size_t size)
 {
-    static char buff[256];
-    int n;
-
     // ignore the extension bit in this selection
     const unsigned char masked_vife0 = vib->vife[0] & MBUS_DIB_VIF_WITHOUT_EXTENSION;
 
-    if ((masked_vife0 & 0x7C) == 0x00)
-    {
-        // VIFE = E000 00nn	Credit of 10nn-3 of the nominal local legal currency units
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Credit of %s of the nominal local legal currency units", mbus_unit_prefix(n - 3));
-    }
-    else if ((masked_vife0 & 0x7C) == 0x04)
-    {
-        // VIFE = E000 01nn Debit of 10nn-3 of the nominal local legal currency units
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Debit of %s of the nominal local legal currency units", mbus_unit_prefix(n - 3));
-    }
-    else if (masked_vife0 == 0x08)
-    {
-        // E000 1000
-        snprintf(buff, sizeof(buff), "Access Number (transmission count)");
-    }
-    else if (masked_vife0 == 0x09)
-    {
-        // E000 1001
-        snprintf(buff, sizeof(buff), "Medium (as in fixed header)");
-    }
-    else if (masked_vife0 == 0x0A)
-    {
-        // E000 1010
-        snprintf(buff, sizeof(buff), "Manufacturer (as in fixed header)");
-    }
-    else if (masked_vife0 == 0x0B)
-    {
-        // E000 1010
-        snprintf(buff, sizeof(buff), "Parameter set identification");
-    }
-    else if (masked_vife0 == 0x0C)
-    {
-        // E000 1100
-        snprintf(buff, sizeof(buff), "Model / Version");
-    }
-    else if (masked_vife0 == 0x0D)
-    {
-        // E000 1100
-        snprintf(buff, sizeof(buff), "Hardware version");
-    }
-    else if (masked_vife0 == 0x0E)
-    {
-        // E000 1101
-        snprintf(buff, sizeof(buff), "Firmware version");
-    }
-    else if (masked_vife0 == 0x0F)
-    {
-        // E000 1101
-        snprintf(buff, sizeof(buff), "Software version");
-    }
-    else if (masked_vife0 == 0x10)
-    {
-        // VIFE = E001 0000 Customer location
-        snprintf(buff, sizeof(buff), "Customer location");
-    }
-    else if (masked_vife0 == 0x11)
-    {
-        // VIFE = E001 0001 Customer
-        snprintf(buff, sizeof(buff), "Customer");
-    }
-    else if (masked_vife0 == 0x12)
-    {
-        // VIFE = E001 0010	Access Code User
-        snprintf(buff, sizeof(buff), "Access Code User");
-    }
-    else if (masked_vife0 == 0x13)
-    {
-        // VIFE = E001 0011	Access Code Operator
-        snprintf(buff, sizeof(buff), "Access Code Operator");
-    }
-    else if (masked_vife0 == 0x14)
-    {
-        // VIFE = E001 0100	Access Code System Operator
-        snprintf(buff, sizeof(buff), "Access Code System Operator");
-    }
-    else if (masked_vife0 == 0x15)
-    {
-        // VIFE = E001 0101	Access Code Developer
-        snprintf(buff, sizeof(buff), "Access Code Developer");
-    }
-    else if (masked_vife0 == 0x16)
-    {
-        // VIFE = E001 0110 Password
-        snprintf(buff, sizeof(buff), "Password");
-    }
-    else if (masked_vife0 == 0x17)
-    {
-        // VIFE = E001 0111 Error flags
-        snprintf(buff, sizeof(buff), "Error flags");
-    }
-    else if (masked_vife0 == 0x18)
-    {
-        // VIFE = E001 1000	Error mask
-        snprintf(buff, sizeof(buff), "Error mask");
-    }
-    else if (masked_vife0 == 0x19)
-    {
-        // VIFE = E001 1001	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if (masked_vife0 == 0x1A)
-    {
-        // VIFE = E001 1010 Digital output (binary)
-        snprintf(buff, sizeof(buff), "Digital output (binary)");
-    }
-    else if (masked_vife0 == 0x1B)
-    {
-        // VIFE = E001 1011 Digital input (binary)
-        snprintf(buff, sizeof(buff), "Digital input (binary)");
-    }
-    else if (masked_vife0 == 0x1C)
-    {
-        // VIFE = E001 1100	Baudrate [Baud]
-        snprintf(buff, sizeof(buff), "Baudrate");
-    }
-    else if (masked_vife0 == 0x1D)
-    {
-        // VIFE = E001 1101	response delay time [bittimes]
-        snprintf(buff, sizeof(buff), "response delay time");
-    }
-    else if (masked_vife0 == 0x1E)
-    {
-        // VIFE = E001 1110	Retry
-        snprintf(buff, sizeof(buff), "Retry");
-    }
-    else if (masked_vife0 == 0x1F)
-    {
-        // VIFE = E001 1111	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if (masked_vife0 == 0x20)
-    {
-        // VIFE = E010 0000	First storage # for cyclic storage
-        snprintf(buff, sizeof(buff), "First storage # for cyclic storage");
-    }
-    else if (masked_vife0 == 0x21)
-    {
-        // VIFE = E010 0001	Last storage # for cyclic storage
-        snprintf(buff, sizeof(buff), "Last storage # for cyclic storage");
-    }
-    else if (masked_vife0 == 0x22)
-    {
-        // VIFE = E010 0010	Size of storage block
-        snprintf(buff, sizeof(buff), "Size of storage block");
-    }
-    else if (masked_vife0 == 0x23)
-    {
-        // VIFE = E010 0011	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if ((masked_vife0 & 0x7C) == 0x24)
-    {
-        // VIFE = E010 01nn	Storage interval [sec(s)..day(s)]
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Storage interval %s", mbus_unit_duration_nn(n));
-    }
-    else if (masked_vife0 == 0x28)
-    {
-        // VIFE = E010 1000	Storage interval month(s)
-        snprintf(buff, sizeof(buff), "Storage interval month(s)");
-    }
-    else if (masked_vife0 == 0x29)
-    {
-        // VIFE = E010 1001	Storage interval year(s)
-        snprintf(buff, sizeof(buff), "Storage interval year(s)");
-    }
-    else if (masked_vife0 == 0x2A)
-    {
-        // VIFE = E010 1010	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if (masked_vife0 == 0x2B)
-    {
-        // VIFE = E010 1011	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if ((masked_vife0 & 0x7C) == 0x2C)
-    {
-        // VIFE = E010 11nn	Duration since last readout [sec(s)..day(s)]
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Duration since last readout %s", mbus_unit_duration_nn(n));
-    }
-    else if (masked_vife0 == 0x30)
-    {
-        // VIFE = E011 0000	Start (date/time) of tariff
-        snprintf(buff, sizeof(buff), "Start (date/time) of tariff");
-    }
-    else if ((masked_vife0 & 0x7C) == 0x30)
-    {
-        // VIFE = E011 00nn	Duration of tariff (nn=01 ..11: min to days)
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Duration of tariff %s", mbus_unit_duration_nn(n));
-    }
-    else if ((masked_vife0 & 0x7C) == 0x34)
-    {
-        // VIFE = E011 01nn	Period of tariff [sec(s) to day(s)]
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Period of tariff %s", mbus_unit_duration_nn(n));
-    }
-    else if (masked_vife0 == 0x38)
-    {
-        // VIFE = E011 1000	Period of tariff months(s)
-        snprintf(buff, sizeof(buff), "Period of tariff months(s)");
-    }
-    else if (masked_vife0 == 0x39)
-    {
-        // VIFE = E011 1001	Period of tariff year(s)
-        snprintf(buff, sizeof(buff), "Period of tariff year(s)");
-    }
-    else if (masked_vife0 == 0x3A)
-    {
-        // VIFE = E011 1010	dimensionless / no VIF
-        snprintf(buff, sizeof(buff), "dimensionless / no VIF");
-    }
-    else if (masked_vife0 == 0x3B)
-    {
-        // VIFE = E011 1011	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if ((masked_vife0 & 0x7C) == 0x3C)
-    {
-        // VIFE = E011 11xx	Reserved
-        snprintf(buff, sizeof(buff), "Reserved");
-    }
-    else if ((masked_vife0 & 0x70) == 0x40)
-    {
-        // VIFE = E100 nnnn 10^(nnnn-9) V
-        n = (masked_vife0 & 0x0F);
-        snprintf(buff, sizeof(buff), "%s V", mbus_unit_prefix(n - 9));
-    }
-    else if ((masked_vife0 & 0x70) == 0x50)
-    {
-        // VIFE = E101 nnnn 10nnnn-12 A
-        n = (masked_vife0 & 0x0F);
-        snprintf(buff, sizeof(buff), "%s A", mbus_unit_prefix(n - 12));
-    }
-    else if (masked_vife0 == 0x60) {
-        // VIFE = E110 0000	Reset counter
-        snprintf(buff, sizeof(buff), "Reset counter");
-    }
-    else if (masked_vife0 == 0x61) {
-        // VIFE = E110 0001	Cumulation counter
-        snprintf(buff, sizeof(buff), "Cumulation counter");
-    }
-    else if (masked_vife0 == 0x62) {
-        // VIFE = E110 0010	Control signal
-        snprintf(buff, sizeof(buff), "Control signal");
-    }
-    else if (masked_vife0 == 0x63) {
-        // VIFE = E110 0011	Day of week
-        snprintf(buff, sizeof(buff), "Day of week");
-    }
-    else if (masked_vife0 == 0x64) {
-        // VIFE = E110 0100	Week number
-        snprintf(buff, sizeof(buff), "Week number");
-    }
-    else if (masked_vife0 == 0x65) {
-        // VIFE = E110 0101	Time point of day change
-        snprintf(buff, sizeof(buff), "Time point of day change");
-    }
-    else if (masked_vife0 == 0x66) {
-        // VIFE = E110 0110	State of parameter activation
-        snprintf(buff, sizeof(buff), "State of parameter activation");
-    }
-    else if (masked_vife0 == 0x67) {
-        // VIFE = E110 0111	Special supplier information
-        snprintf(buff, sizeof(buff), "Special supplier information");
-    }
-    else if ((masked_vife0 & 0x7C) == 0x68) {
-        // VIFE = E110 10pp	Duration since last cumulation [hour(s)..years(s)]Ž
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Duration since last cumulation %s", mbus_unit_duration_pp(n));
-    }
-    else if ((masked_vife0 & 0x7C) == 0x6C) {
-        // VIFE = E110 11pp	Operating time battery [hour(s)..years(s)]Ž
-        n = (masked_vife0 & 0x03);
-        snprintf(buff, sizeof(buff), "Operating time battery %s", mbus_unit_duration_pp(n));
-    }
-    else if (masked_vife0 == 0x70) {
-        // VIFE = E111 0000	Date and time of battery change
-        snprintf(buff, sizeof(buff), "Date and time of battery change");
-    }
-    else if ((masked_vife0 & 0x70) == 0x70)
-    {
-        // VIFE = E111 nnn Reserved
-        snprintf(buff, sizeof(buff), "Reserved VIF extension");
-    }
-    else
-    {
-        snprintf(buff, sizeof(buff), "Unrecognized VIF 0xFD extension: 0x%.2x", masked_vife0);
-    }
+    snprintf(buff, size, mbus_vife_fd_units[masked_vife0].text, masked_vife0);
 
     return buff;
 }
@@ -3059,9 +2889,9 @@ mbus_vib_unit_lookup_fd(mbus_value_information_block *vib)
 //    E000 1111      Software version #
 //------------------------------------------------------------------------------
 const char *
-mbus_vib_unit_lookup(mbus_value_information_block *vib)
+mbus_vib_unit_lookup_r(mbus_value_information_block *vib, char *buff, size_t size)
 {
-    static char buff[256];
+    char prefix[16];
     int n;
 
     if (vib == NULL)
@@ -3074,7 +2904,7 @@ mbus_vib_unit_lookup(mbus_value_information_block *vib)
             return "Missing VIF extension";
         }
 
-        return mbus_vib_unit_lookup_fb(vib);
+        return mbus_vib_unit_lookup_fb(vib, buff, size);
     }
     else if (vib->vif == 0xFD) // first type of VIF extention: see table 8.4.4
     {
@@ -3083,23 +2913,31 @@ mbus_vib_unit_lookup(mbus_value_information_block *vib)
             return "Missing VIF extension";
         }
 
-        return mbus_vib_unit_lookup_fd(vib);
+        return mbus_vib_unit_lookup_fd(vib, buff, size);
     }
     else if (vib->vif == 0x7C)
     {
         // custom VIF
-        snprintf(buff, sizeof(buff), "%s", vib->custom_vif);
+        snprintf(buff, size, "%s", vib->custom_vif);
         return buff;
     }
     else if (vib->vif == 0xFC && (vib->vife[0] & 0x78) == 0x70)
     {
         // custom VIF
         n = (vib->vife[0] & 0x07);
-        snprintf(buff, sizeof(buff), "%s %s", mbus_unit_prefix(n-6), vib->custom_vif);
+        snprintf(buff, size, "%s %s", mbus_unit_prefix_r(n-6, prefix, sizeof(prefix)), vib->custom_vif);
         return buff;
     }
 
-    return mbus_vif_unit_lookup(vib->vif); // no extention, use VIF
+    return mbus_vif_unit_lookup_r(vib->vif, buff, size); // no extention, use VIF
+}
+
+const char *
+mbus_vib_unit_lookup(mbus_value_information_block *vib)
+{
+    static char buff[256];
+
+    return mbus_vib_unit_lookup_r(vib, buff, sizeof(buff));
 }
 
 //------------------------------------------------------------------------------
@@ -3126,9 +2964,8 @@ mbus_vib_unit_lookup(mbus_value_information_block *vib)
 //
 //------------------------------------------------------------------------------
 const char *
-mbus_data_record_decode(mbus_data_record *record)
+mbus_data_record_decode_r(mbus_data_record *record, char *buff, size_t size)
 {
-    static char buff[768];
     unsigned char vif, vife;
 
     if (record)
@@ -3154,7 +2991,7 @@ mbus_data_record_decode(mbus_data_record *record)
 
                 mbus_data_int_decode(record->data, 1, &int_val);
 
-                snprintf(buff, sizeof(buff), "%d", int_val);
+                snprintf(buff, size, "%d", int_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 1 byte integer\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3168,7 +3005,7 @@ mbus_data_record_decode(mbus_data_record *record)
                 if (vif == 0x6C)
                 {
                     mbus_data_tm_decode(&time, record->data, 2);
-                    snprintf(buff, sizeof(buff), "%04d-%02d-%02d",
+                    snprintf(buff, size, "%04d-%02d-%02d",
                                                  (time.tm_year + 1900),
                                                  (time.tm_mon + 1),
                                                   time.tm_mday);
@@ -3176,7 +3013,7 @@ mbus_data_record_decode(mbus_data_record *record)
                 else  // 2 byte integer
                 {
                     mbus_data_int_decode(record->data, 2, &int_val);
-                    snprintf(buff, sizeof(buff), "%d", int_val);
+                    snprintf(buff, size, "%d", int_val);
                     if (debug)
                         printf("%s: DIF 0x%.2x was decoded using 2 byte integer\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
 
@@ -3188,7 +3025,7 @@ mbus_data_record_decode(mbus_data_record *record)
 
                 mbus_data_int_decode(record->data, 3, &int_val);
 
-                snprintf(buff, sizeof(buff), "%d", int_val);
+                snprintf(buff, size, "%d", int_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 3 byte integer\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3205,7 +3042,7 @@ mbus_data_record_decode(mbus_data_record *record)
                     ((record->drh.vib.vif == 0xFD) && (vife == 0x70)))
                 {
                     mbus_data_tm_decode(&time, record->data, 4);
-                    snprintf(buff, sizeof(buff), "%04d-%02d-%02dT%02d:%02d:%02d",
+                    snprintf(buff, size, "%04d-%02d-%02dT%02d:%02d:%02d",
                                                  (time.tm_year + 1900),
                                                  (time.tm_mon + 1),
                                                   time.tm_mday,
@@ -3216,7 +3053,7 @@ mbus_data_record_decode(mbus_data_record *record)
                 else  // 4 byte integer
                 {
                     mbus_data_int_decode(record->data, 4, &int_val);
-                    snprintf(buff, sizeof(buff), "%d", int_val);
+                    snprintf(buff, size, "%d", int_val);
                 }
 
                 if (debug)
@@ -3228,7 +3065,7 @@ mbus_data_record_decode(mbus_data_record *record)
 
                 float_val = mbus_data_float_decode(record->data);
 
-                snprintf(buff, sizeof(buff), "%f", float_val);
+                snprintf(buff, size, "%f", float_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 4 byte Real\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3245,7 +3082,7 @@ mbus_data_record_decode(mbus_data_record *record)
                     ((record->drh.vib.vif == 0xFD) && (vife == 0x70)))
                 {
                     mbus_data_tm_decode(&time, record->data, 6);
-                    snprintf(buff, sizeof(buff), "%04d-%02d-%02dT%02d:%02d:%02d",
+                    snprintf(buff, size, "%04d-%02d-%02dT%02d:%02d:%02d",
                                                  (time.tm_year + 1900),
                                                  (time.tm_mon + 1),
                                                   time.tm_mday,
@@ -3256,7 +3093,7 @@ mbus_data_record_decode(mbus_data_record *record)
                 else  // 6 byte integer
                 {
                     mbus_data_long_long_decode(record->data, 6, &long_long_val);
-                    snprintf(buff, sizeof(buff), "%lld", long_long_val);
+                    snprintf(buff, size, "%lld", long_long_val);
                 }
 
                 if (debug)
@@ -3268,7 +3105,7 @@ mbus_data_record_decode(mbus_data_record *record)
 
                 mbus_data_long_long_decode(record->data, 8, &long_long_val);
 
-                snprintf(buff, sizeof(buff), "%lld", long_long_val);
+                snprintf(buff, size, "%lld", long_long_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 8 byte integer\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3280,7 +3117,7 @@ mbus_data_record_decode(mbus_data_record *record)
             case 0x09: // 2 digit BCD (8 bit)
 
                 int_val = (int)mbus_data_bcd_decode_hex(record->data, 1);
-                snprintf(buff, sizeof(buff), "%X", int_val);
+                snprintf(buff, size, "%X", int_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 2 digit BCD\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3290,7 +3127,7 @@ mbus_data_record_decode(mbus_data_record *record)
             case 0x0A: // 4 digit BCD (16 bit)
 
                 int_val = (int)mbus_data_bcd_decode_hex(record->data, 2);
-                snprintf(buff, sizeof(buff), "%X", int_val);
+                snprintf(buff, size, "%X", int_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 4 digit BCD\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3300,7 +3137,7 @@ mbus_data_record_decode(mbus_data_record *record)
             case 0x0B: // 6 digit BCD (24 bit)
 
                 int_val = (int)mbus_data_bcd_decode_hex(record->data, 3);
-                snprintf(buff, sizeof(buff), "%X", int_val);
+                snprintf(buff, size, "%X", int_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 6 digit BCD\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3310,7 +3147,7 @@ mbus_data_record_decode(mbus_data_record *record)
             case 0x0C: // 8 digit BCD (32 bit)
 
                 int_val = (int)mbus_data_bcd_decode_hex(record->data, 4);
-                snprintf(buff, sizeof(buff), "%X", int_val);
+                snprintf(buff, size, "%X", int_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 8 digit BCD\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3320,7 +3157,7 @@ mbus_data_record_decode(mbus_data_record *record)
             case 0x0E: // 12 digit BCD (48 bit)
 
                 long_long_val = mbus_data_bcd_decode_hex(record->data, 6);
-                snprintf(buff, sizeof(buff), "%llX", long_long_val);
+                snprintf(buff, size, "%llX", long_long_val);
 
                 if (debug)
                     printf("%s: DIF 0x%.2x was decoded using 12 digit BCD\n", __PRETTY_FUNCTION__, record->drh.dib.dif);
@@ -3329,11 +3166,11 @@ mbus_data_record_decode(mbus_data_record *record)
 
             case 0x0F: // special functions
 
-                mbus_data_bin_decode(buff, record->data, record->data_len, sizeof(buff));
+                mbus_data_bin_decode(buff, record->data, record->data_len, size);
                 break;
 
             case 0x0D: // variable length
-                if (record->data_len <= 0xBF)
+                if (record->data_len <= 0xBF && record->data_len < size)
                 {
                     mbus_data_str_decode(buff, record->data, record->data_len);
                     break;
@@ -3342,7 +3179,7 @@ mbus_data_record_decode(mbus_data_record *record)
 
             default:
 
-                snprintf(buff, sizeof(buff), "Unknown DIF (0x%.2x)", record->drh.dib.dif);
+                snprintf(buff, size, "Unknown DIF (0x%.2x)", record->drh.dib.dif);
                 break;
         }
 
@@ -3351,17 +3188,25 @@ mbus_data_record_decode(mbus_data_record *record)
 
     return NULL;
 }
+
+const char *
+mbus_data_record_decode(mbus_data_record *record)
+{
+    static char buff[768];
+
+    return mbus_data_record_decode_r(record, buff, sizeof(buff));
+}
 //------------------------------------------------------------------------------
 /// Return the unit description for a variable-length data record
 //------------------------------------------------------------------------------
 const char *
-mbus_data_record_unit(mbus_data_record *record)
+mbus_data_record_unit_r(mbus_data_record *record, char *buff, size_t size)
 {
-    static char buff[128];
+    char unit[256];
 
     if (record)
     {
-        snprintf(buff, sizeof(buff), "%s", mbus_vib_unit_lookup(&(record->drh.vib)));
+        snprintf(buff, size, "%s", mbus_vib_unit_lookup_r(&(record->drh.vib), unit, sizeof(unit)));
 
         return buff;
     }
@@ -3369,17 +3214,25 @@ mbus_data_record_unit(mbus_data_record *record)
     return NULL;
 }
 
+const char *
+mbus_data_record_unit(mbus_data_record *record)
+{
+    static char buff[128];
+
+    return mbus_data_record_unit_r(record, buff, sizeof(buff));
+}
+
 //------------------------------------------------------------------------------
 /// Return the value for a variable-length data record
 //------------------------------------------------------------------------------
 const char *
-mbus_data_record_value(mbus_data_record *record)
+mbus_data_record_value_r(mbus_data_record *record, char *buff, size_t size)
 {
-    static char buff[768];
+    char value[768];
 
     if (record)
     {
-        snprintf(buff, sizeof(buff), "%s", mbus_data_record_decode(record));
+        snprintf(buff, size, "%s", mbus_data_record_decode_r(record, value, sizeof(value)));
 
         return buff;
     }
@@ -3387,6 +3240,14 @@ mbus_data_record_value(mbus_data_record *record)
     return NULL;
 }
 
+const char *
+mbus_data_record_value(mbus_data_record *record)
+{
+    static char buff[768];
+
+    return mbus_data_record_value_r(record, buff, sizeof(buff));
+}
+
 //------------------------------------------------------------------------------
 /// Return the storage number for a variable-length data record
 //------------------------------------------------------------------------------
@@ -3463,32 +3324,31 @@ int mbus_data_record_device(mbus_data_record *record)
 /// Return a string containing the function description
 //------------------------------------------------------------------------------
 const char *
-mbus_data_record_function(mbus_data_record *record)
+mbus_data_record_function_r(mbus_data_record *record, char *buff, size_t size)
 {
-    static char buff[128];
 
     if (record)
     {
         switch (record->drh.dib.dif & MBUS_DATA_RECORD_DIF_MASK_FUNCTION)
         {
             case 0x00:
-                snprintf(buff, sizeof(buff), "Instantaneous value");
+                snprintf(buff, size, "Instantaneous value");
                 break;
 
             case 0x10:
-                snprintf(buff, sizeof(buff), "Maximum value");
+                snprintf(buff, size, "Maximum value");
                 break;
 
             case 0x20:
-                snprintf(buff, sizeof(buff), "Minimum value");
+                snprintf(buff, size, "Minimum value");
                 break;
 
             case 0x30:
-                snprintf(buff, sizeof(buff), "Value during error state");
+                snprintf(buff, size, "Value during error state");
                 break;
 
             default:
-                snprintf(buff, sizeof(buff), "unknown");
+                snprintf(buff, size, "unknown");
         }
 
         return buff;
@@ -3497,22 +3357,37 @@ mbus_data_record_function(mbus_data_record *record)
     return NULL;
 }
 
+const char *
+mbus_data_record_function(mbus_data_record *record)
+{
+    static char buff[128];
+
+    return mbus_data_record_function_r(record, buff, sizeof(buff));
+}
+
 
 ///
 /// For fixed-length frames, return a string describing the type of value (stored or actual)
 ///
 const char *
-mbus_data_fixed_function(int status)
+mbus_data_fixed_function_r(int status, char *buff, size_t size)
 {
-    static char buff[128];
 
-    snprintf(buff, sizeof(buff), "%s",
+    snprintf(buff, size, "%s",
             (status & MBUS_DATA_FIXED_STATUS_DATE_MASK) == MBUS_DATA_FIXED_STATUS_DATE_STORED ?
             "Stored value" : "Actual value" );
 
     return buff;
 }
 
+const char *
+mbus_data_fixed_function(int status)
+{
+    static char buff[128];
+
+    return mbus_data_fixed_function_r(status, buff, sizeof(buff));
+}
+
 //------------------------------------------------------------------------------
 //
 // PARSER FUNCTIONS
@@ -3520,1486 +3395,2399 @@ mbus_data_fixed_function(int status)
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-/// PARSE M-BUS frame data structures from binary data.
+/// Determine the size of the frame that starts at data from its header. Returns
+/// the number of missing bytes (> 0), 0 when the complete frame of frame_size
+/// bytes is available or -1 when the data can't be the start of a frame (then
+/// frame_size is set to data_size).
 //------------------------------------------------------------------------------
 int
-mbus_parse(mbus_frame *frame, unsigned char *data, size_t data_size)
+mbus_frame_boundary(const unsigned char *data, size_t data_size, size_t *frame_size)
 {
-    size_t i, len;
+    size_t size;
 
-    if (frame && data && data_size > 0)
+    if (data_size == 0)
     {
-        frame->next = NULL;
-
-        if (parse_debug)
-            printf("%s: Attempting to parse binary data [size = %zu]\n", __PRETTY_FUNCTION__, data_size);
-
-        if (parse_debug)
-            printf("%s: ", __PRETTY_FUNCTION__);
-
-        for (i = 0; i < data_size && parse_debug; i++)
-        {
-            printf("%.2X ", data[i] & 0xFF);
-        }
+        return 1;
+    }
 
-        if (parse_debug)
-            printf("\n%s: done.\n", __PRETTY_FUNCTION__);
+    switch (data[0])
+    {
+        case MBUS_FRAME_ACK_START:
+            size = MBUS_FRAME_BASE_SIZE_ACK;
+            break;
 
-        switch (data[0])
-        {
-            case MBUS_FRAME_ACK_START:
+        case MBUS_FRAME_SHORT_START:
+            size = MBUS_FRAME_BASE_SIZE_SHORT;
+            break;
 
-                // OK, got a valid ack frame, require no more data
-                frame->start1   = data[0];
-                frame->type = MBUS_FRAME_TYPE_ACK;
-                return 0;
-                //return MBUS_FRAME_BASE_SIZE_ACK - 1; // == 0
+        case MBUS_FRAME_LONG_START: // (also CONTROL)
+            if (data_size < 3)
+            {
+                // more data to determine the length
+                return 3 - data_size;
+            }
 
-            case MBUS_FRAME_SHORT_START:
+            if (data[1] < 3 || data[1] != data[2])
+            {
+                *frame_size = data_size;
+                return -1;
+            }
 
-                if (data_size < MBUS_FRAME_BASE_SIZE_SHORT)
-                {
-                    // OK, got a valid short packet start, but we need more data
-                    return MBUS_FRAME_BASE_SIZE_SHORT - data_size;
-                }
+            size = MBUS_FRAME_FIXED_SIZE_LONG + data[1];
+            break;
 
-                if (data_size != MBUS_FRAME_BASE_SIZE_SHORT)
-                {
-                    snprintf(error_str, sizeof(error_str), "Too much data in frame.");
+        default:
+            *frame_size = data_size;
+            return -1;
+    }
 
-                    // too much data... ?
-                    return -2;
-                }
+    if (data_size < size)
+    {
+        return size - data_size;
+    }
 
-                // init frame data structure
-                frame->start1   = data[0];
-                frame->control  = data[1];
-                frame->address  = data[2];
-                frame->checksum = data[3];
-                frame->stop     = data[4];
+    *frame_size = size;
+    return 0;
+}
 
-                frame->type = MBUS_FRAME_TYPE_SHORT;
+//------------------------------------------------------------------------------
+/// Drop all buffered bytes.
+//------------------------------------------------------------------------------
+void
+mbus_rx_buffer_reset(mbus_rx_buffer *rx)
+{
+    rx->start = 0;
+    rx->len = 0;
+    rx->echo_len = 0;
+}
 
-                // verify the frame
-                if (mbus_frame_verify(frame) != 0)
-                {
-                    return -3;
-                }
+//------------------------------------------------------------------------------
+/// Free space behind the buffered bytes to read into. The buffered bytes are
+/// moved to the front first, so a frame is always contiguous.
+//------------------------------------------------------------------------------
+unsigned char *
+mbus_rx_buffer_space(mbus_rx_buffer *rx, size_t *size)
+{
+    if (rx->start > 0)
+    {
+        memmove(rx->data, rx->data + rx->start, rx->len);
+        rx->start = 0;
+    }
 
-                // successfully parsed data
-                return 0;
+    *size = sizeof(rx->data) - rx->len;
+    return rx->data + rx->len;
+}
 
-            case MBUS_FRAME_LONG_START: // (also CONTROL)
+//------------------------------------------------------------------------------
+/// Add len bytes that were read into the space of mbus_rx_buffer_space.
+//------------------------------------------------------------------------------
+void
+mbus_rx_buffer_commit(mbus_rx_buffer *rx, size_t len)
+{
+    rx->len += len;
+}
 
-                if (data_size < 3)
-                {
-                    // OK, got a valid long/control packet start, but we need
-                    // more data to determine the length
-                    return 3 - data_size;
-                }
+//------------------------------------------------------------------------------
+/// Check the front of the buffer for a frame, see mbus_frame_boundary for the
+/// result. data points to the first buffered byte. A buffered echo of the
+/// last sent frame is removed first.
+//------------------------------------------------------------------------------
+int
+mbus_rx_buffer_frame(mbus_rx_buffer *rx, unsigned char **data, size_t *frame_size)
+{
+    size_t len;
 
-                // init frame data structure
-                frame->start1   = data[0];
-                frame->length1  = data[1];
-                frame->length2  = data[2];
+    if (rx->echo_len > 0 && rx->len > 0)
+    {
+        len = rx->len < rx->echo_len ? rx->len : rx->echo_len;
 
-                if (frame->length1 < 3)
-                {
-                    snprintf(error_str, sizeof(error_str), "Invalid M-Bus frame length.");
+        if (memcmp(rx->data + rx->start, rx->echo, len) != 0)
+        {
+            // the adapter does not echo, the bytes are a reply
+            rx->echo_len = 0;
+        }
+        else if (len < rx->echo_len)
+        {
+            // more bytes to tell the echo from a reply
+            *data = rx->data + rx->start;
+            return (int)(rx->echo_len - len);
+        }
+        else
+        {
+            mbus_rx_buffer_consume(rx, len);
+            rx->echo_len = 0;
+        }
+    }
 
-                    // not a valid M-bus frame
-                    return -2;
-                }
-
-                if (frame->length1 != frame->length2)
-                {
-                    snprintf(error_str, sizeof(error_str), "Invalid M-Bus frame length.");
-
-                    // not a valid M-bus frame
-                    return -2;
-                }
-
-                // check length of packet:
-                len = frame->length1;
-
-                if (data_size < (size_t)(MBUS_FRAME_FIXED_SIZE_LONG + len))
-                {
-                    // OK, but we need more data
-                    return MBUS_FRAME_FIXED_SIZE_LONG + len - data_size;
-                }
-
-                if (data_size > (size_t)(MBUS_FRAME_FIXED_SIZE_LONG + len))
-                {
-                    snprintf(error_str, sizeof(error_str), "Too much data in frame.");
-
-                    // too much data... ?
-                    return -2;
-                }
-
-                // we got the whole packet, continue parsing
-                frame->start2   = data[3];
-                frame->control  = data[4];
-                frame->address  = data[5];
-                frame->control_information = data[6];
-
-                frame->data_size = len - 3;
-                for (i = 0; i < frame->data_size; i++)
-                {
-                    frame->data[i] = data[7 + i];
-                }
-
-                frame->checksum = data[data_size-2]; // data[6 + frame->data_size + 1]
-                frame->stop     = data[data_size-1]; // data[6 + frame->data_size + 2]
-
-                if (frame->data_size == 0)
-                {
-                    frame->type = MBUS_FRAME_TYPE_CONTROL;
-                }
-                else
-                {
-                    frame->type = MBUS_FRAME_TYPE_LONG;
-                }
-
-                // verify the frame
-                if (mbus_frame_verify(frame) != 0)
-                {
-                    return -3;
-                }
-
-                // successfully parsed data
-                return 0;
-            default:
-                snprintf(error_str, sizeof(error_str), "Invalid M-Bus frame start.");
-
-                // not a valid M-Bus frame header (start byte)
-                return -4;
-        }
+    *data = rx->data + rx->start;
+    return mbus_frame_boundary(*data, rx->len, frame_size);
+}
 
+//------------------------------------------------------------------------------
+/// Remember the bytes of a sent frame, a matching prefix of the following
+/// received bytes is its echo and dropped by mbus_rx_buffer_frame.
+//------------------------------------------------------------------------------
+void
+mbus_rx_buffer_expect_echo(mbus_rx_buffer *rx, const unsigned char *data, size_t len)
+{
+    if (len > sizeof(rx->echo))
+    {
+        rx->echo_len = 0;
+        return;
     }
 
-    snprintf(error_str, sizeof(error_str), "Got null pointer to frame, data or zero data_size.");
-
-    return -1;
+    memcpy(rx->echo, data, len);
+    rx->echo_len = len;
 }
 
-
 //------------------------------------------------------------------------------
-/// Parse the fixed-length data of a M-Bus frame
+/// Remove len bytes (a frame) from the front of the buffer.
 //------------------------------------------------------------------------------
-int
-mbus_data_fixed_parse(mbus_frame *frame, mbus_data_fixed *data)
+void
+mbus_rx_buffer_consume(mbus_rx_buffer *rx, size_t len)
 {
-    if (frame && data)
+    if (len >= rx->len)
     {
-        if (frame->data_size != MBUS_DATA_FIXED_LENGTH)
-        {
-            snprintf(error_str, sizeof(error_str), "Invalid length for fixed data.");
-            return -1;
-        }
-
-        // copy the fixed-length data structure bytewise
-        data->id_bcd[0]   = frame->data[0];
-        data->id_bcd[1]   = frame->data[1];
-        data->id_bcd[2]   = frame->data[2];
-        data->id_bcd[3]   = frame->data[3];
-        data->tx_cnt      = frame->data[4];
-        data->status      = frame->data[5];
-        data->cnt1_type   = frame->data[6];
-        data->cnt2_type   = frame->data[7];
-        data->cnt1_val[0] = frame->data[8];
-        data->cnt1_val[1] = frame->data[9];
-        data->cnt1_val[2] = frame->data[10];
-        data->cnt1_val[3] = frame->data[11];
-        data->cnt2_val[0] = frame->data[12];
-        data->cnt2_val[1] = frame->data[13];
-        data->cnt2_val[2] = frame->data[14];
-        data->cnt2_val[3] = frame->data[15];
-
-        return 0;
+        mbus_rx_buffer_reset(rx);
+        return;
     }
 
-    return -1;
+    rx->start += len;
+    rx->len -= len;
 }
 
-
 //------------------------------------------------------------------------------
-/// Parse the variable-length data of a M-Bus frame
+/// Check the frame in data (data_size bytes) in place: the length fields,
+/// start/stop bytes, control field and checksum are verified and the view
+/// refers to the header fields and user data of the buffer, nothing is copied.
+/// Returns the same values as mbus_parse; after -3 (verification failed) the
+/// view is filled anyway. The buffer has to be kept as long as the view.
 //------------------------------------------------------------------------------
 int
-mbus_data_variable_parse(mbus_frame *frame, mbus_data_variable *data)
+mbus_frame_view_parse(mbus_frame_view *view, const unsigned char *data, size_t data_size)
 {
-    mbus_data_record *record = NULL;
-    size_t i, j;
+    size_t i, len;
+    unsigned char checksum;
 
-    if (frame && data)
+    if (view == NULL || data == NULL || data_size == 0)
     {
-        // parse header
-        data->nrecords = 0;
-        data->more_records_follow = 0;
-        i = MBUS_DATA_VARIABLE_HEADER_LENGTH;
+        snprintf(error_str, sizeof(error_str), "Got null pointer to frame, data or zero data_size.");
 
-        if(frame->data_size < i)
-        {
-            snprintf(error_str, sizeof(error_str), "Variable header too short.");
-            return -1;
-        }
+        return -1;
+    }
 
-        // first copy the variable data fixed header bytewise
-        data->header.id_bcd[0]       = frame->data[0];
-        data->header.id_bcd[1]       = frame->data[1];
-        data->header.id_bcd[2]       = frame->data[2];
-        data->header.id_bcd[3]       = frame->data[3];
-        data->header.manufacturer[0] = frame->data[4];
-        data->header.manufacturer[1] = frame->data[5];
-        data->header.version         = frame->data[6];
-        data->header.medium          = frame->data[7];
-        data->header.access_no       = frame->data[8];
-        data->header.status          = frame->data[9];
-        data->header.signature[0]    = frame->data[10];
-        data->header.signature[1]    = frame->data[11];
+    memset((void *)view, 0, sizeof(mbus_frame_view));
+    view->buff = data;
 
-        data->record = NULL;
+    switch (data[0])
+    {
+        case MBUS_FRAME_ACK_START:
 
-        while (i < frame->data_size)
-        {
-            // Skip filler dif=2F
-            if ((frame->data[i] & 0xFF) == MBUS_DIB_DIF_IDLE_FILLER)
-            {
-              i++;
-              continue;
-            }
+            // OK, got a valid ack frame, require no more data
+            view->type = MBUS_FRAME_TYPE_ACK;
+            view->size = MBUS_FRAME_BASE_SIZE_ACK;
+            return 0;
 
-            if ((record = mbus_data_record_new()) == NULL)
+        case MBUS_FRAME_SHORT_START:
+
+            if (data_size < MBUS_FRAME_BASE_SIZE_SHORT)
             {
-                // clean up...
-                return (-2);
+                // OK, got a valid short packet start, but we need more data
+                return MBUS_FRAME_BASE_SIZE_SHORT - data_size;
             }
 
-            // copy timestamp
-            memcpy((void *)&(record->timestamp), (void *)&(frame->timestamp), sizeof(time_t));
-
-            // read and parse DIB (= DIF + DIFE)
-
-            // DIF
-            record->drh.dib.dif = frame->data[i];
-
-            if ((record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) ||
-                (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW))
+            if (data_size != MBUS_FRAME_BASE_SIZE_SHORT)
             {
-                if ((record->drh.dib.dif & 0xFF) == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
-                {
-                  data->more_records_follow = 1;
-                }
-
-                i++;
-                // just copy the remaining data as it is vendor specific
-                record->data_len = frame->data_size - i;
-                for (j = 0; j < record->data_len; j++)
-                {
-                    record->data[j] = frame->data[i++];
-                }
+                snprintf(error_str, sizeof(error_str), "Too much data in frame.");
 
-                // append the record and move on to next one
-                mbus_data_record_append(data, record);
-                data->nrecords++;
-                continue;
+                // too much data... ?
+                return -2;
             }
 
-            // calculate length of data record
-            record->data_len = mbus_dif_datalength_lookup(record->drh.dib.dif);
+            view->type    = MBUS_FRAME_TYPE_SHORT;
+            view->size    = data_size;
+            view->control = data[1];
+            view->address = data[2];
 
-            // read DIF extensions
-            record->drh.dib.ndife = 0;
-            while ((i < frame->data_size) &&
-                   (frame->data[i] & MBUS_DIB_DIF_EXTENSION_BIT))
+            if (mbus_frame_control_verify(view->type, view->control) != 0)
             {
-                unsigned char dife;
-
-                if (record->drh.dib.ndife >= NITEMS(record->drh.dib.dife))
-                {
-                    mbus_data_record_free(record);
-                    snprintf(error_str, sizeof(error_str), "Too many DIFE.");
-                    return -1;
-                }
+                return -3;
+            }
+            break;
 
-                dife = frame->data[i+1];
-                record->drh.dib.dife[record->drh.dib.ndife] = dife;
+        case MBUS_FRAME_LONG_START: // (also CONTROL)
 
-                record->drh.dib.ndife++;
-                i++;
+            if (data_size < 3)
+            {
+                // OK, got a valid long/control packet start, but we need
+                // more data to determine the length
+                return 3 - data_size;
             }
-            i++;
 
-            if (i > frame->data_size)
+            if (data[1] < 3 || data[1] != data[2])
             {
-                mbus_data_record_free(record);
-                snprintf(error_str, sizeof(error_str), "Premature end of record at DIF.");
-                return -1;
-            }
+                snprintf(error_str, sizeof(error_str), "Invalid M-Bus frame length.");
 
-            // read and parse VIB (= VIF + VIFE)
+                // not a valid M-bus frame
+                return -2;
+            }
 
-            // VIF
-            record->drh.vib.vif = frame->data[i++];
+            // check length of packet:
+            len = data[1];
 
-            if ((record->drh.vib.vif & MBUS_DIB_VIF_WITHOUT_EXTENSION) == 0x7C)
+            if (data_size < (size_t)(MBUS_FRAME_FIXED_SIZE_LONG + len))
             {
-                // variable length VIF in ASCII format
-                int var_vif_len;
-                var_vif_len = frame->data[i++];
-                if (var_vif_len > sizeof(record->drh.vib.custom_vif))
-                {
-                    mbus_data_record_free(record);
-                    snprintf(error_str, sizeof(error_str), "Too long variable length VIF.");
-                    return -1;
-                }
-
-                if (i + var_vif_len > frame->data_size)
-                {
-                    mbus_data_record_free(record);
-                    snprintf(error_str, sizeof(error_str), "Premature end of record at variable length VIF.");
-                    return -1;
-                }
-                mbus_data_str_decode(record->drh.vib.custom_vif, &(frame->data[i]), var_vif_len);
-                i += var_vif_len;
+                // OK, but we need more data
+                return MBUS_FRAME_FIXED_SIZE_LONG + len - data_size;
             }
 
-            // VIFE
-            record->drh.vib.nvife = 0;
-
-            if (record->drh.vib.vif & MBUS_DIB_VIF_EXTENSION_BIT)
+            if (data_size > (size_t)(MBUS_FRAME_FIXED_SIZE_LONG + len))
             {
-                record->drh.vib.vife[0] = frame->data[i];
-                record->drh.vib.nvife++;
+                snprintf(error_str, sizeof(error_str), "Too much data in frame.");
 
-                while ((i < frame->data_size) &&
-                       (frame->data[i] & MBUS_DIB_VIF_EXTENSION_BIT))
-                {
-                    unsigned char vife;
+                // too much data... ?
+                return -2;
+            }
 
-                    if (record->drh.vib.nvife >= NITEMS(record->drh.vib.vife))
-                    {
-                        mbus_data_record_free(record);
-                        snprintf(error_str, sizeof(error_str), "Too many VIFE.");
-                        return -1;
-                    }
+            // we got the whole packet
+            view->type = (len == 3) ? MBUS_FRAME_TYPE_CONTROL : MBUS_FRAME_TYPE_LONG;
+            view->size = data_size;
+            view->control = data[4];
+            view->address = data[5];
+            view->control_information = data[6];
+            view->data = &(data[7]);
+            view->data_size = len - 3;
 
-                    vife = frame->data[i+1];
-                    record->drh.vib.vife[record->drh.vib.nvife] = vife;
+            if (data[3] != MBUS_FRAME_CONTROL_START)
+            {
+                snprintf(error_str, sizeof(error_str), "No frame start");
 
-                    record->drh.vib.nvife++;
-                    i++;
-                }
-                i++;
+                return -3;
             }
 
-            if (i > frame->data_size)
+            if (mbus_frame_control_verify(view->type, view->control) != 0)
             {
-                mbus_data_record_free(record);
-                snprintf(error_str, sizeof(error_str), "Premature end of record at VIF.");
-                return -1;
+                return -3;
             }
+            break;
 
-            // re-calculate data length, if of variable length type
-            if ((record->drh.dib.dif & MBUS_DATA_RECORD_DIF_MASK_DATA) == 0x0D) // flag for variable length data
-            {
-                if(frame->data[i] <= 0xBF)
-                    record->data_len = frame->data[i++];
-                else if(frame->data[i] >= 0xC0 && frame->data[i] <= 0xCF)
-                    record->data_len = (frame->data[i++] - 0xC0) * 2;
-                else if(frame->data[i] >= 0xD0 && frame->data[i] <= 0xDF)
-                    record->data_len = (frame->data[i++] - 0xD0) * 2;
-                else if(frame->data[i] >= 0xE0 && frame->data[i] <= 0xEF)
-                    record->data_len = frame->data[i++] - 0xE0;
-                else if(frame->data[i] >= 0xF0 && frame->data[i] <= 0xFA)
-                    record->data_len = frame->data[i++] - 0xF0;
-            }
+        default:
+            snprintf(error_str, sizeof(error_str), "Invalid M-Bus frame start.");
 
-            if (i + record->data_len > frame->data_size)
-            {
-                mbus_data_record_free(record);
-                snprintf(error_str, sizeof(error_str), "Premature end of record at data.");
-                return -1;
-            }
+            // not a valid M-Bus frame header (start byte)
+            return -4;
+    }
 
-            // copy data
-            for (j = 0; j < record->data_len; j++)
-            {
-                record->data[j] = frame->data[i++];
-            }
+    if (data[data_size - 1] != MBUS_FRAME_STOP)
+    {
+        snprintf(error_str, sizeof(error_str), "No frame stop");
 
-            // append the record and move on to next one
-            mbus_data_record_append(data, record);
-            data->nrecords++;
+        return -3;
+    }
+
+    checksum = view->control + view->address;
+
+    if (view->type != MBUS_FRAME_TYPE_SHORT)
+    {
+        checksum += view->control_information;
+
+        for (i = 0; i < view->data_size; i++)
+        {
+            checksum += view->data[i];
         }
+    }
 
-        return 0;
+    if (data[data_size - 2] != checksum)
+    {
+        snprintf(error_str, sizeof(error_str), "Invalid checksum (0x%.2x != 0x%.2x)", data[data_size - 2], checksum);
+
+        return -3;
     }
 
-    return -1;
+    return 0;
 }
 
 //------------------------------------------------------------------------------
-/// Check the stype of the frame data (error, fixed or variable) and dispatch to the
-/// corresponding parser function.
+/// Copy the frame of the view into a frame data structure.
 //------------------------------------------------------------------------------
 int
-mbus_frame_data_parse(mbus_frame *frame, mbus_frame_data *data)
+mbus_frame_view_to_frame(const mbus_frame_view *view, mbus_frame *frame)
 {
-    char direction;
-
-    if (frame == NULL)
+    if (view == NULL || view->buff == NULL || frame == NULL)
     {
-        snprintf(error_str, sizeof(error_str), "Got null pointer to frame.");
-        return -1;
-    }
+        snprintf(error_str, sizeof(error_str), "Got null pointer to frame view or frame.");
 
-    if (data == NULL)
-    {
-        snprintf(error_str, sizeof(error_str), "Got null pointer to data.");
         return -1;
     }
 
-    direction = (frame->control & MBUS_CONTROL_MASK_DIR);
+    frame->type   = view->type;
+    frame->start1 = view->buff[0];
 
-    if (direction == MBUS_CONTROL_MASK_DIR_S2M)
+    switch (view->type)
     {
-        if (frame->control_information == MBUS_CONTROL_INFO_ERROR_GENERAL)
-        {
-            data->type = MBUS_DATA_TYPE_ERROR;
-
-            if (frame->data_size > 0)
-            {
-                data->error = (int) frame->data[0];
-            }
-            else
-            {
-                data->error = 0;
-            }
-
-            return 0;
-        }
-        else if (frame->control_information == MBUS_CONTROL_INFO_RESP_FIXED)
-        {
-            if (frame->data_size == 0)
-            {
-                snprintf(error_str, sizeof(error_str), "Got zero data_size.");
-
-                return -1;
-            }
+        case MBUS_FRAME_TYPE_ACK:
+            break;
 
-            data->type = MBUS_DATA_TYPE_FIXED;
-            return mbus_data_fixed_parse(frame, &(data->data_fix));
-        }
-        else if (frame->control_information == MBUS_CONTROL_INFO_RESP_VARIABLE)
-        {
-            if (frame->data_size == 0)
-            {
-                snprintf(error_str, sizeof(error_str), "Got zero data_size.");
+        case MBUS_FRAME_TYPE_SHORT:
+            frame->control  = view->control;
+            frame->address  = view->address;
+            frame->checksum = view->buff[3];
+            frame->stop     = view->buff[4];
+            break;
 
-                return -1;
-            }
+        default:
+            frame->length1  = view->buff[1];
+            frame->length2  = view->buff[2];
+            frame->start2   = view->buff[3];
+            frame->control  = view->control;
+            frame->address  = view->address;
+            frame->control_information = view->control_information;
 
-            data->type = MBUS_DATA_TYPE_VARIABLE;
-            return mbus_data_variable_parse(frame, &(data->data_var));
-        }
-        else
-        {
-            snprintf(error_str, sizeof(error_str), "Unknown control information 0x%.2x", frame->control_information);
+            frame->data_size = view->data_size;
+            memcpy(frame->data, view->data, view->data_size);
 
-            return -1;
-        }
+            frame->checksum = view->buff[view->size - 2];
+            frame->stop     = view->buff[view->size - 1];
+            break;
     }
 
-    snprintf(error_str, sizeof(error_str), "Wrong direction in frame (master to slave)");
-
-    return -1;
+    return 0;
 }
 
 //------------------------------------------------------------------------------
-/// Pack the M-bus frame into a binary string representation that can be sent
-/// on the bus. The binary packet format is different for the different types
-/// of M-bus frames.
+/// PARSE M-BUS frame data structures from binary data.
 //------------------------------------------------------------------------------
 int
-mbus_frame_pack(mbus_frame *frame, unsigned char *data, size_t data_size)
+mbus_parse(mbus_frame *frame, unsigned char *data, size_t data_size)
 {
-    size_t i, offset = 0;
+    mbus_frame_view view;
+    size_t i;
+    int ret;
 
-    if (frame && data)
+    if (frame && data && data_size > 0)
     {
-        if (mbus_frame_calc_length(frame) == -1)
+        frame->next = NULL;
+
+        if (parse_debug)
+            printf("%s: Attempting to parse binary data [size = %zu]\n", __PRETTY_FUNCTION__, data_size);
+
+        if (parse_debug)
+            printf("%s: ", __PRETTY_FUNCTION__);
+
+        for (i = 0; i < data_size && parse_debug; i++)
         {
-            return -2;
+            printf("%.2X ", data[i] & 0xFF);
         }
 
-        if (mbus_frame_calc_checksum(frame) == -1)
+        if (parse_debug)
+            printf("\n%s: done.\n", __PRETTY_FUNCTION__);
+
+        ret = mbus_frame_view_parse(&view, data, data_size);
+
+        // a complete frame that failed the verification is kept as well
+        if (ret == 0 || ret == -3)
         {
-            return -3;
+            mbus_frame_view_to_frame(&view, frame);
         }
 
-        switch (frame->type)
-        {
-            case MBUS_FRAME_TYPE_ACK:
+        return ret;
+    }
 
-                if (data_size < MBUS_FRAME_ACK_BASE_SIZE)
-                {
-                    return -4;
-                }
+    snprintf(error_str, sizeof(error_str), "Got null pointer to frame, data or zero data_size.");
 
-                data[offset++] = frame->start1;
+    return -1;
+}
 
-                return offset;
 
-            case MBUS_FRAME_TYPE_SHORT:
+//------------------------------------------------------------------------------
+/// Parse the fixed-length data of a M-Bus frame
+//------------------------------------------------------------------------------
+int
+mbus_data_fixed_parse(mbus_frame *frame, mbus_data_fixed *data)
+{
+    if (frame && data)
+    {
+        if (frame->data_size != MBUS_DATA_FIXED_LENGTH)
+        {
+            snprintf(error_str, sizeof(error_str), "Invalid length for fixed data.");
+            return -1;
+        }
 
-                if (data_size < MBUS_FRAME_SHORT_BASE_SIZE)
-                {
-                    return -4;
-                }
+        // copy the fixed-length data structure bytewise
+        data->id_bcd[0]   = frame->data[0];
+        data->id_bcd[1]   = frame->data[1];
+        data->id_bcd[2]   = frame->data[2];
+        data->id_bcd[3]   = frame->data[3];
+        data->tx_cnt      = frame->data[4];
+        data->status      = frame->data[5];
+        data->cnt1_type   = frame->data[6];
+        data->cnt2_type   = frame->data[7];
+        data->cnt1_val[0] = frame->data[8];
+        data->cnt1_val[1] = frame->data[9];
+        data->cnt1_val[2] = frame->data[10];
+        data->cnt1_val[3] = frame->data[11];
+        data->cnt2_val[0] = frame->data[12];
+        data->cnt2_val[1] = frame->data[13];
+        data->cnt2_val[2] = frame->data[14];
+        data->cnt2_val[3] = frame->data[15];
 
-                data[offset++] = frame->start1;
-                data[offset++] = frame->control;
-                data[offset++] = frame->address;
-                data[offset++] = frame->checksum;
-                data[offset++] = frame->stop;
+        return 0;
+    }
 
-                return offset;
+    return -1;
+}
 
-            case MBUS_FRAME_TYPE_CONTROL:
 
-                if (data_size < MBUS_FRAME_CONTROL_BASE_SIZE)
-                {
-                    return -4;
-                }
+//------------------------------------------------------------------------------
+/// Link the records parsed into one block and hand them over to the data
+/// structure. The first record owns the block (see mbus_data_record_free).
+//------------------------------------------------------------------------------
+static void
+mbus_data_record_link(mbus_data_variable *data, mbus_data_record *records, size_t nrecords)
+{
+    size_t k;
 
-                data[offset++] = frame->start1;
-                data[offset++] = frame->length1;
-                data[offset++] = frame->length2;
-                data[offset++] = frame->start2;
+    if (nrecords == 0)
+    {
+        free(records);
+        return;
+    }
 
-                data[offset++] = frame->control;
-                data[offset++] = frame->address;
-                data[offset++] = frame->control_information;
+    for (k = 0; k + 1 < nrecords; k++)
+    {
+        records[k].next = &records[k + 1];
+    }
+    records[nrecords - 1].next = NULL;
+    records[0].block_size = nrecords;
 
-                data[offset++] = frame->checksum;
-                data[offset++] = frame->stop;
+    data->record = records;
+    data->record_last = &records[nrecords - 1];
+    data->nrecords = nrecords;
+}
 
-                return offset;
+//------------------------------------------------------------------------------
+/// Decode the fixed header of variable-length data (12 bytes).
+//------------------------------------------------------------------------------
+static void
+mbus_data_variable_header_decode(const unsigned char *data, mbus_data_variable_header *header)
+{
+    header->id_bcd[0]       = data[0];
+    header->id_bcd[1]       = data[1];
+    header->id_bcd[2]       = data[2];
+    header->id_bcd[3]       = data[3];
+    header->manufacturer[0] = data[4];
+    header->manufacturer[1] = data[5];
+    header->version         = data[6];
+    header->medium          = data[7];
+    header->access_no       = data[8];
+    header->status          = data[9];
+    header->signature[0]    = data[10];
+    header->signature[1]    = data[11];
+}
 
-            case MBUS_FRAME_TYPE_LONG:
+//------------------------------------------------------------------------------
+/// Take the data record at *pos of variable-length data and advance *pos
+/// behind it, idle fillers are skipped. Returns 1 for a record, 0 at the end of
+/// the data and -1 for a malformed record.
+//------------------------------------------------------------------------------
+static int
+mbus_data_record_scan(const unsigned char *data, size_t data_size, size_t *pos, mbus_record_view *record)
+{
+    size_t i = *pos;
 
-                if (data_size < frame->data_size + MBUS_FRAME_LONG_BASE_SIZE)
-                {
-                    return -4;
-                }
+    // Skip filler dif=2F
+    while (i < data_size && data[i] == MBUS_DIB_DIF_IDLE_FILLER)
+    {
+        i++;
+    }
 
-                data[offset++] = frame->start1;
-                data[offset++] = frame->length1;
-                data[offset++] = frame->length2;
-                data[offset++] = frame->start2;
+    *pos = i;
 
-                data[offset++] = frame->control;
-                data[offset++] = frame->address;
-                data[offset++] = frame->control_information;
+    if (i >= data_size)
+    {
+        return 0;
+    }
 
-                for (i = 0; i < frame->data_size; i++)
-                {
-                    data[offset++] = frame->data[i];
-                }
+    memset((void *)record, 0, sizeof(mbus_record_view));
+    record->offset = i;
 
-                data[offset++] = frame->checksum;
-                data[offset++] = frame->stop;
+    // read and parse DIB (= DIF + DIFE)
 
-                return offset;
+    // DIF
+    record->dif = data[i];
 
-            default:
-                return -5;
-        }
+    if ((record->dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) ||
+        (record->dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW))
+    {
+        i++;
+        // the remaining data is vendor specific
+        record->data = &(data[i]);
+        record->data_len = data_size - i;
+        *pos = data_size;
+        return 1;
     }
 
-    return -1;
-}
+    // calculate length of data record
+    record->data_len = mbus_dif_datalength_lookup(record->dif);
 
+    // DIF extensions
+    record->dife = &(data[i + 1]);
+    while ((i < data_size) &&
+           (data[i] & MBUS_DIB_DIF_EXTENSION_BIT))
+    {
+        if (record->ndife >= MBUS_DATA_INFO_BLOCK_DIFE_SIZE)
+        {
+            snprintf(error_str, sizeof(error_str), "Too many DIFE.");
+            return -1;
+        }
 
-//------------------------------------------------------------------------------
-/// pack the data stuctures into frame->data
-//------------------------------------------------------------------------------
-int
-mbus_frame_internal_pack(mbus_frame *frame, mbus_frame_data *frame_data)
-{
-    mbus_data_record *record;
-    int j;
+        record->ndife++;
+        i++;
+    }
+    i++;
 
-    if (frame == NULL || frame_data == NULL)
+    if (i >= data_size)
+    {
+        snprintf(error_str, sizeof(error_str), "Premature end of record at DIF.");
         return -1;
+    }
 
-    frame->data_size = 0;
+    // read and parse VIB (= VIF + VIFE)
 
-    switch (frame_data->type)
+    // VIF
+    record->vif = data[i++];
+
+    if ((record->vif & MBUS_DIB_VIF_WITHOUT_EXTENSION) == 0x7C)
     {
-        case MBUS_DATA_TYPE_ERROR:
+        // variable length VIF in ASCII format
+        if (i >= data_size ||
+            i + 1 + data[i] > data_size)
+        {
+            snprintf(error_str, sizeof(error_str), "Premature end of record at variable length VIF.");
+            return -1;
+        }
 
-            frame->data[frame->data_size++] = (char) frame_data->error;
+        record->custom_vif_len = data[i++];
+        record->custom_vif = &(data[i]);
+        i += record->custom_vif_len;
+    }
 
-            break;
+    // VIFE
+    if (record->vif & MBUS_DIB_VIF_EXTENSION_BIT)
+    {
+        record->vife = &(data[i]);
+        record->nvife++;
 
-        case MBUS_DATA_TYPE_FIXED:
+        while ((i < data_size) &&
+               (data[i] & MBUS_DIB_VIF_EXTENSION_BIT))
+        {
+            if (record->nvife >= MBUS_VALUE_INFO_BLOCK_VIFE_SIZE)
+            {
+                snprintf(error_str, sizeof(error_str), "Too many VIFE.");
+                return -1;
+            }
 
-            //
-            // pack fixed data structure
-            //
-            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[0];
-            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[1];
-            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[2];
-            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[3];
-            frame->data[frame->data_size++] = frame_data->data_fix.tx_cnt;
-            frame->data[frame->data_size++] = frame_data->data_fix.status;
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_type;
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_type;
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[0];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[1];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[2];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[3];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[0];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[1];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[2];
-            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[3];
+            record->nvife++;
+            i++;
+        }
+        i++;
+    }
 
-            break;
+    if (i > data_size)
+    {
+        snprintf(error_str, sizeof(error_str), "Premature end of record at VIF.");
+        return -1;
+    }
 
-        case MBUS_DATA_TYPE_VARIABLE:
+    // re-calculate data length, if of variable length type
+    if ((record->dif & MBUS_DATA_RECORD_DIF_MASK_DATA) == 0x0D) // flag for variable length data
+    {
+        if (i >= data_size)
+        {
+            snprintf(error_str, sizeof(error_str), "Premature end of record at data.");
+            return -1;
+        }
 
-            //
-            // first pack variable data structure header
-            //
-            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[0];
-            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[1];
-            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[2];
-            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[3];
-            frame->data[frame->data_size++] = frame_data->data_var.header.manufacturer[0];
-            frame->data[frame->data_size++] = frame_data->data_var.header.manufacturer[1];
-            frame->data[frame->data_size++] = frame_data->data_var.header.version;
-            frame->data[frame->data_size++] = frame_data->data_var.header.medium;
-            frame->data[frame->data_size++] = frame_data->data_var.header.access_no;
-            frame->data[frame->data_size++] = frame_data->data_var.header.status;
-            frame->data[frame->data_size++] = frame_data->data_var.header.signature[0];
-            frame->data[frame->data_size++] = frame_data->data_var.header.signature[1];
+        if(data[i] <= 0xBF)
+            record->data_len = data[i++];
+        else if(data[i] >= 0xC0 && data[i] <= 0xCF)
+            record->data_len = (data[i++] - 0xC0) * 2;
+        else if(data[i] >= 0xD0 && data[i] <= 0xDF)
+            record->data_len = (data[i++] - 0xD0) * 2;
+        else if(data[i] >= 0xE0 && data[i] <= 0xEF)
+            record->data_len = data[i++] - 0xE0;
+        else if(data[i] >= 0xF0 && data[i] <= 0xFA)
+            record->data_len = data[i++] - 0xF0;
+    }
 
-            //
-            // pack all data records
-            //
-            for (record = frame_data->data_var.record; record; record = record->next)
-            {
-                // pack DIF
-                if (parse_debug)
-                    printf("%s: packing DIF [%zu]", __PRETTY_FUNCTION__, frame->data_size);
-                frame->data[frame->data_size++] = record->drh.dib.dif;
-                for (j = 0; j < record->drh.dib.ndife; j++)
-                {
-                    frame->data[frame->data_size++] = record->drh.dib.dife[j];
-                }
+    if (i + record->data_len > data_size)
+    {
+        snprintf(error_str, sizeof(error_str), "Premature end of record at data.");
+        return -1;
+    }
 
-                // pack VIF
-                if (parse_debug)
-                    printf("%s: packing VIF [%zu]", __PRETTY_FUNCTION__, frame->data_size);
-                frame->data[frame->data_size++] = record->drh.vib.vif;
-                for (j = 0; j < record->drh.vib.nvife; j++)
-                {
-                    frame->data[frame->data_size++] = record->drh.vib.vife[j];
-                }
+    record->data = &(data[i]);
+    *pos = i + record->data_len;
 
-                // pack data
-                if (parse_debug)
-                    printf("%s: packing data [%zu : %zu]", __PRETTY_FUNCTION__, frame->data_size, record->data_len);
-                for (j = 0; j < record->data_len; j++)
-                {
-                    frame->data[frame->data_size++] = record->data[j];
-                }
-            }
+    return 1;
+}
 
-            break;
+//------------------------------------------------------------------------------
+/// Decode the fixed header of the variable-length data of a frame view.
+//------------------------------------------------------------------------------
+int
+mbus_frame_view_variable_header(const mbus_frame_view *view, mbus_data_variable_header *header)
+{
+    if (view == NULL || header == NULL)
+    {
+        snprintf(error_str, sizeof(error_str), "Got null pointer to frame view or header.");
+        return -1;
+    }
 
-        default:
-            return -2;
+    if (view->control_information != MBUS_CONTROL_INFO_RESP_VARIABLE)
+    {
+        snprintf(error_str, sizeof(error_str), "Non-variable data response.");
+        return -1;
     }
 
+    if (view->data_size < MBUS_DATA_VARIABLE_HEADER_LENGTH)
+    {
+        snprintf(error_str, sizeof(error_str), "Variable header too short.");
+        return -1;
+    }
+
+    mbus_data_variable_header_decode(view->data, header);
     return 0;
 }
 
 //------------------------------------------------------------------------------
-//
-// Print/Dump functions
-//
+/// Take the next data record of the variable-length data of a frame view. Start
+/// with *pos = MBUS_DATA_VARIABLE_HEADER_LENGTH, *pos is advanced behind the
+/// record. Returns 1 for a record, 0 after the last one and -1 on errors.
 //------------------------------------------------------------------------------
+int
+mbus_frame_view_next_record(const mbus_frame_view *view, size_t *pos, mbus_record_view *record)
+{
+    if (view == NULL || pos == NULL || record == NULL)
+    {
+        snprintf(error_str, sizeof(error_str), "Got null pointer to frame view or record.");
+        return -1;
+    }
+
+    if (view->control_information != MBUS_CONTROL_INFO_RESP_VARIABLE ||
+        *pos < MBUS_DATA_VARIABLE_HEADER_LENGTH)
+    {
+        snprintf(error_str, sizeof(error_str), "No variable data record at offset %zu.", *pos);
+        return -1;
+    }
+
+    return mbus_data_record_scan(view->data, view->data_size, pos, record);
+}
+
+//------------------------------------------------------------------------------
+/// Fill the header of a data record from a record view, so the decode functions
+/// can be used. The payload is not copied, record->data refers to the buffer of
+/// the view.
+//------------------------------------------------------------------------------
+int
+mbus_record_view_to_record(const mbus_record_view *view, mbus_data_record *record)
+{
+    if (view == NULL || record == NULL)
+    {
+        snprintf(error_str, sizeof(error_str), "Got null pointer to record view or record.");
+        return -1;
+    }
+
+    if (view->custom_vif_len >= sizeof(record->drh.vib.custom_vif))
+    {
+        snprintf(error_str, sizeof(error_str), "Too long variable length VIF.");
+        return -1;
+    }
+
+    record->drh.dib.dif = view->dif;
+    record->drh.dib.ndife = view->ndife;
+    if (view->ndife > 0)
+    {
+        memcpy(record->drh.dib.dife, view->dife, view->ndife);
+    }
+
+    record->drh.vib.vif = view->vif;
+    record->drh.vib.nvife = view->nvife;
+    if (view->nvife > 0)
+    {
+        memcpy(record->drh.vib.vife, view->vife, view->nvife);
+    }
+
+    if (view->custom_vif)
+    {
+        mbus_data_str_decode(record->drh.vib.custom_vif, view->custom_vif, view->custom_vif_len);
+    }
+
+    record->data = (unsigned char *)view->data;
+    record->data_len = view->data_len;
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Parse the variable-length data of a M-Bus frame
+//------------------------------------------------------------------------------
+int
+mbus_data_variable_parse(mbus_frame *frame, mbus_data_variable *data)
+{
+    mbus_data_record *records = NULL, *tmp;
+    mbus_record_view view;
+    size_t nrecords = 0, nalloc = 0;
+    size_t i;
+    int ret;
+
+    if (frame && data)
+    {
+        // parse header
+        data->nrecords = 0;
+        data->more_records_follow = 0;
+        i = MBUS_DATA_VARIABLE_HEADER_LENGTH;
+
+        if(frame->data_size < i)
+        {
+            snprintf(error_str, sizeof(error_str), "Variable header too short.");
+            return -1;
+        }
+
+        mbus_data_variable_header_decode(frame->data, &(data->header));
+
+        data->record = NULL;
+        data->record_last = NULL;
+
+        while ((ret = mbus_data_record_scan(frame->data, frame->data_size, &i, &view)) == 1)
+        {
+            // all records of the frame are kept in one block
+            if (nrecords == nalloc)
+            {
+                nalloc = nalloc ? 2 * nalloc : MBUS_DATA_RECORD_BLOCK;
+
+                if ((tmp = (mbus_data_record *)realloc(records, nalloc * sizeof(mbus_data_record))) == NULL)
+                {
+                    mbus_data_record_link(data, records, nrecords);
+                    return (-2);
+                }
+                records = tmp;
+            }
+
+            memset(&records[nrecords], 0, sizeof(mbus_data_record));
+
+            // copy timestamp
+            records[nrecords].timestamp = frame->timestamp;
+
+            // the payload stays in the frame
+            if (mbus_record_view_to_record(&view, &records[nrecords]) != 0)
+            {
+                ret = -1;
+                break;
+            }
+
+            if (view.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
+            {
+                data->more_records_follow = 1;
+            }
+
+            // append the record and move on to next one
+            nrecords++;
+        }
+
+        mbus_data_record_link(data, records, nrecords);
+        return ret;
+    }
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+/// Check the stype of the frame data (error, fixed or variable) and dispatch to the
+/// corresponding parser function.
+//------------------------------------------------------------------------------
+int
+mbus_frame_data_parse(mbus_frame *frame, mbus_frame_data *data)
+{
+    char direction;
+
+    if (frame == NULL)
+    {
+        snprintf(error_str, sizeof(error_str), "Got null pointer to frame.");
+        return -1;
+    }
+
+    if (data == NULL)
+    {
+        snprintf(error_str, sizeof(error_str), "Got null pointer to data.");
+        return -1;
+    }
+
+    direction = (frame->control & MBUS_CONTROL_MASK_DIR);
+
+    if (direction == MBUS_CONTROL_MASK_DIR_S2M)
+    {
+        if (frame->control_information == MBUS_CONTROL_INFO_ERROR_GENERAL)
+        {
+            data->type = MBUS_DATA_TYPE_ERROR;
+
+            if (frame->data_size > 0)
+            {
+                data->error = (int) frame->data[0];
+            }
+            else
+            {
+                data->error = 0;
+            }
+
+            return 0;
+        }
+        else if (frame->control_information == MBUS_CONTROL_INFO_RESP_FIXED)
+        {
+            if (frame->data_size == 0)
+            {
+                snprintf(error_str, sizeof(error_str), "Got zero data_size.");
+
+                return -1;
+            }
+
+            data->type = MBUS_DATA_TYPE_FIXED;
+            return mbus_data_fixed_parse(frame, &(data->data_fix));
+        }
+        else if (frame->control_information == MBUS_CONTROL_INFO_RESP_VARIABLE)
+        {
+            if (frame->data_size == 0)
+            {
+                snprintf(error_str, sizeof(error_str), "Got zero data_size.");
+
+                return -1;
+            }
+
+            data->type = MBUS_DATA_TYPE_VARIABLE;
+            return mbus_data_variable_parse(frame, &(data->data_var));
+        }
+        else
+        {
+            snprintf(error_str, sizeof(error_str), "Unknown control information 0x%.2x", frame->control_information);
+
+            return -1;
+        }
+    }
+
+    snprintf(error_str, sizeof(error_str), "Wrong direction in frame (master to slave)");
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+/// Pack the M-bus frame into a binary string representation that can be sent
+/// on the bus. The binary packet format is different for the different types
+/// of M-bus frames.
+//------------------------------------------------------------------------------
+int
+mbus_frame_pack(mbus_frame *frame, unsigned char *data, size_t data_size)
+{
+    size_t i, offset = 0;
+
+    if (frame && data)
+    {
+        if (mbus_frame_calc_length(frame) == -1)
+        {
+            return -2;
+        }
+
+        if (mbus_frame_calc_checksum(frame) == -1)
+        {
+            return -3;
+        }
+
+        switch (frame->type)
+        {
+            case MBUS_FRAME_TYPE_ACK:
+
+                if (data_size < MBUS_FRAME_ACK_BASE_SIZE)
+                {
+                    return -4;
+                }
+
+                data[offset++] = frame->start1;
+
+                return offset;
+
+            case MBUS_FRAME_TYPE_SHORT:
+
+                if (data_size < MBUS_FRAME_SHORT_BASE_SIZE)
+                {
+                    return -4;
+                }
+
+                data[offset++] = frame->start1;
+                data[offset++] = frame->control;
+                data[offset++] = frame->address;
+                data[offset++] = frame->checksum;
+                data[offset++] = frame->stop;
+
+                return offset;
+
+            case MBUS_FRAME_TYPE_CONTROL:
+
+                if (data_size < MBUS_FRAME_CONTROL_BASE_SIZE)
+                {
+                    return -4;
+                }
+
+                data[offset++] = frame->start1;
+                data[offset++] = frame->length1;
+                data[offset++] = frame->length2;
+                data[offset++] = frame->start2;
+
+                data[offset++] = frame->control;
+                data[offset++] = frame->address;
+                data[offset++] = frame->control_information;
+
+                data[offset++] = frame->checksum;
+                data[offset++] = frame->stop;
+
+                return offset;
+
+            case MBUS_FRAME_TYPE_LONG:
+
+                if (data_size < frame->data_size + MBUS_FRAME_LONG_BASE_SIZE)
+                {
+                    return -4;
+                }
+
+                data[offset++] = frame->start1;
+                data[offset++] = frame->length1;
+                data[offset++] = frame->length2;
+                data[offset++] = frame->start2;
+
+                data[offset++] = frame->control;
+                data[offset++] = frame->address;
+                data[offset++] = frame->control_information;
+
+                for (i = 0; i < frame->data_size; i++)
+                {
+                    data[offset++] = frame->data[i];
+                }
+
+                data[offset++] = frame->checksum;
+                data[offset++] = frame->stop;
+
+                return offset;
+
+            default:
+                return -5;
+        }
+    }
+
+    return -1;
+}
+
+
+//------------------------------------------------------------------------------
+/// pack the data stuctures into frame->data
+//------------------------------------------------------------------------------
+int
+mbus_frame_internal_pack(mbus_frame *frame, mbus_frame_data *frame_data)
+{
+    mbus_data_record *record;
+    int j;
+
+    if (frame == NULL || frame_data == NULL)
+        return -1;
+
+    frame->data_size = 0;
+
+    switch (frame_data->type)
+    {
+        case MBUS_DATA_TYPE_ERROR:
+
+            frame->data[frame->data_size++] = (char) frame_data->error;
+
+            break;
+
+        case MBUS_DATA_TYPE_FIXED:
+
+            //
+            // pack fixed data structure
+            //
+            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[0];
+            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[1];
+            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[2];
+            frame->data[frame->data_size++] = frame_data->data_fix.id_bcd[3];
+            frame->data[frame->data_size++] = frame_data->data_fix.tx_cnt;
+            frame->data[frame->data_size++] = frame_data->data_fix.status;
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_type;
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_type;
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[0];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[1];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[2];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt1_val[3];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[0];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[1];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[2];
+            frame->data[frame->data_size++] = frame_data->data_fix.cnt2_val[3];
+
+            break;
+
+        case MBUS_DATA_TYPE_VARIABLE:
+
+            //
+            // first pack variable data structure header
+            //
+            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[0];
+            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[1];
+            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[2];
+            frame->data[frame->data_size++] = frame_data->data_var.header.id_bcd[3];
+            frame->data[frame->data_size++] = frame_data->data_var.header.manufacturer[0];
+            frame->data[frame->data_size++] = frame_data->data_var.header.manufacturer[1];
+            frame->data[frame->data_size++] = frame_data->data_var.header.version;
+            frame->data[frame->data_size++] = frame_data->data_var.header.medium;
+            frame->data[frame->data_size++] = frame_data->data_var.header.access_no;
+            frame->data[frame->data_size++] = frame_data->data_var.header.status;
+            frame->data[frame->data_size++] = frame_data->data_var.header.signature[0];
+            frame->data[frame->data_size++] = frame_data->data_var.header.signature[1];
+
+            //
+            // pack all data records
+            //
+            for (record = frame_data->data_var.record; record; record = record->next)
+            {
+                // pack DIF
+                if (parse_debug)
+                    printf("%s: packing DIF [%zu]", __PRETTY_FUNCTION__, frame->data_size);
+                frame->data[frame->data_size++] = record->drh.dib.dif;
+                for (j = 0; j < record->drh.dib.ndife; j++)
+                {
+                    frame->data[frame->data_size++] = record->drh.dib.dife[j];
+                }
+
+                // pack VIF
+                if (parse_debug)
+                    printf("%s: packing VIF [%zu]", __PRETTY_FUNCTION__, frame->data_size);
+                frame->data[frame->data_size++] = record->drh.vib.vif;
+                for (j = 0; j < record->drh.vib.nvife; j++)
+                {
+                    frame->data[frame->data_size++] = record->drh.vib.vife[j];
+                }
+
+                // pack data
+                if (parse_debug)
+                    printf("%s: packing data [%zu : %zu]", __PRETTY_FUNCTION__, frame->data_size, record->data_len);
+                for (j = 0; j < record->data_len; j++)
+                {
+                    frame->data[frame->data_size++] = record->data[j];
+                }
+            }
+
+            break;
+
+        default:
+            return -2;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+//
+// Print/Dump functions
+//
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+/// Switch parse debugging
+//------------------------------------------------------------------------------
+void
+mbus_parse_set_debug(int debug)
+{
+    parse_debug = debug;
+}
+
+//------------------------------------------------------------------------------
+/// Dump frame in HEX on standard output
+//------------------------------------------------------------------------------
+int
+mbus_frame_print(mbus_frame *frame)
+{
+    mbus_frame *iter;
+    unsigned char data_buff[256];
+    int len, i;
+
+    if (frame == NULL)
+        return -1;
+
+    for (iter = frame; iter; iter = iter->next)
+    {
+        if ((len = mbus_frame_pack(iter, data_buff, sizeof(data_buff))) == -1)
+        {
+            return -2;
+        }
+
+        printf("%s: Dumping M-Bus frame [type %d, %d bytes]: ", __PRETTY_FUNCTION__, iter->type, len);
+        for (i = 0; i < len; i++)
+        {
+            printf("%.2X ", data_buff[i]);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+///
+/// Print the data part of a frame.
+///
+//------------------------------------------------------------------------------
+int
+mbus_frame_data_print(mbus_frame_data *data)
+{
+    if (data)
+    {
+        if (data->type == MBUS_DATA_TYPE_ERROR)
+        {
+            return mbus_data_error_print(data->error);
+        }
+
+        if (data->type == MBUS_DATA_TYPE_FIXED)
+        {
+            return mbus_data_fixed_print(&(data->data_fix));
+        }
+
+        if (data->type == MBUS_DATA_TYPE_VARIABLE)
+        {
+            return mbus_data_variable_print(&(data->data_var));
+        }
+    }
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+/// Print M-bus frame info to stdout
+//------------------------------------------------------------------------------
+int
+mbus_data_variable_header_print(mbus_data_variable_header *header)
+{
+    if (header)
+    {
+        printf("%s: ID           = %llX\n", __PRETTY_FUNCTION__,
+               mbus_data_bcd_decode_hex(header->id_bcd, 4));
+
+        printf("%s: Manufacturer = 0x%.2X%.2X\n", __PRETTY_FUNCTION__,
+               header->manufacturer[1], header->manufacturer[0]);
+
+        printf("%s: Manufacturer = %s\n", __PRETTY_FUNCTION__,
+               mbus_decode_manufacturer(header->manufacturer[0], header->manufacturer[1]));
+
+        printf("%s: Version      = 0x%.2X\n", __PRETTY_FUNCTION__, header->version);
+        printf("%s: Medium       = %s (0x%.2X)\n", __PRETTY_FUNCTION__, mbus_data_variable_medium_lookup(header->medium), header->medium);
+        printf("%s: Access #     = 0x%.2X\n", __PRETTY_FUNCTION__, header->access_no);
+        printf("%s: Status       = 0x%.2X\n", __PRETTY_FUNCTION__, header->status);
+        printf("%s: Signature    = 0x%.2X%.2X\n", __PRETTY_FUNCTION__,
+               header->signature[1], header->signature[0]);
+
+    }
+
+    return -1;
+}
+
+int
+mbus_data_variable_print(mbus_data_variable *data)
+{
+    mbus_data_record *record;
+    size_t j;
+
+    if (data)
+    {
+        mbus_data_variable_header_print(&(data->header));
+
+        for (record = data->record; record; record = record->next)
+        {
+            // DIF
+            printf("DIF               = %.2X\n", record->drh.dib.dif);
+            printf("DIF.Extension     = %s\n",  (record->drh.dib.dif & MBUS_DIB_DIF_EXTENSION_BIT) ? "Yes":"No");
+            printf("DIF.StorageNumber = %d\n",  (record->drh.dib.dif & MBUS_DATA_RECORD_DIF_MASK_STORAGE_NO) >> 6);
+            printf("DIF.Function      = %s\n",  (record->drh.dib.dif & 0x30) ? "Minimum value" : "Instantaneous value" );
+            printf("DIF.Data          = %.2X\n", record->drh.dib.dif & 0x0F);
+
+            // VENDOR SPECIFIC
+            if ((record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) ||
+                (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)) //MBUS_DIB_DIF_VENDOR_SPECIFIC
+            {
+                printf("%s: VENDOR DATA [size=%zu] = ", __PRETTY_FUNCTION__, record->data_len);
+                for (j = 0; j < record->data_len; j++)
+                {
+                    printf("%.2X ", record->data[j]);
+                }
+                printf("\n");
+
+                if (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
+                {
+                  printf("%s: More records follow in next telegram\n", __PRETTY_FUNCTION__);
+                }
+                continue;
+            }
+
+            // calculate length of data record
+            printf("DATA LENGTH = %zu\n", record->data_len);
+
+            // DIFE
+            for (j = 0; j < record->drh.dib.ndife; j++)
+            {
+                unsigned char dife = record->drh.dib.dife[j];
+
+                printf("DIFE[%zu]               = %.2X\n", j,  dife);
+                printf("DIFE[%zu].Extension     = %s\n",   j, (dife & MBUS_DATA_RECORD_DIFE_MASK_EXTENSION) ? "Yes" : "No");
+                printf("DIFE[%zu].Device        = %d\n",   j, (dife & MBUS_DATA_RECORD_DIFE_MASK_DEVICE) >> 6 );
+                printf("DIFE[%zu].Tariff        = %d\n",   j, (dife & MBUS_DATA_RECORD_DIFE_MASK_TARIFF) >> 4 );
+                printf("DIFE[%zu].StorageNumber = %.2X\n", j,  dife & MBUS_DATA_RECORD_DIFE_MASK_STORAGE_NO);
+            }
+
+            // VIF
+            printf("VIF           = %.2X\n", record->drh.vib.vif);
+            printf("VIF.Extension = %s\n",  (record->drh.vib.vif & MBUS_DIB_VIF_EXTENSION_BIT) ? "Yes":"No");
+            printf("VIF.Value     = %.2X\n", record->drh.vib.vif & MBUS_DIB_VIF_WITHOUT_EXTENSION);
+
+            // VIFE
+            for (j = 0; j < record->drh.vib.nvife; j++)
+            {
+                unsigned char vife = record->drh.vib.vife[j];
+
+                printf("VIFE[%zu]           = %.2X\n", j,  vife);
+                printf("VIFE[%zu].Extension = %s\n",   j, (vife & MBUS_DIB_VIF_EXTENSION_BIT) ? "Yes" : "No");
+                printf("VIFE[%zu].Value     = %.2X\n", j,  vife & MBUS_DIB_VIF_WITHOUT_EXTENSION);
+            }
+
+            printf("\n");
+        }
+    }
+
+    return -1;
+}
+
+int
+mbus_data_fixed_print(mbus_data_fixed *data)
+{
+    int val;
+
+    if (data)
+    {
+        printf("%s: ID       = %llX\n", __PRETTY_FUNCTION__, mbus_data_bcd_decode_hex(data->id_bcd, 4));
+        printf("%s: Access # = 0x%.2X\n", __PRETTY_FUNCTION__, data->tx_cnt);
+        printf("%s: Status   = 0x%.2X\n", __PRETTY_FUNCTION__, data->status);
+        printf("%s: Function = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_function(data->status));
+
+        printf("%s: Medium1  = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_medium(data));
+        printf("%s: Unit1    = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_unit(data->cnt1_type));
+        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
+        {
+            printf("%s: Counter1 = %llX\n", __PRETTY_FUNCTION__, mbus_data_bcd_decode_hex(data->cnt1_val, 4));
+        }
+        else
+        {
+            mbus_data_int_decode(data->cnt1_val, 4, &val);
+            printf("%s: Counter1 = %d\n", __PRETTY_FUNCTION__, val);
+        }
+
+        printf("%s: Medium2  = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_medium(data));
+        printf("%s: Unit2    = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_unit(data->cnt2_type));
+        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
+        {
+            printf("%s: Counter2 = %llX\n", __PRETTY_FUNCTION__, mbus_data_bcd_decode_hex(data->cnt2_val, 4));
+        }
+        else
+        {
+            mbus_data_int_decode(data->cnt2_val, 4, &val);
+            printf("%s: Counter2 = %d\n", __PRETTY_FUNCTION__, val);
+        }
+    }
+
+    return -1;
+}
+
+void
+mbus_hex_dump(const char *label, const char *buff, size_t len)
+{
+    time_t rawtime;
+    struct tm * timeinfo;
+    char timestamp[22];
+    struct tm tm_buff;
+    size_t i;
+
+    if (label == NULL || buff == NULL)
+        return;
+
+    time ( &rawtime );
+    timeinfo = mbus_gmtime_r(&rawtime, &tm_buff);
+
+    strftime(timestamp,21,"%Y-%m-%d %H:%M:%SZ",timeinfo);
+    fprintf(stderr, "[%s] %s (%03zu):", timestamp, label, len);
+
+    for (i = 0; i < len; i++)
+    {
+       fprintf(stderr, " %02X", (unsigned char) buff[i]);
+    }
+
+    fprintf(stderr, "\n");
+}
+
+int
+mbus_data_error_print(int error)
+{
+    printf("%s: Error = %d\n", __PRETTY_FUNCTION__, error);
+
+    return -1;
+}
+
+
+//------------------------------------------------------------------------------
+//
+// XML RELATED FUNCTIONS
+//
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+///
+/// Encode string to XML
+///
+//------------------------------------------------------------------------------
+int
+mbus_str_xml_encode(unsigned char *dst, const unsigned char *src, size_t max_len)
+{
+    size_t i, len;
+
+    i = 0;
+    len = 0;
+
+    if (dst == NULL)
+    {
+        return -1;
+    }
+
+    if (src == NULL)
+    {
+        dst[len] = '\0';
+        return -2;
+    }
+
+    while((len+6) < max_len)
+    {
+        if (src[i] == '\0')
+        {
+            break;
+        }
+
+        if (iscntrl(src[i]))
+        {
+            // convert all control chars into spaces
+            dst[len++] = ' ';
+        }
+        else
+        {
+            switch (src[i])
+            {
+                case '&':
+                    len += snprintf(&dst[len], max_len - len, "&amp;");
+                    break;
+                case '<':
+                    len += snprintf(&dst[len], max_len - len, "&lt;");
+                    break;
+                case '>':
+                    len += snprintf(&dst[len], max_len - len, "&gt;");
+                    break;
+                case '"':
+                    len += snprintf(&dst[len], max_len - len, "&quot;");
+                    break;
+                default:
+                    dst[len++] = src[i];
+                    break;
+            }
+        }
+
+        i++;
+    }
+
+    dst[len] = '\0';
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Generate XML for the variable-length data header
+//------------------------------------------------------------------------------
+char *
+mbus_data_variable_header_xml_r(mbus_data_variable_header *header, char *buff, size_t size)
+{
+    char manufacturer[4], medium[256];
+    char str_encoded[768];
+    size_t len = 0;
+
+    if (header)
+    {
+        len += snprintf(&buff[len], size - len, "    <SlaveInformation>\n");
+
+        len += snprintf(&buff[len], size - len, "        <Id>%llX</Id>\n", mbus_data_bcd_decode_hex(header->id_bcd, 4));
+        len += snprintf(&buff[len], size - len, "        <Manufacturer>%s</Manufacturer>\n",
+                mbus_decode_manufacturer_r(header->manufacturer[0], header->manufacturer[1], manufacturer, sizeof(manufacturer)));
+        len += snprintf(&buff[len], size - len, "        <Version>%d</Version>\n", header->version);
+
+        mbus_str_xml_encode(str_encoded, mbus_data_product_name(header), sizeof(str_encoded));
+
+        len += snprintf(&buff[len], size - len, "        <ProductName>%s</ProductName>\n", str_encoded);
+
+        mbus_str_xml_encode(str_encoded, mbus_data_variable_medium_lookup_r(header->medium, medium, sizeof(medium)), sizeof(str_encoded));
+
+        len += snprintf(&buff[len], size - len, "        <Medium>%s</Medium>\n", str_encoded);
+        len += snprintf(&buff[len], size - len, "        <AccessNumber>%d</AccessNumber>\n", header->access_no);
+        len += snprintf(&buff[len], size - len, "        <Status>%.2X</Status>\n", header->status);
+        len += snprintf(&buff[len], size - len, "        <Signature>%.2X%.2X</Signature>\n", header->signature[1], header->signature[0]);
+
+        len += snprintf(&buff[len], size - len, "    </SlaveInformation>\n\n");
+
+        return buff;
+    }
+
+    return "";
+}
+
+char *
+mbus_data_variable_header_xml(mbus_data_variable_header *header)
+{
+    static char buff[8192];
+
+    return mbus_data_variable_header_xml_r(header, buff, sizeof(buff));
+}
+
+//------------------------------------------------------------------------------
+/// Generate XML for a single variable-length data record
+//------------------------------------------------------------------------------
+char *
+mbus_data_variable_record_xml_r(mbus_data_record *record, int record_cnt, int frame_cnt, mbus_data_variable_header *header, char *buff, size_t size)
+{
+    char function[128], unit[128], value[768];
+    struct tm tm_buff;
+    char str_encoded[768];
+    size_t len = 0;
+    struct tm * timeinfo;
+    char timestamp[22];
+    long tariff;
+
+    if (record)
+    {
+        if (frame_cnt >= 0)
+        {
+            len += snprintf(&buff[len], size - len,
+                            "    <DataRecord id=\"%d\" frame=\"%d\">\n",
+                            record_cnt, frame_cnt);
+        }
+        else
+        {
+            len += snprintf(&buff[len], size - len,
+                            "    <DataRecord id=\"%d\">\n", record_cnt);
+        }
+
+        if (record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) // MBUS_DIB_DIF_VENDOR_SPECIFIC
+        {
+            len += snprintf(&buff[len], size - len,
+                            "        <Function>Manufacturer specific</Function>\n");
+        }
+        else if (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
+        {
+            len += snprintf(&buff[len], size - len,
+                            "        <Function>More records follow</Function>\n");
+        }
+        else
+        {
+            mbus_str_xml_encode(str_encoded, mbus_data_record_function_r(record, function, sizeof(function)), sizeof(str_encoded));
+            len += snprintf(&buff[len], size - len,
+                            "        <Function>%s</Function>\n", str_encoded);
+
+            len += snprintf(&buff[len], size - len,
+                            "        <StorageNumber>%ld</StorageNumber>\n",
+                            mbus_data_record_storage_number(record));
+
+            if ((tariff = mbus_data_record_tariff(record)) >= 0)
+            {
+                len += snprintf(&buff[len], size - len, "        <Tariff>%ld</Tariff>\n",
+                                tariff);
+                len += snprintf(&buff[len], size - len, "        <Device>%d</Device>\n",
+                                mbus_data_record_device(record));
+            }
+
+            mbus_str_xml_encode(str_encoded, mbus_data_record_unit_r(record, unit, sizeof(unit)), sizeof(str_encoded));
+            len += snprintf(&buff[len], size - len,
+                            "        <Unit>%s</Unit>\n", str_encoded);
+        }
+
+        mbus_str_xml_encode(str_encoded, mbus_data_record_value_r(record, value, sizeof(value)), sizeof(str_encoded));
+        len += snprintf(&buff[len], size - len, "        <Value>%s</Value>\n", str_encoded);
+
+        if (record->timestamp > 0)
+        {
+            timeinfo = mbus_gmtime_r(&(record->timestamp), &tm_buff);
+            strftime(timestamp,21,"%Y-%m-%dT%H:%M:%SZ",timeinfo);
+            len += snprintf(&buff[len], size - len,
+                            "        <Timestamp>%s</Timestamp>\n", timestamp);
+        }
+
+        len += snprintf(&buff[len], size - len, "    </DataRecord>\n\n");
+
+        return buff;
+    }
+
+    return "";
+}
+
+char *
+mbus_data_variable_record_xml(mbus_data_record *record, int record_cnt, int frame_cnt, mbus_data_variable_header *header)
+{
+    static char buff[8192];
+
+    return mbus_data_variable_record_xml_r(record, record_cnt, frame_cnt, header, buff, sizeof(buff));
+}
+
+//------------------------------------------------------------------------------
+/// Generate XML for variable-length data
+//------------------------------------------------------------------------------
+char *
+mbus_data_variable_xml(mbus_data_variable *data)
+{
+    mbus_data_record *record;
+    char *buff = NULL, *new_buff;
+    char xml[8192];
+    size_t len = 0, buff_size = 8192;
+    int i;
+
+    if (data)
+    {
+        buff = (char*) malloc(buff_size);
+
+        if (buff == NULL)
+            return NULL;
+
+        len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
+
+        len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
+
+        len += snprintf(&buff[len], buff_size - len, "%s",
+                        mbus_data_variable_header_xml_r(&(data->header), xml, sizeof(xml)));
+
+        for (record = data->record, i = 0; record; record = record->next, i++)
+        {
+            if ((buff_size - len) < 1024)
+            {
+                buff_size *= 2;
+                new_buff = (char*) realloc(buff,buff_size);
+
+                if (new_buff == NULL)
+                {
+                    free(buff);
+                    return NULL;
+                }
+
+                buff = new_buff;
+            }
+
+            len += snprintf(&buff[len], buff_size - len, "%s",
+                            mbus_data_variable_record_xml_r(record, i, -1, &(data->header), xml, sizeof(xml)));
+        }
+        len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
+
+        return buff;
+    }
+
+    return NULL;
+}
+
+//------------------------------------------------------------------------------
+/// Generate XML representation of fixed-length frame.
+//------------------------------------------------------------------------------
+char *
+mbus_data_fixed_xml(mbus_data_fixed *data)
+{
+    char *buff = NULL;
+    char str_encoded[256];
+    char lookup[256];
+    size_t len = 0, buff_size = 8192;
+    int val;
+
+    if (data)
+    {
+        buff = (char*) malloc(buff_size);
+
+        if (buff == NULL)
+            return NULL;
+
+        len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
+
+        len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
+
+        len += snprintf(&buff[len], buff_size - len, "    <SlaveInformation>\n");
+        len += snprintf(&buff[len], buff_size - len, "        <Id>%llX</Id>\n", mbus_data_bcd_decode_hex(data->id_bcd, 4));
+
+        mbus_str_xml_encode(str_encoded, mbus_data_fixed_medium_r(data, lookup, sizeof(lookup)), sizeof(str_encoded));
+        len += snprintf(&buff[len], buff_size - len, "        <Medium>%s</Medium>\n", str_encoded);
+
+        len += snprintf(&buff[len], buff_size - len, "        <AccessNumber>%d</AccessNumber>\n", data->tx_cnt);
+        len += snprintf(&buff[len], buff_size - len, "        <Status>%.2X</Status>\n", data->status);
+        len += snprintf(&buff[len], buff_size - len, "    </SlaveInformation>\n\n");
+
+        len += snprintf(&buff[len], buff_size - len, "    <DataRecord id=\"0\">\n");
+
+        mbus_str_xml_encode(str_encoded, mbus_data_fixed_function_r(data->status, lookup, sizeof(lookup)), sizeof(str_encoded));
+        len += snprintf(&buff[len], buff_size - len, "        <Function>%s</Function>\n", str_encoded);
+
+        mbus_str_xml_encode(str_encoded, mbus_data_fixed_unit_r(data->cnt1_type, lookup, sizeof(lookup)), sizeof(str_encoded));
+        len += snprintf(&buff[len], buff_size - len, "        <Unit>%s</Unit>\n", str_encoded);
+        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
+        {
+            len += snprintf(&buff[len], buff_size - len, "        <Value>%llX</Value>\n", mbus_data_bcd_decode_hex(data->cnt1_val, 4));
+        }
+        else
+        {
+            mbus_data_int_decode(data->cnt1_val, 4, &val);
+            len += snprintf(&buff[len], buff_size - len, "        <Value>%d</Value>\n", val);
+        }
+
+        len += snprintf(&buff[len], buff_size - len, "    </DataRecord>\n\n");
+
+        len += snprintf(&buff[len], buff_size - len, "    <DataRecord id=\"1\">\n");
+
+        mbus_str_xml_encode(str_encoded, mbus_data_fixed_function_r(data->status, lookup, sizeof(lookup)), sizeof(str_encoded));
+        len += snprintf(&buff[len], buff_size - len, "        <Function>%s</Function>\n", str_encoded);
+
+        mbus_str_xml_encode(str_encoded, mbus_data_fixed_unit_r(data->cnt2_type, lookup, sizeof(lookup)), sizeof(str_encoded));
+        len += snprintf(&buff[len], buff_size - len, "        <Unit>%s</Unit>\n", str_encoded);
+        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
+        {
+            len += snprintf(&buff[len], buff_size - len, "        <Value>%llX</Value>\n", mbus_data_bcd_decode_hex(data->cnt2_val, 4));
+        }
+        else
+        {
+            mbus_data_int_decode(data->cnt2_val, 4, &val);
+            len += snprintf(&buff[len], buff_size - len, "        <Value>%d</Value>\n", val);
+        }
+
+        len += snprintf(&buff[len], buff_size - len, "    </DataRecord>\n\n");
+
+        len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
+
+        return buff;
+    }
 
-//------------------------------------------------------------------------------
-/// Switch parse debugging
-//------------------------------------------------------------------------------
-void
-mbus_parse_set_debug(int debug)
-{
-    parse_debug = debug;
+    return NULL;
 }
 
 //------------------------------------------------------------------------------
-/// Dump frame in HEX on standard output
+/// Generate XML representation of a general application error.
 //------------------------------------------------------------------------------
-int
-mbus_frame_print(mbus_frame *frame)
+char *
+mbus_data_error_xml(int error)
 {
-    mbus_frame *iter;
-    unsigned char data_buff[256];
-    int len, i;
+    char *buff = NULL;
+    char str_encoded[256];
+    char lookup[256];
+    size_t len = 0, buff_size = 8192;
 
-    if (frame == NULL)
-        return -1;
+    buff = (char*) malloc(buff_size);
 
-    for (iter = frame; iter; iter = iter->next)
-    {
-        if ((len = mbus_frame_pack(iter, data_buff, sizeof(data_buff))) == -1)
-        {
-            return -2;
-        }
+    if (buff == NULL)
+        return NULL;
 
-        printf("%s: Dumping M-Bus frame [type %d, %d bytes]: ", __PRETTY_FUNCTION__, iter->type, len);
-        for (i = 0; i < len; i++)
-        {
-            printf("%.2X ", data_buff[i]);
-        }
-        printf("\n");
-    }
+    len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
+    len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
 
-    return 0;
+    len += snprintf(&buff[len], buff_size - len, "    <SlaveInformation>\n");
+
+    mbus_str_xml_encode(str_encoded, mbus_data_error_lookup_r(error, lookup, sizeof(lookup)), sizeof(str_encoded));
+    len += snprintf(&buff[len], buff_size - len, "        <Error>%s</Error>\n", str_encoded);
+
+    len += snprintf(&buff[len], buff_size - len, "    </SlaveInformation>\n\n");
+
+    len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
+
+    return buff;
 }
 
 //------------------------------------------------------------------------------
-///
-/// Print the data part of a frame.
-///
+/// Return a string containing an XML representation of the M-BUS frame data.
 //------------------------------------------------------------------------------
-int
-mbus_frame_data_print(mbus_frame_data *data)
+char *
+mbus_frame_data_xml(mbus_frame_data *data)
 {
     if (data)
     {
         if (data->type == MBUS_DATA_TYPE_ERROR)
         {
-            return mbus_data_error_print(data->error);
+            return mbus_data_error_xml(data->error);
         }
 
         if (data->type == MBUS_DATA_TYPE_FIXED)
         {
-            return mbus_data_fixed_print(&(data->data_fix));
+            return mbus_data_fixed_xml(&(data->data_fix));
         }
 
         if (data->type == MBUS_DATA_TYPE_VARIABLE)
         {
-            return mbus_data_variable_print(&(data->data_var));
+            return mbus_data_variable_xml(&(data->data_var));
         }
     }
 
-    return -1;
+    return NULL;
 }
 
+
 //------------------------------------------------------------------------------
-/// Print M-bus frame info to stdout
+/// Return an XML representation of the M-BUS frame.
 //------------------------------------------------------------------------------
-int
-mbus_data_variable_header_print(mbus_data_variable_header *header)
+char *
+mbus_frame_xml(mbus_frame *frame)
 {
-    if (header)
-    {
-        printf("%s: ID           = %llX\n", __PRETTY_FUNCTION__,
-               mbus_data_bcd_decode_hex(header->id_bcd, 4));
-
-        printf("%s: Manufacturer = 0x%.2X%.2X\n", __PRETTY_FUNCTION__,
-               header->manufacturer[1], header->manufacturer[0]);
+    mbus_frame_data frame_data;
+    mbus_frame *iter;
 
-        printf("%s: Manufacturer = %s\n", __PRETTY_FUNCTION__,
-               mbus_decode_manufacturer(header->manufacturer[0], header->manufacturer[1]));
+    mbus_data_record *record;
+    char *buff = NULL, *new_buff;
+    char xml[8192];
 
-        printf("%s: Version      = 0x%.2X\n", __PRETTY_FUNCTION__, header->version);
-        printf("%s: Medium       = %s (0x%.2X)\n", __PRETTY_FUNCTION__, mbus_data_variable_medium_lookup(header->medium), header->medium);
-        printf("%s: Access #     = 0x%.2X\n", __PRETTY_FUNCTION__, header->access_no);
-        printf("%s: Status       = 0x%.2X\n", __PRETTY_FUNCTION__, header->status);
-        printf("%s: Signature    = 0x%.2X%.2X\n", __PRETTY_FUNCTION__,
-               header->signature[1], header->signature[0]);
+    size_t len = 0, buff_size = 8192;
+    int record_cnt = 0, frame_cnt;
 
-    }
+    if (frame)
+    {
+        memset((void *)&frame_data, 0, sizeof(mbus_frame_data));
 
-    return -1;
-}
+        if (mbus_frame_data_parse(frame, &frame_data) == -1)
+        {
+            mbus_error_set(MBUS_ERROR_CODE_DATA, "M-bus data parse error.");
+            return NULL;
+        }
 
-int
-mbus_data_variable_print(mbus_data_variable *data)
-{
-    mbus_data_record *record;
-    size_t j;
+        if (frame_data.type == MBUS_DATA_TYPE_ERROR)
+        {
+            //
+            // generate XML for error
+            //
+            return mbus_data_error_xml(frame_data.error);
+        }
 
-    if (data)
-    {
-        mbus_data_variable_header_print(&(data->header));
+        if (frame_data.type == MBUS_DATA_TYPE_FIXED)
+        {
+            //
+            // generate XML for fixed data
+            //
+            return mbus_data_fixed_xml(&(frame_data.data_fix));
+        }
 
-        for (record = data->record; record; record = record->next)
+        if (frame_data.type == MBUS_DATA_TYPE_VARIABLE)
         {
-            // DIF
-            printf("DIF               = %.2X\n", record->drh.dib.dif);
-            printf("DIF.Extension     = %s\n",  (record->drh.dib.dif & MBUS_DIB_DIF_EXTENSION_BIT) ? "Yes":"No");
-            printf("DIF.StorageNumber = %d\n",  (record->drh.dib.dif & MBUS_DATA_RECORD_DIF_MASK_STORAGE_NO) >> 6);
-            printf("DIF.Function      = %s\n",  (record->drh.dib.dif & 0x30) ? "Minimum value" : "Instantaneous value" );
-            printf("DIF.Data          = %.2X\n", record->drh.dib.dif & 0x0F);
+            //
+            // generate XML for a sequence of variable data frames
+            //
 
-            // VENDOR SPECIFIC
-            if ((record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) ||
-                (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)) //MBUS_DIB_DIF_VENDOR_SPECIFIC
-            {
-                printf("%s: VENDOR DATA [size=%zu] = ", __PRETTY_FUNCTION__, record->data_len);
-                for (j = 0; j < record->data_len; j++)
-                {
-                    printf("%.2X ", record->data[j]);
-                }
-                printf("\n");
+            buff = (char*) malloc(buff_size);
 
-                if (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
-                {
-                  printf("%s: More records follow in next telegram\n", __PRETTY_FUNCTION__);
-                }
-                continue;
+            if (buff == NULL)
+            {
+                mbus_data_record_free(frame_data.data_var.record);
+                return NULL;
             }
 
-            // calculate length of data record
-            printf("DATA LENGTH = %zu\n", record->data_len);
+            // include frame counter in XML output if more than one frame
+            // is available (frame_cnt = -1 => not included in output)
+            frame_cnt = (frame->next == NULL) ? -1 : 0;
 
-            // DIFE
-            for (j = 0; j < record->drh.dib.ndife; j++)
-            {
-                unsigned char dife = record->drh.dib.dife[j];
+            len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
 
-                printf("DIFE[%zu]               = %.2X\n", j,  dife);
-                printf("DIFE[%zu].Extension     = %s\n",   j, (dife & MBUS_DATA_RECORD_DIFE_MASK_EXTENSION) ? "Yes" : "No");
-                printf("DIFE[%zu].Device        = %d\n",   j, (dife & MBUS_DATA_RECORD_DIFE_MASK_DEVICE) >> 6 );
-                printf("DIFE[%zu].Tariff        = %d\n",   j, (dife & MBUS_DATA_RECORD_DIFE_MASK_TARIFF) >> 4 );
-                printf("DIFE[%zu].StorageNumber = %.2X\n", j,  dife & MBUS_DATA_RECORD_DIFE_MASK_STORAGE_NO);
-            }
+            len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
 
-            // VIF
-            printf("VIF           = %.2X\n", record->drh.vib.vif);
-            printf("VIF.Extension = %s\n",  (record->drh.vib.vif & MBUS_DIB_VIF_EXTENSION_BIT) ? "Yes":"No");
-            printf("VIF.Value     = %.2X\n", record->drh.vib.vif & MBUS_DIB_VIF_WITHOUT_EXTENSION);
+            // only print the header info for the first frame (should be
+            // the same for each frame in a sequence of a multi-telegram
+            // transfer.
+            len += snprintf(&buff[len], buff_size - len, "%s",
+                                    mbus_data_variable_header_xml_r(&(frame_data.data_var.header), xml, sizeof(xml)));
 
-            // VIFE
-            for (j = 0; j < record->drh.vib.nvife; j++)
+            // loop through all records in the current frame, using a global
+            // record count as record ID in the XML output
+            for (record = frame_data.data_var.record; record; record = record->next, record_cnt++)
             {
-                unsigned char vife = record->drh.vib.vife[j];
-
-                printf("VIFE[%zu]           = %.2X\n", j,  vife);
-                printf("VIFE[%zu].Extension = %s\n",   j, (vife & MBUS_DIB_VIF_EXTENSION_BIT) ? "Yes" : "No");
-                printf("VIFE[%zu].Value     = %.2X\n", j,  vife & MBUS_DIB_VIF_WITHOUT_EXTENSION);
-            }
-
-            printf("\n");
-        }
-    }
+                if ((buff_size - len) < 1024)
+                {
+                    buff_size *= 2;
+                    new_buff = (char*) realloc(buff,buff_size);
 
-    return -1;
-}
+                    if (new_buff == NULL)
+                    {
+                        free(buff);
+                        mbus_data_record_free(frame_data.data_var.record);
+                        return NULL;
+                    }
 
-int
-mbus_data_fixed_print(mbus_data_fixed *data)
-{
-    int val;
+                    buff = new_buff;
+                }
 
-    if (data)
-    {
-        printf("%s: ID       = %llX\n", __PRETTY_FUNCTION__, mbus_data_bcd_decode_hex(data->id_bcd, 4));
-        printf("%s: Access # = 0x%.2X\n", __PRETTY_FUNCTION__, data->tx_cnt);
-        printf("%s: Status   = 0x%.2X\n", __PRETTY_FUNCTION__, data->status);
-        printf("%s: Function = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_function(data->status));
+                len += snprintf(&buff[len], buff_size - len, "%s",
+                                mbus_data_variable_record_xml_r(record, record_cnt, frame_cnt, &(frame_data.data_var.header), xml, sizeof(xml)));
+            }
 
-        printf("%s: Medium1  = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_medium(data));
-        printf("%s: Unit1    = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_unit(data->cnt1_type));
-        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
-        {
-            printf("%s: Counter1 = %llX\n", __PRETTY_FUNCTION__, mbus_data_bcd_decode_hex(data->cnt1_val, 4));
-        }
-        else
-        {
-            mbus_data_int_decode(data->cnt1_val, 4, &val);
-            printf("%s: Counter1 = %d\n", __PRETTY_FUNCTION__, val);
-        }
+            // free all records in the list
+            if (frame_data.data_var.record)
+            {
+                mbus_data_record_free(frame_data.data_var.record);
+                frame_data.data_var.record = NULL;
+            }
 
-        printf("%s: Medium2  = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_medium(data));
-        printf("%s: Unit2    = %s\n", __PRETTY_FUNCTION__, mbus_data_fixed_unit(data->cnt2_type));
-        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
-        {
-            printf("%s: Counter2 = %llX\n", __PRETTY_FUNCTION__, mbus_data_bcd_decode_hex(data->cnt2_val, 4));
-        }
-        else
-        {
-            mbus_data_int_decode(data->cnt2_val, 4, &val);
-            printf("%s: Counter2 = %d\n", __PRETTY_FUNCTION__, val);
-        }
-    }
+            frame_cnt++;
 
-    return -1;
-}
+            for (iter = frame->next; iter; iter = iter->next, frame_cnt++)
+            {
+                if (mbus_frame_data_parse(iter, &frame_data) == -1)
+                {
+                    mbus_error_set(MBUS_ERROR_CODE_DATA, "M-bus variable data parse error.");
+                    return NULL;
+                }
 
-void
-mbus_hex_dump(const char *label, const char *buff, size_t len)
-{
-    time_t rawtime;
-    struct tm * timeinfo;
-    char timestamp[22];
-    size_t i;
+                // loop through all records in the current frame, using a global
+                // record count as record ID in the XML output
+                for (record = frame_data.data_var.record; record; record = record->next, record_cnt++)
+                {
+                    if ((buff_size - len) < 1024)
+                    {
+                        buff_size *= 2;
+                        new_buff = (char*) realloc(buff,buff_size);
 
-    if (label == NULL || buff == NULL)
-        return;
+                        if (new_buff == NULL)
+                        {
+                            free(buff);
+                            mbus_data_record_free(frame_data.data_var.record);
+                            return NULL;
+                        }
 
-    time ( &rawtime );
-    timeinfo = gmtime ( &rawtime );
+                        buff = new_buff;
+                    }
 
-    strftime(timestamp,21,"%Y-%m-%d %H:%M:%SZ",timeinfo);
-    fprintf(stderr, "[%s] %s (%03zu):", timestamp, label, len);
+                    len += snprintf(&buff[len], buff_size - len, "%s",
+                                    mbus_data_variable_record_xml_r(record, record_cnt, frame_cnt, &(frame_data.data_var.header), xml, sizeof(xml)));
+                }
 
-    for (i = 0; i < len; i++)
-    {
-       fprintf(stderr, " %02X", (unsigned char) buff[i]);
-    }
+                // free all records in the list
+                if (frame_data.data_var.record)
+                {
+                    mbus_data_record_free(frame_data.data_var.record);
+                    frame_data.data_var.record = NULL;
+                }
+            }
 
-    fprintf(stderr, "\n");
-}
+            len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
 
-int
-mbus_data_error_print(int error)
-{
-    printf("%s: Error = %d\n", __PRETTY_FUNCTION__, error);
+            return buff;
+        }
+    }
 
-    return -1;
+    return NULL;
 }
 
-
 //------------------------------------------------------------------------------
 //
-// XML RELATED FUNCTIONS
+// JSON RELATED FUNCTIONS
 //
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
-///
-/// Encode string to XML
-///
+/// Growable output buffer used by the JSON generating functions. Internal.
 //------------------------------------------------------------------------------
-int
-mbus_str_xml_encode(unsigned char *dst, const unsigned char *src, size_t max_len)
+typedef struct _mbus_json_buff {
+
+    char  *buff;
+    size_t len;
+    size_t size;
+
+} mbus_json_buff;
+
+static int
+mbus_json_reserve(mbus_json_buff *jb, size_t needed)
 {
-    size_t i, len;
+    char *new_buff;
+    size_t new_size;
 
-    i = 0;
-    len = 0;
+    if (jb->buff == NULL)
+        return -1;
 
-    if (dst == NULL)
+    if (jb->len + needed < jb->size)
+        return 0;
+
+    for (new_size = jb->size * 2; jb->len + needed >= new_size; new_size *= 2);
+
+    if ((new_buff = (char *) realloc(jb->buff, new_size)) == NULL)
     {
+        free(jb->buff);
+        jb->buff = NULL;
         return -1;
     }
 
-    if (src == NULL)
-    {
-        dst[len] = '\0';
-        return -2;
-    }
+    jb->buff = new_buff;
+    jb->size = new_size;
+    return 0;
+}
 
-    while((len+6) < max_len)
-    {
-        if (src[i] == '\0')
-        {
-            break;
-        }
+static int
+mbus_json_printf(mbus_json_buff *jb, const char *format, ...)
+{
+    va_list args;
+    int n;
 
-        if (iscntrl(src[i]))
-        {
-            // convert all control chars into spaces
-            dst[len++] = ' ';
-        }
-        else
-        {
-            switch (src[i])
-            {
-                case '&':
-                    len += snprintf(&dst[len], max_len - len, "&amp;");
-                    break;
-                case '<':
-                    len += snprintf(&dst[len], max_len - len, "&lt;");
-                    break;
-                case '>':
-                    len += snprintf(&dst[len], max_len - len, "&gt;");
-                    break;
-                case '"':
-                    len += snprintf(&dst[len], max_len - len, "&quot;");
-                    break;
-                default:
-                    dst[len++] = src[i];
-                    break;
-            }
-        }
+    if (jb->buff == NULL)
+        return -1;
 
-        i++;
+    va_start(args, format);
+    n = vsnprintf(&jb->buff[jb->len], jb->size - jb->len, format, args);
+    va_end(args);
+
+    if (n < 0)
+        return -1;
+
+    if ((size_t) n >= jb->size - jb->len)
+    {
+        if (mbus_json_reserve(jb, n + 1) == -1)
+            return -1;
+
+        va_start(args, format);
+        vsnprintf(&jb->buff[jb->len], jb->size - jb->len, format, args);
+        va_end(args);
     }
 
-    dst[len] = '\0';
+    jb->len += n;
     return 0;
 }
 
 //------------------------------------------------------------------------------
-/// Generate XML for the variable-length data header
+/// Append a quoted JSON string. Control characters are escaped and bytes above
+/// 0x7F are treated as ISO-8859-1 (the code page used by the XML output).
 //------------------------------------------------------------------------------
-char *
-mbus_data_variable_header_xml(mbus_data_variable_header *header)
+static int
+mbus_json_string(mbus_json_buff *jb, const char *src)
 {
-    static char buff[8192];
-    char str_encoded[768];
-    size_t len = 0;
-
-    if (header)
-    {
-        len += snprintf(&buff[len], sizeof(buff) - len, "    <SlaveInformation>\n");
-
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Id>%llX</Id>\n", mbus_data_bcd_decode_hex(header->id_bcd, 4));
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Manufacturer>%s</Manufacturer>\n",
-                mbus_decode_manufacturer(header->manufacturer[0], header->manufacturer[1]));
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Version>%d</Version>\n", header->version);
-
-        mbus_str_xml_encode(str_encoded, mbus_data_product_name(header), sizeof(str_encoded));
+    const unsigned char *p;
 
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <ProductName>%s</ProductName>\n", str_encoded);
-
-        mbus_str_xml_encode(str_encoded, mbus_data_variable_medium_lookup(header->medium), sizeof(str_encoded));
+    if (src == NULL)
+        src = "";
 
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Medium>%s</Medium>\n", str_encoded);
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <AccessNumber>%d</AccessNumber>\n", header->access_no);
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Status>%.2X</Status>\n", header->status);
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Signature>%.2X%.2X</Signature>\n", header->signature[1], header->signature[0]);
+    // worst case is a \u00XX escape for every byte
+    if (mbus_json_reserve(jb, strlen(src) * 6 + 3) == -1)
+        return -1;
 
-        len += snprintf(&buff[len], sizeof(buff) - len, "    </SlaveInformation>\n\n");
+    jb->buff[jb->len++] = '"';
 
-        return buff;
+    for (p = (const unsigned char *) src; *p; p++)
+    {
+        switch (*p)
+        {
+            case '"':
+                jb->buff[jb->len++] = '\\';
+                jb->buff[jb->len++] = '"';
+                break;
+            case '\\':
+                jb->buff[jb->len++] = '\\';
+                jb->buff[jb->len++] = '\\';
+                break;
+            default:
+                if (*p < 0x20 || *p > 0x7E)
+                {
+                    jb->len += snprintf(&jb->buff[jb->len], jb->size - jb->len, "\\u%04x", *p);
+                }
+                else
+                {
+                    jb->buff[jb->len++] = *p;
+                }
+                break;
+        }
     }
 
-    return "";
+    jb->buff[jb->len++] = '"';
+    jb->buff[jb->len] = '\0';
+    return 0;
 }
 
 //------------------------------------------------------------------------------
-/// Generate XML for a single variable-length data record
+/// Check if a decoded value string represents a number and optionally return
+/// its value. Leading zeros are accepted ("0012"), hex digits, dates and
+/// whitespace-only strings are not. Returns 1 for numbers, 0 otherwise.
 //------------------------------------------------------------------------------
-char *
-mbus_data_variable_record_xml(mbus_data_record *record, int record_cnt, int frame_cnt, mbus_data_variable_header *header)
+int
+mbus_str_to_number(const char *src, double *value)
 {
-    static char buff[8192];
-    char str_encoded[768];
-    size_t len = 0;
-    struct tm * timeinfo;
-    char timestamp[22];
-    long tariff;
+    const char *p;
+    char *end;
+    double val;
+    int digits = 0;
 
-    if (record)
-    {
-        if (frame_cnt >= 0)
-        {
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "    <DataRecord id=\"%d\" frame=\"%d\">\n",
-                            record_cnt, frame_cnt);
-        }
-        else
-        {
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "    <DataRecord id=\"%d\">\n", record_cnt);
-        }
+    if (src == NULL)
+        return 0;
 
-        if (record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) // MBUS_DIB_DIF_VENDOR_SPECIFIC
-        {
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "        <Function>Manufacturer specific</Function>\n");
-        }
-        else if (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
-        {
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "        <Function>More records follow</Function>\n");
-        }
-        else
-        {
-            mbus_str_xml_encode(str_encoded, mbus_data_record_function(record), sizeof(str_encoded));
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "        <Function>%s</Function>\n", str_encoded);
+    for (p = src; isspace((unsigned char) *p); p++);
 
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "        <StorageNumber>%ld</StorageNumber>\n",
-                            mbus_data_record_storage_number(record));
+    if (*p == '+' || *p == '-')
+        p++;
 
-            if ((tariff = mbus_data_record_tariff(record)) >= 0)
-            {
-                len += snprintf(&buff[len], sizeof(buff) - len, "        <Tariff>%ld</Tariff>\n",
-                                tariff);
-                len += snprintf(&buff[len], sizeof(buff) - len, "        <Device>%d</Device>\n",
-                                mbus_data_record_device(record));
-            }
+    // only plain decimal notation, strtod would also accept hex, inf and nan
+    for (; *p; p++)
+    {
+        if (isdigit((unsigned char) *p))
+            digits++;
+        else if (*p != '.' && *p != 'e' && *p != 'E' &&
+                 *p != '+' && *p != '-' && !isspace((unsigned char) *p))
+            return 0;
+    }
 
-            mbus_str_xml_encode(str_encoded, mbus_data_record_unit(record), sizeof(str_encoded));
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "        <Unit>%s</Unit>\n", str_encoded);
-        }
+    if (digits == 0)
+        return 0;
 
-        mbus_str_xml_encode(str_encoded, mbus_data_record_value(record), sizeof(str_encoded));
-        len += snprintf(&buff[len], sizeof(buff) - len, "        <Value>%s</Value>\n", str_encoded);
+    val = strtod(src, &end);
 
-        if (record->timestamp > 0)
-        {
-            timeinfo = gmtime (&(record->timestamp));
-            strftime(timestamp,21,"%Y-%m-%dT%H:%M:%SZ",timeinfo);
-            len += snprintf(&buff[len], sizeof(buff) - len,
-                            "        <Timestamp>%s</Timestamp>\n", timestamp);
-        }
+    for (; isspace((unsigned char) *end); end++);
 
-        len += snprintf(&buff[len], sizeof(buff) - len, "    </DataRecord>\n\n");
+    if (*end != '\0')
+        return 0;
 
-        return buff;
-    }
+    if (value)
+        *value = val;
 
-    return "";
+    return 1;
 }
 
 //------------------------------------------------------------------------------
-/// Generate XML for variable-length data
+/// Append a decoded value either as JSON number or as JSON string.
 //------------------------------------------------------------------------------
-char *
-mbus_data_variable_xml(mbus_data_variable *data)
+static int
+mbus_json_value(mbus_json_buff *jb, const char *src)
 {
-    mbus_data_record *record;
-    char *buff = NULL, *new_buff;
-    size_t len = 0, buff_size = 8192;
-    int i;
+    const char *p;
+    double val;
+    int is_int = 1;
 
-    if (data)
-    {
-        buff = (char*) malloc(buff_size);
+    if (!mbus_str_to_number(src, &val))
+        return mbus_json_string(jb, src);
 
-        if (buff == NULL)
-            return NULL;
+    for (p = src; isspace((unsigned char) *p); p++);
 
-        len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
+    if (*p == '-' || *p == '+')
+        p++;
 
-        len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
+    for (; *p && !isspace((unsigned char) *p); p++)
+    {
+        if (!isdigit((unsigned char) *p))
+            is_int = 0;
+    }
 
-        len += snprintf(&buff[len], buff_size - len, "%s",
-                        mbus_data_variable_header_xml(&(data->header)));
+    if (!is_int)
+    {
+        char num[32];
 
-        for (record = data->record, i = 0; record; record = record->next, i++)
+        // shortest representation that survives the round trip
+        snprintf(num, sizeof(num), "%.15g", val);
+
+        if (strtod(num, NULL) != val)
         {
-            if ((buff_size - len) < 1024)
-            {
-                buff_size *= 2;
-                new_buff = (char*) realloc(buff,buff_size);
+            snprintf(num, sizeof(num), "%.17g", val);
+        }
 
-                if (new_buff == NULL)
-                {
-                    free(buff);
-                    return NULL;
-                }
+        return mbus_json_printf(jb, "%s", num);
+    }
 
-                buff = new_buff;
-            }
+    // integers are copied digit by digit (JSON does not allow leading zeros
+    // and the value may exceed the precision of a double)
+    for (p = src; isspace((unsigned char) *p); p++);
 
-            len += snprintf(&buff[len], buff_size - len, "%s",
-                            mbus_data_variable_record_xml(record, i, -1, &(data->header)));
-        }
-        len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
+    if (*p == '-')
+    {
+        if (mbus_json_printf(jb, "-") == -1)
+            return -1;
+        p++;
+    }
+    else if (*p == '+')
+    {
+        p++;
+    }
 
-        return buff;
+    for (; *p == '0' && isdigit((unsigned char) p[1]); p++);
+
+    for (; *p && !isspace((unsigned char) *p); p++)
+    {
+        if (mbus_json_printf(jb, "%c", *p) == -1)
+            return -1;
     }
 
-    return NULL;
+    return 0;
 }
 
 //------------------------------------------------------------------------------
-/// Generate XML representation of fixed-length frame.
+/// Append the JSON object for the variable-length data header. Internal.
 //------------------------------------------------------------------------------
-char *
-mbus_data_fixed_xml(mbus_data_fixed *data)
+static void
+mbus_data_variable_header_json(mbus_json_buff *jb, mbus_data_variable_header *header)
 {
-    char *buff = NULL;
-    char str_encoded[256];
-    size_t len = 0, buff_size = 8192;
-    int val;
+    char str[32];
+    char manufacturer[4], medium[256];
 
-    if (data)
-    {
-        buff = (char*) malloc(buff_size);
+    mbus_json_printf(jb, "\"SlaveInformation\":{");
 
-        if (buff == NULL)
-            return NULL;
+    snprintf(str, sizeof(str), "%llX", mbus_data_bcd_decode_hex(header->id_bcd, 4));
+    mbus_json_printf(jb, "\"Id\":");
+    mbus_json_value(jb, str);
 
-        len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
+    mbus_json_printf(jb, ",\"Manufacturer\":");
+    mbus_json_string(jb, mbus_decode_manufacturer_r(header->manufacturer[0], header->manufacturer[1], manufacturer, sizeof(manufacturer)));
 
-        len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
+    mbus_json_printf(jb, ",\"Version\":%d", header->version);
 
-        len += snprintf(&buff[len], buff_size - len, "    <SlaveInformation>\n");
-        len += snprintf(&buff[len], buff_size - len, "        <Id>%llX</Id>\n", mbus_data_bcd_decode_hex(data->id_bcd, 4));
+    mbus_json_printf(jb, ",\"ProductName\":");
+    mbus_json_string(jb, mbus_data_product_name(header));
 
-        mbus_str_xml_encode(str_encoded, mbus_data_fixed_medium(data), sizeof(str_encoded));
-        len += snprintf(&buff[len], buff_size - len, "        <Medium>%s</Medium>\n", str_encoded);
+    mbus_json_printf(jb, ",\"Medium\":");
+    mbus_json_string(jb, mbus_data_variable_medium_lookup_r(header->medium, medium, sizeof(medium)));
 
-        len += snprintf(&buff[len], buff_size - len, "        <AccessNumber>%d</AccessNumber>\n", data->tx_cnt);
-        len += snprintf(&buff[len], buff_size - len, "        <Status>%.2X</Status>\n", data->status);
-        len += snprintf(&buff[len], buff_size - len, "    </SlaveInformation>\n\n");
+    mbus_json_printf(jb, ",\"AccessNumber\":%d", header->access_no);
 
-        len += snprintf(&buff[len], buff_size - len, "    <DataRecord id=\"0\">\n");
+    snprintf(str, sizeof(str), "%.2X", header->status);
+    mbus_json_printf(jb, ",\"Status\":");
+    mbus_json_value(jb, str);
 
-        mbus_str_xml_encode(str_encoded, mbus_data_fixed_function(data->status), sizeof(str_encoded));
-        len += snprintf(&buff[len], buff_size - len, "        <Function>%s</Function>\n", str_encoded);
+    snprintf(str, sizeof(str), "%.2X%.2X", header->signature[1], header->signature[0]);
+    mbus_json_printf(jb, ",\"Signature\":");
+    mbus_json_value(jb, str);
 
-        mbus_str_xml_encode(str_encoded, mbus_data_fixed_unit(data->cnt1_type), sizeof(str_encoded));
-        len += snprintf(&buff[len], buff_size - len, "        <Unit>%s</Unit>\n", str_encoded);
-        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
-        {
-            len += snprintf(&buff[len], buff_size - len, "        <Value>%llX</Value>\n", mbus_data_bcd_decode_hex(data->cnt1_val, 4));
-        }
-        else
-        {
-            mbus_data_int_decode(data->cnt1_val, 4, &val);
-            len += snprintf(&buff[len], buff_size - len, "        <Value>%d</Value>\n", val);
-        }
+    mbus_json_printf(jb, "}");
+}
 
-        len += snprintf(&buff[len], buff_size - len, "    </DataRecord>\n\n");
+//------------------------------------------------------------------------------
+/// Append the JSON object for a single variable-length data record. Uses the
+/// same fields as mbus_data_variable_record_xml. Internal.
+//------------------------------------------------------------------------------
+static void
+mbus_data_variable_record_json(mbus_json_buff *jb, mbus_data_record *record, int record_cnt, int frame_cnt)
+{
+    struct tm * timeinfo;
+    char timestamp[22];
+    char function[128], unit[128], value[768];
+    struct tm tm_buff;
+    long tariff;
 
-        len += snprintf(&buff[len], buff_size - len, "    <DataRecord id=\"1\">\n");
+    if (frame_cnt >= 0)
+    {
+        mbus_json_printf(jb, "{\"id\":%d,\"frame\":%d", record_cnt, frame_cnt);
+    }
+    else
+    {
+        mbus_json_printf(jb, "{\"id\":%d", record_cnt);
+    }
 
-        mbus_str_xml_encode(str_encoded, mbus_data_fixed_function(data->status), sizeof(str_encoded));
-        len += snprintf(&buff[len], buff_size - len, "        <Function>%s</Function>\n", str_encoded);
+    if (record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC)
+    {
+        mbus_json_printf(jb, ",\"Function\":\"Manufacturer specific\"");
+    }
+    else if (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW)
+    {
+        mbus_json_printf(jb, ",\"Function\":\"More records follow\"");
+    }
+    else
+    {
+        mbus_json_printf(jb, ",\"Function\":");
+        mbus_json_string(jb, mbus_data_record_function_r(record, function, sizeof(function)));
 
-        mbus_str_xml_encode(str_encoded, mbus_data_fixed_unit(data->cnt2_type), sizeof(str_encoded));
-        len += snprintf(&buff[len], buff_size - len, "        <Unit>%s</Unit>\n", str_encoded);
-        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
-        {
-            len += snprintf(&buff[len], buff_size - len, "        <Value>%llX</Value>\n", mbus_data_bcd_decode_hex(data->cnt2_val, 4));
-        }
-        else
+        mbus_json_printf(jb, ",\"StorageNumber\":%ld", mbus_data_record_storage_number(record));
+
+        if ((tariff = mbus_data_record_tariff(record)) >= 0)
         {
-            mbus_data_int_decode(data->cnt2_val, 4, &val);
-            len += snprintf(&buff[len], buff_size - len, "        <Value>%d</Value>\n", val);
+            mbus_json_printf(jb, ",\"Tariff\":%ld", tariff);
+            mbus_json_printf(jb, ",\"Device\":%d", mbus_data_record_device(record));
         }
 
-        len += snprintf(&buff[len], buff_size - len, "    </DataRecord>\n\n");
+        mbus_json_printf(jb, ",\"Unit\":");
+        mbus_json_string(jb, mbus_data_record_unit_r(record, unit, sizeof(unit)));
+    }
 
-        len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
+    mbus_json_printf(jb, ",\"Value\":");
+    mbus_json_value(jb, mbus_data_record_value_r(record, value, sizeof(value)));
 
-        return buff;
+    if (record->timestamp > 0)
+    {
+        timeinfo = mbus_gmtime_r(&(record->timestamp), &tm_buff);
+        strftime(timestamp,21,"%Y-%m-%dT%H:%M:%SZ",timeinfo);
+        mbus_json_printf(jb, ",\"Timestamp\":");
+        mbus_json_string(jb, timestamp);
     }
 
-    return NULL;
+    mbus_json_printf(jb, "}");
 }
 
 //------------------------------------------------------------------------------
-/// Generate XML representation of a general application error.
+/// Append the JSON object for a fixed-length counter. Internal.
 //------------------------------------------------------------------------------
-char *
-mbus_data_error_xml(int error)
+static void
+mbus_data_fixed_record_json(mbus_json_buff *jb, mbus_data_fixed *data, int id, int type, unsigned char *value)
 {
-    char *buff = NULL;
-    char str_encoded[256];
-    size_t len = 0, buff_size = 8192;
-
-    buff = (char*) malloc(buff_size);
-
-    if (buff == NULL)
-        return NULL;
-
-    len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
-    len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
+    char str[32];
+    char lookup[256];
+    int val;
 
-    len += snprintf(&buff[len], buff_size - len, "    <SlaveInformation>\n");
+    mbus_json_printf(jb, "{\"id\":%d,\"Function\":", id);
+    mbus_json_string(jb, mbus_data_fixed_function_r(data->status, lookup, sizeof(lookup)));
 
-    mbus_str_xml_encode(str_encoded, mbus_data_error_lookup(error), sizeof(str_encoded));
-    len += snprintf(&buff[len], buff_size - len, "        <Error>%s</Error>\n", str_encoded);
+    mbus_json_printf(jb, ",\"Unit\":");
+    mbus_json_string(jb, mbus_data_fixed_unit_r(type, lookup, sizeof(lookup)));
 
-    len += snprintf(&buff[len], buff_size - len, "    </SlaveInformation>\n\n");
+    if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD)
+    {
+        snprintf(str, sizeof(str), "%llX", mbus_data_bcd_decode_hex(value, 4));
+    }
+    else
+    {
+        mbus_data_int_decode(value, 4, &val);
+        snprintf(str, sizeof(str), "%d", val);
+    }
 
-    len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
+    mbus_json_printf(jb, ",\"Value\":");
+    mbus_json_value(jb, str);
 
-    return buff;
+    mbus_json_printf(jb, "}");
 }
 
 //------------------------------------------------------------------------------
-/// Return a string containing an XML representation of the M-BUS frame data.
+/// Append the JSON object for fixed-length data. Internal.
 //------------------------------------------------------------------------------
-char *
-mbus_frame_data_xml(mbus_frame_data *data)
+static void
+mbus_data_fixed_json(mbus_json_buff *jb, mbus_data_fixed *data)
 {
-    if (data)
-    {
-        if (data->type == MBUS_DATA_TYPE_ERROR)
-        {
-            return mbus_data_error_xml(data->error);
-        }
+    char str[32];
+    char lookup[256];
 
-        if (data->type == MBUS_DATA_TYPE_FIXED)
-        {
-            return mbus_data_fixed_xml(&(data->data_fix));
-        }
+    mbus_json_printf(jb, "\"SlaveInformation\":{");
 
-        if (data->type == MBUS_DATA_TYPE_VARIABLE)
-        {
-            return mbus_data_variable_xml(&(data->data_var));
-        }
-    }
+    snprintf(str, sizeof(str), "%llX", mbus_data_bcd_decode_hex(data->id_bcd, 4));
+    mbus_json_printf(jb, "\"Id\":");
+    mbus_json_value(jb, str);
 
-    return NULL;
-}
+    mbus_json_printf(jb, ",\"Medium\":");
+    mbus_json_string(jb, mbus_data_fixed_medium_r(data, lookup, sizeof(lookup)));
+
+    mbus_json_printf(jb, ",\"AccessNumber\":%d", data->tx_cnt);
 
+    snprintf(str, sizeof(str), "%.2X", data->status);
+    mbus_json_printf(jb, ",\"Status\":");
+    mbus_json_value(jb, str);
+
+    mbus_json_printf(jb, "},\"DataRecord\":[");
+    mbus_data_fixed_record_json(jb, data, 0, data->cnt1_type, data->cnt1_val);
+    mbus_json_printf(jb, ",");
+    mbus_data_fixed_record_json(jb, data, 1, data->cnt2_type, data->cnt2_val);
+    mbus_json_printf(jb, "]");
+}
 
 //------------------------------------------------------------------------------
-/// Return an XML representation of the M-BUS frame.
+/// Return a JSON representation of the M-BUS frame (including all frames of a
+/// multi-telegram reply). The object has the same shape as the XML output after
+/// conversion by xml2js: a "SlaveInformation" object and a "DataRecord" array.
+/// Numeric values are emitted as JSON numbers. The returned string has to be
+/// freed by the caller.
 //------------------------------------------------------------------------------
 char *
-mbus_frame_xml(mbus_frame *frame)
+mbus_frame_json(mbus_frame *frame)
 {
     mbus_frame_data frame_data;
     mbus_frame *iter;
-
     mbus_data_record *record;
-    char *buff = NULL, *new_buff;
-
-    size_t len = 0, buff_size = 8192;
+    mbus_json_buff jb;
+    char lookup[256];
     int record_cnt = 0, frame_cnt;
 
-    if (frame)
-    {
-        memset((void *)&frame_data, 0, sizeof(mbus_frame_data));
-
-        if (mbus_frame_data_parse(frame, &frame_data) == -1)
-        {
-            mbus_error_str_set("M-bus data parse error.");
-            return NULL;
-        }
+    if (frame == NULL)
+        return NULL;
 
-        if (frame_data.type == MBUS_DATA_TYPE_ERROR)
-        {
-            //
-            // generate XML for error
-            //
-            return mbus_data_error_xml(frame_data.error);
-        }
+    memset((void *)&frame_data, 0, sizeof(mbus_frame_data));
 
-        if (frame_data.type == MBUS_DATA_TYPE_FIXED)
-        {
-            //
-            // generate XML for fixed data
-            //
-            return mbus_data_fixed_xml(&(frame_data.data_fix));
-        }
+    if (mbus_frame_data_parse(frame, &frame_data) == -1)
+    {
+        mbus_error_set(MBUS_ERROR_CODE_DATA, "M-bus data parse error.");
+        return NULL;
+    }
 
-        if (frame_data.type == MBUS_DATA_TYPE_VARIABLE)
-        {
-            //
-            // generate XML for a sequence of variable data frames
-            //
+    jb.len = 0;
+    jb.size = 8192;
 
-            buff = (char*) malloc(buff_size);
+    if ((jb.buff = (char *) malloc(jb.size)) == NULL)
+    {
+        mbus_data_record_free(frame_data.data_var.record);
+        return NULL;
+    }
 
-            if (buff == NULL)
-            {
-                mbus_data_record_free(frame_data.data_var.record);
-                return NULL;
-            }
+    jb.buff[0] = '\0';
 
-            // include frame counter in XML output if more than one frame
-            // is available (frame_cnt = -1 => not included in output)
-            frame_cnt = (frame->next == NULL) ? -1 : 0;
+    mbus_json_printf(&jb, "{");
 
-            len += snprintf(&buff[len], buff_size - len, MBUS_XML_PROCESSING_INSTRUCTION);
+    if (frame_data.type == MBUS_DATA_TYPE_ERROR)
+    {
+        mbus_json_printf(&jb, "\"SlaveInformation\":{\"Error\":");
+        mbus_json_string(&jb, mbus_data_error_lookup_r(frame_data.error, lookup, sizeof(lookup)));
+        mbus_json_printf(&jb, "}");
+    }
+    else if (frame_data.type == MBUS_DATA_TYPE_FIXED)
+    {
+        mbus_data_fixed_json(&jb, &(frame_data.data_fix));
+    }
+    else if (frame_data.type == MBUS_DATA_TYPE_VARIABLE)
+    {
+        // include frame counter in output if more than one frame
+        // is available (frame_cnt = -1 => not included in output)
+        frame_cnt = (frame->next == NULL) ? -1 : 0;
 
-            len += snprintf(&buff[len], buff_size - len, "<MBusData>\n\n");
+        // only the header of the first frame is used (should be the same
+        // for each frame in a sequence of a multi-telegram transfer)
+        mbus_data_variable_header_json(&jb, &(frame_data.data_var.header));
 
-            // only print the header info for the first frame (should be
-            // the same for each frame in a sequence of a multi-telegram
-            // transfer.
-            len += snprintf(&buff[len], buff_size - len, "%s",
-                                    mbus_data_variable_header_xml(&(frame_data.data_var.header)));
+        iter = frame;
 
+        while (1)
+        {
             // loop through all records in the current frame, using a global
-            // record count as record ID in the XML output
+            // record count as record ID in the output
             for (record = frame_data.data_var.record; record; record = record->next, record_cnt++)
             {
-                if ((buff_size - len) < 1024)
-                {
-                    buff_size *= 2;
-                    new_buff = (char*) realloc(buff,buff_size);
-
-                    if (new_buff == NULL)
-                    {
-                        free(buff);
-                        mbus_data_record_free(frame_data.data_var.record);
-                        return NULL;
-                    }
-
-                    buff = new_buff;
-                }
-
-                len += snprintf(&buff[len], buff_size - len, "%s",
-                                mbus_data_variable_record_xml(record, record_cnt, frame_cnt, &(frame_data.data_var.header)));
+                mbus_json_printf(&jb, record_cnt == 0 ? ",\"DataRecord\":[" : ",");
+                mbus_data_variable_record_json(&jb, record, record_cnt, frame_cnt);
             }
 
             // free all records in the list
             if (frame_data.data_var.record)
             {
                 mbus_data_record_free(frame_data.data_var.record);
+                frame_data.data_var.record = NULL;
             }
 
+            if ((iter = iter->next) == NULL)
+                break;
+
             frame_cnt++;
 
-            for (iter = frame->next; iter; iter = iter->next, frame_cnt++)
+            if (mbus_frame_data_parse(iter, &frame_data) == -1)
             {
-                if (mbus_frame_data_parse(iter, &frame_data) == -1)
-                {
-                    mbus_error_str_set("M-bus variable data parse error.");
-                    return NULL;
-                }
-
-                // loop through all records in the current frame, using a global
-                // record count as record ID in the XML output
-                for (record = frame_data.data_var.record; record; record = record->next, record_cnt++)
-                {
-                    if ((buff_size - len) < 1024)
-                    {
-                        buff_size *= 2;
-                        new_buff = (char*) realloc(buff,buff_size);
-
-                        if (new_buff == NULL)
-                        {
-                            free(buff);
-                            mbus_data_record_free(frame_data.data_var.record);
-                            return NULL;
-                        }
-
-                        buff = new_buff;
-                    }
-
-                    len += snprintf(&buff[len], buff_size - len, "%s",
-                                    mbus_data_variable_record_xml(record, record_cnt, frame_cnt, &(frame_data.data_var.header)));
-                }
-
-                // free all records in the list
-                if (frame_data.data_var.record)
-                {
-                    mbus_data_record_free(frame_data.data_var.record);
-                }
+                mbus_error_set(MBUS_ERROR_CODE_DATA, "M-bus variable data parse error.");
+                free(jb.buff);
+                return NULL;
             }
+        }
 
-            len += snprintf(&buff[len], buff_size - len, "</MBusData>\n");
-
-            return buff;
+        if (record_cnt > 0)
+        {
+            mbus_json_printf(&jb, "]");
         }
     }
 
-    return NULL;
+    mbus_json_printf(&jb, "}");
+
+    // NULL if any of the appends ran out of memory
+    return jb.buff;
 }
 
 
@@ -5065,24 +5853,33 @@ mbus_data_record_new()
 
 //------------------------------------------------------------------------------
 /// free up memory associated with a data record and all the subsequent records
-/// in its list (apply recursively)
+/// in its list. The records of a parsed frame are one block owned by the first
+/// record, so a parsed list must be freed from its head.
 //------------------------------------------------------------------------------
 void
 mbus_data_record_free(mbus_data_record *record)
 {
-    if (record)
+    mbus_data_record *next;
+
+    while (record)
     {
-        mbus_data_record *next = record->next;
+        if (record->block_size > 0)
+        {
+            // continue after the last record of the block
+            next = record[record->block_size - 1].next;
+        }
+        else
+        {
+            next = record->next;
+        }
 
         free(record);
-
-        if (next)
-            mbus_data_record_free(next);
+        record = next;
     }
 }
 
 //------------------------------------------------------------------------------
-/// Return a string containing an XML representation of the M-BUS frame.
+/// Append a record to the record list of the variable data.
 //------------------------------------------------------------------------------
 void
 mbus_data_record_append(mbus_data_variable *data, mbus_data_record *record)
@@ -5097,11 +5894,13 @@ mbus_data_record_append(mbus_data_variable *data, mbus_data_record *record)
         }
         else
         {
-            // find the end of the list
-            for (iter = data->record; iter->next; iter = iter->next);
+            // find the end of the list, starting at the last appended record
+            iter = data->record_last ? data->record_last : data->record;
+            for (; iter->next; iter = iter->next);
 
             iter->next = record;
         }
+        data->record_last = record;
     }
 }
 
@@ -5111,9 +5910,8 @@ mbus_data_record_append(mbus_data_variable *data, mbus_data_record *record)
 // manufacturer ID (2 bytes), version (1 byte) and medium (1 byte).
 //------------------------------------------------------------------------------
 char *
-mbus_frame_get_secondary_address(mbus_frame *frame)
+mbus_frame_get_secondary_address_r(mbus_frame *frame, char *buff, size_t size)
 {
-    static char addr[32];
     mbus_frame_data *data;
     unsigned long id;
 
@@ -5140,7 +5938,7 @@ mbus_frame_get_secondary_address(mbus_frame *frame)
 
     id = (unsigned long) mbus_data_bcd_decode_hex(data->data_var.header.id_bcd, 4);
 
-    snprintf(addr, sizeof(addr), "%08lX%02X%02X%02X%02X",
+    snprintf(buff, size, "%08lX%02X%02X%02X%02X",
              id,
              data->data_var.header.manufacturer[0],
              data->data_var.header.manufacturer[1],
@@ -5150,7 +5948,15 @@ mbus_frame_get_secondary_address(mbus_frame *frame)
     // free data
     mbus_frame_data_free(data);
 
-    return addr;
+    return buff;
+}
+
+char *
+mbus_frame_get_secondary_address(mbus_frame *frame)
+{
+    static char buff[32];
+
+    return mbus_frame_get_secondary_address_r(frame, buff, sizeof(buff));
 }
 
 //------------------------------------------------------------------------------
@@ -97,6 +97,42 @@ typedef struct _mbus_frame {
 
 } mbus_frame;
 
+//
+// Read-only view of a frame in a receive buffer: the fields refer to the
+// bytes of the buffer, see mbus_frame_view_parse.
+//
+typedef struct _mbus_frame_view {
+
+    const unsigned char *buff;  // first byte of the frame
+    size_t size;                // bytes of the frame
+
+    int type;
+    unsigned char control;
+    unsigned char address;
+    unsigned char control_information;
+
+    const unsigned char *data;  // user data after the CI field
+    size_t data_size;
+
+} mbus_frame_view;
+
+//
+// Receive buffer of a handle: bytes are read in bulk, complete frames are
+// taken from the front and the bytes of a following frame stay buffered.
+//
+#define MBUS_RX_BUFFER_SIZE 2048
+
+typedef struct _mbus_rx_buffer {
+
+    unsigned char data[MBUS_RX_BUFFER_SIZE];
+    size_t start;   // offset of the first buffered byte
+    size_t len;     // number of buffered bytes
+
+    unsigned char echo[MBUS_FRAME_DATA_LENGTH + 10]; // last sent frame
+    size_t echo_len;  // bytes of the echo that are still expected, 0 if none
+
+} mbus_rx_buffer;
+
 typedef struct _mbus_slave_data {
 
     int state_fcb;
@@ -134,11 +170,21 @@ typedef struct _mbus_slave_data {
 #define MBUS_DIB_DIF_MORE_RECORDS_FOLLOW   0x1F
 #define MBUS_DIB_DIF_IDLE_FILLER           0x2F
 
+// READOUT SELECTION (SND_UD records that select the records of the next REQ_UD2)
+#define MBUS_DIB_DIF_SELECTION             0x08 /**< data field: selection for readout */
+#define MBUS_DIB_DIF_GLOBAL_READOUT        0x7F /**< all storage numbers, units, tariffs and functions */
+#define MBUS_DIB_DIF_STORAGE_BIT           0x40 /**< LSB of the storage number */
+#define MBUS_DIB_DIFE_STORAGE_MASK         0x0F /**< 4 more storage number bits per DIFE */
+#define MBUS_DIB_VIF_ANY                   0x7E /**< any VIF */
+
+
+#define MBUS_DATA_INFO_BLOCK_DIFE_SIZE  10
+#define MBUS_VALUE_INFO_BLOCK_VIFE_SIZE 10
 
 typedef struct _mbus_data_information_block {
 
         unsigned char dif;
-        unsigned char dife[10];
+        unsigned char dife[MBUS_DATA_INFO_BLOCK_DIFE_SIZE];
         size_t  ndife;
 
 } mbus_data_information_block;
@@ -146,13 +192,136 @@ typedef struct _mbus_data_information_block {
 typedef struct _mbus_value_information_block {
 
         unsigned char vif;
-        unsigned char vife[10];
+        unsigned char vife[MBUS_VALUE_INFO_BLOCK_VIFE_SIZE];
         size_t  nvife;
 
         unsigned char custom_vif[128];
 
 } mbus_value_information_block;
 
+//
+// Decoded VIF/VIFE: quantity, unit and decimal exponent of the value, i.e. the
+// value is value * 10^exponent unit (see mbus_vib_unit_decode)
+//
+typedef enum _mbus_quantity {
+    MBUS_QUANTITY_UNKNOWN = 0,
+    MBUS_QUANTITY_RESERVED,
+    MBUS_QUANTITY_ENERGY,
+    MBUS_QUANTITY_VOLUME,
+    MBUS_QUANTITY_MASS,
+    MBUS_QUANTITY_ON_TIME,
+    MBUS_QUANTITY_OPERATING_TIME,
+    MBUS_QUANTITY_POWER,
+    MBUS_QUANTITY_VOLUME_FLOW,
+    MBUS_QUANTITY_MASS_FLOW,
+    MBUS_QUANTITY_FLOW_TEMPERATURE,
+    MBUS_QUANTITY_RETURN_TEMPERATURE,
+    MBUS_QUANTITY_TEMPERATURE_DIFFERENCE,
+    MBUS_QUANTITY_EXTERNAL_TEMPERATURE,
+    MBUS_QUANTITY_PRESSURE,
+    MBUS_QUANTITY_TIME_POINT,
+    MBUS_QUANTITY_HCA_UNITS,
+    MBUS_QUANTITY_AVERAGING_DURATION,
+    MBUS_QUANTITY_ACTUALITY_DURATION,
+    MBUS_QUANTITY_FABRICATION_NUMBER,
+    MBUS_QUANTITY_BUS_ADDRESS,
+    MBUS_QUANTITY_CUSTOM,
+    MBUS_QUANTITY_MANUFACTURER_SPECIFIC,
+    MBUS_QUANTITY_TEMPERATURE_LIMIT,
+    MBUS_QUANTITY_MAX_POWER_COUNT,
+    MBUS_QUANTITY_CREDIT,
+    MBUS_QUANTITY_DEBIT,
+    MBUS_QUANTITY_ACCESS_NUMBER,
+    MBUS_QUANTITY_MEDIUM,
+    MBUS_QUANTITY_MANUFACTURER,
+    MBUS_QUANTITY_PARAMETER_SET,
+    MBUS_QUANTITY_MODEL_VERSION,
+    MBUS_QUANTITY_HARDWARE_VERSION,
+    MBUS_QUANTITY_FIRMWARE_VERSION,
+    MBUS_QUANTITY_SOFTWARE_VERSION,
+    MBUS_QUANTITY_CUSTOMER_LOCATION,
+    MBUS_QUANTITY_CUSTOMER,
+    MBUS_QUANTITY_ACCESS_CODE_USER,
+    MBUS_QUANTITY_ACCESS_CODE_OPERATOR,
+    MBUS_QUANTITY_ACCESS_CODE_SYSTEM_OPERATOR,
+    MBUS_QUANTITY_ACCESS_CODE_DEVELOPER,
+    MBUS_QUANTITY_PASSWORD,
+    MBUS_QUANTITY_ERROR_FLAGS,
+    MBUS_QUANTITY_ERROR_MASK,
+    MBUS_QUANTITY_DIGITAL_OUTPUT,
+    MBUS_QUANTITY_DIGITAL_INPUT,
+    MBUS_QUANTITY_BAUDRATE,
+    MBUS_QUANTITY_RESPONSE_DELAY,
+    MBUS_QUANTITY_RETRY,
+    MBUS_QUANTITY_FIRST_STORAGE,
+    MBUS_QUANTITY_LAST_STORAGE,
+    MBUS_QUANTITY_STORAGE_BLOCK_SIZE,
+    MBUS_QUANTITY_STORAGE_INTERVAL,
+    MBUS_QUANTITY_DURATION_SINCE_READOUT,
+    MBUS_QUANTITY_TARIFF_START,
+    MBUS_QUANTITY_TARIFF_DURATION,
+    MBUS_QUANTITY_TARIFF_PERIOD,
+    MBUS_QUANTITY_DIMENSIONLESS,
+    MBUS_QUANTITY_VOLTAGE,
+    MBUS_QUANTITY_CURRENT,
+    MBUS_QUANTITY_RESET_COUNTER,
+    MBUS_QUANTITY_CUMULATION_COUNTER,
+    MBUS_QUANTITY_CONTROL_SIGNAL,
+    MBUS_QUANTITY_DAY_OF_WEEK,
+    MBUS_QUANTITY_WEEK_NUMBER,
+    MBUS_QUANTITY_DAY_CHANGE,
+    MBUS_QUANTITY_PARAMETER_ACTIVATION,
+    MBUS_QUANTITY_SUPPLIER_INFORMATION,
+    MBUS_QUANTITY_DURATION_SINCE_CUMULATION,
+    MBUS_QUANTITY_BATTERY_OPERATING_TIME,
+    MBUS_QUANTITY_BATTERY_CHANGE,
+    MBUS_QUANTITY_COUNT
+} mbus_quantity;
+
+typedef enum _mbus_unit {
+    MBUS_UNIT_NONE = 0,
+    MBUS_UNIT_WH,
+    MBUS_UNIT_J,
+    MBUS_UNIT_M3,
+    MBUS_UNIT_KG,
+    MBUS_UNIT_SECOND,
+    MBUS_UNIT_MINUTE,
+    MBUS_UNIT_HOUR,
+    MBUS_UNIT_DAY,
+    MBUS_UNIT_W,
+    MBUS_UNIT_J_PER_H,
+    MBUS_UNIT_M3_PER_H,
+    MBUS_UNIT_M3_PER_MIN,
+    MBUS_UNIT_M3_PER_S,
+    MBUS_UNIT_KG_PER_H,
+    MBUS_UNIT_CELSIUS,
+    MBUS_UNIT_KELVIN,
+    MBUS_UNIT_BAR,
+    MBUS_UNIT_DATE,
+    MBUS_UNIT_DATE_TIME,
+    MBUS_UNIT_FEET3,
+    MBUS_UNIT_US_GALLON,
+    MBUS_UNIT_US_GALLON_PER_MIN,
+    MBUS_UNIT_US_GALLON_PER_H,
+    MBUS_UNIT_FAHRENHEIT,
+    MBUS_UNIT_CURRENCY,
+    MBUS_UNIT_BAUD,
+    MBUS_UNIT_BIT_TIMES,
+    MBUS_UNIT_MONTH,
+    MBUS_UNIT_YEAR,
+    MBUS_UNIT_V,
+    MBUS_UNIT_A,
+    MBUS_UNIT_COUNT
+} mbus_unit;
+
+typedef struct _mbus_value_unit {
+
+    mbus_quantity quantity;
+    mbus_unit     unit;
+    int           exponent;
+
+} mbus_value_unit;
+
 typedef struct _mbus_data_record_header {
 
     mbus_data_information_block  dib;
@@ -164,15 +333,40 @@ typedef struct _mbus_data_record {
 
     mbus_data_record_header drh;
 
-    unsigned char data[234];
+    unsigned char *data;    /**< payload, points into the data of the parsed frame */
     size_t data_len;
 
     time_t timestamp;
 
+    size_t block_size;      /**< records in the block of a parsed frame, set for the first record only */
+
     void *next;
 
 } mbus_data_record;
 
+//
+// Read-only view of a data record: offset and spans into the user data of a
+// frame view, see mbus_frame_view_next_record.
+//
+typedef struct _mbus_record_view {
+
+    size_t offset;                     // offset of the DIF in the user data
+
+    unsigned char dif;
+    const unsigned char *dife;         // ndife DIF extensions
+    size_t ndife;
+
+    unsigned char vif;
+    const unsigned char *custom_vif;   // plain text VIF (not decoded), custom_vif_len bytes
+    size_t custom_vif_len;
+    const unsigned char *vife;         // nvife VIF extensions
+    size_t nvife;
+
+    const unsigned char *data;         // payload
+    size_t data_len;
+
+} mbus_record_view;
+
 //
 // HEADER FOR VARIABLE LENGTH DATA FORMAT
 //
@@ -204,6 +398,7 @@ typedef struct _mbus_data_variable {
     mbus_data_variable_header header;
 
     mbus_data_record *record;
+    mbus_data_record *record_last;
     size_t nrecords;
 
     unsigned char *data;
@@ -551,7 +746,29 @@ int mbus_frame_calc_length  (mbus_frame *frame);
 // Parse/Pack to bin
 //
 int mbus_parse(mbus_frame *frame, unsigned char *data, size_t data_size);
+int mbus_frame_boundary(const unsigned char *data, size_t data_size, size_t *frame_size);
+
+//
+// Frame views (validate and decode in place, without copying)
+//
+int mbus_frame_view_parse(mbus_frame_view *view, const unsigned char *data, size_t data_size);
+int mbus_frame_view_to_frame(const mbus_frame_view *view, mbus_frame *frame);
+int mbus_frame_view_variable_header(const mbus_frame_view *view, mbus_data_variable_header *header);
+int mbus_frame_view_next_record(const mbus_frame_view *view, size_t *pos, mbus_record_view *record);
+int mbus_record_view_to_record(const mbus_record_view *view, mbus_data_record *record);
 
+//
+// Receive buffer
+//
+void           mbus_rx_buffer_reset  (mbus_rx_buffer *rx);
+unsigned char *mbus_rx_buffer_space  (mbus_rx_buffer *rx, size_t *size);
+void           mbus_rx_buffer_commit (mbus_rx_buffer *rx, size_t len);
+int            mbus_rx_buffer_frame  (mbus_rx_buffer *rx, unsigned char **data, size_t *frame_size);
+void           mbus_rx_buffer_consume(mbus_rx_buffer *rx, size_t len);
+void           mbus_rx_buffer_expect_echo(mbus_rx_buffer *rx, const unsigned char *data, size_t len);
+
+// The parsed records refer to the payload of the frame, so the frame has to be
+// kept until the records are freed.
 int mbus_data_fixed_parse   (mbus_frame *frame, mbus_data_fixed    *data);
 int mbus_data_variable_parse(mbus_frame *frame, mbus_data_variable *data);
 
@@ -566,6 +783,10 @@ int mbus_frame_internal_pack(mbus_frame *frame, mbus_frame_data *frame_data);
 //
 // data parsing
 //
+// The functions returning strings use a static buffer. Their _r variants
+// write into the buffer of the caller (size bytes) and can be used from
+// several threads at once; they may also return a constant string.
+//
 const char *mbus_data_record_function(mbus_data_record *record);
 const char *mbus_data_fixed_function(int status);
 long        mbus_data_record_storage_number(mbus_data_record *record);
@@ -573,6 +794,13 @@ long        mbus_data_record_tariff(mbus_data_record *record);
 int         mbus_data_record_device(mbus_data_record *record);
 const char *mbus_data_record_unit(mbus_data_record *record);
 const char *mbus_data_record_value(mbus_data_record *record);
+const char *mbus_data_record_decode(mbus_data_record *record);
+
+const char *mbus_data_record_function_r(mbus_data_record *record, char *buff, size_t size);
+const char *mbus_data_fixed_function_r(int status, char *buff, size_t size);
+const char *mbus_data_record_unit_r(mbus_data_record *record, char *buff, size_t size);
+const char *mbus_data_record_value_r(mbus_data_record *record, char *buff, size_t size);
+const char *mbus_data_record_decode_r(mbus_data_record *record, char *buff, size_t size);
 
 //
 // M-Bus frame data struct access/write functions
@@ -596,9 +824,19 @@ char *mbus_data_error_xml(int error);
 char *mbus_frame_data_xml(mbus_frame_data *data);
 
 char *mbus_data_variable_header_xml(mbus_data_variable_header *header);
+char *mbus_data_variable_record_xml(mbus_data_record *record, int record_cnt, int frame_cnt, mbus_data_variable_header *header);
+
+char *mbus_data_variable_header_xml_r(mbus_data_variable_header *header, char *buff, size_t size);
+char *mbus_data_variable_record_xml_r(mbus_data_record *record, int record_cnt, int frame_cnt, mbus_data_variable_header *header, char *buff, size_t size);
 
 char *mbus_frame_xml(mbus_frame *frame);
 
+//
+// JSON generating functions
+//
+int   mbus_str_to_number(const char *src, double *value);
+char *mbus_frame_json(mbus_frame *frame);
+
 //
 // Debug/dump
 //
@@ -609,7 +847,27 @@ int mbus_data_error_print(int error);
 int mbus_data_variable_header_print(mbus_data_variable_header *header);
 int mbus_data_variable_print(mbus_data_variable *data);
 
+//
+// Error codes of mbus_error_code() and mbus_handle_error_code()
+//
+#define MBUS_ERROR_CODE_NONE       0
+#define MBUS_ERROR_CODE_OTHER      1  /**< set by mbus_error_str_set without a code */
+#define MBUS_ERROR_CODE_INVALID    2  /**< invalid parameter or handle */
+#define MBUS_ERROR_CODE_NOMEM      3
+#define MBUS_ERROR_CODE_CONNECT    4  /**< failed to open the device or connection */
+#define MBUS_ERROR_CODE_IO         5  /**< failed to send or receive */
+#define MBUS_ERROR_CODE_TIMEOUT    6  /**< no answer in time */
+#define MBUS_ERROR_CODE_CLOSED     7  /**< connection closed by the remote host */
+#define MBUS_ERROR_CODE_FRAME      8  /**< invalid or unexpected frame */
+#define MBUS_ERROR_CODE_DATA       9  /**< failed to parse the frame data */
+#define MBUS_ERROR_CODE_NO_DEVICE  10 /**< no device matches the (secondary) address */
+#define MBUS_ERROR_CODE_COLLISION  11 /**< more than one device matches the address */
+#define MBUS_ERROR_CODE_ABORTED    12
+
+// the last error of the calling thread
 char *mbus_error_str();
+int   mbus_error_code();
+void  mbus_error_set(int code, const char *message);
 void  mbus_error_str_set(char *message);
 void  mbus_error_reset();
 
@@ -621,6 +879,7 @@ void  mbus_hex_dump(const char *label, const char *buff, size_t len);
 //
 int mbus_data_manufacturer_encode(unsigned char *m_data, unsigned char *m_code);
 const char *mbus_decode_manufacturer(unsigned char byte1, unsigned char byte2);
+const char *mbus_decode_manufacturer_r(unsigned char byte1, unsigned char byte2, char *buff, size_t size);
 const char *mbus_data_product_name(mbus_data_variable_header *header);
 
 int mbus_data_bcd_encode(unsigned char *bcd_data, size_t bcd_data_size, int value);
@@ -645,14 +904,27 @@ const char *mbus_data_fixed_unit(int medium_unit_byte);
 const char *mbus_data_variable_medium_lookup(unsigned char medium);
 const char *mbus_unit_prefix(int exp);
 
+const char *mbus_data_fixed_medium_r(mbus_data_fixed *data, char *buff, size_t size);
+const char *mbus_data_fixed_unit_r(int medium_unit_byte, char *buff, size_t size);
+const char *mbus_data_variable_medium_lookup_r(unsigned char medium, char *buff, size_t size);
+const char *mbus_unit_prefix_r(int exp, char *buff, size_t size);
+
 const char *mbus_data_error_lookup(int error);
+const char *mbus_data_error_lookup_r(int error, char *buff, size_t size);
 
 const char *mbus_vib_unit_lookup(mbus_value_information_block *vib);
 const char *mbus_vif_unit_lookup(unsigned char vif);
+const char *mbus_vib_unit_lookup_r(mbus_value_information_block *vib, char *buff, size_t size);
+const char *mbus_vif_unit_lookup_r(unsigned char vif, char *buff, size_t size);
+
+int         mbus_vib_unit_decode(const mbus_value_information_block *vib, mbus_value_unit *unit);
+const char *mbus_quantity_name(int quantity);
+const char *mbus_unit_symbol(int unit);
 
 unsigned char mbus_dif_datalength_lookup(unsigned char dif);
 
 char *mbus_frame_get_secondary_address(mbus_frame *frame);
+char *mbus_frame_get_secondary_address_r(mbus_frame *frame, char *buff, size_t size);
 int   mbus_frame_select_secondary_pack(mbus_frame *frame, char *address);
 
 int mbus_is_primary_address(int value);
@@ -38,6 +38,8 @@ typedef SSIZE_T ssize_t;
 #include <unistd.h>
 #include <strings.h>
 #include <string.h>
+#include <poll.h>
+#include <time.h>
 #endif
 
 #include <limits.h>
@@ -63,6 +65,92 @@ typedef SSIZE_T ssize_t;
 #define close(...) closeSerial(__VA_ARGS__)
 #endif
 
+#ifndef _WIN32
+//------------------------------------------------------------------------------
+// Monotonic time in ms for the receive timing
+//------------------------------------------------------------------------------
+static unsigned long long
+mbus_serial_now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+#endif
+
+// duration of the given number of bit times in ms, rounded up
+static int
+mbus_serial_bit_times(long baudrate, int bits)
+{
+    return (int)((bits * 1000L + baudrate - 1) / baudrate);
+}
+
+static int
+mbus_serial_inter_byte_timeout(mbus_serial_data *serial_data)
+{
+    if (serial_data->inter_byte_timeout >= 0)
+    {
+        return serial_data->inter_byte_timeout;
+    }
+    return mbus_serial_bit_times(serial_data->baudrate, 11 * MBUS_SERIAL_INTER_BYTE_CHARS) + MBUS_SERIAL_ADAPTER_DELAY_MS;
+}
+
+//------------------------------------------------------------------------------
+/// Silence in ms after which no further frame is expected on the bus: the
+/// inter-byte timeout of a serial handle, for other handles the one of a
+/// 2400 baud bus behind a gateway.
+//------------------------------------------------------------------------------
+int
+mbus_serial_silence_window(mbus_handle *handle)
+{
+    mbus_serial_data gateway;
+
+    if (handle != NULL && handle->is_serial && handle->auxdata != NULL)
+    {
+        return mbus_serial_inter_byte_timeout((mbus_serial_data *) handle->auxdata);
+    }
+
+    gateway.baudrate = 2400;
+    gateway.inter_byte_timeout = -1;
+    return mbus_serial_inter_byte_timeout(&gateway);
+}
+
+#ifndef _WIN32
+//------------------------------------------------------------------------------
+// The answer time between the end of a master send telegram and the beginning
+// of the response telegram of the slave shall be between 11 bit times and
+// (330 bit times + 50ms) (EN 13757-2). 11 more bit times receive the first
+// byte and USB to serial adapters may add their own delay.
+//------------------------------------------------------------------------------
+static int
+mbus_serial_first_byte_timeout(mbus_handle *handle, mbus_serial_data *serial_data)
+{
+    // learned from the response times of the requested address
+    if (handle->response_timeout >= 0)
+    {
+        return handle->response_timeout;
+    }
+    if (serial_data->first_byte_timeout >= 0)
+    {
+        return serial_data->first_byte_timeout;
+    }
+    return mbus_serial_bit_times(serial_data->baudrate, 330 + 11) + 50 + MBUS_SERIAL_ADAPTER_DELAY_MS;
+}
+
+// a slave may send its answer 11 bit times after the request at the earliest,
+// the master keeps the same pause after an answer
+static int
+mbus_serial_turnaround_time(mbus_serial_data *serial_data)
+{
+    if (serial_data->turnaround_time >= 0)
+    {
+        return serial_data->turnaround_time;
+    }
+    return mbus_serial_bit_times(serial_data->baudrate, 11);
+}
+#endif
+
 //------------------------------------------------------------------------------
 /// Set up a serial connection handle.
 //------------------------------------------------------------------------------
@@ -90,6 +178,7 @@ mbus_serial_connect(mbus_handle *handle)
     if ((handle->fd = open(device, O_RDWR | O_NOCTTY)) < 0)
     {
         fprintf(stderr, "%s: failed to open tty.\n", __PRETTY_FUNCTION__);
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_CONNECT, "M-Bus serial transport layer failed to open the device.");
         return -1;
     }
 
@@ -116,6 +205,12 @@ mbus_serial_connect(mbus_handle *handle)
 
     term->c_cc[VTIME] = (cc_t) 3; // Timeout in 1/10 sec
 
+#ifndef _WIN32
+    // The timeouts are derived from the baud rate and waited for with poll(),
+    // a read only returns the bytes already received.
+    term->c_cc[VTIME] = (cc_t) 0;
+#endif
+
     cfsetispeed(term, B2400);
     cfsetospeed(term, B2400);
 
@@ -128,6 +223,8 @@ mbus_serial_connect(mbus_handle *handle)
 
     tcsetattr(handle->fd, TCSANOW, term);
 
+    mbus_rx_buffer_reset(&(handle->rx));
+
     return 0;
 }
 
@@ -194,6 +291,12 @@ mbus_serial_set_baudrate(mbus_handle *handle, long baudrate)
             return -1; // unsupported baudrate
     }
 
+#ifndef _WIN32
+    // VTIME is only used by the Windows emulation, see mbus_serial_recv_frame
+    serial_data->t.c_cc[VTIME] = (cc_t) 0;
+#endif
+    serial_data->baudrate = baudrate;
+
     // Set input baud rate
     if (cfsetispeed(&(serial_data->t), speed) != 0)
     {
@@ -215,6 +318,37 @@ mbus_serial_set_baudrate(mbus_handle *handle, long baudrate)
     return 0;
 }
 
+//------------------------------------------------------------------------------
+/// Set the receive timing in ms: the wait for the first byte of an answer, the
+/// maximum gap between two bytes of an answer and the pause after an answer
+/// before the next request. -1 derives the value from the baud rate.
+/// Note: Windows still uses the VTIME timeout of the baud rate.
+//------------------------------------------------------------------------------
+int
+mbus_serial_set_timeouts(mbus_handle *handle, int first_byte_timeout, int inter_byte_timeout, int turnaround_time)
+{
+    mbus_serial_data *serial_data;
+
+    if (handle == NULL || !handle->is_serial)
+        return -1;
+
+    serial_data = (mbus_serial_data *) handle->auxdata;
+
+    if (serial_data == NULL)
+        return -1;
+
+    if (first_byte_timeout < -1 || inter_byte_timeout < -1 || turnaround_time < -1)
+    {
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_INVALID, "Invalid timeout (must be positive).");
+        return -1;
+    }
+
+    serial_data->first_byte_timeout = first_byte_timeout;
+    serial_data->inter_byte_timeout = inter_byte_timeout;
+    serial_data->turnaround_time = turnaround_time;
+
+    return 0;
+}
 
 //------------------------------------------------------------------------------
 //
@@ -269,6 +403,10 @@ mbus_serial_send_frame(mbus_handle *handle, mbus_frame *frame)
 {
     unsigned char buff[PACKET_BUFF_SIZE];
     int len, ret;
+#ifndef _WIN32
+    mbus_serial_data *serial_data;
+    long long wait;
+#endif
 
     if (handle == NULL || frame == NULL)
     {
@@ -299,6 +437,21 @@ mbus_serial_send_frame(mbus_handle *handle, mbus_frame *frame)
     printf("\n");
 #endif
 
+#ifndef _WIN32
+    //
+    // keep the bus idle for the turnaround time after the last answer
+    //
+    serial_data = (mbus_serial_data *) handle->auxdata;
+    if (serial_data != NULL && serial_data->idle_since != 0)
+    {
+        wait = (long long)serial_data->idle_since + mbus_serial_turnaround_time(serial_data) - (long long)mbus_serial_now_ms();
+        if (wait > 0)
+        {
+            poll(NULL, 0, (int)wait);
+        }
+    }
+#endif
+
     if ((ret = write(handle->fd, buff, len)) == len)
     {
         //
@@ -306,10 +459,15 @@ mbus_serial_send_frame(mbus_handle *handle, mbus_frame *frame)
         //
         if (handle->send_event)
                 handle->send_event(MBUS_HANDLE_TYPE_SERIAL, buff, len);
+
+        // an echo of the frame is dropped from the received bytes
+        if (handle->purge_first_frame == MBUS_FRAME_PURGE_M2S)
+            mbus_rx_buffer_expect_echo(&(handle->rx), buff, len);
     }
     else
     {
         fprintf(stderr, "%s: Failed to write frame to socket (ret = %d: %s)\n", __PRETTY_FUNCTION__, ret, strerror(errno));
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_IO, "M-Bus serial transport layer failed to write data.");
         return -1;
     }
 
@@ -327,9 +485,16 @@ mbus_serial_send_frame(mbus_handle *handle, mbus_frame *frame)
 int
 mbus_serial_recv_frame(mbus_handle *handle, mbus_frame *frame)
 {
-    unsigned char buff[PACKET_BUFF_SIZE];
-    int remaining, timeouts;
-    ssize_t len, nread;
+    unsigned char *data, *space;
+    size_t size, frame_size;
+    int remaining;
+    ssize_t nread;
+#ifdef _WIN32
+    int timeouts;
+#else
+    mbus_serial_data *serial_data;
+    int timeout;
+#endif
 
     if (handle == NULL || frame == NULL)
     {
@@ -348,43 +513,29 @@ mbus_serial_recv_frame(mbus_handle *handle, mbus_frame *frame)
         return MBUS_RECV_RESULT_ERROR;
     }
 
-    memset((void *)buff, 0, sizeof(buff));
-
     //
-    // read data until a packet is received
+    // read data in bulk until a complete frame is buffered, the bytes of a
+    // following frame stay in the buffer for the next call
     //
-    remaining = 1; // start by reading 1 byte
-    len = 0;
+#ifdef _WIN32
+    // no poll() for the serial emulation, wait for three VTIME expiries
     timeouts = 0;
 
-    do {
-        if (len + remaining > PACKET_BUFF_SIZE)
-        {
-            // avoid out of bounds access
-            return MBUS_RECV_RESULT_ERROR;
-        }
+    while ((remaining = mbus_rx_buffer_frame(&(handle->rx), &data, &frame_size)) > 0)
+    {
+        space = mbus_rx_buffer_space(&(handle->rx), &size);
 
         #ifdef MBUS_SERIAL_DEBUG
-        printf("%s: Attempt to read %d bytes [len = %d]\n", __PRETTY_FUNCTION__, remaining, len);
+        printf("%s: Attempt to read %d bytes [remaining = %d, len = %d]\n", __PRETTY_FUNCTION__, (int)size, remaining, (int)handle->rx.len);
         #endif
 
-        if ((nread = read(handle->fd, &buff[len], remaining)) == -1)
+        if ((nread = read(handle->fd, (char *)space, size)) == -1)
         {
-       //     fprintf(stderr, "%s: aborting recv frame (remaining = %d, len = %d, nread = %d)\n",
-         //          __PRETTY_FUNCTION__, remaining, len, nread);
+            mbus_rx_buffer_reset(&(handle->rx));
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_IO, "M-Bus serial transport layer failed to read data.");
             return MBUS_RECV_RESULT_ERROR;
         }
 
-        #ifdef MBUS_SERIAL_DEBUG
-        printf("%s: Got %d byte [remaining %d, len %d]\n", __PRETTY_FUNCTION__, nread, remaining, len);
-        int i;
-        for (i = len; i < len+nread; i++)
-        {
-           printf("%.2X ", buff[i]);
-        }
-        printf("\n");
-        #endif
-
         if (nread == 0)
         {
             timeouts++;
@@ -397,40 +548,103 @@ mbus_serial_recv_frame(mbus_handle *handle, mbus_frame *frame)
             }
         }
 
-        if (len > (SSIZE_MAX-nread))
+        mbus_rx_buffer_commit(&(handle->rx), nread);
+    }
+#else
+    serial_data = (mbus_serial_data *) handle->auxdata;
+
+    while ((remaining = mbus_rx_buffer_frame(&(handle->rx), &data, &frame_size)) > 0)
+    {
+        struct pollfd pfd;
+        int ret;
+
+        // the answer window applies until the first byte, then the gap
+        // between the bytes of the frame
+        timeout = handle->rx.len == 0 ? mbus_serial_first_byte_timeout(handle, serial_data) : mbus_serial_inter_byte_timeout(serial_data);
+
+        pfd.fd = handle->fd;
+        pfd.events = POLLIN;
+        if ((ret = poll(&pfd, 1, timeout)) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            mbus_rx_buffer_reset(&(handle->rx));
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_IO, "M-Bus serial transport layer failed to read data.");
+            return MBUS_RECV_RESULT_ERROR;
+        }
+
+        if (ret == 0)
         {
-            // avoid overflow
+            fprintf(stderr, "%s: Timeout\n", __PRETTY_FUNCTION__);
+            break;
+        }
+
+        space = mbus_rx_buffer_space(&(handle->rx), &size);
+
+        #ifdef MBUS_SERIAL_DEBUG
+        printf("%s: Attempt to read %d bytes [remaining = %d, len = %d]\n", __PRETTY_FUNCTION__, (int)size, remaining, (int)handle->rx.len);
+        #endif
+
+        if ((nread = read(handle->fd, (char *)space, size)) == -1)
+        {
+            mbus_rx_buffer_reset(&(handle->rx));
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_IO, "M-Bus serial transport layer failed to read data.");
             return MBUS_RECV_RESULT_ERROR;
         }
 
-        len += nread;
+        #ifdef MBUS_SERIAL_DEBUG
+        printf("%s: Got %d byte [remaining %d, len %d]\n", __PRETTY_FUNCTION__, (int)nread, remaining, (int)handle->rx.len);
+        int i;
+        for (i = 0; i < nread; i++)
+        {
+           printf("%.2X ", space[i]);
+        }
+        printf("\n");
+        #endif
+
+        if (nread == 0)
+        {
+            // readable without data: the device is gone
+            fprintf(stderr, "%s: Timeout\n", __PRETTY_FUNCTION__);
+            break;
+        }
 
-    } while ((remaining = mbus_parse(frame, buff, len)) > 0);
+        mbus_rx_buffer_commit(&(handle->rx), nread);
+        serial_data->idle_since = mbus_serial_now_ms();
+    }
+#endif
 
-    if (len == 0)
+    if (handle->rx.len == 0)
     {
         // No data received
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_TIMEOUT, "M-Bus serial transport layer response timeout has been reached.");
         return MBUS_RECV_RESULT_TIMEOUT;
     }
 
+    if (remaining > 0)
+    {
+        // incomplete frame, the buffered bytes are dropped
+        data = handle->rx.data + handle->rx.start;
+        frame_size = handle->rx.len;
+    }
+
     //
     // call the receive event function, if the callback function is registered
     //
     if (handle->recv_event)
-        handle->recv_event(MBUS_HANDLE_TYPE_SERIAL, buff, len);
+        handle->recv_event(MBUS_HANDLE_TYPE_SERIAL, (const char *)data, frame_size);
 
-    if (remaining != 0)
+    if (mbus_parse(frame, data, frame_size) != 0 || remaining != 0)
     {
         // Would be OK when e.g. scanning the bus, otherwise it is a failure.
         // printf("%s: M-Bus layer failed to receive complete data.\n", __PRETTY_FUNCTION__);
+        mbus_rx_buffer_consume(&(handle->rx), frame_size);
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_FRAME, "M-Bus layer failed to parse data.");
         return MBUS_RECV_RESULT_INVALID;
     }
 
-    if (len == -1)
-    {
-        fprintf(stderr, "%s: M-Bus layer failed to parse data.\n", __PRETTY_FUNCTION__);
-        return MBUS_RECV_RESULT_ERROR;
-    }
-
+    mbus_rx_buffer_consume(&(handle->rx), frame_size);
     return MBUS_RECV_RESULT_OK;
 }
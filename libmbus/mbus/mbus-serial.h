@@ -32,10 +32,21 @@ extern "C" {
 #endif
 
 
+//
+// Receive timing, a timeout of -1 is derived from the baud rate
+//
+#define MBUS_SERIAL_ADAPTER_DELAY_MS 100 /**< worst case delay of USB to serial adapters */
+#define MBUS_SERIAL_INTER_BYTE_CHARS 20  /**< gap within a frame in character times */
+
 typedef struct _mbus_serial_data
 {
     char *device;
     struct termios t;
+    long baudrate;
+    int first_byte_timeout;    /**< ms from the end of the request to the first byte of the answer */
+    int inter_byte_timeout;    /**< ms between two bytes of an answer */
+    int turnaround_time;       /**< ms the bus stays idle after an answer before the next request */
+    unsigned long long idle_since; /**< monotonic ms of the last received byte */
 } mbus_serial_data;
 
 int  mbus_serial_connect(mbus_handle *handle);
@@ -43,6 +54,8 @@ int  mbus_serial_disconnect(mbus_handle *handle);
 int  mbus_serial_send_frame(mbus_handle *handle, mbus_frame *frame);
 int  mbus_serial_recv_frame(mbus_handle *handle, mbus_frame *frame);
 int  mbus_serial_set_baudrate(mbus_handle *handle, long baudrate);
+int  mbus_serial_set_timeouts(mbus_handle *handle, int first_byte_timeout, int inter_byte_timeout, int turnaround_time);
+int  mbus_serial_silence_window(mbus_handle *handle);
 void mbus_serial_data_free(mbus_handle *handle);
 
 #ifdef __cplusplus
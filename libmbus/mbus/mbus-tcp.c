@@ -14,6 +14,7 @@
 
 #ifdef _WIN32
 #include <winsock2.h>
+#include <ws2tcpip.h>
 #include <windows.h>
 #include <stdlib.h>
 #include <io.h>
@@ -34,8 +35,10 @@ typedef SSIZE_T ssize_t;
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 #include <strings.h>
+#include <poll.h>
 #endif
 
 #include <limits.h>
@@ -54,18 +57,120 @@ typedef SSIZE_T ssize_t;
 static int tcp_timeout_sec = 4;
 static int tcp_timeout_usec = 0;
 
+#ifdef _WIN32
+#define tcp_close(fd) closesocket(fd)
+#define TCP_ERRNO     WSAGetLastError()
+#define TCP_INPROGRESS(err) ((err) == WSAEWOULDBLOCK)
+#else
+#define tcp_close(fd) close(fd)
+#define TCP_ERRNO     errno
+#define TCP_INPROGRESS(err) ((err) == EINPROGRESS)
+#endif
+
+// response timeout of the handle in microseconds
+static long
+mbus_tcp_timeout_usec(mbus_tcp_data *tcp_data)
+{
+    if (tcp_data->timeout_usec >= 0)
+    {
+        return tcp_data->timeout_usec;
+    }
+    return tcp_timeout_sec * 1000000L + tcp_timeout_usec;
+}
+
+static int
+mbus_tcp_set_blocking(int fd, int blocking)
+{
+    #ifdef _WIN32
+    u_long mode = blocking ? 0 : 1;
+    return ioctlsocket(fd, FIONBIO, &mode) == 0 ? 0 : -1;
+    #else
+    int flags = fcntl(fd, F_GETFL, 0);
+
+    if (flags == -1)
+    {
+        return -1;
+    }
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    return fcntl(fd, F_SETFL, flags);
+    #endif
+}
+
+//------------------------------------------------------------------------------
+/// Connect the socket to the address, waiting at most timeout_usec.
+//------------------------------------------------------------------------------
+static int
+mbus_tcp_connect_addr(int fd, struct addrinfo *addr, long timeout_usec)
+{
+    int err, ret;
+    socklen_t len;
+
+    if (mbus_tcp_set_blocking(fd, 0) == -1)
+    {
+        return -1;
+    }
+
+    if (connect(fd, addr->ai_addr, (int)addr->ai_addrlen) == 0)
+    {
+        return mbus_tcp_set_blocking(fd, 1);
+    }
+
+    if (!TCP_INPROGRESS(TCP_ERRNO))
+    {
+        return -1;
+    }
+
+    #ifdef _WIN32
+    fd_set wfds, efds;
+    struct timeval time_out;
+
+    FD_ZERO(&wfds);
+    FD_SET(fd, &wfds);
+    FD_ZERO(&efds);
+    FD_SET(fd, &efds);
+    time_out.tv_sec  = timeout_usec / 1000000;
+    time_out.tv_usec = timeout_usec % 1000000;
+    ret = select(fd + 1, NULL, &wfds, &efds, &time_out);
+    #else
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    do {
+        // round up to full ms, a sub ms timeout must not become 0
+        ret = poll(&pfd, 1, (int)((timeout_usec + 999) / 1000));
+    } while (ret == -1 && errno == EINTR);
+    #endif
+
+    if (ret <= 0)
+    {
+        // timeout or error
+        return -1;
+    }
+
+    len = sizeof(err);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, (char *)&err, &len) == -1 || err != 0)
+    {
+        return -1;
+    }
+
+    return mbus_tcp_set_blocking(fd, 1);
+}
+
 //------------------------------------------------------------------------------
-/// Setup a TCP/IP handle.
+/// Setup a TCP/IP handle. The host name is resolved with getaddrinfo (IPv4
+/// and IPv6), every address is tried with the connect timeout of the handle.
 //------------------------------------------------------------------------------
 int
 mbus_tcp_connect(mbus_handle *handle)
 {
-    char error_str[128], *host;
-    struct hostent *host_addr;
-    struct sockaddr_in s;
+    char error_str[128], *host, service[8];
+    struct addrinfo hints, *addrs, *addr;
     struct timeval time_out;
     mbus_tcp_data *tcp_data;
     uint16_t port;
+    long timeout_usec, connect_timeout_usec;
+    int ret, on = 1;
 
     if (handle == NULL)
         return -1;
@@ -76,6 +181,8 @@ mbus_tcp_connect(mbus_handle *handle)
 
     host = tcp_data->host;
     port = tcp_data->port;
+    timeout_usec = mbus_tcp_timeout_usec(tcp_data);
+    connect_timeout_usec = tcp_data->connect_timeout_usec >= 0 ? tcp_data->connect_timeout_usec : timeout_usec;
 
     #ifdef _WIN32
         WORD wVersionRequested;
@@ -90,48 +197,77 @@ mbus_tcp_connect(mbus_handle *handle)
             /* Tell the user that we could not find a usable */
             /* Winsock DLL.                                  */
             snprintf(error_str, sizeof(error_str), "%s: WSAStartup failed with error: %d", __PRETTY_FUNCTION__, err);
-            mbus_error_str_set(error_str);
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_CONNECT, error_str);
             return -1;
         }
     #endif
+
+    /* resolve hostname */
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%d", port);
+
+    if ((ret = getaddrinfo(host, service, &hints, &addrs)) != 0)
+    {
+        snprintf(error_str, sizeof(error_str), "%s: unknown host: %s (%s)", __PRETTY_FUNCTION__, host, gai_strerror(ret));
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_CONNECT, error_str);
+        return -1;
+    }
+
     //
     // create the TCP connection
     //
-    if ((handle->fd = socket(AF_INET,SOCK_STREAM, 0)) < 0)
+    handle->fd = -1;
+    for (addr = addrs; addr != NULL; addr = addr->ai_next)
     {
-        snprintf(error_str, sizeof(error_str), "%s: failed to setup a socket.", __PRETTY_FUNCTION__);
-        mbus_error_str_set(error_str);
-        return -1;
-    }
+        if ((handle->fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol)) < 0)
+        {
+            continue;
+        }
+
+        if (mbus_tcp_connect_addr(handle->fd, addr, connect_timeout_usec) == 0)
+        {
+            break;
+        }
 
-    s.sin_family = AF_INET;
-    s.sin_port = htons(port);
+        tcp_close(handle->fd);
+        handle->fd = -1;
+    }
+    freeaddrinfo(addrs);
 
-    /* resolve hostname */
-    if ((host_addr = gethostbyname(host)) == NULL)
+    if (handle->fd < 0)
     {
-        snprintf(error_str, sizeof(error_str), "%s: unknown host: %s", __PRETTY_FUNCTION__, host);
-        mbus_error_str_set(error_str);
+        snprintf(error_str, sizeof(error_str), "%s: Failed to establish connection to %s:%d", __PRETTY_FUNCTION__, host, port);
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_CONNECT, error_str);
         return -1;
     }
 
-    memcpy((void *)(&s.sin_addr), (void *)(host_addr->h_addr), host_addr->h_length);
+    mbus_rx_buffer_reset(&(handle->rx));
+
+    // frames are written in one piece, no need to wait for more data
+    setsockopt(handle->fd, IPPROTO_TCP, TCP_NODELAY, (char *)&on, sizeof(on));
 
-    if (connect(handle->fd, (struct sockaddr *)&s, sizeof(s)) < 0)
+    // detect dead gateways on idle connections
+    setsockopt(handle->fd, SOL_SOCKET, SO_KEEPALIVE, (char *)&on, sizeof(on));
+    #ifdef TCP_KEEPIDLE
     {
-        snprintf(error_str, sizeof(error_str), "%s: Failed to establish connection to %s:%d", __PRETTY_FUNCTION__, host, port);
-        mbus_error_str_set(error_str);
-        return -1;
+        int idle = 60, interval = 10, count = 3;
+
+        setsockopt(handle->fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+        setsockopt(handle->fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+        setsockopt(handle->fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
     }
+    #endif
 
     // Set a timeout
-    time_out.tv_sec  = tcp_timeout_sec;   // seconds
-    time_out.tv_usec = tcp_timeout_usec;  // microseconds
+    time_out.tv_sec  = timeout_usec / 1000000;   // seconds
+    time_out.tv_usec = timeout_usec % 1000000;   // microseconds
 
     #ifdef _WIN32
-    uint64_t millis = (time_out.tv_sec * (uint64_t)1000) + (time_out.tv_usec / 1000);
-    setsockopt(handle->fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&millis, sizeof(time_out));
-    setsockopt(handle->fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&millis, sizeof(time_out));
+    DWORD millis = (DWORD)(timeout_usec / 1000);
+    setsockopt(handle->fd, SOL_SOCKET, SO_SNDTIMEO, (char *)&millis, sizeof(millis));
+    setsockopt(handle->fd, SOL_SOCKET, SO_RCVTIMEO, (char *)&millis, sizeof(millis));
     #else
     setsockopt(handle->fd, SOL_SOCKET, SO_SNDTIMEO, &time_out, sizeof(time_out));
     setsockopt(handle->fd, SOL_SOCKET, SO_RCVTIMEO, &time_out, sizeof(time_out));
@@ -207,7 +343,7 @@ mbus_tcp_send_frame(mbus_handle *handle, mbus_frame *frame)
     if ((len = mbus_frame_pack(frame, buff, sizeof(buff))) == -1)
     {
         snprintf(error_str, sizeof(error_str), "%s: mbus_frame_pack failed\n", __PRETTY_FUNCTION__);
-        mbus_error_str_set(error_str);
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_INVALID, error_str);
         return -1;
     }
 
@@ -222,11 +358,15 @@ mbus_tcp_send_frame(mbus_handle *handle, mbus_frame *frame)
         //
         if (handle->send_event)
             handle->send_event(MBUS_HANDLE_TYPE_TCP, buff, len);
+
+        // an echo of the frame is dropped from the received bytes
+        if (handle->purge_first_frame == MBUS_FRAME_PURGE_M2S)
+            mbus_rx_buffer_expect_echo(&(handle->rx), buff, len);
     }
     else
     {
         snprintf(error_str, sizeof(error_str), "%s: Failed to write frame to socket (ret = %d)\n", __PRETTY_FUNCTION__, ret);
-        mbus_error_str_set(error_str);
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_IO, error_str);
         return -1;
     }
 
@@ -236,80 +376,112 @@ mbus_tcp_send_frame(mbus_handle *handle, mbus_frame *frame)
 //------------------------------------------------------------------------------
 //
 //------------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+// Wait at most timeout ms for data, returns 0 on timeout
+//------------------------------------------------------------------------------
+static int
+mbus_tcp_wait_readable(int fd, int timeout)
+{
+    int ret;
+
+    #ifdef _WIN32
+    fd_set rfds;
+    struct timeval time_out;
+
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    time_out.tv_sec  = timeout / 1000;
+    time_out.tv_usec = (timeout % 1000) * 1000;
+    ret = select(fd + 1, &rfds, NULL, NULL, &time_out);
+    #else
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    do {
+        ret = poll(&pfd, 1, timeout);
+    } while (ret == -1 && errno == EINTR);
+    #endif
+
+    // errors are reported by the following read
+    return ret != 0;
+}
+
 int mbus_tcp_recv_frame(mbus_handle *handle, mbus_frame *frame)
 {
-    char buff[PACKET_BUFF_SIZE];
+    unsigned char *data, *space;
+    size_t size, frame_size;
     int remaining;
-    ssize_t len, nread;
+    ssize_t nread;
 
     if (handle == NULL || frame == NULL) {
         fprintf(stderr, "%s: Invalid parameter.\n", __PRETTY_FUNCTION__);
         return MBUS_RECV_RESULT_ERROR;
     }
 
-    memset((void *) buff, 0, sizeof(buff));
-
     //
-    // read data until a packet is received
+    // read data in bulk until a complete frame is buffered, the bytes of a
+    // following frame stay in the buffer for the next call
     //
-    remaining = 1; // start by reading 1 byte
-    len = 0;
-
-    do {
-retry:
-        if (len + remaining > PACKET_BUFF_SIZE)
-        {
-            // avoid out of bounds access
-            return MBUS_RECV_RESULT_ERROR;
+    while ((remaining = mbus_rx_buffer_frame(&(handle->rx), &data, &frame_size)) > 0) {
+        space = mbus_rx_buffer_space(&(handle->rx), &size);
+
+        // a response timeout of the request overrides the socket timeout
+        if (handle->response_timeout >= 0 && mbus_tcp_wait_readable(handle->fd, handle->response_timeout) == 0) {
+            mbus_rx_buffer_reset(&(handle->rx));
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_TIMEOUT, "M-Bus tcp transport layer response timeout has been reached.");
+            return MBUS_RECV_RESULT_TIMEOUT;
         }
 
+retry:
         #ifdef _WIN32
-            nread = recv(handle->fd, &buff[len], remaining, 0);
+            nread = recv(handle->fd, (char *)space, (int)size, 0);
             errno = WSAGetLastError();
         #else
-            nread = read(handle->fd, &buff[len], remaining);
+            nread = read(handle->fd, space, size);
         #endif
         switch (nread) {
         case -1:
             if (errno == EINTR)
                 goto retry;
 
+            // an incomplete frame is dropped
+            mbus_rx_buffer_reset(&(handle->rx));
+
             if (errno == EAGAIN || errno == EWOULDBLOCK
                 #ifdef _WIN32
                  || errno == WSAETIMEDOUT
                 #endif
             ) {
-                mbus_error_str_set("M-Bus tcp transport layer response timeout has been reached.");
+                mbus_handle_error_set(handle, MBUS_ERROR_CODE_TIMEOUT, "M-Bus tcp transport layer response timeout has been reached.");
                 return MBUS_RECV_RESULT_TIMEOUT;
             }
 
-            mbus_error_str_set("M-Bus tcp transport layer failed to read data.");
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_IO, "M-Bus tcp transport layer failed to read data.");
             return MBUS_RECV_RESULT_ERROR;
         case 0:
-            mbus_error_str_set("M-Bus tcp transport layer connection closed by remote host.");
+            mbus_rx_buffer_reset(&(handle->rx));
+            mbus_handle_error_set(handle, MBUS_ERROR_CODE_CLOSED, "M-Bus tcp transport layer connection closed by remote host.");
             return MBUS_RECV_RESULT_RESET;
         default:
-            if (len > (SSIZE_MAX-nread))
-            {
-                // avoid overflow
-                return MBUS_RECV_RESULT_ERROR;
-            }
-
-            len += nread;
+            mbus_rx_buffer_commit(&(handle->rx), nread);
         }
-    } while ((remaining = mbus_parse(frame, buff, len)) > 0);
+    }
 
     //
     // call the receive event function, if the callback function is registered
     //
     if (handle->recv_event)
-        handle->recv_event(MBUS_HANDLE_TYPE_TCP, buff, len);
+        handle->recv_event(MBUS_HANDLE_TYPE_TCP, (const char *)data, frame_size);
 
-    if (remaining < 0) {
-        mbus_error_str_set("M-Bus layer failed to parse data.");
+    // invalid data is dropped completely
+    if (mbus_parse(frame, data, frame_size) != 0 || remaining < 0) {
+        mbus_rx_buffer_consume(&(handle->rx), frame_size);
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_FRAME, "M-Bus layer failed to parse data.");
         return MBUS_RECV_RESULT_INVALID;
     }
 
+    mbus_rx_buffer_consume(&(handle->rx), frame_size);
     return MBUS_RECV_RESULT_OK;
 }
 
@@ -323,7 +495,7 @@ mbus_tcp_set_timeout_set(double seconds)
 {
     if (seconds < 0.0)
     {
-        mbus_error_str_set("Invalid timeout (must be positive).");
+        mbus_error_set(MBUS_ERROR_CODE_INVALID, "Invalid timeout (must be positive).");
         return -1;
     }
 
@@ -332,3 +504,56 @@ mbus_tcp_set_timeout_set(double seconds)
 
     return 0;
 }
+
+//------------------------------------------------------------------------------
+/// Set the response timeout in seconds of one handle (microsecond
+/// resolution), it overrides the global default of mbus_tcp_set_timeout_set.
+/// Note: This configuration has to be made before calling mbus_tcp_connect.
+//------------------------------------------------------------------------------
+int
+mbus_tcp_set_timeout(mbus_handle *handle, double seconds)
+{
+    mbus_tcp_data *tcp_data;
+
+    if (handle == NULL || (tcp_data = (mbus_tcp_data *) handle->auxdata) == NULL || handle->is_serial)
+    {
+        mbus_error_set(MBUS_ERROR_CODE_INVALID, "Invalid M-Bus TCP handle.");
+        return -1;
+    }
+
+    if (seconds < 0.0)
+    {
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_INVALID, "Invalid timeout (must be positive).");
+        return -1;
+    }
+
+    tcp_data->timeout_usec = (long)(seconds * 1000000);
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Set the time in seconds mbus_tcp_connect waits for a connection to one
+/// address of the host. Without it the response timeout is used.
+//------------------------------------------------------------------------------
+int
+mbus_tcp_set_connect_timeout(mbus_handle *handle, double seconds)
+{
+    mbus_tcp_data *tcp_data;
+
+    if (handle == NULL || (tcp_data = (mbus_tcp_data *) handle->auxdata) == NULL || handle->is_serial)
+    {
+        mbus_error_set(MBUS_ERROR_CODE_INVALID, "Invalid M-Bus TCP handle.");
+        return -1;
+    }
+
+    if (seconds < 0.0)
+    {
+        mbus_handle_error_set(handle, MBUS_ERROR_CODE_INVALID, "Invalid timeout (must be positive).");
+        return -1;
+    }
+
+    tcp_data->connect_timeout_usec = (long)(seconds * 1000000);
+
+    return 0;
+}
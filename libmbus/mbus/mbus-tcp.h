@@ -30,6 +30,8 @@ typedef struct _mbus_tcp_data
 {
     char *host;
     uint16_t port;
+    long timeout_usec;          /**< response timeout, -1 for the global default */
+    long connect_timeout_usec;  /**< connect timeout, -1 for the response timeout */
 } mbus_tcp_data;
 
 int  mbus_tcp_connect(mbus_handle *handle);
@@ -38,6 +40,8 @@ int  mbus_tcp_send_frame(mbus_handle *handle, mbus_frame *frame);
 int  mbus_tcp_recv_frame(mbus_handle *handle, mbus_frame *frame);
 void mbus_tcp_data_free(mbus_handle *handle);
 int  mbus_tcp_set_timeout_set(double seconds);
+int  mbus_tcp_set_timeout(mbus_handle *handle, double seconds);
+int  mbus_tcp_set_connect_timeout(mbus_handle *handle, double seconds);
 
 #ifdef __cplusplus
 }
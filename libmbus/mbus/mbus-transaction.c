@@ -0,0 +1,906 @@
+#ifdef _WIN32
+#define __PRETTY_FUNCTION__ __FUNCSIG__
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mbus-transaction.h"
+
+#define MBUS_ERROR(...) fprintf (stderr, __VA_ARGS__)
+
+//
+// Phases of a transaction
+//
+#define PHASE_INIT             0
+#define PHASE_PING             1
+#define PHASE_SELECT           2
+#define PHASE_SELECT_COLLISION 3
+#define PHASE_REQUEST          4
+#define PHASE_RECORDS          5
+
+//
+// Error messages, the same as the ones of the blocking functions
+//
+#define MSG_INIT    "Failed to init slaves."
+#define MSG_PING    "Failed to initialize slave[%s]."
+#define MSG_SELECT  "Failed to select secondary address [%s]."
+#define MSG_NOTHING "The selected secondary address does not match any device [%s]."
+#define MSG_COLLIDE "The address mask [%s] matches more than one device."
+#define MSG_REQUEST "Failed to send/receive M-Bus request frame[%s]."
+#define MSG_RECORDS "Failed to send readout selection[%s]."
+#define MSG_ADDRESS "Invalid primary address [%s]."
+
+// error of a failed send, indexed by the phase
+static const char *send_error[] = { MSG_INIT, MSG_PING, MSG_SELECT, MSG_SELECT, MSG_REQUEST, MSG_RECORDS };
+
+static void mbus_transaction_send(mbus_transaction *tr, mbus_frame *frame, int purge);
+static void mbus_transaction_receive(mbus_transaction *tr);
+static void mbus_transaction_received(mbus_transaction *tr, int result);
+static void mbus_transaction_purged(mbus_transaction *tr);
+
+#ifdef _WIN32
+#define tr_read(fd, buff, len)  recv(fd, (char *)(buff), (int)(len), 0)
+#define tr_write(fd, buff, len) send(fd, (const char *)(buff), (int)(len), 0)
+#define TR_WOULDBLOCK(err)      ((err) == WSAEWOULDBLOCK)
+#define TR_ERRNO                WSAGetLastError()
+#else
+#define tr_read(fd, buff, len)  read(fd, buff, len)
+#define tr_write(fd, buff, len) write(fd, buff, len)
+#define TR_WOULDBLOCK(err)      ((err) == EAGAIN || (err) == EWOULDBLOCK)
+#define TR_ERRNO                errno
+#endif
+
+static int
+mbus_transaction_init(mbus_transaction *tr, mbus_handle *handle, const char *addr_str, int timeout)
+{
+    if (tr == NULL || handle == NULL || addr_str == NULL)
+    {
+        return -1;
+    }
+
+    memset((void *)tr, 0, sizeof(mbus_transaction));
+    tr->handle = handle;
+    tr->timeout = timeout;
+    snprintf(tr->addr_str, sizeof(tr->addr_str), "%s", addr_str);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Prepare a transaction that requests the data of the slave at addr_str
+/// (primary or secondary address) incl. multi-telegram replies of up to
+/// max_frames frames. timeout is the receive timeout in ms.
+//------------------------------------------------------------------------------
+int
+mbus_transaction_request(mbus_transaction *tr, mbus_handle *handle, const char *addr_str, int max_frames, int timeout, int flags)
+{
+    if (mbus_transaction_init(tr, handle, addr_str, timeout) == -1)
+    {
+        return -1;
+    }
+
+    tr->type = MBUS_TRANSACTION_REQUEST;
+    tr->flags = flags;
+    tr->max_frames = max_frames;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Send the readout selection records (SND_UD) before the request of a
+/// request transaction, see mbus_send_readout_selection.
+//------------------------------------------------------------------------------
+int
+mbus_transaction_set_selection(mbus_transaction *tr, const unsigned char *records, size_t records_size)
+{
+    if (tr == NULL || records_size > sizeof(tr->selection) || (records == NULL && records_size > 0))
+    {
+        return -1;
+    }
+
+    if (records_size > 0)
+    {
+        memcpy(tr->selection, records, records_size);
+    }
+    tr->selection_len = records_size;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Prepare a transaction that selects the secondary address (mask) addr_str.
+/// The result is MBUS_PROBE_SINGLE, MBUS_PROBE_NOTHING, MBUS_PROBE_COLLISION
+/// or MBUS_PROBE_ERROR like the one of mbus_select_secondary_address.
+//------------------------------------------------------------------------------
+int
+mbus_transaction_select(mbus_transaction *tr, mbus_handle *handle, const char *addr_str, int timeout)
+{
+    if (mbus_transaction_init(tr, handle, addr_str, timeout) == -1)
+    {
+        return -1;
+    }
+
+    if (!mbus_is_secondary_address(tr->addr_str))
+    {
+        MBUS_ERROR("%s: Invalid secondary address [%s].\n", __PRETTY_FUNCTION__, addr_str);
+        return -1;
+    }
+
+    tr->type = MBUS_TRANSACTION_SELECT;
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/// Free the reply chain of a transaction.
+//------------------------------------------------------------------------------
+void
+mbus_transaction_free(mbus_transaction *tr)
+{
+    if (tr == NULL)
+    {
+        return;
+    }
+
+    mbus_frame_free((mbus_frame *)tr->reply.next);
+    tr->reply.next = NULL;
+}
+
+static void
+mbus_transaction_finish(mbus_transaction *tr, int result)
+{
+    tr->result = result;
+    tr->done = 1;
+    tr->want_read = 0;
+    tr->want_write = 0;
+    tr->timeout_at = 0;
+}
+
+// error code of a receive result that ends the transaction
+static int
+mbus_transaction_result_code(int result)
+{
+    switch (result)
+    {
+        case MBUS_RECV_RESULT_TIMEOUT:
+            return MBUS_ERROR_CODE_TIMEOUT;
+        case MBUS_RECV_RESULT_RESET:
+            return MBUS_ERROR_CODE_CLOSED;
+        case MBUS_RECV_RESULT_ERROR:
+            return MBUS_ERROR_CODE_IO;
+        default:
+            return MBUS_ERROR_CODE_FRAME;
+    }
+}
+
+static void
+mbus_transaction_fail(mbus_transaction *tr, int code, const char *fmt)
+{
+    if (tr->phase == PHASE_REQUEST || tr->phase == PHASE_RECORDS)
+    {
+        // the slave state is unknown, start a new session the next time
+        mbus_slave_session_reset(tr->handle, tr->address);
+    }
+
+    snprintf(tr->error, sizeof(tr->error), fmt, tr->addr_str);
+    tr->error_code = code;
+    mbus_handle_error_set(tr->handle, code, tr->error);
+    mbus_transaction_finish(tr, -1);
+}
+
+// outcome of a select, the end of a select transaction
+static void
+mbus_transaction_selected(mbus_transaction *tr, int probe, const char *fmt)
+{
+    if (tr->type == MBUS_TRANSACTION_SELECT)
+    {
+        if (probe == MBUS_PROBE_ERROR)
+        {
+            snprintf(tr->error, sizeof(tr->error), fmt, tr->addr_str);
+        }
+        mbus_transaction_finish(tr, probe);
+        return;
+    }
+
+    mbus_transaction_fail(tr, probe == MBUS_PROBE_NOTHING ? MBUS_ERROR_CODE_NO_DEVICE :
+                              probe == MBUS_PROBE_COLLISION ? MBUS_ERROR_CODE_COLLISION : MBUS_ERROR_CODE_IO, fmt);
+}
+
+static void
+mbus_transaction_send_control(mbus_transaction *tr, int control, int address, int purge)
+{
+    mbus_frame *frame = mbus_frame_new(MBUS_FRAME_TYPE_SHORT);
+
+    if (frame == NULL)
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_NOMEM, "Failed to allocate mbus frame.");
+        return;
+    }
+
+    frame->control = control | MBUS_CONTROL_MASK_DIR_M2S;
+    frame->address = address;
+    mbus_transaction_send(tr, frame, purge);
+    mbus_frame_free(frame);
+}
+
+static void
+mbus_transaction_send_request(mbus_transaction *tr)
+{
+    if (tr->handle->abort_check && tr->handle->abort_check(tr->handle))
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_ABORTED, "M-Bus request aborted.");
+        return;
+    }
+
+    if (tr->retry > tr->handle->max_data_retry)
+    {
+        // Give up, the error of the last attempt
+        mbus_transaction_fail(tr, tr->error_code, MSG_REQUEST);
+        return;
+    }
+
+    mbus_transaction_send_control(tr, tr->request_control, tr->address, 0);
+}
+
+// send the readout selection, continuing the link layer session of the slave
+static void
+mbus_transaction_send_selection(mbus_transaction *tr)
+{
+    mbus_frame *frame = mbus_frame_new(MBUS_FRAME_TYPE_LONG);
+
+    tr->phase = PHASE_RECORDS;
+
+    if (frame == NULL)
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_NOMEM, "Failed to allocate mbus frame.");
+        return;
+    }
+
+    frame->control = MBUS_CONTROL_MASK_SND_UD |
+                     MBUS_CONTROL_MASK_DIR_M2S |
+                     MBUS_CONTROL_MASK_FCV     |
+                     MBUS_CONTROL_MASK_FCB;
+    if (mbus_slave_session(tr->handle, tr->address) == 0)
+    {
+        frame->control &= ~MBUS_CONTROL_MASK_FCB;
+    }
+    frame->address = tr->address;
+    frame->control_information = MBUS_CONTROL_INFO_DATA_SEND;
+    frame->data_size = tr->selection_len;
+    memcpy(frame->data, tr->selection, tr->selection_len);
+
+    tr->request_control = frame->control;
+    mbus_transaction_send(tr, frame, 0);
+    mbus_frame_free(frame);
+}
+
+// request the data, continuing the link layer session of the slave
+static void
+mbus_transaction_start_request(mbus_transaction *tr)
+{
+    if (tr->selection_len > 0 && !tr->selection_sent)
+    {
+        mbus_transaction_send_selection(tr);
+        return;
+    }
+
+    tr->phase = PHASE_REQUEST;
+    tr->request_control = MBUS_CONTROL_MASK_REQ_UD2 |
+                          MBUS_CONTROL_MASK_DIR_M2S |
+                          MBUS_CONTROL_MASK_FCV     |
+                          MBUS_CONTROL_MASK_FCB;
+    if (mbus_slave_session(tr->handle, tr->address) == 0)
+    {
+        tr->request_control &= ~MBUS_CONTROL_MASK_FCB;
+    }
+    mbus_transaction_send_request(tr);
+}
+
+static void
+mbus_transaction_send_select(mbus_transaction *tr)
+{
+    mbus_frame *frame;
+
+    tr->phase = PHASE_SELECT;
+    tr->address = MBUS_ADDRESS_NETWORK_LAYER;
+
+    // the slave is still selected
+    if (strcmp(tr->handle->selected_address, tr->addr_str) == 0)
+    {
+        if (tr->type == MBUS_TRANSACTION_SELECT)
+        {
+            mbus_transaction_finish(tr, MBUS_PROBE_SINGLE);
+            return;
+        }
+        mbus_transaction_start_request(tr);
+        return;
+    }
+
+    // the selection changes
+    tr->handle->selected_address[0] = '\0';
+
+    frame = mbus_frame_new(MBUS_FRAME_TYPE_LONG);
+    if (frame == NULL || mbus_frame_select_secondary_pack(frame, tr->addr_str) == -1)
+    {
+        mbus_frame_free(frame);
+        mbus_transaction_selected(tr, MBUS_PROBE_ERROR, MSG_SELECT);
+        return;
+    }
+
+    mbus_transaction_send(tr, frame, 0);
+    mbus_frame_free(frame);
+}
+
+// take the primary address, the transaction fails without sending anything
+// when the address is neither a primary nor a secondary one
+static int
+mbus_transaction_check_address(mbus_transaction *tr)
+{
+    if (mbus_is_secondary_address(tr->addr_str))
+    {
+        return 0;
+    }
+
+    tr->address = atoi(tr->addr_str);
+    if (!mbus_is_primary_address(tr->address))
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_INVALID, MSG_ADDRESS);
+        return -1;
+    }
+    return 0;
+}
+
+// select or ping the slave after the optional init
+static void
+mbus_transaction_address(mbus_transaction *tr)
+{
+    if (mbus_transaction_check_address(tr) == -1)
+    {
+        return;
+    }
+
+    if (mbus_is_secondary_address(tr->addr_str))
+    {
+        // secondary addressing
+        mbus_transaction_send_select(tr);
+        return;
+    }
+
+    if (mbus_slave_session(tr->handle, tr->address) != -1)
+    {
+        mbus_transaction_start_request(tr);
+        return;
+    }
+
+    // primary addressing, send a reset SND_NKE to the device before requesting data
+    tr->phase = PHASE_PING;
+    mbus_transaction_send_control(tr, MBUS_CONTROL_MASK_SND_NKE, tr->address, 1);
+}
+
+//------------------------------------------------------------------------------
+/// Start the transaction, the first frame is written right away if possible.
+//------------------------------------------------------------------------------
+void
+mbus_transaction_start(mbus_transaction *tr, uint64_t now)
+{
+    tr->now = now;
+    tr->done = 0;
+    tr->result = 0;
+    tr->error[0] = '\0';
+    tr->init_cnt = 0;
+    tr->retry = 0;
+    tr->error_code = MBUS_ERROR_CODE_NONE;
+    tr->frame_cnt = 0;
+    tr->selection_sent = 0;
+    tr->next_frame = &(tr->reply);
+
+    if (tr->type == MBUS_TRANSACTION_SELECT)
+    {
+        mbus_transaction_send_select(tr);
+    }
+    else if (mbus_transaction_check_address(tr) == -1)
+    {
+        return;
+    }
+    else if ((tr->flags & MBUS_TRANSACTION_INIT_SLAVES) &&
+             mbus_slave_session(tr->handle, MBUS_ADDRESS_NETWORK_LAYER) == -1)
+    {
+        // init slaves: two SND_NKE to the network layer address, they
+        // deselect the selected slave
+        tr->phase = PHASE_INIT;
+        tr->handle->selected_address[0] = '\0';
+        mbus_transaction_send_control(tr, MBUS_CONTROL_MASK_SND_NKE, MBUS_ADDRESS_NETWORK_LAYER, 1);
+    }
+    else
+    {
+        mbus_transaction_address(tr);
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Stop the transaction with an abort error.
+//------------------------------------------------------------------------------
+void
+mbus_transaction_cancel(mbus_transaction *tr)
+{
+    if (!tr->done)
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_ABORTED, "M-Bus request aborted.");
+    }
+}
+
+// take the complete frames that are buffered while a frame is expected
+static void
+mbus_transaction_process(mbus_transaction *tr)
+{
+    unsigned char *data;
+    size_t frame_size;
+    int ret;
+
+    while (tr->want_read &&
+           (ret = mbus_rx_buffer_frame(&(tr->handle->rx), &data, &frame_size)) <= 0)
+    {
+        //
+        // call the receive event function, if the callback function is registered
+        //
+        if (tr->handle->recv_event)
+            tr->handle->recv_event(tr->handle->is_serial ? MBUS_HANDLE_TYPE_SERIAL : MBUS_HANDLE_TYPE_TCP, (const char *)data, frame_size);
+
+        if (mbus_parse(&(tr->rx_frame), data, frame_size) != 0)
+        {
+            ret = -1;
+        }
+        mbus_rx_buffer_consume(&(tr->handle->rx), frame_size);
+
+        mbus_transaction_received(tr, ret == 0 ? MBUS_RECV_RESULT_OK : MBUS_RECV_RESULT_INVALID);
+    }
+}
+
+// send the frame, then receive one frame or purge all frames till the timeout
+static void
+mbus_transaction_send(mbus_transaction *tr, mbus_frame *frame, int purge)
+{
+    if ((tr->tx_len = mbus_frame_pack(frame, tr->tx_buff, sizeof(tr->tx_buff))) == -1)
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_INVALID, "Failed to pack mbus frame.");
+        return;
+    }
+
+    tr->tx_pos = 0;
+    tr->tx_address = mbus_latency_address(frame);
+    tr->purging = purge;
+    tr->purge_cnt = 0;
+    tr->want_read = 0;
+    tr->want_write = 1;
+    tr->timeout_at = tr->now + tr->timeout;
+    mbus_transaction_on_writable(tr, tr->now);
+}
+
+//------------------------------------------------------------------------------
+/// Write the pending frame as far as the fd accepts it.
+//------------------------------------------------------------------------------
+void
+mbus_transaction_on_writable(mbus_transaction *tr, uint64_t now)
+{
+    tr->now = now;
+
+    if (!tr->want_write)
+    {
+        return;
+    }
+
+    while (tr->tx_pos < tr->tx_len)
+    {
+        int n = tr_write(tr->handle->fd, tr->tx_buff + tr->tx_pos, tr->tx_len - tr->tx_pos);
+
+        if (n == -1)
+        {
+            int err = TR_ERRNO;
+
+            if (err == EINTR)
+            {
+                continue;
+            }
+            if (TR_WOULDBLOCK(err))
+            {
+                return;
+            }
+            mbus_transaction_fail(tr, MBUS_ERROR_CODE_IO, send_error[tr->phase]);
+            return;
+        }
+        tr->tx_pos += n;
+    }
+
+    //
+    // call the send event function, if the callback function is registered
+    //
+    if (tr->handle->send_event)
+        tr->handle->send_event(tr->handle->is_serial ? MBUS_HANDLE_TYPE_SERIAL : MBUS_HANDLE_TYPE_TCP, (const char *)tr->tx_buff, tr->tx_len);
+
+    // an echo of the frame is dropped from the received bytes
+    if (tr->handle->purge_first_frame == MBUS_FRAME_PURGE_M2S)
+        mbus_rx_buffer_expect_echo(&(tr->handle->rx), tr->tx_buff, tr->tx_len);
+
+    mbus_latency_sent(tr->handle, tr->tx_address, now);
+
+    tr->rx_echo_checked = 0;
+    mbus_transaction_receive(tr);
+    mbus_transaction_process(tr);
+}
+
+static void
+mbus_transaction_receive(mbus_transaction *tr)
+{
+    memset((void *)&(tr->rx_frame), 0, sizeof(mbus_frame));
+    int timeout = tr->timeout;
+
+    if (tr->purging && tr->handle->purge_policy != MBUS_PURGE_POLICY_FULL)
+    {
+        timeout = mbus_purge_window(tr->handle);
+    }
+
+    tr->want_read = 1;
+    tr->want_write = 0;
+    // an answer to the request is awaited as long as its address needs
+    tr->timeout_at = tr->now + mbus_latency_timeout(tr->handle, tr->handle->latency.pending_address, timeout);
+}
+
+//------------------------------------------------------------------------------
+/// Read the available bytes and process the complete frames.
+//------------------------------------------------------------------------------
+void
+mbus_transaction_on_readable(mbus_transaction *tr, uint64_t now)
+{
+    unsigned char *space;
+    size_t size;
+
+    tr->now = now;
+
+    if (!tr->want_read)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        space = mbus_rx_buffer_space(&(tr->handle->rx), &size);
+
+        int n = tr_read(tr->handle->fd, space, size);
+
+        if (n > 0)
+        {
+            mbus_rx_buffer_commit(&(tr->handle->rx), n);
+            continue;
+        }
+        if (n == 0)
+        {
+            mbus_rx_buffer_reset(&(tr->handle->rx));
+            mbus_transaction_received(tr, MBUS_RECV_RESULT_RESET);
+            return;
+        }
+        int err = TR_ERRNO;
+
+        if (err == EINTR)
+        {
+            continue;
+        }
+        if (!TR_WOULDBLOCK(err))
+        {
+            mbus_rx_buffer_reset(&(tr->handle->rx));
+            mbus_transaction_received(tr, MBUS_RECV_RESULT_ERROR);
+            return;
+        }
+        break;
+    }
+
+    mbus_transaction_process(tr);
+}
+
+//------------------------------------------------------------------------------
+/// Called when timeout_at has passed.
+//------------------------------------------------------------------------------
+void
+mbus_transaction_on_timeout(mbus_transaction *tr, uint64_t now)
+{
+    tr->now = now;
+
+    if (tr->done)
+    {
+        return;
+    }
+
+    if (tr->want_write)
+    {
+        mbus_transaction_fail(tr, MBUS_ERROR_CODE_TIMEOUT, send_error[tr->phase]);
+        return;
+    }
+
+    // an incomplete frame is dropped
+    mbus_rx_buffer_reset(&(tr->handle->rx));
+    mbus_transaction_received(tr, MBUS_RECV_RESULT_TIMEOUT);
+}
+
+// same as mbus_purge_frames: receive frames till the timeout
+static void
+mbus_transaction_purge(mbus_transaction *tr)
+{
+    tr->purging = 1;
+    tr->purge_cnt = 0;
+    tr->rx_echo_checked = 0;
+    mbus_transaction_receive(tr);
+}
+
+static void
+mbus_transaction_frame_received(mbus_transaction *tr, int result)
+{
+    if (tr->phase == PHASE_SELECT)
+    {
+        if (result == MBUS_RECV_RESULT_TIMEOUT)
+        {
+            mbus_transaction_selected(tr, MBUS_PROBE_NOTHING, MSG_NOTHING);
+        }
+        else if (result == MBUS_RECV_RESULT_INVALID)
+        {
+            /* check for more data (collision) */
+            tr->phase = PHASE_SELECT_COLLISION;
+            mbus_transaction_purge(tr);
+        }
+        else if (result != MBUS_RECV_RESULT_OK)
+        {
+            mbus_transaction_selected(tr, MBUS_PROBE_ERROR, MSG_SELECT);
+        }
+        else if (mbus_frame_type(&(tr->rx_frame)) == MBUS_FRAME_TYPE_ACK)
+        {
+            /* check for more data (collision) */
+            mbus_transaction_purge(tr);
+        }
+        else
+        {
+            mbus_transaction_selected(tr, MBUS_PROBE_NOTHING, MSG_NOTHING);
+        }
+        return;
+    }
+
+    if (tr->phase == PHASE_RECORDS)
+    {
+        if (result != MBUS_RECV_RESULT_OK || mbus_frame_type(&(tr->rx_frame)) != MBUS_FRAME_TYPE_ACK)
+        {
+            mbus_transaction_fail(tr, mbus_transaction_result_code(result), MSG_RECORDS);
+            return;
+        }
+
+        // the acknowledged selection completes the FCB cycle
+        tr->selection_sent = 1;
+        if (tr->address >= 0 && tr->address <= MBUS_ADDRESS_NETWORK_LAYER)
+        {
+            tr->handle->slave_data[tr->address].state_fcb = (tr->request_control & MBUS_CONTROL_MASK_FCB) ? 0 : 1;
+        }
+        if (tr->handle->purge_policy == MBUS_PURGE_POLICY_SKIP_VALID)
+        {
+            mbus_transaction_start_request(tr);
+            return;
+        }
+        mbus_transaction_purge(tr);
+        return;
+    }
+
+    // PHASE_REQUEST
+    if (result == MBUS_RECV_RESULT_OK)
+    {
+        void *next = tr->next_frame->next;
+
+        tr->retry = 0;
+        *(tr->next_frame) = tr->rx_frame;
+        tr->next_frame->next = next;
+
+        tr->purge_after_ok = 1;
+        if (tr->handle->purge_policy == MBUS_PURGE_POLICY_SKIP_VALID)
+        {
+            // a valid complete answer is the only one on the bus
+            mbus_transaction_purged(tr);
+            return;
+        }
+        mbus_transaction_purge(tr);
+    }
+    else if (result == MBUS_RECV_RESULT_TIMEOUT)
+    {
+        tr->retry++;
+        tr->error_code = MBUS_ERROR_CODE_TIMEOUT;
+        mbus_transaction_send_request(tr);
+    }
+    else if (result == MBUS_RECV_RESULT_INVALID)
+    {
+        tr->retry++;
+        tr->error_code = MBUS_ERROR_CODE_FRAME;
+        tr->purge_after_ok = 0;
+        mbus_transaction_purge(tr);
+    }
+    else
+    {
+        mbus_transaction_fail(tr, mbus_transaction_result_code(result), MSG_REQUEST);
+    }
+}
+
+// same as mbus_recv_frame: purge the echo of the own frame and retry
+static void
+mbus_transaction_received(mbus_transaction *tr, int result)
+{
+    if (!tr->rx_echo_checked && result != MBUS_RECV_RESULT_ERROR && result != MBUS_RECV_RESULT_RESET)
+    {
+        tr->rx_echo_checked = 1;
+
+        switch (mbus_frame_direction(&(tr->rx_frame)))
+        {
+            case MBUS_CONTROL_MASK_DIR_M2S:
+                if (tr->handle->purge_first_frame == MBUS_FRAME_PURGE_M2S)
+                {
+                    mbus_transaction_receive(tr);
+                    return;
+                }
+                break;
+            case MBUS_CONTROL_MASK_DIR_S2M:
+                if (tr->handle->purge_first_frame == MBUS_FRAME_PURGE_S2M)
+                {
+                    mbus_transaction_receive(tr);
+                    return;
+                }
+                break;
+        }
+    }
+
+    mbus_latency_received(tr->handle, result, tr->now);
+
+    /* set timestamp to receive time */
+    time(&(tr->rx_frame.timestamp));
+
+    if (tr->purging)
+    {
+        // the valid ACK of a single slave needs no further purge
+        int single_ack = result == MBUS_RECV_RESULT_OK && tr->phase == PHASE_PING && tr->purge_cnt == 0 &&
+                         tr->handle->purge_policy == MBUS_PURGE_POLICY_SKIP_VALID;
+
+        if (!single_ack && (result == MBUS_RECV_RESULT_OK || result == MBUS_RECV_RESULT_INVALID))
+        {
+            tr->purge_cnt++;
+            tr->rx_echo_checked = 0;
+            mbus_transaction_receive(tr);
+            return;
+        }
+        if (single_ack)
+        {
+            tr->purge_cnt++;
+        }
+        tr->purging = 0;
+        tr->want_read = 0;
+        tr->timeout_at = 0;
+        mbus_transaction_purged(tr);
+        return;
+    }
+
+    mbus_transaction_frame_received(tr, result);
+}
+
+static void
+mbus_transaction_purged(mbus_transaction *tr)
+{
+    mbus_frame_data reply_data;
+    int more_frames;
+
+    switch (tr->phase)
+    {
+        case PHASE_INIT:
+            if (++tr->init_cnt < 2)
+            {
+                mbus_transaction_send_control(tr, MBUS_CONTROL_MASK_SND_NKE, MBUS_ADDRESS_NETWORK_LAYER, 1);
+            }
+            else
+            {
+                mbus_slave_session_start(tr->handle, MBUS_ADDRESS_NETWORK_LAYER);
+                mbus_transaction_address(tr);
+            }
+            break;
+
+        case PHASE_PING:
+            // a slave that acknowledged the reset expects FCB 1 next
+            if (tr->purge_cnt > 0)
+            {
+                mbus_slave_session_start(tr->handle, tr->address);
+            }
+            else
+            {
+                mbus_slave_session_reset(tr->handle, tr->address);
+            }
+            mbus_transaction_start_request(tr);
+            break;
+
+        case PHASE_SELECT:
+            if (tr->purge_cnt > 0)
+            {
+                mbus_transaction_selected(tr, MBUS_PROBE_COLLISION, MSG_COLLIDE);
+                return;
+            }
+            // a newly selected slave is requested with FCB 1, the selection
+            // is kept for the next requests
+            mbus_slave_session_start(tr->handle, MBUS_ADDRESS_NETWORK_LAYER);
+            snprintf(tr->handle->selected_address, sizeof(tr->handle->selected_address), "%s", tr->addr_str);
+            if (tr->type == MBUS_TRANSACTION_SELECT)
+            {
+                mbus_transaction_finish(tr, MBUS_PROBE_SINGLE);
+                return;
+            }
+            mbus_transaction_start_request(tr);
+            break;
+
+        case PHASE_SELECT_COLLISION:
+            mbus_transaction_selected(tr, MBUS_PROBE_COLLISION, MSG_COLLIDE);
+            break;
+
+        case PHASE_RECORDS:
+            mbus_transaction_start_request(tr);
+            break;
+
+        case PHASE_REQUEST:
+            if (!tr->purge_after_ok)
+            {
+                mbus_transaction_send_request(tr);
+                return;
+            }
+
+            tr->frame_cnt++;
+
+            // the answered request completes the FCB cycle
+            if (tr->address >= 0 && tr->address <= MBUS_ADDRESS_NETWORK_LAYER)
+            {
+                tr->handle->slave_data[tr->address].state_fcb = (tr->request_control & MBUS_CONTROL_MASK_FCB) ? 0 : 1;
+                tr->handle->slave_data[tr->address].state_acd = (tr->next_frame->control & MBUS_CONTROL_MASK_ACD) ? 1 : 0;
+            }
+
+            //
+            // We need to parse the data in the received frame to be able to tell
+            // if more records are available or not.
+            //
+            memset((void *)&reply_data, 0, sizeof(mbus_frame_data));
+            if (mbus_frame_data_parse(tr->next_frame, &reply_data) == -1)
+            {
+                mbus_transaction_fail(tr, MBUS_ERROR_CODE_DATA, MSG_REQUEST);
+                return;
+            }
+
+            //
+            // call the frame event function, if the callback function is registered
+            //
+            if (tr->handle->frame_event)
+                tr->handle->frame_event(tr->handle, tr->next_frame);
+
+            more_frames = reply_data.type == MBUS_DATA_TYPE_VARIABLE &&
+                          reply_data.data_var.more_records_follow &&
+                          tr->max_frames > 0 && tr->frame_cnt < tr->max_frames; // only readout max_frames
+
+            if (reply_data.data_var.record)
+            {
+                // free's up the whole list
+                mbus_data_record_free(reply_data.data_var.record);
+            }
+
+            if (!more_frames)
+            {
+                mbus_transaction_finish(tr, 0);
+                return;
+            }
+
+            // allocate new frame and increment next_frame pointer
+            if ((tr->next_frame->next = mbus_frame_new(MBUS_FRAME_TYPE_ANY)) == NULL)
+            {
+                mbus_transaction_fail(tr, MBUS_ERROR_CODE_NOMEM, "Failed to allocate mbus frame.");
+                return;
+            }
+            tr->next_frame = (mbus_frame *)tr->next_frame->next;
+
+            // toogle FCB bit
+            tr->request_control ^= MBUS_CONTROL_MASK_FCB;
+            mbus_transaction_send_request(tr);
+            break;
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * @file   mbus-transaction.h
+ *
+ * @brief  Non-blocking M-Bus transactions for event loops.
+ *
+ * A transaction runs the same frame sequence as the blocking functions
+ * (mbus_sendrecv_request, mbus_select_secondary_address, mbus_purge_frames)
+ * but never waits itself. The caller polls the handle fd as requested by
+ * want_read/want_write, calls mbus_transaction_on_timeout when timeout_at
+ * has passed and checks done after every step. All times are milliseconds
+ * of a monotonic clock chosen by the caller. The fd has to be non-blocking.
+ */
+
+#ifndef MBUS_TRANSACTION_H
+#define MBUS_TRANSACTION_H
+
+#include "mbus-protocol.h"
+#include "mbus-protocol-aux.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//
+// Transaction types
+//
+#define MBUS_TRANSACTION_REQUEST 0 /**< select/ping the slave and request its (multi-telegram) data */
+#define MBUS_TRANSACTION_SELECT  1 /**< select a secondary address, result is a MBUS_PROBE_* code */
+
+//
+// Transaction flags
+//
+#define MBUS_TRANSACTION_INIT_SLAVES 0x01 /**< send two SND_NKE to the network layer address first */
+
+typedef struct _mbus_transaction {
+
+    // state for the caller, updated by every step
+    int want_read;
+    int want_write;
+    uint64_t timeout_at;    /**< 0 when no timeout is pending */
+    int done;
+    int result;             /**< 0 on success, -1 on error (see error), MBUS_PROBE_* for selects */
+    char error[128];
+    int error_code;         /**< MBUS_ERROR_CODE_* of the error */
+    mbus_frame reply;       /**< reply chain of a request, owned by the transaction */
+
+    // internal state
+    mbus_handle *handle;
+    int type;
+    int flags;
+    char addr_str[17];
+    int max_frames;
+    int timeout;
+    uint64_t now;
+
+    int phase;
+    int init_cnt;
+    int address;
+    int retry;
+    int frame_cnt;
+    unsigned char request_control;
+    mbus_frame *next_frame;
+
+    unsigned char selection[MBUS_FRAME_DATA_LENGTH]; /**< readout selection records, sent before the request */
+    size_t selection_len;
+    int selection_sent;
+
+    unsigned char tx_buff[MBUS_FRAME_DATA_LENGTH + 10];
+    int tx_len;
+    int tx_pos;
+    int tx_address;
+
+    mbus_frame rx_frame;
+    int rx_echo_checked;
+    int purging;
+    int purge_after_ok;
+    int purge_cnt;
+
+} mbus_transaction;
+
+int  mbus_transaction_request(mbus_transaction *tr, mbus_handle *handle, const char *addr_str, int max_frames, int timeout, int flags);
+int  mbus_transaction_set_selection(mbus_transaction *tr, const unsigned char *records, size_t records_size);
+int  mbus_transaction_select(mbus_transaction *tr, mbus_handle *handle, const char *addr_str, int timeout);
+void mbus_transaction_free(mbus_transaction *tr);
+
+void mbus_transaction_start(mbus_transaction *tr, uint64_t now);
+void mbus_transaction_on_readable(mbus_transaction *tr, uint64_t now);
+void mbus_transaction_on_writable(mbus_transaction *tr, uint64_t now);
+void mbus_transaction_on_timeout(mbus_transaction *tr, uint64_t now);
+void mbus_transaction_cancel(mbus_transaction *tr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBUS_TRANSACTION_H */
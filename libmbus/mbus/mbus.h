@@ -37,6 +37,7 @@
 #include "mbus-protocol-aux.h"
 #include "mbus-tcp.h"
 #include "mbus-serial.h"
+#include "mbus-transaction.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,88 @@
+#include "bus-thread.h"
+
+BusThread::BusThread() : stopping(false), pending(0) {
+}
+
+BusThread::~BusThread() {
+    uv_sem_destroy(&wakeup);
+}
+
+void BusThread::Start() {
+    uv_sem_init(&wakeup, 0);
+    uv_async_init(Nan::GetCurrentEventLoop(), &async, OnAsync);
+    async.data = this;
+    // only keep the loop alive while workers are pending
+    uv_unref((uv_handle_t *)&async);
+    uv_thread_create(&thread, Run, this);
+}
+
+void BusThread::Stop() {
+    stopping = true;
+    uv_sem_post(&wakeup);
+    uv_thread_join(&thread);
+    uv_close((uv_handle_t *)&async, OnClose);
+}
+
+void BusThread::Queue(Nan::AsyncWorker *worker) {
+    Job *job = new Job;
+    job->worker = worker;
+
+    if (pending++ == 0) {
+        uv_ref((uv_handle_t *)&async);
+    }
+    submitted.Push(job);
+    uv_sem_post(&wakeup);
+}
+
+// Executed inside the bus thread.
+void BusThread::Run(void *arg) {
+    BusThread *self = (BusThread *)arg;
+
+    for (;;) {
+        uv_sem_wait(&self->wakeup);
+
+        Job *job = self->submitted.Take();
+        while (job) {
+            Job *next = job->next;
+            job->worker->Execute();
+            self->completed.Push(job);
+            uv_async_send(&self->async);
+            job = next;
+        }
+
+        if (self->stopping) {
+            break;
+        }
+    }
+}
+
+// Executed inside the main event loop.
+void BusThread::Complete() {
+    Job *job = completed.Take();
+
+    while (job) {
+        Job *next = job->next;
+        if (--pending == 0) {
+            uv_unref((uv_handle_t *)&async);
+        }
+        job->worker->WorkComplete();
+        job->worker->Destroy();
+        delete job;
+        job = next;
+    }
+}
+
+void BusThread::OnAsync(uv_async_t *handle) {
+    Nan::HandleScope scope;
+
+    ((BusThread *)handle->data)->Complete();
+}
+
+void BusThread::OnClose(uv_handle_t *handle) {
+    Nan::HandleScope scope;
+
+    BusThread *self = (BusThread *)handle->data;
+    // deliver completions that were posted after the last async callback
+    self->Complete();
+    delete self;
+}
@@ -0,0 +1,51 @@
+#ifndef BUSTHREAD_H
+#define BUSTHREAD_H
+
+#include <node.h>
+#include <uv.h>
+#include <nan.h>
+#include <atomic>
+#include "job-list.h"
+
+// Dedicated I/O thread of one bus. Workers are executed one after the other
+// on this thread instead of the libuv threadpool, so waiting for slow serial
+// or TCP replies never blocks fs/dns requests of the process. Completions are
+// posted back to the main event loop with an uv_async_t.
+class BusThread {
+public:
+    BusThread();
+
+    void Start();
+    // Executes all queued workers, then joins the thread. The object deletes
+    // itself once the async handle is closed, do not use it afterwards.
+    void Stop();
+
+    // Same contract as Nan::AsyncQueueWorker, must be called from the main thread
+    void Queue(Nan::AsyncWorker *worker);
+
+    // Number of queued or running workers whose callback was not yet called
+    int Pending() const { return pending; }
+
+private:
+    struct Job {
+        Nan::AsyncWorker *worker;
+        Job *next;
+    };
+
+    ~BusThread();
+
+    static void Run(void *arg);
+    static void OnAsync(uv_async_t *handle);
+    static void OnClose(uv_handle_t *handle);
+    void Complete();
+
+    uv_thread_t thread;
+    uv_sem_t wakeup;
+    uv_async_t async;
+    JobList<Job> submitted;
+    JobList<Job> completed;
+    std::atomic<bool> stopping;
+    int pending;
+};
+
+#endif
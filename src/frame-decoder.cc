@@ -0,0 +1,219 @@
+#include "frame-decoder.h"
+#include "mbus-data.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace v8;
+
+// one archived reply of a batch
+struct DecodeItem {
+    const unsigned char *buff;
+    size_t len;
+    char *data;
+    FrameData frameData;
+    std::string error;
+};
+
+//------------------------------------------------------------------------------
+// Validate the frames of one reply in place and convert it like a received
+// reply. Variable data is decoded to objects directly from the Buffer, the
+// JSON/XML serializers of libmbus need a frame chain, so only for them the
+// frames are copied (not parsed again). Executed inside a worker thread (or
+// the main thread for the sync version).
+//------------------------------------------------------------------------------
+static void decode_item(DecodeItem *item, int format, int index)
+{
+    std::vector<mbus_frame_view> views;
+    mbus_frame_view view;
+    mbus_frame reply, *frame = &reply;
+    size_t pos = 0, size;
+    char addr_str[16];
+    char error[100];
+
+    item->data = NULL;
+    snprintf(addr_str, sizeof(addr_str), "%d", index);
+
+    if (item->len == 0)
+    {
+        sprintf(error, "Empty M-Bus frame buffer [%s].", addr_str);
+        item->error = error;
+        return;
+    }
+
+    while (pos < item->len)
+    {
+        if (mbus_frame_boundary(item->buff + pos, item->len - pos, &size) != 0)
+        {
+            sprintf(error, "Incomplete M-Bus frame at offset %d [%s].", (int)pos, addr_str);
+            item->error = error;
+            return;
+        }
+
+        if (mbus_frame_view_parse(&view, item->buff + pos, size) != 0)
+        {
+            sprintf(error, "Invalid M-Bus frame at offset %d [%s].", (int)pos, addr_str);
+            item->error = error;
+            return;
+        }
+        views.push_back(view);
+        pos += size;
+    }
+
+    if (format == RESULT_FORMAT_OBJECT && views[0].control_information == MBUS_CONTROL_INFO_RESP_VARIABLE)
+    {
+        if (!item->frameData.Parse(&views[0], views.size()))
+        {
+            sprintf(error, "Failed to decode MBUS frame [%s].", addr_str);
+            item->error = error;
+        }
+        return;
+    }
+
+    memset((void *)&reply, 0, sizeof(mbus_frame));
+
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        if (i > 0)
+        {
+            if ((frame->next = mbus_frame_new(MBUS_FRAME_TYPE_ANY)) == NULL)
+            {
+                sprintf(error, "Failed to allocate mbus frame.");
+                item->error = error;
+                break;
+            }
+            frame = (mbus_frame *)frame->next;
+        }
+        mbus_frame_view_to_frame(&views[i], frame);
+    }
+
+    if (item->error.empty() &&
+        format_reply(&reply, format, addr_str, &(item->data), &(item->frameData), error) != 0)
+    {
+        item->error = error;
+    }
+
+    // manual free
+    mbus_frame_free((mbus_frame*)reply.next);
+}
+
+static void decode_items(std::vector<DecodeItem> &items, int format)
+{
+    for (size_t i = 0; i < items.size(); i++) {
+        decode_item(&items[i], format, (int)i);
+    }
+}
+
+// the Buffers of the list, their memory is used in place
+static bool get_items(Local<Value> value, std::vector<DecodeItem> &items)
+{
+    if (!value->IsArray()) {
+        return false;
+    }
+
+    Local<Array> list = value.As<Array>();
+    items.resize(list->Length());
+    for (uint32_t i = 0; i < list->Length(); i++) {
+        Local<Value> buffer = Nan::Get(list, i).ToLocalChecked();
+
+        if (!node::Buffer::HasInstance(buffer)) {
+            return false;
+        }
+        items[i].buff = (const unsigned char *)node::Buffer::Data(buffer);
+        items[i].len = node::Buffer::Length(buffer);
+        items[i].data = NULL;
+    }
+    return true;
+}
+
+// results in the same shape as getMany: {data} or {error}
+static Local<Array> items_value(std::vector<DecodeItem> &items, int format)
+{
+    Nan::EscapableHandleScope scope;
+
+    Local<Array> list = Nan::New<Array>(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        DecodeItem &item = items[i];
+        Local<Object> entry = Nan::New<Object>();
+
+        if (item.error.empty()) {
+            Nan::Set(entry, Nan::New("data").ToLocalChecked(), reply_value(format, item.data, &(item.frameData)));
+            item.data = NULL;
+        } else {
+            Nan::Set(entry, Nan::New("error").ToLocalChecked(), Nan::New<String>(item.error).ToLocalChecked());
+        }
+        Nan::Set(list, i, entry);
+    }
+    return scope.Escape(list);
+}
+
+class DecodeWorker : public Nan::AsyncWorker {
+public:
+    DecodeWorker(Nan::Callback *callback, int format)
+    : Nan::AsyncWorker(callback), format(format) {}
+    ~DecodeWorker() {
+        for (size_t i = 0; i < items.size(); i++) {
+            free(items[i].data);
+        }
+    }
+
+    // Executed inside the worker thread.
+    // The Buffers are kept alive by the persistent handle.
+    void Execute () {
+        decode_items(items, format);
+    }
+
+    // Executed when the async work is complete
+    // this function will be run inside the main event loop
+    // so it is safe to use V8 again
+    void HandleOKCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Null(),
+            items_value(items, format)
+        };
+        callback->Call(2, argv);
+    };
+
+    std::vector<DecodeItem> items;
+private:
+    int format;
+};
+
+NAN_MODULE_INIT(FrameDecoder::Init) {
+    Nan::SetMethod(target, "decodeFrames", Decode);
+    Nan::SetMethod(target, "decodeFramesSync", DecodeSync);
+}
+
+NAN_METHOD(FrameDecoder::Decode) {
+    Nan::HandleScope scope;
+
+    int result_format = get_result_format(info[1]);
+    Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
+    DecodeWorker *worker = new DecodeWorker(callback, result_format);
+
+    if (!get_items(info[0], worker->items)) {
+        worker->items.clear();
+        delete worker;
+        return Nan::ThrowTypeError("Array of Buffers expected");
+    }
+
+    worker->SaveToPersistent("buffers", info[0]);
+    Nan::AsyncQueueWorker(worker);
+}
+
+NAN_METHOD(FrameDecoder::DecodeSync) {
+    Nan::HandleScope scope;
+
+    std::vector<DecodeItem> items;
+    int result_format = get_result_format(info[1]);
+
+    if (!get_items(info[0], items)) {
+        return Nan::ThrowTypeError("Array of Buffers expected");
+    }
+
+    decode_items(items, result_format);
+    info.GetReturnValue().Set(items_value(items, result_format));
+}
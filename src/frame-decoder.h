@@ -0,0 +1,20 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <node.h>
+#include <mbus.h>
+#include <uv.h>
+#include <nan.h>
+
+// Module functions to decode archived telegrams without an open bus. Every
+// Buffer holds one reply, i.e. one or more frames back to back.
+class FrameDecoder {
+public:
+    static NAN_MODULE_INIT(Init);
+
+private:
+    static NAN_METHOD(Decode);
+    static NAN_METHOD(DecodeSync);
+};
+
+#endif
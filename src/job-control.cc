@@ -0,0 +1,60 @@
+#include "job-control.h"
+
+JobControl::JobControl() : nextId(0), currentId(-1), current(NULL) {
+    uv_mutex_init(&lock);
+}
+
+JobControl::~JobControl() {
+    uv_mutex_destroy(&lock);
+}
+
+int JobControl::NextId() {
+    pending.insert(++nextId);
+    return nextId;
+}
+
+// unknown or already completed jobs are ignored
+void JobControl::Abort(int id) {
+    if (pending.count(id) == 0) {
+        return;
+    }
+    uv_mutex_lock(&lock);
+    aborted.insert(id);
+    uv_mutex_unlock(&lock);
+}
+
+// forget the state of a completed job
+void JobControl::Finish(int id) {
+    pending.erase(id);
+    uv_mutex_lock(&lock);
+    aborted.erase(id);
+    uv_mutex_unlock(&lock);
+}
+
+bool JobControl::Aborted(int id) {
+    bool result;
+
+    uv_mutex_lock(&lock);
+    result = aborted.count(id) > 0;
+    uv_mutex_unlock(&lock);
+    return result;
+}
+
+int JobControl::AbortCheck(mbus_handle *handle) {
+    JobControl *control = (JobControl *)handle->user_data;
+
+    if (control == NULL || control->currentId < 0) {
+        return 0;
+    }
+    return control->Aborted(control->currentId) ? 1 : 0;
+}
+
+JobControl::Active::Active(JobControl *control, int id, void *worker) : control(control) {
+    control->currentId = id;
+    control->current = worker;
+}
+
+JobControl::Active::~Active() {
+    control->currentId = -1;
+    control->current = NULL;
+}
@@ -0,0 +1,63 @@
+#ifndef JOBCONTROL_H
+#define JOBCONTROL_H
+
+#include <mbus.h>
+#include <uv.h>
+#include <set>
+#include <memory>
+
+// Per bus state shared by a MbusMaster and its workers. Every job gets an id
+// that can be aborted from the main thread; the running job polls its state
+// through the libmbus abort_check hook (handle->user_data points here).
+class JobControl {
+public:
+    JobControl();
+    ~JobControl();
+
+    // Executed inside the main event loop.
+    int NextId();
+    void Abort(int id);
+    void Finish(int id);
+
+    bool Aborted(int id);
+
+    // Worker that is currently executed by the bus thread (NULL when idle)
+    void *Current() { return current; }
+
+    // libmbus abort_check hook
+    static int AbortCheck(mbus_handle *handle);
+
+    // Marks a worker as running for the lifetime of the object (bus thread)
+    class Active {
+    public:
+        Active(JobControl *control, int id, void *worker);
+        ~Active();
+    private:
+        JobControl *control;
+    };
+
+private:
+    uv_mutex_t lock;
+    std::set<int> pending;
+    std::set<int> aborted;
+    int nextId;
+    int currentId;
+    void *current;
+};
+
+// Base of the workers that can be aborted
+class AbortableJob {
+public:
+    explicit AbortableJob(const std::shared_ptr<JobControl> &control) : control(control), id(control->NextId()) {}
+    virtual ~AbortableJob() { control->Finish(id); }
+
+    int Id() const { return id; }
+
+protected:
+    bool Aborted() { return control->Aborted(id); }
+
+    std::shared_ptr<JobControl> control;
+    int id;
+};
+
+#endif
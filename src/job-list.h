@@ -0,0 +1,37 @@
+#ifndef JOBLIST_H
+#define JOBLIST_H
+
+#include <atomic>
+#include <cstddef>
+
+// Lock-free list of intrusive jobs (T needs a `T *next` member). Push() may be
+// called from any thread, Take() returns all jobs in the order they were pushed.
+template <typename T>
+class JobList {
+public:
+    JobList() : head(NULL) {}
+
+    void Push(T *job) {
+        job->next = head.load();
+        while (!head.compare_exchange_weak(job->next, job)) {
+        }
+    }
+
+    T *Take() {
+        T *job = head.exchange(NULL);
+        T *fifo = NULL;
+
+        while (job) {
+            T *next = job->next;
+            job->next = fifo;
+            fifo = job;
+            job = next;
+        }
+        return fifo;
+    }
+
+private:
+    std::atomic<T*> head;
+};
+
+#endif
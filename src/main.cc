@@ -1,8 +1,10 @@
 #include <nan.h>
 #include "mbus-master.h"
+#include "frame-decoder.h"
 
 NAN_MODULE_INIT(InitModule) {
     MbusMaster::Init(target);
+    FrameDecoder::Init(target);
 }
 
 NODE_MODULE(mbus, InitModule)
@@ -0,0 +1,338 @@
+#include "mbus-data.h"
+#include "util.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace v8;
+
+FrameData::FrameData() {
+}
+
+void FrameData::AddString(Fields &fields, const char *key, const char *str) {
+    Field field;
+    field.key = key;
+    field.numeric = false;
+    field.number = 0;
+    field.str = str ? str : "";
+    fields.push_back(field);
+}
+
+void FrameData::AddNumber(Fields &fields, const char *key, double number) {
+    Field field;
+    field.key = key;
+    field.numeric = true;
+    field.number = number;
+    fields.push_back(field);
+}
+
+// same rule as the JSON output: plain decimal numbers become numbers
+void FrameData::AddValue(Fields &fields, const char *key, const char *str) {
+    double number;
+
+    if (mbus_str_to_number(str, &number)) {
+        AddNumber(fields, key, number);
+    } else {
+        AddString(fields, key, str);
+    }
+}
+
+void FrameData::ParseVariableHeader(mbus_data_variable_header *header) {
+    char str[32];
+    char lookup[256];
+
+    snprintf(str, sizeof(str), "%llX", mbus_data_bcd_decode_hex(header->id_bcd, 4));
+    AddValue(slave, "Id", str);
+    AddString(slave, "Manufacturer", mbus_decode_manufacturer_r(header->manufacturer[0], header->manufacturer[1], str, sizeof(str)));
+    AddNumber(slave, "Version", header->version);
+    AddString(slave, "ProductName", mbus_data_product_name(header));
+    AddString(slave, "Medium", mbus_data_variable_medium_lookup_r(header->medium, lookup, sizeof(lookup)));
+    AddNumber(slave, "AccessNumber", header->access_no);
+    snprintf(str, sizeof(str), "%.2X", header->status);
+    AddValue(slave, "Status", str);
+    snprintf(str, sizeof(str), "%.2X%.2X", header->signature[1], header->signature[0]);
+    AddValue(slave, "Signature", str);
+}
+
+void FrameData::ParseVariableRecord(mbus_data_record *record, int record_cnt, int frame_cnt) {
+    Fields fields;
+    struct tm timeinfo;
+    char timestamp[22];
+    char buff[768];
+    long tariff;
+
+    AddNumber(fields, "id", record_cnt);
+    if (frame_cnt >= 0) {
+        AddNumber(fields, "frame", frame_cnt);
+    }
+
+    if (record->drh.dib.dif == MBUS_DIB_DIF_MANUFACTURER_SPECIFIC) {
+        AddString(fields, "Function", "Manufacturer specific");
+    }
+    else if (record->drh.dib.dif == MBUS_DIB_DIF_MORE_RECORDS_FOLLOW) {
+        AddString(fields, "Function", "More records follow");
+    }
+    else {
+        AddString(fields, "Function", mbus_data_record_function_r(record, buff, sizeof(buff)));
+        AddNumber(fields, "StorageNumber", mbus_data_record_storage_number(record));
+
+        if ((tariff = mbus_data_record_tariff(record)) >= 0) {
+            AddNumber(fields, "Tariff", tariff);
+            AddNumber(fields, "Device", mbus_data_record_device(record));
+        }
+
+        AddString(fields, "Unit", mbus_data_record_unit_r(record, buff, sizeof(buff)));
+    }
+
+    AddValue(fields, "Value", mbus_data_record_value_r(record, buff, sizeof(buff)));
+
+    if (record->timestamp > 0) {
+#ifdef _WIN32
+        gmtime_s(&timeinfo, &(record->timestamp));
+#else
+        gmtime_r(&(record->timestamp), &timeinfo);
+#endif
+        strftime(timestamp, 21, "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+        AddString(fields, "Timestamp", timestamp);
+    }
+
+    records.push_back(fields);
+}
+
+void FrameData::ParseFixed(mbus_data_fixed *data) {
+    unsigned char *values[2] = { data->cnt1_val, data->cnt2_val };
+    int types[2] = { data->cnt1_type, data->cnt2_type };
+    char str[32];
+    char lookup[256];
+    int val;
+
+    snprintf(str, sizeof(str), "%llX", mbus_data_bcd_decode_hex(data->id_bcd, 4));
+    AddValue(slave, "Id", str);
+    AddString(slave, "Medium", mbus_data_fixed_medium_r(data, lookup, sizeof(lookup)));
+    AddNumber(slave, "AccessNumber", data->tx_cnt);
+    snprintf(str, sizeof(str), "%.2X", data->status);
+    AddValue(slave, "Status", str);
+
+    for (int i = 0; i < 2; i++) {
+        Fields fields;
+
+        AddNumber(fields, "id", i);
+        AddString(fields, "Function", mbus_data_fixed_function_r(data->status, lookup, sizeof(lookup)));
+        AddString(fields, "Unit", mbus_data_fixed_unit_r(types[i], lookup, sizeof(lookup)));
+
+        if ((data->status & MBUS_DATA_FIXED_STATUS_FORMAT_MASK) == MBUS_DATA_FIXED_STATUS_FORMAT_BCD) {
+            snprintf(str, sizeof(str), "%llX", mbus_data_bcd_decode_hex(values[i], 4));
+        } else {
+            mbus_data_int_decode(values[i], 4, &val);
+            snprintf(str, sizeof(str), "%d", val);
+        }
+        AddValue(fields, "Value", str);
+
+        records.push_back(fields);
+    }
+}
+
+// Decode the reply chain (executed inside the worker thread)
+bool FrameData::Parse(mbus_frame *frame) {
+    mbus_frame_data frame_data;
+    mbus_data_record *record;
+    mbus_frame *iter;
+    int record_cnt = 0, frame_cnt;
+    char lookup[256];
+
+    slave.clear();
+    records.clear();
+
+    memset((void *)&frame_data, 0, sizeof(mbus_frame_data));
+
+    if (mbus_frame_data_parse(frame, &frame_data) == -1) {
+        return false;
+    }
+
+    if (frame_data.type == MBUS_DATA_TYPE_ERROR) {
+        AddString(slave, "Error", mbus_data_error_lookup_r(frame_data.error, lookup, sizeof(lookup)));
+        return true;
+    }
+
+    if (frame_data.type == MBUS_DATA_TYPE_FIXED) {
+        ParseFixed(&(frame_data.data_fix));
+        return true;
+    }
+
+    // include frame counter if more than one frame is available
+    frame_cnt = (frame->next == NULL) ? -1 : 0;
+
+    ParseVariableHeader(&(frame_data.data_var.header));
+
+    for (iter = frame; ; frame_cnt++) {
+        for (record = frame_data.data_var.record; record; record = (mbus_data_record *)record->next, record_cnt++) {
+            ParseVariableRecord(record, record_cnt, frame_cnt);
+        }
+
+        if (frame_data.data_var.record) {
+            mbus_data_record_free(frame_data.data_var.record);
+            frame_data.data_var.record = NULL;
+        }
+
+        if ((iter = (mbus_frame *)iter->next) == NULL) {
+            break;
+        }
+
+        if (mbus_frame_data_parse(iter, &frame_data) == -1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decode the variable data of the frames of a reply in place, the records
+// refer to the buffer of the views (executed inside the worker thread)
+bool FrameData::Parse(const mbus_frame_view *views, size_t count) {
+    mbus_data_variable_header header;
+    mbus_record_view view;
+    mbus_data_record record;
+    int record_cnt = 0, frame_cnt, ret;
+    size_t pos;
+
+    slave.clear();
+    records.clear();
+
+    for (size_t i = 0; i < count; i++) {
+        const mbus_frame_view *frame = &views[i];
+
+        // include frame counter if more than one frame is available
+        frame_cnt = (count == 1) ? -1 : (int)i;
+
+        if ((frame->control & MBUS_CONTROL_MASK_DIR) != MBUS_CONTROL_MASK_DIR_S2M) {
+            return false;
+        }
+
+        // like mbus_frame_data_parse, error and fixed data frames following
+        // the first frame have no records
+        if (i > 0 &&
+            (frame->control_information == MBUS_CONTROL_INFO_ERROR_GENERAL ||
+             (frame->control_information == MBUS_CONTROL_INFO_RESP_FIXED && frame->data_size > 0))) {
+            continue;
+        }
+
+        if (mbus_frame_view_variable_header(frame, &header) != 0) {
+            return false;
+        }
+
+        if (i == 0) {
+            ParseVariableHeader(&header);
+        }
+
+        pos = MBUS_DATA_VARIABLE_HEADER_LENGTH;
+        while ((ret = mbus_frame_view_next_record(frame, &pos, &view)) == 1) {
+            memset((void *)&record, 0, sizeof(mbus_data_record));
+            if (mbus_record_view_to_record(&view, &record) != 0) {
+                return false;
+            }
+            ParseVariableRecord(&record, record_cnt++, frame_cnt);
+        }
+        if (ret != 0) {
+            return false;
+        }
+    }
+    return count > 0;
+}
+
+Local<Object> FrameData::FieldsToObject(const Fields &fields) {
+    Nan::EscapableHandleScope scope;
+
+    Local<Object> object = Nan::New<Object>();
+    for (size_t i = 0; i < fields.size(); i++) {
+        const Field &field = fields[i];
+        if (field.numeric) {
+            Nan::Set(object, Nan::New(field.key).ToLocalChecked(), Nan::New<Number>(field.number));
+        } else {
+            // libmbus strings are ISO-8859-1 encoded (e.g. 0xB0 for degree)
+            Nan::Set(object, Nan::New(field.key).ToLocalChecked(),
+                Nan::NewOneByteString((const uint8_t *)field.str.c_str(), field.str.length()).ToLocalChecked());
+        }
+    }
+    return scope.Escape(object);
+}
+
+// Build the result object (executed inside the main event loop)
+Local<Object> FrameData::ToObject() {
+    Nan::EscapableHandleScope scope;
+
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New("SlaveInformation").ToLocalChecked(), FieldsToObject(slave));
+
+    if (!records.empty()) {
+        Local<Array> list = Nan::New<Array>(records.size());
+        for (size_t i = 0; i < records.size(); i++) {
+            Nan::Set(list, i, FieldsToObject(records[i]));
+        }
+        Nan::Set(result, Nan::New("DataRecord").ToLocalChecked(), list);
+    }
+    return scope.Escape(result);
+}
+
+//------------------------------------------------------------------------------
+// Convert the reply chain into the requested result format. For objects only
+// plain C++ data is created, the objects are built in the main event loop.
+//------------------------------------------------------------------------------
+int format_reply(mbus_frame *reply, int format, const char *addr_str, char **data, FrameData *frameData, char *error)
+{
+    if (format == RESULT_FORMAT_OBJECT)
+    {
+        if (!frameData->Parse(reply))
+        {
+            sprintf(error, "Failed to decode MBUS frame [%s].", addr_str);
+            return -1;
+        }
+        return 0;
+    }
+
+    //
+    // generate JSON (or XML for legacy consumers)
+    //
+    if (format == RESULT_FORMAT_XML)
+    {
+        *data = mbus_frame_xml(reply);
+    }
+    else
+    {
+        *data = mbus_frame_json(reply);
+    }
+
+    if (*data == NULL)
+    {
+        sprintf(error, "Failed to generate %s representation of MBUS frame [%s].", format == RESULT_FORMAT_XML ? "XML" : "JSON", addr_str);
+        return -1;
+    }
+
+    return 0;
+}
+
+// create the JS value of a successfully formatted reply (frees data)
+Local<Value> reply_value(int format, char *data, FrameData *frameData)
+{
+    Nan::EscapableHandleScope scope;
+
+    Local<Value> result;
+    if (format == RESULT_FORMAT_OBJECT) {
+        result = frameData->ToObject();
+    } else {
+        result = Nan::New<String>(data).ToLocalChecked();
+        free(data);
+    }
+    return scope.Escape(result);
+}
+
+int get_result_format(Local<Value> value)
+{
+    char *format = get(value, "json");
+    int result_format = RESULT_FORMAT_JSON;
+
+    if (strcmp(format, "xml") == 0) {
+        result_format = RESULT_FORMAT_XML;
+    } else if (strcmp(format, "object") == 0) {
+        result_format = RESULT_FORMAT_OBJECT;
+    }
+    free(format);
+    return result_format;
+}
@@ -0,0 +1,53 @@
+#ifndef MBUSDATA_H
+#define MBUSDATA_H
+
+#include <node.h>
+#include <mbus.h>
+#include <nan.h>
+#include <string>
+#include <vector>
+
+// Decoded content of a (multi-telegram) reply. Parse() runs in the worker
+// thread and only uses plain C++ data, ToObject() builds the same object
+// shape as the JSON/XML output (SlaveInformation, DataRecord[]) and must be
+// called from the main thread.
+class FrameData {
+public:
+    struct Field {
+        const char *key;
+        bool numeric;
+        double number;
+        std::string str;
+    };
+    typedef std::vector<Field> Fields;
+
+    FrameData();
+
+    bool Parse(mbus_frame *frame);
+    bool Parse(const mbus_frame_view *views, size_t count);
+    v8::Local<v8::Object> ToObject();
+
+    Fields slave;
+    std::vector<Fields> records;
+
+private:
+    void ParseVariableHeader(mbus_data_variable_header *header);
+    void ParseVariableRecord(mbus_data_record *record, int record_cnt, int frame_cnt);
+    void ParseFixed(mbus_data_fixed *data);
+
+    static void AddString(Fields &fields, const char *key, const char *str);
+    static void AddNumber(Fields &fields, const char *key, double number);
+    static void AddValue(Fields &fields, const char *key, const char *str);
+    static v8::Local<v8::Object> FieldsToObject(const Fields &fields);
+};
+
+// result formats of the decoded data
+#define RESULT_FORMAT_JSON   0
+#define RESULT_FORMAT_XML    1
+#define RESULT_FORMAT_OBJECT 2
+
+int format_reply(mbus_frame *reply, int format, const char *addr_str, char **data, FrameData *frameData, char *error);
+v8::Local<v8::Value> reply_value(int format, char *data, FrameData *frameData);
+int get_result_format(v8::Local<v8::Value> value);
+
+#endif
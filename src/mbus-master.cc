@@ -1,14 +1,20 @@
 #include "mbus-master.h"
+#include "mbus-data.h"
+#include "bus-thread.h"
+#include "readout-job.h"
+#include "job-control.h"
 #include "util.h"
 
 #ifdef _WIN32
 #define __PRETTY_FUNCTION__ __FUNCSIG__
 #else
 #include <unistd.h>
+#include <fcntl.h>
 #endif
 
 #define MBUS_ERROR(...) fprintf (stderr, __VA_ARGS__)
 #define MAXFRAMES 16
+#define ABORT_MESSAGE "Aborted."
 
 using namespace v8;
 
@@ -17,12 +23,18 @@ Nan::Persistent<v8::Function> MbusMaster::constructor;
 MbusMaster::MbusMaster() {
     connected = false;
     serial = true;
-    communicationInProgress = false;
     handle = NULL;
-    uv_rwlock_init(&queueLock);
+    busThread = NULL;
+    reactor = false;
+    timeout = 0;
+    control = std::make_shared<JobControl>();
 }
 
 MbusMaster::~MbusMaster(){
+    if(busThread) {
+        busThread->Stop();
+        busThread = NULL;
+    }
     if(connected && handle) {
         mbus_disconnect(handle);
     }
@@ -30,7 +42,6 @@ MbusMaster::~MbusMaster(){
         mbus_context_free(handle);
         handle = NULL;
     }
-    uv_rwlock_destroy(&queueLock);
 }
 
 NAN_MODULE_INIT(MbusMaster::Init) {
@@ -50,8 +61,14 @@ NAN_MODULE_INIT(MbusMaster::Init) {
     Nan::SetPrototypeMethod(tpl, "openTCP", OpenTCP);
     Nan::SetPrototypeMethod(tpl, "close", Close);
     Nan::SetPrototypeMethod(tpl, "get", Get);
+    Nan::SetPrototypeMethod(tpl, "getMany", GetMany);
+    Nan::SetPrototypeMethod(tpl, "getStream", GetStream);
+    Nan::SetPrototypeMethod(tpl, "getRaw", GetRaw);
     Nan::SetPrototypeMethod(tpl, "scan", ScanSecondary);
     Nan::SetPrototypeMethod(tpl, "setPrimaryId", SetPrimaryId);
+    Nan::SetPrototypeMethod(tpl, "abort", Abort);
+    Nan::SetPrototypeMethod(tpl, "setAdaptiveTimeout", SetAdaptiveTimeout);
+    Nan::SetPrototypeMethod(tpl, "setPurgePolicy", SetPurgePolicy);
 
     v8::Local<v8::Function> function = Nan::GetFunction(tpl).ToLocalChecked();
     constructor.Reset(function);
@@ -81,6 +98,7 @@ NAN_METHOD(MbusMaster::OpenTCP) {
     int port = (long)Nan::To<int64_t>(info[1]).FromJust();
     char *host = get(Nan::To<v8::String>(info[0]).ToLocalChecked(), "127.0.0.1");
     double timeout = (double)Nan::To<double>(info[2]).FromJust();
+    double connectTimeout = Nan::To<double>(info[4]).FromMaybe(0.0);
 
     if(!obj->connected) {
         obj->serial = false;
@@ -98,7 +116,10 @@ NAN_METHOD(MbusMaster::OpenTCP) {
         free(host);
 
         if (timeout > 0.0) {
-            mbus_tcp_set_timeout_set(timeout);
+            mbus_tcp_set_timeout(obj->handle, timeout);
+        }
+        if (connectTimeout > 0.0) {
+            mbus_tcp_set_connect_timeout(obj->handle, connectTimeout);
         }
 
         if (mbus_connect(obj->handle) == -1)
@@ -109,7 +130,20 @@ NAN_METHOD(MbusMaster::OpenTCP) {
             return;
         }
         obj->connected = true;
-        obj->communicationInProgress = false;
+        obj->RegisterControl();
+
+#ifdef __linux__
+        // the reactor waits with epoll instead of blocking socket timeouts
+        obj->reactor = Nan::To<bool>(info[3]).FromMaybe(false) && Reactor::Get() != NULL;
+        if (obj->reactor) {
+            obj->timeout = timeout > 0.0 ? (int)(timeout * 1000) : 4000;
+            fcntl(obj->handle->fd, F_SETFL, fcntl(obj->handle->fd, F_GETFL) | O_NONBLOCK);
+            info.GetReturnValue().Set(Nan::True());
+            return;
+        }
+#endif
+        obj->busThread = new BusThread();
+        obj->busThread->Start();
         info.GetReturnValue().Set(Nan::True());
         return;
     }
@@ -124,6 +158,10 @@ NAN_METHOD(MbusMaster::OpenSerial) {
     long boudrate;
     int _boudrate = (int)Nan::To<int64_t>(info[1]).FromJust();
     char *port = get(Nan::To<v8::String>(info[0]).ToLocalChecked(), "/dev/ttyS0");
+    // receive timing in ms, -1 derives it from the baud rate
+    int firstByteTimeout = Nan::To<int>(info[2]).FromMaybe(-1);
+    int interByteTimeout = Nan::To<int>(info[3]).FromMaybe(-1);
+    int turnaroundTime = Nan::To<int>(info[4]).FromMaybe(-1);
 
     switch(_boudrate) {
     case 300:
@@ -155,7 +193,6 @@ NAN_METHOD(MbusMaster::OpenSerial) {
         break;
     }
 
-    obj->communicationInProgress = false;
     if(!obj->connected) {
         obj->serial = true;
 
@@ -165,92 +202,836 @@ NAN_METHOD(MbusMaster::OpenSerial) {
             info.GetReturnValue().Set(Nan::False());
             return;
         }
-        free(port);
+        free(port);
+
+        if (mbus_connect(obj->handle) == -1)
+        {
+            mbus_context_free(obj->handle);
+            obj->handle = NULL;
+            info.GetReturnValue().Set(Nan::False());
+            return;
+        }
+
+        if (mbus_serial_set_baudrate(obj->handle, boudrate) == -1 ||
+            mbus_serial_set_timeouts(obj->handle, firstByteTimeout, interByteTimeout, turnaroundTime) == -1)
+        {
+            mbus_disconnect(obj->handle);
+            mbus_context_free(obj->handle);
+            obj->handle = NULL;
+            info.GetReturnValue().Set(Nan::False());
+            return;
+        }
+
+        obj->connected = true;
+        obj->RegisterControl();
+        obj->busThread = new BusThread();
+        obj->busThread->Start();
+        info.GetReturnValue().Set(Nan::True());
+        return;
+    }
+    info.GetReturnValue().Set(Nan::False());
+}
+
+NAN_METHOD(MbusMaster::Close) {
+    Nan::HandleScope scope;
+
+    MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
+
+    if(obj->PendingJobs() > 0) {
+        info.GetReturnValue().Set(Nan::False());
+        return;
+    }
+
+    if(obj->connected) {
+        if(obj->busThread) {
+            obj->busThread->Stop();
+            obj->busThread = NULL;
+        }
+        obj->reactor = false;
+        mbus_disconnect(obj->handle);
+        mbus_context_free(obj->handle);
+        obj->handle = NULL;
+        obj->connected = false;
+        info.GetReturnValue().Set(Nan::True());
+    }
+    else {
+        info.GetReturnValue().Set(Nan::False());
+    }
+}
+
+NAN_METHOD(MbusMaster::Abort) {
+    Nan::HandleScope scope;
+
+    MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
+
+    obj->control->Abort(Nan::To<int>(info[0]).FromJust());
+}
+
+// bounds in ms of the response timeouts learned per address, a ceiling of 0
+// disables them; only called without pending jobs
+NAN_METHOD(MbusMaster::SetAdaptiveTimeout) {
+    Nan::HandleScope scope;
+
+    MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
+    long floor = (long)Nan::To<int64_t>(info[0]).FromMaybe(0);
+    long ceiling = (long)Nan::To<int64_t>(info[1]).FromMaybe(0);
+
+    if (!obj->connected || obj->PendingJobs() > 0 ||
+        mbus_context_set_option(obj->handle, MBUS_OPTION_TIMEOUT_FLOOR, floor) == -1 ||
+        mbus_context_set_option(obj->handle, MBUS_OPTION_TIMEOUT_CEILING, ceiling) == -1) {
+        info.GetReturnValue().Set(Nan::False());
+        return;
+    }
+    info.GetReturnValue().Set(Nan::True());
+}
+
+// MBUS_PURGE_POLICY_* and the silence window in ms of the fast policies (-1
+// derives it from the baud rate); only called without pending jobs
+NAN_METHOD(MbusMaster::SetPurgePolicy) {
+    Nan::HandleScope scope;
+
+    MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
+    long policy = (long)Nan::To<int64_t>(info[0]).FromMaybe(MBUS_PURGE_POLICY_FULL);
+    long window = (long)Nan::To<int64_t>(info[1]).FromMaybe(-1);
+
+    if (!obj->connected || obj->PendingJobs() > 0 ||
+        mbus_context_set_option(obj->handle, MBUS_OPTION_PURGE_POLICY, policy) == -1 ||
+        mbus_context_set_option(obj->handle, MBUS_OPTION_PURGE_WINDOW, window) == -1) {
+        info.GetReturnValue().Set(Nan::False());
+        return;
+    }
+    info.GetReturnValue().Set(Nan::True());
+}
+
+// let the abortable workers interrupt libmbus between frames and probes
+void MbusMaster::RegisterControl() {
+    handle->user_data = control.get();
+    mbus_register_abort_check(handle, JobControl::AbortCheck);
+}
+
+int MbusMaster::PendingJobs() {
+    if(reactor) {
+        return Reactor::Get()->Pending(handle->fd);
+    }
+    return busThread ? busThread->Pending() : 0;
+}
+
+// reset the devices on first contact and after errors, the link layer
+// session of the handle keeps them initialized between the jobs
+static int init_slaves(mbus_handle *handle)
+{
+    if (mbus_slave_session(handle, MBUS_ADDRESS_NETWORK_LAYER) != -1)
+    {
+        return 1;
+    }
+
+    if (mbus_send_ping_frame(handle, MBUS_ADDRESS_NETWORK_LAYER, 1) == -1)
+    {
+        return 0;
+    }
+
+    if (mbus_send_ping_frame(handle, MBUS_ADDRESS_NETWORK_LAYER, 1) == -1)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// Select the slave (primary or secondary address) and request its data, the
+// optional selection records restrict the reply to the selected records. The
+// reply chain has to be freed by the caller also in the error case.
+//------------------------------------------------------------------------------
+static int request_slave_data(mbus_handle *handle, const char *addr_str, int max_frames, mbus_frame *reply, char *error, const std::string &selection = std::string())
+{
+    int address;
+
+    if (mbus_is_secondary_address(addr_str))
+    {
+        // secondary addressing
+
+        int ret;
+
+        ret = mbus_select_secondary_address(handle, addr_str);
+
+        if (ret != MBUS_PROBE_SINGLE)
+        {
+            // reset the devices before the next select
+            mbus_slave_session_reset(handle, MBUS_ADDRESS_NETWORK_LAYER);
+        }
+
+        if (ret == MBUS_PROBE_COLLISION)
+        {
+            sprintf(error, "The address mask [%s] matches more than one device.", addr_str);
+            return -1;
+        }
+        else if (ret == MBUS_PROBE_NOTHING)
+        {
+            sprintf(error, "The selected secondary address does not match any device [%s].", addr_str);
+            return -1;
+        }
+        else if (ret == MBUS_PROBE_ERROR)
+        {
+            sprintf(error, "Failed to select secondary address [%s].", addr_str);
+            return -1;
+        }
+
+        address = MBUS_ADDRESS_NETWORK_LAYER;
+    }
+    else
+    {
+        // primary addressing
+        address = atoi(addr_str);
+
+        // send a reset SND_NKE to the device before requesting data
+        // this does not make sense for devices that are accessed by secondary addressing
+        // as the reset de-selects the device
+        // taken from https://github.com/rscada/libmbus/pull/95
+        // it is only needed on first contact and after errors, otherwise the
+        // FCB of the session continues
+        if (mbus_slave_session(handle, address) == -1 &&
+            mbus_send_ping_frame(handle, address, 1) == -1)
+        {
+            sprintf(error, "Failed to initialize slave[%s].", addr_str);
+            return -1;
+        }
+    }
+
+    if (!selection.empty() &&
+        mbus_send_readout_selection(handle, address, (const unsigned char *)selection.data(), selection.size()) != 0)
+    {
+        sprintf(error, "Failed to send readout selection[%s].", addr_str);
+        return -1;
+    }
+
+    // instead of the send and recv, use this sendrecv function that
+    // takes care of the possibility of multi-telegram replies (limit = 16 frames)
+    if (mbus_sendrecv_request(handle, address, reply, max_frames) != 0)
+    {
+        sprintf(error, "Failed to send/receive M-Bus request frame[%s].", addr_str);
+        return -1;
+    }
+
+    return 0;
+}
+
+class RecieveWorker : public Nan::AsyncWorker, public AbortableJob {
+public:
+    RecieveWorker(Nan::Callback *callback,char *addr_str, mbus_handle *handle, int max_frames, int format, const std::string &selection, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncWorker(callback), AbortableJob(control), data(NULL), addr_str(addr_str), max_frames(max_frames), format(format), selection(selection), handle(handle) {}
+    ~RecieveWorker() {
+        free(addr_str);
+    }
+
+    // Executed inside the bus thread.
+    // It is not safe to access V8, or V8 data structures
+    // here, so everything we need for input and output
+    // should go on `this`.
+    void Execute () {
+        JobControl::Active active(control.get(), id, this);
+        mbus_frame reply;
+        char error[100];
+
+        if (Aborted()) {
+            SetErrorMessage(ABORT_MESSAGE);
+            return;
+        }
+
+        memset((void *)&reply, 0, sizeof(mbus_frame));
+
+        if (init_slaves(handle) == 0)
+        {
+            sprintf(error, "Failed to init slaves.");
+            SetErrorMessage(error);
+            return;
+        }
+
+        if (request_slave_data(handle, addr_str, max_frames, &reply, error, selection) != 0 ||
+            format_reply(&reply, format, addr_str, &data, &frameData, error) != 0)
+        {
+            SetErrorMessage(Aborted() ? ABORT_MESSAGE : error);
+        }
+
+        // manual free
+        mbus_frame_free((mbus_frame*)reply.next);
+    }
+
+    // Executed when the async work is complete
+    // this function will be run inside the main event loop
+    // so it is safe to use V8 again
+    void HandleOKCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Null(),
+            reply_value(format, data, &frameData)
+        };
+        callback->Call(2, argv);
+    };
+
+    void HandleErrorCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Error(ErrorMessage())
+        };
+
+        callback->Call(1, argv);
+    }
+private:
+    char *data;
+    FrameData frameData;
+    char *addr_str;
+    int max_frames;
+    int format;
+    std::string selection;
+    mbus_handle *handle;
+};
+
+#ifdef __linux__
+// getData in reactor mode, the reactor drives the ReadoutJob part
+class ReactorRecieveWorker : public Nan::AsyncWorker, public ReadoutJob, public AbortableJob {
+public:
+    ReactorRecieveWorker(Nan::Callback *callback, char *addr_str, mbus_handle *handle, int max_frames, int timeout, int format, const std::string &selection, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncWorker(callback), ReadoutJob(handle, addr_str, max_frames, timeout, this), AbortableJob(control), format(format), data(NULL) {
+        free(addr_str);
+        Select(selection);
+    }
+
+    // not used, the job is executed by the reactor
+    void Execute () {
+    }
+
+    // Executed inside the reactor thread when the readout has finished.
+    void Done () {
+        char error[100];
+
+        if (Aborted()) {
+            SetErrorMessage(ABORT_MESSAGE);
+            return;
+        }
+
+        if (!ReadoutJob::error.empty()) {
+            SetErrorMessage(ReadoutJob::error.c_str());
+            return;
+        }
+
+        if (format_reply(Reply(), format, addr_str.c_str(), &data, &frameData, error) != 0) {
+            SetErrorMessage(error);
+        }
+    }
+
+    // Executed when the async work is complete
+    // this function will be run inside the main event loop
+    // so it is safe to use V8 again
+    void HandleOKCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Null(),
+            reply_value(format, data, &frameData)
+        };
+        callback->Call(2, argv);
+    };
+
+    void HandleErrorCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Error(ErrorMessage())
+        };
+
+        callback->Call(1, argv);
+    }
+private:
+    // Executed inside the reactor thread before each request frame.
+    bool AbortRequested () {
+        return Aborted();
+    }
+
+    int format;
+    char *data;
+    FrameData frameData;
+};
+#endif
+
+NAN_METHOD(MbusMaster::Get) {
+    Nan::HandleScope scope;
+
+    MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
+
+    char *address = get(Nan::To<v8::String>(info[0]).ToLocalChecked(),"0");
+    int max_frames = (int)Nan::To<int64_t>(info[1]).FromJust();
+    int result_format = get_result_format(info[2]);
+    Nan::Callback *callback = new Nan::Callback(info[3].As<Function>());
+    std::string selection;
+
+    // readout selection: DIF/VIF records, a storage number and/or the
+    // global readout, a plain request sends no selection at all
+    if (node::Buffer::HasInstance(info[4])) {
+        selection.assign(node::Buffer::Data(info[4]), node::Buffer::Length(info[4]));
+    }
+    if (info[5]->IsNumber() && Nan::To<int64_t>(info[5]).FromJust() >= 0) {
+        unsigned char record[12];
+        int len = mbus_readout_selection_storage(record, sizeof(record), (long)Nan::To<int64_t>(info[5]).FromJust());
+
+        if (len > 0) {
+            selection.append((const char *)record, len);
+        }
+    }
+    if (Nan::To<bool>(info[6]).FromMaybe(false)) {
+        selection.push_back((char)MBUS_DIB_DIF_GLOBAL_READOUT);
+    }
+    if (selection.size() > MBUS_FRAME_DATA_LENGTH) {
+        Local<Value> argv[] = {
+            Nan::Error("Readout selection too long")
+        };
+        free(address);
+        callback->Call(1, argv);
+        delete callback;
+        return;
+    }
+
+    char num_char[10 + sizeof(char)];
+    std::sprintf(num_char, "%d", max_frames);
+    MBUS_ERROR("[INFO] Max frames = %s \n", num_char);
+
+    if(obj->connected && obj->reactor) {
+#ifdef __linux__
+        ReactorRecieveWorker *worker = new ReactorRecieveWorker(callback, address, obj->handle, max_frames, obj->timeout, result_format, selection, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        Reactor::Get()->Queue(worker);
+#endif
+    } else if(obj->connected) {
+        RecieveWorker *worker = new RecieveWorker(callback, address, obj->handle, max_frames, result_format, selection, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        obj->busThread->Queue(worker);
+    } else {
+        Local<Value> argv[] = {
+            Nan::Error("Not connected to port")
+        };
+        callback->Call(1, argv);
+    }
+}
+
+// result of one slave of a RecieveManyWorker
+struct SlaveResult {
+    char *addr_str;
+    char *data;
+    FrameData frameData;
+    std::string error;
+};
+
+class RecieveManyWorker : public Nan::AsyncProgressQueueWorker<int>, public AbortableJob {
+public:
+    RecieveManyWorker(Nan::Callback *callback, Nan::Callback *onResult, std::vector<char*> &addresses, mbus_handle *handle, int max_frames, int format, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncProgressQueueWorker<int>(callback), AbortableJob(control), onResult(onResult), results(addresses.size()), handle(handle), max_frames(max_frames), format(format) {
+        for (size_t i = 0; i < addresses.size(); i++) {
+            results[i].addr_str = addresses[i];
+            results[i].data = NULL;
+        }
+    }
+    ~RecieveManyWorker() {
+        for (size_t i = 0; i < results.size(); i++) {
+            free(results[i].addr_str);
+            free(results[i].data);
+        }
+        delete onResult;
+    }
+
+    // Executed inside the bus thread.
+    // All slaves are read one after the other in this single job, the
+    // results are only written to the preallocated entry of the slave.
+    void Execute (const ExecutionProgress& progress) {
+        JobControl::Active active(control.get(), id, this);
+        char error[100];
+
+        if (init_slaves(handle) == 0)
+        {
+            sprintf(error, "Failed to init slaves.");
+            SetErrorMessage(error);
+            return;
+        }
+
+        for (int i = 0; i < (int)results.size(); i++)
+        {
+            SlaveResult &result = results[i];
+            mbus_frame reply;
+
+            if (Aborted()) {
+                SetErrorMessage(ABORT_MESSAGE);
+                return;
+            }
+
+            memset((void *)&reply, 0, sizeof(mbus_frame));
+
+            if (request_slave_data(handle, result.addr_str, max_frames, &reply, error) != 0 ||
+                format_reply(&reply, format, result.addr_str, &(result.data), &(result.frameData), error) != 0)
+            {
+                result.error = Aborted() ? ABORT_MESSAGE : error;
+            }
+
+            // manual free
+            mbus_frame_free((mbus_frame*)reply.next);
+
+            if (onResult) {
+                progress.Send(&i, 1);
+            }
+        }
+    }
+
+    // Executed inside the main event loop for every finished slave
+    void HandleProgressCallback (const int *index, size_t count) {
+        Nan::HandleScope scope;
+
+        for (size_t i = 0; i < count; i++) {
+            SlaveResult &result = results[index[i]];
+
+            Local<Value> argv[] = {
+                Nan::Null(),
+                Nan::New<String>(result.addr_str).ToLocalChecked(),
+                Nan::Undefined()
+            };
+            if (result.error.empty()) {
+                argv[2] = reply_value(format, result.data, &(result.frameData));
+                result.data = NULL;
+            } else {
+                argv[0] = Nan::Error(result.error.c_str());
+            }
+            onResult->Call(3, argv);
+        }
+    }
+
+    // Executed when the async work is complete
+    // this function will be run inside the main event loop
+    // so it is safe to use V8 again
+    void HandleOKCallback () {
+        Nan::HandleScope scope;
+
+        if (onResult) {
+            Local<Value> argv[] = {
+                Nan::Null()
+            };
+            callback->Call(1, argv);
+            return;
+        }
+
+        Local<Array> list = Nan::New<Array>(results.size());
+        for (size_t i = 0; i < results.size(); i++) {
+            SlaveResult &result = results[i];
+            Local<Object> entry = Nan::New<Object>();
+
+            Nan::Set(entry, Nan::New("address").ToLocalChecked(), Nan::New<String>(result.addr_str).ToLocalChecked());
+            if (result.error.empty()) {
+                Nan::Set(entry, Nan::New("data").ToLocalChecked(), reply_value(format, result.data, &(result.frameData)));
+                result.data = NULL;
+            } else {
+                Nan::Set(entry, Nan::New("error").ToLocalChecked(), Nan::New<String>(result.error).ToLocalChecked());
+            }
+            Nan::Set(list, i, entry);
+        }
+
+        Local<Value> argv[] = {
+            Nan::Null(),
+            list
+        };
+        callback->Call(2, argv);
+    };
+
+    void HandleErrorCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Error(ErrorMessage())
+        };
+
+        callback->Call(1, argv);
+    }
+private:
+    Nan::Callback *onResult;
+    std::vector<SlaveResult> results;
+    mbus_handle *handle;
+    int max_frames;
+    int format;
+};
+
+NAN_METHOD(MbusMaster::GetMany) {
+    Nan::HandleScope scope;
+
+    MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
+
+    Local<Array> list = info[0].As<Array>();
+    int max_frames = (int)Nan::To<int64_t>(info[1]).FromJust();
+    int result_format = get_result_format(info[2]);
+    Nan::Callback *onResult = info[3]->IsFunction() ? new Nan::Callback(info[3].As<Function>()) : NULL;
+    Nan::Callback *callback = new Nan::Callback(info[4].As<Function>());
+
+    if(obj->connected && obj->reactor) {
+        delete onResult;
+        Local<Value> argv[] = {
+            Nan::Error("Not supported in reactor mode")
+        };
+        callback->Call(1, argv);
+    } else if(obj->connected) {
+        std::vector<char*> addresses;
+        for (uint32_t i = 0; i < list->Length(); i++) {
+            addresses.push_back(get(Nan::Get(list, i).ToLocalChecked(), "0"));
+        }
+
+        RecieveManyWorker *worker = new RecieveManyWorker(callback, onResult, addresses, obj->handle, max_frames, result_format, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        obj->busThread->Queue(worker);
+    } else {
+        delete onResult;
+        Local<Value> argv[] = {
+            Nan::Error("Not connected to port")
+        };
+        callback->Call(1, argv);
+    }
+}
+
+// one frame of a streamed reply
+struct StreamFrame {
+    int index;
+    char *data;
+    FrameData frameData;
+};
+
+class StreamWorker : public Nan::AsyncProgressQueueWorker<StreamFrame*>, public AbortableJob {
+public:
+    StreamWorker(Nan::Callback *callback, Nan::Callback *onFrame, char *addr_str, mbus_handle *handle, int max_frames, int format, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncProgressQueueWorker<StreamFrame*>(callback), AbortableJob(control), onFrame(onFrame), addr_str(addr_str), handle(handle), max_frames(max_frames), format(format), frame_cnt(0), progress(NULL) {}
+    ~StreamWorker() {
+        free(addr_str);
+        delete onFrame;
+    }
+
+    // called by mbus_sendrecv_request for every received frame (bus thread)
+    static void FrameEvent(mbus_handle *handle, mbus_frame *frame) {
+        ((StreamWorker *)((JobControl *)handle->user_data)->Current())->SendFrame(frame);
+    }
+
+    void SendFrame(mbus_frame *frame) {
+        StreamFrame *part = new StreamFrame;
+        char error[100];
+
+        part->index = frame_cnt++;
+        part->data = NULL;
+
+        if (format_reply(frame, format, addr_str, &(part->data), &(part->frameData), error) != 0) {
+            frame_error = error;
+            delete part;
+            return;
+        }
+        progress->Send(&part, 1);
+    }
+
+    // Executed inside the bus thread.
+    // It is not safe to access V8, or V8 data structures
+    // here, so everything we need for input and output
+    // should go on `this`.
+    void Execute (const ExecutionProgress& progress) {
+        JobControl::Active active(control.get(), id, this);
+        mbus_frame reply;
+        char error[100];
+
+        if (Aborted()) {
+            SetErrorMessage(ABORT_MESSAGE);
+            return;
+        }
 
-        if (mbus_connect(obj->handle) == -1)
+        memset((void *)&reply, 0, sizeof(mbus_frame));
+
+        if (init_slaves(handle) == 0)
         {
-            mbus_context_free(obj->handle);
-            obj->handle = NULL;
-            info.GetReturnValue().Set(Nan::False());
+            sprintf(error, "Failed to init slaves.");
+            SetErrorMessage(error);
             return;
         }
 
-        if (mbus_serial_set_baudrate(obj->handle, boudrate) == -1)
+        this->progress = &progress;
+        mbus_register_frame_event(handle, FrameEvent);
+
+        // frames that were received before an error are already delivered
+        if (request_slave_data(handle, addr_str, max_frames, &reply, error) != 0)
         {
-            mbus_disconnect(obj->handle);
-            mbus_context_free(obj->handle);
-            obj->handle = NULL;
-            info.GetReturnValue().Set(Nan::False());
-            return;
+            SetErrorMessage(Aborted() ? ABORT_MESSAGE : error);
+        }
+        else if (!frame_error.empty())
+        {
+            SetErrorMessage(frame_error.c_str());
         }
 
-        obj->connected = true;
-        obj->communicationInProgress = false;
-        info.GetReturnValue().Set(Nan::True());
-        return;
+        mbus_register_frame_event(handle, NULL);
+
+        // manual free
+        mbus_frame_free((mbus_frame*)reply.next);
     }
-    info.GetReturnValue().Set(Nan::False());
-}
 
-NAN_METHOD(MbusMaster::Close) {
+    // Executed inside the main event loop for every received frame
+    void HandleProgressCallback (StreamFrame *const *parts, size_t count) {
+        Nan::HandleScope scope;
+
+        for (size_t i = 0; i < count; i++) {
+            StreamFrame *part = parts[i];
+
+            Local<Value> argv[] = {
+                reply_value(format, part->data, &(part->frameData)),
+                Nan::New<Number>(part->index)
+            };
+            delete part;
+            onFrame->Call(2, argv);
+        }
+    }
+
+    // Executed when the async work is complete
+    // this function will be run inside the main event loop
+    // so it is safe to use V8 again
+    void HandleOKCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Null()
+        };
+        callback->Call(1, argv);
+    };
+
+    void HandleErrorCallback () {
+        Nan::HandleScope scope;
+
+        Local<Value> argv[] = {
+            Nan::Error(ErrorMessage())
+        };
+
+        callback->Call(1, argv);
+    }
+private:
+    Nan::Callback *onFrame;
+    char *addr_str;
+    mbus_handle *handle;
+    int max_frames;
+    int format;
+    int frame_cnt;
+    std::string frame_error;
+    const ExecutionProgress *progress;
+};
+
+NAN_METHOD(MbusMaster::GetStream) {
     Nan::HandleScope scope;
 
     MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
 
-    if(obj->communicationInProgress) {
-        info.GetReturnValue().Set(Nan::False());
-        return;
+    char *address = get(Nan::To<v8::String>(info[0]).ToLocalChecked(),"0");
+    int max_frames = (int)Nan::To<int64_t>(info[1]).FromJust();
+    int result_format = get_result_format(info[2]);
+    Nan::Callback *onFrame = new Nan::Callback(info[3].As<Function>());
+    Nan::Callback *callback = new Nan::Callback(info[4].As<Function>());
+
+    if(obj->connected && obj->reactor) {
+        free(address);
+        delete onFrame;
+        Local<Value> argv[] = {
+            Nan::Error("Not supported in reactor mode")
+        };
+        callback->Call(1, argv);
+    } else if(obj->connected) {
+        StreamWorker *worker = new StreamWorker(callback, onFrame, address, obj->handle, max_frames, result_format, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        obj->busThread->Queue(worker);
+    } else {
+        free(address);
+        delete onFrame;
+        Local<Value> argv[] = {
+            Nan::Error("Not connected to port")
+        };
+        callback->Call(1, argv);
     }
+}
 
-    if(obj->connected) {
-        mbus_disconnect(obj->handle);
-        mbus_context_free(obj->handle);
-        obj->handle = NULL;
-        obj->connected = false;
-        obj->communicationInProgress = false;
-        info.GetReturnValue().Set(Nan::True());
+// packed bytes of the frames of a reply for getRaw
+class RawFrames {
+public:
+    RawFrames() {}
+    ~RawFrames() {
+        // frames that were not handed over to a Buffer
+        for (size_t i = 0; i < frames.size(); i++) {
+            free(frames[i].data);
+        }
     }
-    else {
-        info.GetReturnValue().Set(Nan::False());
+
+    // Executed inside the bus/reactor thread.
+    bool Pack(mbus_frame *reply, char *error) {
+        for (mbus_frame *frame = reply; frame; frame = (mbus_frame *)frame->next) {
+            RawFrame raw;
+
+            raw.timestamp = frame->timestamp;
+            raw.data = (unsigned char *)malloc(MBUS_FRAME_DATA_LENGTH + 10);
+            if (raw.data == NULL) {
+                sprintf(error, "Failed to allocate frame buffer.");
+                return false;
+            }
+            if ((raw.length = mbus_frame_pack(frame, raw.data, MBUS_FRAME_DATA_LENGTH + 10)) == -1) {
+                free(raw.data);
+                sprintf(error, "Failed to pack mbus frame.");
+                return false;
+            }
+            frames.push_back(raw);
+        }
+        return true;
     }
-}
 
-static int init_slaves(mbus_handle *handle)
-{
+    // Executed inside the main event loop, the Buffers take over the memory.
+    Local<Array> ToArray() {
+        Local<Array> list = Nan::New<Array>(frames.size());
 
-    if (mbus_send_ping_frame(handle, MBUS_ADDRESS_NETWORK_LAYER, 1) == -1)
-    {
-        return 0;
+        for (size_t i = 0; i < frames.size(); i++) {
+            Local<Object> entry = Nan::New<Object>();
+
+            Nan::Set(entry, Nan::New("index").ToLocalChecked(), Nan::New<Number>(i));
+            Nan::Set(entry, Nan::New("timestamp").ToLocalChecked(), Nan::New<v8::Date>(frames[i].timestamp * 1000.0).ToLocalChecked());
+            Nan::Set(entry, Nan::New("data").ToLocalChecked(), Nan::NewBuffer((char *)frames[i].data, frames[i].length, FreeData, NULL).ToLocalChecked());
+            frames[i].data = NULL;
+            Nan::Set(list, i, entry);
+        }
+        return list;
     }
 
-    if (mbus_send_ping_frame(handle, MBUS_ADDRESS_NETWORK_LAYER, 1) == -1)
-    {
-        return 0;
+private:
+    struct RawFrame {
+        unsigned char *data;
+        int length;
+        time_t timestamp;
+    };
+
+    static void FreeData(char *data, void * /* hint */) {
+        free(data);
     }
 
-    return 1;
-}
+    std::vector<RawFrame> frames;
+};
 
-class RecieveWorker : public Nan::AsyncWorker {
+class RawWorker : public Nan::AsyncWorker, public AbortableJob {
 public:
-    RecieveWorker(Nan::Callback *callback,char *addr_str,uv_rwlock_t *lock, mbus_handle *handle, bool *communicationInProgress, int max_frames)
-    : Nan::AsyncWorker(callback), addr_str(addr_str), lock(lock), handle(handle), communicationInProgress(communicationInProgress), max_frames(max_frames){}
-    ~RecieveWorker() {
+    RawWorker(Nan::Callback *callback, char *addr_str, mbus_handle *handle, int max_frames, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncWorker(callback), AbortableJob(control), addr_str(addr_str), handle(handle), max_frames(max_frames) {}
+    ~RawWorker() {
         free(addr_str);
     }
 
-    // Executed inside the worker-thread.
+    // Executed inside the bus thread.
     // It is not safe to access V8, or V8 data structures
     // here, so everything we need for input and output
     // should go on `this`.
     void Execute () {
-        uv_rwlock_wrlock(lock);
-
+        JobControl::Active active(control.get(), id, this);
         mbus_frame reply;
         char error[100];
-        int address;
-        int secondary_selected = 0;
-        int request_frame_res;
+
+        if (Aborted()) {
+            SetErrorMessage(ABORT_MESSAGE);
+            return;
+        }
 
         memset((void *)&reply, 0, sizeof(mbus_frame));
 
@@ -258,101 +1039,78 @@ public:
         {
             sprintf(error, "Failed to init slaves.");
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
-        if (mbus_is_secondary_address(addr_str))
+        if (request_slave_data(handle, addr_str, max_frames, &reply, error) != 0 ||
+            !frames.Pack(&reply, error))
         {
-            // secondary addressing
+            SetErrorMessage(Aborted() ? ABORT_MESSAGE : error);
+        }
 
-            int ret;
+        // manual free
+        mbus_frame_free((mbus_frame*)reply.next);
+    }
 
-            ret = mbus_select_secondary_address(handle, addr_str);
+    // Executed when the async work is complete
+    // this function will be run inside the main event loop
+    // so it is safe to use V8 again
+    void HandleOKCallback () {
+        Nan::HandleScope scope;
 
-            if (ret == MBUS_PROBE_COLLISION)
-            {
-                sprintf(error, "The address mask [%s] matches more than one device.", addr_str);
-                SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
-                return;
-            }
-            else if (ret == MBUS_PROBE_NOTHING)
-            {
-                sprintf(error, "The selected secondary address does not match any device [%s].", addr_str);
-                SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
-                return;
-            }
-            else if (ret == MBUS_PROBE_ERROR)
-            {
-                sprintf(error, "Failed to select secondary address [%s].", addr_str);
-                SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
-                return;
-            }
-            else if (ret == MBUS_PROBE_SINGLE)
-            {
-                secondary_selected = 1;
-            }
+        Local<Value> argv[] = {
+            Nan::Null(),
+            frames.ToArray()
+        };
+        callback->Call(2, argv);
+    };
 
-            address = MBUS_ADDRESS_NETWORK_LAYER;
-        }
-        else
-        {
-            // primary addressing
-            address = atoi(addr_str);
+    void HandleErrorCallback () {
+        Nan::HandleScope scope;
 
-            // send a reset SND_NKE to the device before requesting data
-            // this does not make sense for devices that are accessed by secondary addressing
-            // as the reset de-selects the device
-            // taken from https://github.com/rscada/libmbus/pull/95
-            if (mbus_send_ping_frame(handle, address, 1) == -1)
-            {
-                sprintf(error, "Failed to initialize slave[%s].", addr_str);
-                SetErrorMessage(error);
+        Local<Value> argv[] = {
+            Nan::Error(ErrorMessage())
+        };
 
-                // manual free
-                mbus_frame_free((mbus_frame*)reply.next);
+        callback->Call(1, argv);
+    }
+private:
+    RawFrames frames;
+    char *addr_str;
+    mbus_handle *handle;
+    int max_frames;
+};
 
-                uv_rwlock_wrunlock(lock);
-                return;
-            }
-        }
+#ifdef __linux__
+// getRaw in reactor mode, the reactor drives the ReadoutJob part
+class ReactorRawWorker : public Nan::AsyncWorker, public ReadoutJob, public AbortableJob {
+public:
+    ReactorRawWorker(Nan::Callback *callback, char *addr_str, mbus_handle *handle, int max_frames, int timeout, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncWorker(callback), ReadoutJob(handle, addr_str, max_frames, timeout, this), AbortableJob(control) {
+        free(addr_str);
+    }
 
-        // instead of the send and recv, use this sendrecv function that
-        // takes care of the possibility of multi-telegram replies (limit = 16 frames)
-        if (mbus_sendrecv_request(handle, address, &reply, max_frames) != 0)
-        {
-            sprintf(error, "Failed to send/receive M-Bus request frame[%s].", addr_str);
-            SetErrorMessage(error);
+    // not used, the job is executed by the reactor
+    void Execute () {
+    }
 
-            // manual free
-            mbus_frame_free((mbus_frame*)reply.next);
+    // Executed inside the reactor thread when the readout has finished.
+    void Done () {
+        char error[100];
 
-            uv_rwlock_wrunlock(lock);
+        if (Aborted()) {
+            SetErrorMessage(ABORT_MESSAGE);
             return;
         }
 
-        //
-        // generate XML
-        //
-        if ((data = mbus_frame_xml(&reply)) == NULL)
-        {
-            sprintf(error, "Failed to generate XML representation of MBUS frame [%s].", addr_str);
-            SetErrorMessage(error);
-
-            // manual free
-			mbus_frame_free((mbus_frame*)reply.next);
-
-            uv_rwlock_wrunlock(lock);
+        if (!ReadoutJob::error.empty()) {
+            SetErrorMessage(ReadoutJob::error.c_str());
             return;
         }
 
-        // manual free
-        mbus_frame_free((mbus_frame*)reply.next);
-
-        uv_rwlock_wrunlock(lock);
+        if (!frames.Pack(Reply(), error)) {
+            SetErrorMessage(error);
+        }
     }
 
     // Executed when the async work is complete
@@ -361,21 +1119,16 @@ public:
     void HandleOKCallback () {
         Nan::HandleScope scope;
 
-        *communicationInProgress = false;
-
         Local<Value> argv[] = {
             Nan::Null(),
-            Nan::New<String>(data).ToLocalChecked()
+            frames.ToArray()
         };
-        free(data);
         callback->Call(2, argv);
     };
 
     void HandleErrorCallback () {
         Nan::HandleScope scope;
 
-        *communicationInProgress = false;
-
         Local<Value> argv[] = {
             Nan::Error(ErrorMessage())
         };
@@ -383,15 +1136,16 @@ public:
         callback->Call(1, argv);
     }
 private:
-    char *data;
-    char *addr_str;
-    int max_frames;
-    uv_rwlock_t *lock;
-    mbus_handle *handle;
-    bool *communicationInProgress;
+    // Executed inside the reactor thread before each request frame.
+    bool AbortRequested () {
+        return Aborted();
+    }
+
+    RawFrames frames;
 };
+#endif
 
-NAN_METHOD(MbusMaster::Get) {
+NAN_METHOD(MbusMaster::GetRaw) {
     Nan::HandleScope scope;
 
     MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
@@ -400,28 +1154,61 @@ NAN_METHOD(MbusMaster::Get) {
     int max_frames = (int)Nan::To<int64_t>(info[1]).FromJust();
     Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
 
-    char num_char[10 + sizeof(char)];
-    std::sprintf(num_char, "%d", max_frames);
-    MBUS_ERROR("[INFO] Max frames = %s \n", num_char);
-
-    if(obj->connected) {
-        obj->communicationInProgress = true;
-
-        Nan::AsyncQueueWorker(new RecieveWorker(callback, address, &(obj->queueLock), obj->handle, &(obj->communicationInProgress), max_frames));
+    if(obj->connected && obj->reactor) {
+#ifdef __linux__
+        ReactorRawWorker *worker = new ReactorRawWorker(callback, address, obj->handle, max_frames, obj->timeout, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        Reactor::Get()->Queue(worker);
+#endif
+    } else if(obj->connected) {
+        RawWorker *worker = new RawWorker(callback, address, obj->handle, max_frames, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        obj->busThread->Queue(worker);
     } else {
+        free(address);
         Local<Value> argv[] = {
             Nan::Error("Not connected to port")
         };
         callback->Call(1, argv);
     }
-    info.GetReturnValue().SetUndefined();
 }
 
-class ScanSecondaryWorker : public Nan::AsyncWorker {
+// progress or found device of a ScanSecondaryWorker
+struct ScanEvent {
+    bool found;
+    char address[17];   // probed mask or found secondary address
+};
+
+class ScanSecondaryWorker : public Nan::AsyncProgressQueueWorker<ScanEvent>, public AbortableJob {
 public:
-    ScanSecondaryWorker(Nan::Callback *callback,uv_rwlock_t *lock, mbus_handle *handle, bool *communicationInProgress)
-    : Nan::AsyncWorker(callback), lock(lock), handle(handle), communicationInProgress(communicationInProgress) {}
+    ScanSecondaryWorker(Nan::Callback *callback, Nan::Callback *onProgress, Nan::Callback *onFound, mbus_handle *handle, const std::shared_ptr<JobControl> &control)
+    : Nan::AsyncProgressQueueWorker<ScanEvent>(callback), AbortableJob(control), onProgress(onProgress), onFound(onFound), handle(handle), progress(NULL) {}
     ~ScanSecondaryWorker() {
+        delete onProgress;
+        delete onFound;
+    }
+
+    // called by the scan before every probe (bus thread)
+    static void ScanProgress(mbus_handle *handle, const char *mask) {
+        ((ScanSecondaryWorker *)((JobControl *)handle->user_data)->Current())->SendEvent(false, mask);
+    }
+
+    // called by mbus_probe_secondary_address for every found device (bus thread)
+    static void FoundEvent(mbus_handle *handle, mbus_frame *frame) {
+        char buff[32];
+        char *addr = mbus_frame_get_secondary_address_r(frame, buff, sizeof(buff));
+
+        if (addr) {
+            ((ScanSecondaryWorker *)((JobControl *)handle->user_data)->Current())->SendEvent(true, addr);
+        }
+    }
+
+    void SendEvent(bool found, const char *address) {
+        ScanEvent event;
+
+        event.found = found;
+        snprintf(event.address, sizeof(event.address), "%s", address);
+        progress->Send(&event, 1);
     }
 
     //------------------------------------------------------------------------------
@@ -468,7 +1255,11 @@ public:
             if (pos < 15)
             {
                 // mask[pos] is not a wildcard -> don't iterate, recursively check pos+1
-                Scan2ndAddressRange(handle, pos+1, mask);
+                if (Scan2ndAddressRange(handle, pos+1, mask) == -1)
+                {
+                    free(mask);
+                    return -1;
+                }
             }
             else
             {
@@ -485,6 +1276,12 @@ public:
             {
                 mask[pos] = '0'+i;
 
+                if (handle->abort_check && handle->abort_check(handle))
+                {
+                    free(mask);
+                    return -1;
+                }
+
                 if (handle->scan_progress)
                     handle->scan_progress(handle,mask);
 
@@ -502,7 +1299,11 @@ public:
                 else if (probe_ret == MBUS_PROBE_COLLISION)
                 {
                     // collision, more than one device matching, restrict the search mask further
-                    Scan2ndAddressRange(handle, pos+1, mask);
+                    if (Scan2ndAddressRange(handle, pos+1, mask) == -1)
+                    {
+                        free(mask);
+                        return -1;
+                    }
                 }
                 else if (probe_ret == MBUS_PROBE_NOTHING)
                 {
@@ -511,6 +1312,7 @@ public:
                 else // MBUS_PROBE_ERROR
                 {
                     MBUS_ERROR("%s: Failed to probe secondary address [%s].\n", __PRETTY_FUNCTION__, mask);
+                    free(mask);
                     return -1;
                 }
             }
@@ -520,13 +1322,12 @@ public:
         return 0;
     }
 
-    // Executed inside the worker-thread.
+    // Executed inside the bus thread.
     // It is not safe to access V8, or V8 data structures
     // here, so everything we need for input and output
     // should go on `this`.
-    void Execute () {
-        uv_rwlock_wrlock(lock);
-
+    void Execute (const ExecutionProgress& progress) {
+        JobControl::Active active(control.get(), id, this);
         mbus_frame *frame = NULL, reply;
         char error[100];
         char mask[17];
@@ -541,32 +1342,58 @@ public:
         {
             sprintf(error, "Failed to allocate mbus frame.");
             free(frame);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
+        // the scan selects many devices, start from a reset bus
+        mbus_slave_session_reset(handle, -1);
         if (init_slaves(handle) == 0)
         {
             free(frame);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
         data = strdup("[ ");
 
+        this->progress = &progress;
+        if (onProgress) {
+            mbus_register_scan_progress(handle, ScanProgress);
+        }
+        if (onFound) {
+            mbus_register_found_event(handle, FoundEvent);
+        }
+
         int ret = Scan2ndAddressRange(handle, 0, mask);
 
+        mbus_register_scan_progress(handle, NULL);
+        mbus_register_found_event(handle, NULL);
+
         if (ret == -1)
         {
             sprintf(error,"Failed to probe secondary address %s", mask);
-            SetErrorMessage(error);
+            SetErrorMessage(Aborted() ? ABORT_MESSAGE : error);
             free(data);
-            uv_rwlock_wrunlock(lock);
             return;
         }
         data[strlen(data) - 1] = ']';
         data[strlen(data)] = '\0';
-        uv_rwlock_wrunlock(lock);
+    }
+
+    // Executed inside the main event loop for every probe and found device,
+    // before the final callback
+    void HandleProgressCallback (const ScanEvent *events, size_t count) {
+        Nan::HandleScope scope;
+
+        for (size_t i = 0; i < count; i++) {
+            Local<Value> argv[] = {
+                Nan::New<String>(events[i].address).ToLocalChecked()
+            };
+            if (events[i].found) {
+                onFound->Call(1, argv);
+            } else {
+                onProgress->Call(1, argv);
+            }
+        }
     }
 
     // Executed when the async work is complete
@@ -575,8 +1402,6 @@ public:
     void HandleOKCallback () {
         Nan::HandleScope scope;
 
-        *communicationInProgress = false;
-
         Local<Value> argv[] = {
             Nan::Null(),
             Nan::New<String>(data).ToLocalChecked()
@@ -588,18 +1413,17 @@ public:
     void HandleErrorCallback () {
         Nan::HandleScope scope;
 
-        *communicationInProgress = false;
-
         Local<Value> argv[] = {
             Nan::Error(ErrorMessage())
         };
         callback->Call(1, argv);
     }
 private:
+    Nan::Callback *onProgress;
+    Nan::Callback *onFound;
     char *data;
-    uv_rwlock_t *lock;
     mbus_handle *handle;
-    bool *communicationInProgress;
+    const ExecutionProgress *progress;
 };
 
 NAN_METHOD(MbusMaster::ScanSecondary) {
@@ -607,35 +1431,43 @@ NAN_METHOD(MbusMaster::ScanSecondary) {
 
     MbusMaster* obj = node::ObjectWrap::Unwrap<MbusMaster>(info.This());
 
-    Nan::Callback *callback = new Nan::Callback(info[0].As<Function>());
-    if(obj->connected) {
-        obj->communicationInProgress = true;
-
-        Nan::AsyncQueueWorker(new ScanSecondaryWorker(callback, &(obj->queueLock), obj->handle, &(obj->communicationInProgress)));
+    Nan::Callback *onProgress = info[0]->IsFunction() ? new Nan::Callback(info[0].As<Function>()) : NULL;
+    Nan::Callback *onFound = info[1]->IsFunction() ? new Nan::Callback(info[1].As<Function>()) : NULL;
+    Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
+    if(obj->connected && obj->reactor) {
+        delete onProgress;
+        delete onFound;
+        Local<Value> argv[] = {
+            Nan::Error("Not supported in reactor mode")
+        };
+        callback->Call(1, argv);
+    } else if(obj->connected) {
+        ScanSecondaryWorker *worker = new ScanSecondaryWorker(callback, onProgress, onFound, obj->handle, obj->control);
+        info.GetReturnValue().Set(worker->Id());
+        obj->busThread->Queue(worker);
     } else {
+        delete onProgress;
+        delete onFound;
         Local<Value> argv[] = {
             Nan::Error("Not connected to port")
         };
         callback->Call(1, argv);
     }
-    info.GetReturnValue().SetUndefined();
 }
 
 class SetPrimaryWorker : public Nan::AsyncWorker {
 public:
-    SetPrimaryWorker(Nan::Callback *callback, char *old_addr_str, int new_address, uv_rwlock_t *lock, mbus_handle *handle, bool *communicationInProgress)
-    : Nan::AsyncWorker(callback), old_addr_str(old_addr_str), new_address(new_address), lock(lock), handle(handle), communicationInProgress(communicationInProgress) {}
+    SetPrimaryWorker(Nan::Callback *callback, char *old_addr_str, int new_address, mbus_handle *handle)
+    : Nan::AsyncWorker(callback), old_addr_str(old_addr_str), new_address(new_address), handle(handle) {}
     ~SetPrimaryWorker() {
         free(old_addr_str);
     }
 
-    // Executed inside the worker-thread.
+    // Executed inside the bus thread.
     // It is not safe to access V8, or V8 data structures
     // here, so everything we need for input and output
     // should go on `this`.
     void Execute () {
-        uv_rwlock_wrlock(lock);
-
         mbus_frame reply;
         char error[150];
         int old_address;
@@ -645,7 +1477,6 @@ public:
         {
             sprintf(error, "Invalid new primary address");
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
@@ -656,23 +1487,22 @@ public:
             case MBUS_ADDRESS_BROADCAST_NOREPLY:
                 sprintf(error, "Invalid new primary address");
                 SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
                 return;
         }
 
+        // the addresses change, start from a reset bus
+        mbus_slave_session_reset(handle, -1);
         if (init_slaves(handle) == 0)
         {
             sprintf(error, "Failed to init slaves.");
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
         if (mbus_send_ping_frame(handle, new_address, 0) == -1)
         {
-            sprintf(error, "Verification failed. Could not send ping frame: %s", mbus_error_str());
+            snprintf(error, sizeof(error), "Verification failed. Could not send ping frame: %s", mbus_handle_error_str(handle));
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
@@ -680,7 +1510,6 @@ public:
         {
             sprintf(error, "Verification failed. Got a response from new address");
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
@@ -694,21 +1523,18 @@ public:
             {
                 sprintf(error, "The address mask [%s] matches more than one device.", old_addr_str);
                 SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
                 return;
             }
             else if (ret == MBUS_PROBE_NOTHING)
             {
                 sprintf(error, "The selected secondary address does not match any device [%s].", old_addr_str);
                 SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
                 return;
             }
             else if (ret == MBUS_PROBE_ERROR)
             {
                 sprintf(error, "Failed to select secondary address [%s].", old_addr_str);
                 SetErrorMessage(error);
-                uv_rwlock_wrunlock(lock);
                 return;
             }
 
@@ -722,9 +1548,8 @@ public:
 
         if (mbus_set_primary_address(handle, old_address, new_address) == -1)
         {
-            sprintf(error, "Failed to send set primary address frame: %s", mbus_error_str());
+            snprintf(error, sizeof(error), "Failed to send set primary address frame: %s", mbus_handle_error_str(handle));
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
 
@@ -735,7 +1560,6 @@ public:
         {
             sprintf(error, "No reply from device");
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
         else if (mbus_frame_type(&reply) != MBUS_FRAME_TYPE_ACK)
@@ -743,7 +1567,6 @@ public:
             sprintf(error, "Unknown reply from Device (%d)", mbus_frame_type(&reply));
             //mbus_frame_print(&reply);
             SetErrorMessage(error);
-            uv_rwlock_wrunlock(lock);
             return;
         }
         else
@@ -751,7 +1574,6 @@ public:
             //printf("Set primary address of device to %d", new_address);
             // Success
         }
-        uv_rwlock_wrunlock(lock);
     }
 
     // Executed when the async work is complete
@@ -760,8 +1582,6 @@ public:
     void HandleOKCallback () {
         Nan::HandleScope scope;
 
-        *communicationInProgress = false;
-
         Local<Value> argv[] = {
             Nan::Null()
         };
@@ -771,8 +1591,6 @@ public:
     void HandleErrorCallback () {
         Nan::HandleScope scope;
 
-        *communicationInProgress = false;
-
         Local<Value> argv[] = {
             Nan::Error(ErrorMessage())
         };
@@ -782,9 +1600,7 @@ public:
 private:
     char *old_addr_str;
     int new_address;
-    uv_rwlock_t *lock;
     mbus_handle *handle;
-    bool *communicationInProgress;
 };
 
 NAN_METHOD(MbusMaster::SetPrimaryId) {
@@ -795,10 +1611,13 @@ NAN_METHOD(MbusMaster::SetPrimaryId) {
     char *oldAddress = get(Nan::To<v8::String>(info[0]).ToLocalChecked(),"0");
     int newAddress = (int)Nan::To<int64_t>(info[1]).FromJust();
     Nan::Callback *callback = new Nan::Callback(info[2].As<Function>());
-    if(obj->connected) {
-        obj->communicationInProgress = true;
-
-        Nan::AsyncQueueWorker(new SetPrimaryWorker(callback, oldAddress, newAddress, &(obj->queueLock), obj->handle, &(obj->communicationInProgress)));
+    if(obj->connected && obj->reactor) {
+        Local<Value> argv[] = {
+            Nan::Error("Not supported in reactor mode")
+        };
+        callback->Call(1, argv);
+    } else if(obj->connected) {
+        obj->busThread->Queue(new SetPrimaryWorker(callback, oldAddress, newAddress, obj->handle));
     } else {
         Local<Value> argv[] = {
             Nan::Error("Not connected to port")
@@ -817,7 +1636,7 @@ NAN_GETTER(MbusMaster::HandleGetters) {
         info.GetReturnValue().Set(obj->connected);
     }
     else if (propertyName == "communicationInProgress") {
-        info.GetReturnValue().Set(obj->communicationInProgress);
+        info.GetReturnValue().Set(obj->PendingJobs() > 0);
     } else {
         info.GetReturnValue().Set(Nan::Undefined());
     }
@@ -5,6 +5,10 @@
 #include <mbus.h>
 #include <uv.h>
 #include <nan.h>
+#include <memory>
+
+class BusThread;
+class JobControl;
 
 class MbusMaster : public node::ObjectWrap {
 public:
@@ -20,17 +24,28 @@ private:
     static NAN_METHOD(Close);
     static NAN_METHOD(ScanSecondary);
     static NAN_METHOD(Get);
+    static NAN_METHOD(GetMany);
+    static NAN_METHOD(GetStream);
+    static NAN_METHOD(GetRaw);
     static NAN_METHOD(SetPrimaryId);
+    static NAN_METHOD(Abort);
+    static NAN_METHOD(SetAdaptiveTimeout);
+    static NAN_METHOD(SetPurgePolicy);
 
     static NAN_GETTER(HandleGetters);
     static NAN_SETTER(HandleSetters);
 
     static Nan::Persistent<v8::Function> constructor;
 
+    int PendingJobs();
+    void RegisterControl();
+
     bool connected;
-    bool communicationInProgress;
     mbus_handle *handle;
-    uv_rwlock_t queueLock;
+    BusThread *busThread;
+    std::shared_ptr<JobControl> control;
+    bool reactor;
+    int timeout;
     bool serial;
 };
 
@@ -0,0 +1,233 @@
+#include "reactor.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define MAX_EVENTS 64
+
+ReactorJob::ReactorJob(int fd, Nan::AsyncWorker *worker)
+: fd(fd), events(0), deadline(0), finished(false), worker(worker), next(NULL) {
+}
+
+ReactorJob::~ReactorJob() {
+}
+
+uint64_t ReactorJob::Now() {
+    return uv_hrtime() / 1000000;
+}
+
+#ifdef __linux__
+
+Reactor::Reactor() : epfd(-1), wakefd(-1), pendingTotal(0) {
+}
+
+Reactor *Reactor::Get() {
+    static Reactor *reactor = NULL;
+
+    if (reactor == NULL) {
+        reactor = new Reactor();
+        if (!reactor->Start()) {
+            delete reactor;
+            reactor = NULL;
+        }
+    }
+    return reactor;
+}
+
+bool Reactor::Start() {
+    struct epoll_event ev;
+
+    if ((epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        return false;
+    }
+    if ((wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+        close(epfd);
+        return false;
+    }
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, wakefd, &ev);
+
+    uv_async_init(Nan::GetCurrentEventLoop(), &async, OnAsync);
+    async.data = this;
+    // only keep the loop alive while jobs are pending
+    uv_unref((uv_handle_t *)&async);
+
+    // the reactor lives as long as the process
+    uv_thread_create(&thread, Run, this);
+    return true;
+}
+
+void Reactor::Queue(ReactorJob *job) {
+    uint64_t one = 1;
+
+    pending[job->fd]++;
+    if (pendingTotal++ == 0) {
+        uv_ref((uv_handle_t *)&async);
+    }
+    submitted.Push(job);
+    if (write(wakefd, &one, sizeof(one)) != sizeof(one)) {
+        // counter is already signaled
+    }
+}
+
+int Reactor::Pending(int fd) {
+    std::map<int, int>::iterator it = pending.find(fd);
+    return it == pending.end() ? 0 : it->second;
+}
+
+// Executed inside the reactor thread.
+void Reactor::Activate(ReactorJob *job) {
+    struct epoll_event ev;
+
+    ev.events = 0;
+    ev.data.ptr = job;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, job->fd, &ev);
+
+    job->Start();
+    Update(job);
+}
+
+// Executed inside the reactor thread.
+void Reactor::Update(ReactorJob *job) {
+    struct epoll_event ev;
+
+    if (!job->finished) {
+        ev.events = job->events;
+        ev.data.ptr = job;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, job->fd, &ev);
+        return;
+    }
+
+    int fd = job->fd;
+
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, &ev);
+    job->Done();
+    completed.Push(job);
+    uv_async_send(&async);
+
+    std::deque<ReactorJob*> &queue = buses[fd];
+    queue.pop_front();
+    if (queue.empty()) {
+        buses.erase(fd);
+    } else {
+        Activate(queue.front());
+    }
+}
+
+// Executed inside the reactor thread.
+void Reactor::Run(void *arg) {
+    Reactor *self = (Reactor *)arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    for (;;) {
+        int timeout = -1;
+        uint64_t now = ReactorJob::Now();
+
+        for (std::map<int, std::deque<ReactorJob*> >::iterator it = self->buses.begin(); it != self->buses.end(); ++it) {
+            ReactorJob *job = it->second.front();
+            if (job->deadline == 0) {
+                continue;
+            }
+            int wait = job->deadline > now ? (int)(job->deadline - now) : 0;
+            if (timeout == -1 || wait < timeout) {
+                timeout = wait;
+            }
+        }
+
+        int n = epoll_wait(self->epfd, events, MAX_EVENTS, timeout);
+        if (n == -1 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            ReactorJob *job = (ReactorJob *)events[i].data.ptr;
+
+            if (job == NULL) {
+                uint64_t value;
+                if (read(self->wakefd, &value, sizeof(value)) != sizeof(value)) {
+                    // nothing signaled
+                }
+
+                for (job = self->submitted.Take(); job; ) {
+                    ReactorJob *next = job->next;
+                    std::deque<ReactorJob*> &queue = self->buses[job->fd];
+                    queue.push_back(job);
+                    if (queue.size() == 1) {
+                        self->Activate(job);
+                    }
+                    job = next;
+                }
+                continue;
+            }
+
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                job->Readable();
+            }
+            if (!job->finished && (events[i].events & EPOLLOUT)) {
+                job->Writable();
+            }
+            self->Update(job);
+        }
+
+        // a finished job may have activated the next one, so collect the
+        // expired jobs first
+        now = ReactorJob::Now();
+        std::deque<ReactorJob*> expired;
+        for (std::map<int, std::deque<ReactorJob*> >::iterator it = self->buses.begin(); it != self->buses.end(); ++it) {
+            ReactorJob *job = it->second.front();
+            if (job->deadline != 0 && job->deadline <= now) {
+                expired.push_back(job);
+            }
+        }
+        for (size_t i = 0; i < expired.size(); i++) {
+            expired[i]->deadline = 0;
+            expired[i]->Timeout();
+            self->Update(expired[i]);
+        }
+    }
+}
+
+// Executed inside the main event loop.
+void Reactor::Complete() {
+    ReactorJob *job = completed.Take();
+
+    while (job) {
+        ReactorJob *next = job->next;
+        if (--pending[job->fd] == 0) {
+            pending.erase(job->fd);
+        }
+        if (--pendingTotal == 0) {
+            uv_unref((uv_handle_t *)&async);
+        }
+        job->worker->WorkComplete();
+        job->worker->Destroy();
+        job = next;
+    }
+}
+
+void Reactor::OnAsync(uv_async_t *handle) {
+    Nan::HandleScope scope;
+
+    ((Reactor *)handle->data)->Complete();
+}
+
+#else
+
+Reactor *Reactor::Get() {
+    return NULL;
+}
+
+void Reactor::Queue(ReactorJob *job) {
+}
+
+int Reactor::Pending(int fd) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <node.h>
+#include <uv.h>
+#include <nan.h>
+#include <stdint.h>
+#include <map>
+#include <deque>
+#include "job-list.h"
+
+// Non-blocking job of one bus driven by the reactor thread. The job tells the
+// reactor what it waits for with `events` (EPOLLIN/EPOLLOUT) and `deadline`,
+// and sets `finished` when it is done.
+class ReactorJob {
+public:
+    ReactorJob(int fd, Nan::AsyncWorker *worker);
+    virtual ~ReactorJob();
+
+    // Executed inside the reactor thread.
+    virtual void Start() = 0;
+    virtual void Readable() = 0;
+    virtual void Writable() = 0;
+    virtual void Timeout() = 0;
+    // called once after the job has finished, before the completion is posted
+    virtual void Done() {}
+
+    static uint64_t Now();
+
+    int fd;
+    uint32_t events;
+    uint64_t deadline;  // ms of Now(), 0 when no timeout is pending
+    bool finished;
+    Nan::AsyncWorker *worker;
+    ReactorJob *next;
+};
+
+// One thread with epoll over the file descriptors of all buses that were
+// opened in reactor mode. Jobs of the same bus are executed in order, jobs of
+// different buses run concurrently. The number of threads stays constant no
+// matter how many buses are served.
+class Reactor {
+public:
+    // Returns the process wide reactor, NULL if not supported on this platform
+    static Reactor *Get();
+
+    // Must be called from the main thread
+    void Queue(ReactorJob *job);
+    // Number of queued or running jobs of the bus with this fd (main thread)
+    int Pending(int fd);
+
+private:
+    Reactor();
+
+    bool Start();
+    static void Run(void *arg);
+    static void OnAsync(uv_async_t *handle);
+    void Activate(ReactorJob *job);
+    void Update(ReactorJob *job);
+    void Complete();
+
+    uv_thread_t thread;
+    uv_async_t async;
+    int epfd;
+    int wakefd;
+    JobList<ReactorJob> submitted;
+    JobList<ReactorJob> completed;
+
+    // only used by the reactor thread
+    std::map<int, std::deque<ReactorJob*> > buses;
+
+    // only used by the main thread
+    std::map<int, int> pending;
+    int pendingTotal;
+};
+
+#endif
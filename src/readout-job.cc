@@ -0,0 +1,62 @@
+#include "readout-job.h"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+
+ReadoutJob::ReadoutJob(mbus_handle *handle, const char *addr_str, int max_frames, int timeout, Nan::AsyncWorker *worker)
+: ReactorJob(handle->fd, worker), addr_str(addr_str) {
+    mbus_transaction_request(&transaction, handle, addr_str, max_frames, timeout, MBUS_TRANSACTION_INIT_SLAVES);
+}
+
+ReadoutJob::~ReadoutJob() {
+    mbus_transaction_free(&transaction);
+}
+
+void ReadoutJob::Select(const std::string &selection) {
+    mbus_transaction_set_selection(&transaction, (const unsigned char *)selection.data(), selection.size());
+}
+
+// copy the state of the transaction for the reactor
+void ReadoutJob::Update() {
+    events = (transaction.want_read ? (uint32_t)EPOLLIN : 0u) | (transaction.want_write ? (uint32_t)EPOLLOUT : 0u);
+    deadline = transaction.timeout_at;
+    finished = transaction.done != 0;
+    if (finished && transaction.result != 0) {
+        error = transaction.error;
+    }
+}
+
+void ReadoutJob::Start() {
+    mbus_transaction_start(&transaction, Now());
+    Update();
+}
+
+void ReadoutJob::Readable() {
+    if (AbortRequested()) {
+        mbus_transaction_cancel(&transaction);
+    } else {
+        mbus_transaction_on_readable(&transaction, Now());
+    }
+    Update();
+}
+
+void ReadoutJob::Writable() {
+    if (AbortRequested()) {
+        mbus_transaction_cancel(&transaction);
+    } else {
+        mbus_transaction_on_writable(&transaction, Now());
+    }
+    Update();
+}
+
+void ReadoutJob::Timeout() {
+    if (AbortRequested()) {
+        mbus_transaction_cancel(&transaction);
+    } else {
+        mbus_transaction_on_timeout(&transaction, Now());
+    }
+    Update();
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef READOUTJOB_H
+#define READOUTJOB_H
+
+#include <mbus.h>
+#include <mbus-transaction.h>
+#include <string>
+#include "reactor.h"
+
+// getData sequence (init slaves, select the slave, request the data incl.
+// multi-telegram replies) for the reactor. The libmbus transaction does the
+// work, this only maps its want_read/want_write/timeout_at to epoll.
+class ReadoutJob : public ReactorJob {
+public:
+    ReadoutJob(mbus_handle *handle, const char *addr_str, int max_frames, int timeout, Nan::AsyncWorker *worker);
+    ~ReadoutJob();
+
+    // readout selection records (SND_UD) sent before the request
+    void Select(const std::string &selection);
+
+    void Start();
+    void Readable();
+    void Writable();
+    void Timeout();
+
+    mbus_frame *Reply() { return &(transaction.reply); } // valid when error is empty
+
+    std::string error;  // empty on success
+
+protected:
+    // polled before every step, an abort fails the job
+    virtual bool AbortRequested() { return false; }
+
+    std::string addr_str;
+
+private:
+    void Update();
+
+    mbus_transaction transaction;
+};
+
+#endif